@@ -0,0 +1,161 @@
+/* Copyright (c) 2011-2014 ETH Zürich. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ *    * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *    * Neither the names of ETH Zürich nor the names of other contributors 
+ *      may be used to endorse or promote products derived from this software 
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL ETH 
+ * ZURICH BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, 
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, 
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR 
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY 
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** Run the libfc microbenchmarks.
+ *
+ * Syntax: fcbench [-f filter] [-o file] [-t seconds] [-r repetitions]
+ *
+ * Runs all registered benchmarks (or those whose names contain the
+ * filter string), prints a table to stderr and writes the results as
+ * JSON to the given file, or to stdout.  See bench/README for the
+ * format.
+ */
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include <getopt.h>
+
+#if defined(_libfc_HAVE_LOG4CPLUS_)
+#  include <log4cplus/configurator.h>
+#endif /* defined(_libfc_HAVE_LOG4CPLUS_) */
+
+#include "Benchmark.h"
+#include "InfoModel.h"
+
+static int help_flag = false;
+static std::string filter;
+static const char* output_file_name = 0;
+static double min_time = 0.5;
+static unsigned int repetitions = 5;
+
+static void parse_options(int argc, char* const* argv) {
+  while (1) {
+    static struct option options[] = {
+      { "filter", required_argument, 0, 'f' },
+      { "help", no_argument, &help_flag, 1 },
+      { "output", required_argument, 0, 'o' },
+      { "repetitions", required_argument, 0, 'r' },
+      { "min-time", required_argument, 0, 't' },
+      { 0, 0, 0, 0 },
+    };
+
+    int option_index = 0;
+
+    int c = getopt_long(argc, argv, "f:ho:r:t:", options, &option_index);
+
+    if (c == -1)
+      break;
+
+    switch(c) {
+    case 0:
+      break;
+    case 'f':
+      filter = optarg;
+      break;
+    case 'h':
+      help_flag = 1;
+      break;
+    case 'o':
+      output_file_name = optarg;
+      break;
+    case 'r':
+      repetitions = atoi(optarg);
+      if (repetitions == 0) {
+        std::cerr << "Need at least one repetition, got " << optarg
+                  << std::endl;
+        exit(EXIT_FAILURE);
+      }
+      break;
+    case 't':
+      min_time = atof(optarg);
+      if (min_time <= 0) {
+        std::cerr << "Minimum time must be positive, got " << optarg
+                  << std::endl;
+        exit(EXIT_FAILURE);
+      }
+      break;
+    default:
+      std::cerr << "Unrecognised option character '" << c 
+                << "', aborting" << std::endl;
+      exit(EXIT_FAILURE);
+    }
+  }
+}
+
+static void help() {
+  std::cerr << "usage: ./fcbench [options]" << std::endl
+            << "Options:" << std::endl
+            << "  -f s|--filter=s\trun only benchmarks whose name contains S"
+            << std::endl
+            << "  -o file|--output=file" << std::endl
+            << "\twrite JSON results to FILE instead of stdout" << std::endl
+            << "  -t s|--min-time=s\trun each repetition for at least S seconds"
+            << std::endl
+            << "  -r n|--repetitions=n\treport the median of N repetitions"
+            << std::endl
+            << "  -h|--help\tprint this help text" << std::endl;
+}
+
+int main(int argc, char* const* argv) {
+#if defined(_libfc_HAVE_LOG4CPLUS_)
+  log4cplus::PropertyConfigurator config("log4cplus.properties");
+  config.configure();
+#endif /* defined(_libfc_HAVE_LOG4CPLUS_) */
+
+  parse_options(argc, argv);
+
+  if (help_flag) {
+    help();
+    return EXIT_SUCCESS;
+  }
+
+  libfc::InfoModel::instance().defaultIPFIX();
+
+  libfc::bench::Runner runner(min_time, repetitions);
+  unsigned int n_run;
+  if (output_file_name != 0) {
+    std::ofstream json(output_file_name);
+    if (!json) {
+      std::cerr << "Can't create " << output_file_name << std::endl;
+      return EXIT_FAILURE;
+    }
+    n_run = runner.run(filter, json);
+    json.close();
+    if (!json) {
+      std::cerr << "Can't write " << output_file_name << std::endl;
+      return EXIT_FAILURE;
+    }
+  } else
+    n_run = runner.run(filter, std::cout);
+
+  if (n_run == 0) {
+    std::cerr << "No benchmark matches \"" << filter << "\"" << std::endl;
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
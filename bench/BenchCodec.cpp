@@ -0,0 +1,144 @@
+/* Copyright (c) 2011-2014 ETH Zürich. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ *    * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *    * Neither the names of ETH Zürich nor the names of other contributors 
+ *      may be used to endorse or promote products derived from this software 
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL ETH 
+ * ZURICH BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, 
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, 
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR 
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY 
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* Benchmarks for record decoding and encoding, for each workload. */
+
+#include <cassert>
+#include <vector>
+
+#include "Benchmark.h"
+#include "Constants.h"
+#include "DecodePlan.h"
+#include "ExportDestination.h"
+#include "PlacementExporter.h"
+#include "Workload.h"
+
+using namespace libfc;
+using namespace libfc::bench;
+
+/** Discards messages; used to time encoding alone. */
+class NullExportDestination : public ExportDestination {
+public:
+  ssize_t writev(const std::vector< ::iovec>& iovecs) {
+    size_t n = 0;
+    for (auto i = iovecs.begin(); i != iovecs.end(); ++i)
+      n += i->iov_len;
+    return n;
+  }
+
+  int flush() {
+    return 0;
+  }
+
+  bool is_connectionless() const {
+    return false;
+  }
+
+  size_t preferred_maximum_message_size() const {
+    return kMaxMessageLen;
+  }
+};
+
+static void
+decode_plan_construct(State& state, const std::string& name) {
+  Workload w(name);
+  state.reset_timer();
+
+  for (uint64_t i = 0; i < state.iterations(); ++i) {
+    DecodePlan plan(&w.placement(), &w.wire_template());
+    do_not_optimize(plan);
+  }
+}
+
+static void
+decode_plan_execute(State& state, const std::string& name) {
+  /* Few enough that the buffer fits into a data set. */
+  static const unsigned int n_records = 512;
+
+  Workload w(name);
+  DecodePlan plan(&w.placement(), &w.wire_template());
+  std::vector<uint8_t> records = w.make_records(n_records);
+  assert(records.size() <= kMaxMessageLen);
+  state.set_bytes_per_iteration(w.record_size());
+  state.reset_timer();
+
+  const uint8_t* begin = records.data();
+  const uint8_t* end = begin + records.size();
+  const uint8_t* cur = begin;
+  for (uint64_t i = 0; i < state.iterations(); ++i) {
+    cur += plan.execute(cur, end - cur);
+    if (cur == end)
+      cur = begin;
+  }
+  do_not_optimize(w.placement());
+}
+
+static void
+place_values(State& state, const std::string& name) {
+  Workload w(name);
+  NullExportDestination d;
+  PlacementExporter e(d, 1);
+  state.set_bytes_per_iteration(w.record_size());
+  state.reset_timer();
+
+  for (uint64_t i = 0; i < state.iterations(); ++i)
+    e.place_values(&w.placement());
+}
+
+static struct RegisterCodecBenchmarks {
+  RegisterCodecBenchmarks() {
+    const std::vector<std::string>& names = Workload::names();
+    for (auto n = names.begin(); n != names.end(); ++n) {
+      std::string name = *n;
+      register_benchmark("DecodePlan/construct/" + name,
+                         [name](State& state) {
+                           decode_plan_construct(state, name);
+                         });
+      register_benchmark("DecodePlan/execute/" + name,
+                         [name](State& state) {
+                           decode_plan_execute(state, name);
+                         });
+      register_benchmark("PlacementExporter/place_values/" + name,
+                         [name](State& state) {
+                           place_values(state, name);
+                         });
+    }
+  }
+} register_codec_benchmarks;
+
+/* Alternating between two templates makes the exporter start a new
+ * data set and build a new EncodePlan for every record, so this is
+ * dominated by EncodePlan construction. */
+FC_BENCHMARK("EncodePlan/construct") {
+  Workload w4("ipv4");
+  Workload w6("ipv6");
+  NullExportDestination d;
+  PlacementExporter e(d, 1);
+  state.reset_timer();
+
+  for (uint64_t i = 0; i < state.iterations(); ++i)
+    e.place_values(i % 2 == 0 ? &w4.placement() : &w6.placement());
+}
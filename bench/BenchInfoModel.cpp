@@ -0,0 +1,89 @@
+/* Copyright (c) 2011-2014 ETH Zürich. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ *    * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *    * Neither the names of ETH Zürich nor the names of other contributors 
+ *      may be used to endorse or promote products derived from this software 
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL ETH 
+ * ZURICH BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, 
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, 
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR 
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY 
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* Benchmarks for IE lookup and template matching. */
+
+#include <vector>
+
+#include "Benchmark.h"
+#include "InfoModel.h"
+#include "Workload.h"
+
+using namespace libfc;
+using namespace libfc::bench;
+
+static const char* ie_names[] = {
+  "octetDeltaCount", "packetDeltaCount", "protocolIdentifier",
+  "sourceTransportPort", "sourceIPv4Address", "destinationTransportPort",
+  "destinationIPv4Address", "sourceIPv6Address", "destinationIPv6Address",
+  "flowStartMilliseconds", "flowEndMilliseconds", "interfaceName",
+  "ingressInterface", "egressInterface", "tcpControlBits", "vlanId",
+};
+static const unsigned int n_ie_names = sizeof(ie_names)/sizeof(ie_names[0]);
+
+FC_BENCHMARK("InfoModel/lookupIE/name") {
+  InfoModel& model = InfoModel::instance();
+  for (uint64_t i = 0; i < state.iterations(); ++i)
+    do_not_optimize(model.lookupIE(ie_names[i % n_ie_names]));
+}
+
+FC_BENCHMARK("InfoModel/lookupIE/spec") {
+  InfoModel& model = InfoModel::instance();
+  std::vector<std::string> specs;
+  for (unsigned int i = 0; i < n_ie_names; ++i)
+    specs.push_back(model.lookupIE(ie_names[i])->toIESpec());
+  state.reset_timer();
+
+  for (uint64_t i = 0; i < state.iterations(); ++i)
+    do_not_optimize(model.lookupIE(specs[i % n_ie_names]));
+}
+
+/* This is what happens for every field of every incoming template. */
+FC_BENCHMARK("InfoModel/lookupIE/number") {
+  InfoModel& model = InfoModel::instance();
+  std::vector<const InfoElement*> ies;
+  for (unsigned int i = 0; i < n_ie_names; ++i)
+    ies.push_back(model.lookupIE(ie_names[i]));
+  state.reset_timer();
+
+  for (uint64_t i = 0; i < state.iterations(); ++i) {
+    const InfoElement* ie = ies[i % n_ie_names];
+    do_not_optimize(model.lookupIE(ie->pen(), ie->number(), ie->len()));
+  }
+}
+
+FC_BENCHMARK("PlacementTemplate/is_match/hit") {
+  Workload w("ipv4");
+  for (uint64_t i = 0; i < state.iterations(); ++i)
+    do_not_optimize(w.placement().is_match(&w.wire_template(), 0));
+}
+
+FC_BENCHMARK("PlacementTemplate/is_match/miss") {
+  Workload w4("ipv4");
+  Workload w6("ipv6");
+  for (uint64_t i = 0; i < state.iterations(); ++i)
+    do_not_optimize(w6.placement().is_match(&w4.wire_template(), 0));
+}
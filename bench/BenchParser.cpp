@@ -0,0 +1,159 @@
+/* Copyright (c) 2011-2014 ETH Zürich. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ *    * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *    * Neither the names of ETH Zürich nor the names of other contributors 
+ *      may be used to endorse or promote products derived from this software 
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL ETH 
+ * ZURICH BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, 
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, 
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR 
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY 
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* Benchmarks for message deframing. */
+
+#include <vector>
+
+#include "Benchmark.h"
+#include "BufferInputSource.h"
+#include "Constants.h"
+#include "ContentHandler.h"
+#include "ExportDestination.h"
+#include "IPFIXMessageStreamParser.h"
+#include "PlacementExporter.h"
+#include "V9MessageStreamParser.h"
+#include "Workload.h"
+
+using namespace libfc;
+using namespace libfc::bench;
+
+/** Collects messages in memory. */
+class MemoryExportDestination : public ExportDestination {
+public:
+  ssize_t writev(const std::vector< ::iovec>& iovecs) {
+    size_t n = 0;
+    for (auto i = iovecs.begin(); i != iovecs.end(); ++i) {
+      const uint8_t* p = static_cast<const uint8_t*>(i->iov_base);
+      contents.insert(contents.end(), p, p + i->iov_len);
+      n += i->iov_len;
+    }
+    return n;
+  }
+
+  int flush() {
+    return 0;
+  }
+
+  bool is_connectionless() const {
+    return false;
+  }
+
+  size_t preferred_maximum_message_size() const {
+    return kMaxMessageLen;
+  }
+
+  std::vector<uint8_t> contents;
+};
+
+/** Counts sets and does nothing else. */
+class CountingContentHandler : public ContentHandler {
+public:
+  CountingContentHandler() : n_sets(0) {
+  }
+
+  std::shared_ptr<ErrorContext> start_session() { libfc_RETURN_OK(); }
+  std::shared_ptr<ErrorContext> end_session() { libfc_RETURN_OK(); }
+  std::shared_ptr<ErrorContext> start_message(uint16_t version,
+                                              uint16_t length,
+                                              uint32_t export_time,
+                                              uint32_t sequence_number,
+                                              uint32_t observation_domain,
+                                              uint64_t base_time) {
+    libfc_RETURN_OK();
+  }
+  std::shared_ptr<ErrorContext> end_message() { libfc_RETURN_OK(); }
+  std::shared_ptr<ErrorContext> start_template_set(uint16_t set_id,
+                                                   uint16_t set_length,
+                                                   const uint8_t* buf) {
+    n_sets++;
+    libfc_RETURN_OK();
+  }
+  std::shared_ptr<ErrorContext> end_template_set() { libfc_RETURN_OK(); }
+  std::shared_ptr<ErrorContext> start_options_template_set(
+      uint16_t set_id, uint16_t set_length, const uint8_t* buf) {
+    n_sets++;
+    libfc_RETURN_OK();
+  }
+  std::shared_ptr<ErrorContext> end_options_template_set() {
+    libfc_RETURN_OK();
+  }
+  std::shared_ptr<ErrorContext> start_data_set(uint16_t id, uint16_t length,
+                                               const uint8_t* buf) {
+    n_sets++;
+    libfc_RETURN_OK();
+  }
+  std::shared_ptr<ErrorContext> end_data_set() { libfc_RETURN_OK(); }
+
+  uint64_t n_sets;
+};
+
+/** Makes a message stream of ipv4 records, alternating between two
+ * domains every few records so that there are many small sets. */
+static std::vector<uint8_t>
+make_stream(uint16_t version, unsigned int n_records) {
+  Workload w("ipv4");
+  MemoryExportDestination d;
+  {
+    PlacementExporter e1(d, 1);
+    PlacementExporter e2(d, 2);
+    e1.set_protocol_version(version);
+    e2.set_protocol_version(version);
+    e1.set_export_time(1400000000);
+    e2.set_export_time(1400000000);
+    for (unsigned int i = 0; i < n_records; ++i)
+      (i % 64 < 48 ? e1 : e2).place_values(&w.placement());
+  }
+  return d.contents;
+}
+
+static void
+deframe(State& state, MessageStreamParser& parser, uint16_t version) {
+  static const unsigned int n_records = 100000;
+
+  std::vector<uint8_t> stream = make_stream(version, n_records);
+  CountingContentHandler handler;
+  parser.set_content_handler(&handler);
+  state.set_items_per_iteration(n_records);
+  state.set_bytes_per_iteration(stream.size());
+  state.reset_timer();
+
+  for (uint64_t i = 0; i < state.iterations(); ++i) {
+    BufferInputSource is(stream.data(), stream.size());
+    parser.parse(is);
+  }
+  do_not_optimize(handler.n_sets);
+}
+
+FC_BENCHMARK("IPFIXMessageStreamParser/deframe") {
+  IPFIXMessageStreamParser parser;
+  deframe(state, parser, kIpfixVersion);
+}
+
+FC_BENCHMARK("V9MessageStreamParser/deframe") {
+  V9MessageStreamParser parser;
+  deframe(state, parser, kV9Version);
+}
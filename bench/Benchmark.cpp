@@ -0,0 +1,219 @@
+/* Copyright (c) 2011-2014 ETH Zürich. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ *    * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *    * Neither the names of ETH Zürich nor the names of other contributors 
+ *      may be used to endorse or promote products derived from this software 
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL ETH 
+ * ZURICH BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, 
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, 
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR 
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY 
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#include "Benchmark.h"
+
+namespace libfc {
+
+  namespace bench {
+
+    State::State(uint64_t _iterations)
+      : n_iterations(_iterations),
+        items_per_iteration(1),
+        bytes_per_iteration(0),
+        start(Clock::now()) {
+    }
+
+    uint64_t State::iterations() const {
+      return n_iterations;
+    }
+
+    void State::reset_timer() {
+      start = Clock::now();
+    }
+
+    double State::elapsed_ns() const {
+      return std::chrono::duration<double, std::nano>(
+        Clock::now() - start).count();
+    }
+
+    void State::set_items_per_iteration(uint64_t items) {
+      items_per_iteration = items;
+    }
+
+    void State::set_bytes_per_iteration(uint64_t bytes) {
+      bytes_per_iteration = bytes;
+    }
+
+    struct Benchmark {
+      std::string name;
+      std::function<void(State&)> function;
+    };
+
+    /* A function-local static, so that registrars in other
+     * translation units can't run before the vector is constructed. */
+    static std::vector<Benchmark>& benchmarks() {
+      static std::vector<Benchmark> ret;
+      return ret;
+    }
+
+    void register_benchmark(const std::string& name,
+                            std::function<void(State&)> function) {
+      Benchmark b = { name, function };
+      benchmarks().push_back(b);
+    }
+
+    /** Runs a benchmark once.
+     *
+     * @return the elapsed time in nanoseconds
+     */
+    static double run_once(const Benchmark& b, State& state) {
+      state.reset_timer();
+      b.function(state);
+      return state.elapsed_ns();
+    }
+
+    static std::string json_string(const std::string& s) {
+      std::string ret = "\"";
+      for (auto c = s.begin(); c != s.end(); ++c) {
+        if (*c == '"' || *c == '\\')
+          ret += '\\';
+        ret += *c;
+      }
+      return ret + "\"";
+    }
+
+    Runner::Runner(double _min_time, unsigned int _repetitions)
+      : min_time(_min_time), repetitions(_repetitions) {
+    }
+
+    unsigned int Runner::run(const std::string& filter, std::ostream& json) {
+      char host_name[256] = "unknown";
+      (void) gethostname(host_name, sizeof(host_name) - 1);
+
+      char date[32];
+      time_t now = time(0);
+      struct tm tm;
+      gmtime_r(&now, &tm);
+      strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", &tm);
+
+      json << "{" << std::endl
+           << "  \"context\": {" << std::endl
+           << "    \"date\": " << json_string(date) << "," << std::endl
+           << "    \"host_name\": " << json_string(host_name) << ","
+           << std::endl
+           << "    \"num_cpus\": " << std::thread::hardware_concurrency()
+           << "," << std::endl
+#if defined(_libfc_HAVE_LOG4CPLUS_)
+           << "    \"log4cplus\": true," << std::endl
+#else
+           << "    \"log4cplus\": false," << std::endl
+#endif /* defined(_libfc_HAVE_LOG4CPLUS_) */
+           << "    \"min_time\": " << min_time << "," << std::endl
+           << "    \"repetitions\": " << repetitions << std::endl
+           << "  }," << std::endl
+           << "  \"benchmarks\": [";
+
+      std::cerr << std::left << std::setw(48) << "benchmark" << std::right
+                << std::setw(12) << "iterations"
+                << std::setw(12) << "ns/iter"
+                << std::setw(14) << "items/s"
+                << std::setw(10) << "MB/s" << std::endl;
+
+      unsigned int n_run = 0;
+      for (auto b = benchmarks().begin(); b != benchmarks().end(); ++b) {
+        if (!filter.empty() && b->name.find(filter) == std::string::npos)
+          continue;
+
+        /* Find an iteration count that takes at least min_time, but
+         * don't grow it by more than a factor of 100 at a time, in
+         * case the first iterations were unrepresentative. */
+        uint64_t n = 1;
+        double ns = 0;
+        while (true) {
+          State state(n);
+          ns = run_once(*b, state);
+          if (ns >= min_time * 1e9)
+            break;
+          double factor = ns > 0 ? 1.2 * min_time * 1e9 / ns : 100;
+          factor = std::min(std::max(factor, 2.0), 100.0);
+          n = static_cast<uint64_t>(std::ceil(n * factor));
+        }
+
+        std::vector<double> times;
+        uint64_t items = 1;
+        uint64_t bytes = 0;
+        for (unsigned int r = 0; r < repetitions; ++r) {
+          State state(n);
+          times.push_back(run_once(*b, state) / n);
+          items = state.items_per_iteration;
+          bytes = state.bytes_per_iteration;
+        }
+        std::sort(times.begin(), times.end());
+        double median = times[times.size()/2];
+        if (times.size() % 2 == 0)
+          median = (median + times[times.size()/2 - 1]) / 2;
+
+        double items_per_second = items * 1e9 / median;
+        double bytes_per_second = bytes * 1e9 / median;
+
+        std::cerr << std::left << std::setw(48) << b->name << std::right
+                  << std::setw(12) << n
+                  << std::fixed << std::setprecision(1)
+                  << std::setw(12) << median
+                  << std::setprecision(0)
+                  << std::setw(14) << items_per_second
+                  << std::setprecision(1)
+                  << std::setw(10) << bytes_per_second / 1e6
+                  << std::endl;
+
+        json << (n_run == 0 ? "" : ",") << std::endl
+             << "    {" << std::endl
+             << "      \"name\": " << json_string(b->name) << "," << std::endl
+             << "      \"iterations\": " << n << "," << std::endl
+             << std::setprecision(3) << std::fixed
+             << "      \"ns_per_iteration\": " << median << "," << std::endl
+             << "      \"min_ns_per_iteration\": " << times.front() << ","
+             << std::endl
+             << "      \"max_ns_per_iteration\": " << times.back() << ","
+             << std::endl
+             << std::setprecision(0)
+             << "      \"items_per_iteration\": " << items << "," << std::endl
+             << "      \"items_per_second\": " << items_per_second << ","
+             << std::endl
+             << "      \"bytes_per_second\": " << bytes_per_second
+             << std::endl
+             << "    }";
+        n_run++;
+      }
+
+      json << std::endl << "  ]" << std::endl << "}" << std::endl;
+      return n_run;
+    }
+
+  } // namespace bench
+
+} // namespace libfc
@@ -0,0 +1,169 @@
+/* Hi Emacs, please use -*- mode: C++; -*- */
+/* Copyright (c) 2011-2014 ETH Zürich. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ *    * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *    * Neither the names of ETH Zürich nor the names of other contributors 
+ *      may be used to endorse or promote products derived from this software 
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL ETH 
+ * ZURICH BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, 
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, 
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR 
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY 
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ * @author Stephan Neuhaus <neuhaust@tik.ee.ethz.ch>
+ */
+
+#ifndef _libfc_BENCHMARK_H_
+#  define _libfc_BENCHMARK_H_
+
+#  include <chrono>
+#  include <cstdint>
+#  include <functional>
+#  include <string>
+
+namespace libfc {
+
+  namespace bench {
+
+    /** What a running benchmark sees of the runner.
+     *
+     * A benchmark function runs its operation iterations() times.
+     * The runner times the entire call; expensive setup that should
+     * not be measured goes before a call to reset_timer().  If one
+     * iteration processes more than one item (records, lookups), or
+     * a known number of octets, the benchmark says so, and the
+     * runner reports throughput as well as time per iteration.
+     */
+    class State {
+    public:
+      typedef std::chrono::steady_clock Clock;
+
+      explicit State(uint64_t iterations);
+
+      /** Returns the number of iterations to run. */
+      uint64_t iterations() const;
+
+      /** Restarts the clock, excluding everything before the call
+       * from the measurement. */
+      void reset_timer();
+
+      /** Returns the time since the timer was last reset, in
+       * nanoseconds. */
+      double elapsed_ns() const;
+
+      /** Sets the number of items processed by one iteration. */
+      void set_items_per_iteration(uint64_t items);
+
+      /** Sets the number of octets processed by one iteration. */
+      void set_bytes_per_iteration(uint64_t bytes);
+
+    private:
+      friend class Runner;
+
+      uint64_t n_iterations;
+      uint64_t items_per_iteration;
+      uint64_t bytes_per_iteration;
+      Clock::time_point start;
+    };
+
+    /** Registers a benchmark.
+     *
+     * Benchmarks are usually registered by defining a static
+     * Registrar, which is what FC_BENCHMARK does.  Names are
+     * hierarchical, like Boost.Test names: "DecodePlan/execute/ipv4"
+     * is the ipv4 variant of the DecodePlan execution benchmark.
+     *
+     * @param name the benchmark's name
+     * @param function the benchmark
+     */
+    void register_benchmark(const std::string& name,
+                            std::function<void(State&)> function);
+
+    /** Registers a benchmark at static initialisation time. */
+    class Registrar {
+    public:
+      Registrar(const std::string& name,
+                std::function<void(State&)> function) {
+        register_benchmark(name, function);
+      }
+    };
+
+    /** Runs benchmarks and writes their results. */
+    class Runner {
+    public:
+      /** Creates a runner.
+       *
+       * @param min_time the minimum time, in seconds, that one
+       *   repetition of a benchmark should take; the runner
+       *   increases the number of iterations until it does
+       * @param repetitions the number of timed repetitions; the
+       *   reported time is their median
+       */
+      Runner(double min_time, unsigned int repetitions);
+
+      /** Runs all benchmarks whose names contain a filter string,
+       * printing a table to stderr and writing JSON to a stream.
+       *
+       * @param filter run only benchmarks whose name contains this
+       *   string, or all benchmarks if it is empty
+       * @param json where to write the JSON results
+       *
+       * @return the number of benchmarks run
+       */
+      unsigned int run(const std::string& filter, std::ostream& json);
+
+    private:
+      double min_time;
+      unsigned int repetitions;
+    };
+
+    /** Keeps the compiler from optimising away the computation of a
+     * value. */
+    template<typename T>
+    inline void do_not_optimize(const T& value) {
+      asm volatile("" : : "g"(&value) : "memory");
+    }
+
+  } // namespace bench
+
+} // namespace libfc
+
+#  define FC_BENCHMARK_CAT2(a, b) a ## b
+#  define FC_BENCHMARK_CAT(a, b) FC_BENCHMARK_CAT2(a, b)
+
+/** Defines and registers a benchmark.
+ *
+ * @code
+ * FC_BENCHMARK("InfoModel/lookupIE/name") {
+ *   for (uint64_t i = 0; i < state.iterations(); ++i)
+ *     do_not_optimize(InfoModel::instance().lookupIE("octetDeltaCount"));
+ * }
+ * @endcode
+ */
+#  define FC_BENCHMARK(name)                                          \
+  static void FC_BENCHMARK_CAT(fc_benchmark_, __LINE__)(              \
+    libfc::bench::State& state);                                      \
+  static libfc::bench::Registrar                                      \
+    FC_BENCHMARK_CAT(fc_benchmark_registrar_, __LINE__)(              \
+      name, FC_BENCHMARK_CAT(fc_benchmark_, __LINE__));               \
+  static void FC_BENCHMARK_CAT(fc_benchmark_, __LINE__)(              \
+    libfc::bench::State& state)
+
+#endif // _libfc_BENCHMARK_H_
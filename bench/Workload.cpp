@@ -0,0 +1,147 @@
+/* Copyright (c) 2011-2014 ETH Zürich. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ *    * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *    * Neither the names of ETH Zürich nor the names of other contributors 
+ *      may be used to endorse or promote products derived from this software 
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL ETH 
+ * ZURICH BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, 
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, 
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR 
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY 
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cassert>
+#include <cstring>
+#include <iostream>
+
+#include "Constants.h"
+#include "IEType.h"
+#include "InfoModel.h"
+#include "Workload.h"
+
+namespace libfc {
+
+  namespace bench {
+
+    /** Lengths of the two strings in the varlen workload. */
+    static const size_t string_lengths[] = { 12, 20 };
+
+    Workload::Workload(const std::string& name)
+      : fixed_values(16*16) {
+      /* Reduced-length fields. */
+      size_t counter_size = name == "reduced" ? 4 : 0;
+      size_t interface_size = name == "reduced" ? 2 : 0;
+
+      add("flowStartMilliseconds");
+      add("flowEndMilliseconds");
+      if (name == "ipv6") {
+        add("sourceIPv6Address");
+        add("destinationIPv6Address");
+      } else {
+        add("sourceIPv4Address");
+        add("destinationIPv4Address");
+      }
+      add("sourceTransportPort");
+      add("destinationTransportPort");
+      add("protocolIdentifier");
+      add("tcpControlBits");
+      add("octetDeltaCount", counter_size);
+      add("packetDeltaCount", counter_size);
+      add("ingressInterface", interface_size);
+      add("egressInterface", interface_size);
+      if (name == "varlen") {
+        add("interfaceName");
+        add("applicationName");
+      }
+
+      /* Values for export; the actual numbers don't matter much, but
+       * reduced-length fields must fit. */
+      for (size_t i = 0; i < fixed_values.size(); ++i)
+        fixed_values[i] = i % 8 < 3 ? (i * 37) & 0xff : 0;
+      size_t i = 0;
+      for (auto s = varlen_values.begin(); s != varlen_values.end(); ++s) {
+        std::string value(string_lengths[i++ % 2], 'x');
+        s->copy_content(reinterpret_cast<const uint8_t*>(value.data()),
+                        value.size());
+      }
+    }
+
+    const std::vector<std::string>& Workload::names() {
+      static const char* names[] = { "ipv4", "ipv6", "reduced", "varlen" };
+      static const std::vector<std::string> ret(
+        names, names + sizeof(names)/sizeof(names[0]));
+      return ret;
+    }
+
+    void Workload::add(const char* name, size_t size_on_wire) {
+      InfoModel& model = InfoModel::instance();
+      const InfoElement* ie = model.lookupIE(name);
+      if (ie == 0) {
+        std::cerr << "Workload needs unknown IE " << name << std::endl;
+        exit(EXIT_FAILURE);
+      }
+
+      if (size_on_wire == 0)
+        size_on_wire = ie->len();
+      wire.add(model.lookupIE(ie->pen(), ie->number(), size_on_wire));
+
+      size_t size = ie->ietype()->placedWidth();
+      if (size == 0) {
+        varlen_values.push_back(BasicOctetArray());
+        placement_template.register_placement(ie, &varlen_values.back(), 0);
+      } else {
+        assert(16*(wire.size() - 1) < fixed_values.size());
+        placement_template.register_placement(
+          ie, &fixed_values[16*(wire.size() - 1)],
+          size_on_wire == size ? 0 : size_on_wire);
+      }
+    }
+
+    const IETemplate& Workload::wire_template() const {
+      return wire;
+    }
+
+    PlacementTemplate& Workload::placement() {
+      return placement_template;
+    }
+
+    size_t Workload::record_size() const {
+      return make_records(1).size();
+    }
+
+    std::vector<uint8_t> Workload::make_records(unsigned int n_records) const {
+      std::vector<uint8_t> ret;
+      unsigned int n = 0;
+
+      for (unsigned int r = 0; r < n_records; ++r) {
+        unsigned int s = 0;
+        for (auto ie = wire.begin(); ie != wire.end(); ++ie) {
+          size_t len = (*ie)->len();
+          if (len == kIpfixVarlen) {
+            len = string_lengths[s++ % 2];
+            ret.push_back(len);
+          }
+          for (size_t i = 0; i < len; ++i)
+            ret.push_back(n++ * 131);
+        }
+      }
+      return ret;
+    }
+
+  } // namespace bench
+
+} // namespace libfc
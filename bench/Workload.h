@@ -0,0 +1,103 @@
+/* Hi Emacs, please use -*- mode: C++; -*- */
+/* Copyright (c) 2011-2014 ETH Zürich. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ *    * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *    * Neither the names of ETH Zürich nor the names of other contributors 
+ *      may be used to endorse or promote products derived from this software 
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL ETH 
+ * ZURICH BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, 
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, 
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR 
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY 
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ * @author Stephan Neuhaus <neuhaust@tik.ee.ethz.ch>
+ */
+
+#ifndef _libfc_WORKLOAD_H_
+#  define _libfc_WORKLOAD_H_
+
+#  include <cstdint>
+#  include <list>
+#  include <string>
+#  include <vector>
+
+#  include "BasicOctetArray.h"
+#  include "IETemplate.h"
+#  include "PlacementTemplate.h"
+
+namespace libfc {
+
+  namespace bench {
+
+    /** A mix of IE types for the codec benchmarks.
+     *
+     * A workload consists of a wire template, a placement template
+     * that places every field of the wire template, and values for
+     * these placements.  The mixes are
+     *
+     *   ipv4     an IPv4 flow record: timestamps, addresses, ports,
+     *            protocol and counters;
+     *   ipv6     the same with IPv6 addresses;
+     *   reduced  the IPv4 record with counters and interfaces sent
+     *            with reduced length;
+     *   varlen   the IPv4 record with two strings.
+     */
+    class Workload {
+    public:
+      /** Creates a workload.
+       *
+       * @param name one of the names returned by names()
+       */
+      explicit Workload(const std::string& name);
+
+      /** Returns the names of all workloads. */
+      static const std::vector<std::string>& names();
+
+      const IETemplate& wire_template() const;
+      PlacementTemplate& placement();
+
+      /** Returns the size of one encoded record. */
+      size_t record_size() const;
+
+      /** Encodes records for the wire template.
+       *
+       * @param n_records the number of records
+       *
+       * @return n_records data records, back to back
+       */
+      std::vector<uint8_t> make_records(unsigned int n_records) const;
+
+    private:
+      Workload(const Workload&);
+      Workload& operator=(const Workload&);
+
+      void add(const char* name, size_t size_on_wire = 0);
+
+      IETemplate wire;
+      PlacementTemplate placement_template;
+      std::vector<uint8_t> fixed_values;
+      std::list<BasicOctetArray> varlen_values;
+    };
+
+  } // namespace bench
+
+} // namespace libfc
+
+#endif // _libfc_WORKLOAD_H_
@@ -0,0 +1,94 @@
+# Copyright (c) 2011-2014 ETH Zürich. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without 
+# modification, are permitted provided that the following conditions are met:
+#    * Redistributions of source code must retain the above copyright
+#      notice, this list of conditions and the following disclaimer.
+#    * Redistributions in binary form must reproduce the above copyright
+#      notice, this list of conditions and the following disclaimer in the
+#      documentation and/or other materials provided with the distribution.
+#    * Neither the names of ETH Zürich nor the names of other contributors 
+#      may be used to endorse or promote products derived from this software
+#      without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+# "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+# A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL ETH 
+# ZURICH BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, 
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, 
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR 
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY 
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+# NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+# SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#
+
+# Generate a static IE table from a file of IESpecs.
+#
+# Run as a script:
+#
+#   cmake -DINPUT=iana.iespec -DOUTPUT=iana_ie_specs.cpp -DTABLE=iana \
+#         -P GenerateIETable.cmake
+#
+# INPUT has one complete IESpec per line, in the same format as the
+# spec files that programs load with InfoModel::add().  OUTPUT
+# defines the arrays ${TABLE}_ie_specs and n_${TABLE}_ie_specs
+# declared in lib/IESpecTable.h.
+#
+
+if (NOT INPUT OR NOT OUTPUT OR NOT TABLE)
+  message(FATAL_ERROR "GenerateIETable.cmake needs INPUT, OUTPUT and TABLE")
+endif ()
+
+get_filename_component(_input_name ${INPUT} NAME)
+file(STRINGS ${INPUT} _specs)
+
+set(_out "/* Generated by cmake/GenerateIETable.cmake from ${_input_name}.\n")
+set(_out "${_out} * Do not edit; edit ${_input_name} instead. */\n\n")
+set(_out "${_out}#include \"lib/IESpecTable.h\"\n\n")
+set(_out "${_out}namespace libfc {\n\n")
+set(_out "${_out}  const StaticIESpec ${TABLE}_ie_specs[] = {\n")
+
+set(_n 0)
+foreach (_spec ${_specs})
+  if (NOT _spec MATCHES "^([A-Za-z0-9_]+)\\(([0-9]+/)?([0-9]+)\\)<([A-Za-z0-9]+)>(\\[([0-9]+)\\])?$")
+    message(FATAL_ERROR "${_input_name}: not a complete IESpec: ${_spec}")
+  endif ()
+  set(_name ${CMAKE_MATCH_1})
+  set(_pen ${CMAKE_MATCH_2})
+  set(_number ${CMAKE_MATCH_3})
+  set(_type ${CMAKE_MATCH_4})
+  set(_len ${CMAKE_MATCH_6})
+
+  if (_pen)
+    string(REPLACE "/" "" _pen ${_pen})
+  else ()
+    set(_pen 0)
+  endif ()
+  if (NOT _len)
+    set(_len 0)
+  endif ()
+
+  # unsigned64 -> IEType::kUnsigned64
+  string(SUBSTRING ${_type} 0 1 _first)
+  string(SUBSTRING ${_type} 1 -1 _rest)
+  string(TOUPPER ${_first} _first)
+
+  set(_out "${_out}    { \"${_name}\", ${_pen}, ${_number}, IEType::k${_first}${_rest}, ${_len} },\n")
+  math(EXPR _n "${_n} + 1")
+endforeach ()
+
+set(_out "${_out}  };\n\n")
+set(_out "${_out}  const size_t n_${TABLE}_ie_specs = ${_n};\n\n")
+set(_out "${_out}} // namespace libfc\n")
+
+# Only touch the output if it changed, so that a reconfigure doesn't
+# force a rebuild.
+if (EXISTS ${OUTPUT})
+  file(READ ${OUTPUT} _old)
+  if (_old STREQUAL _out)
+    return()
+  endif ()
+endif ()
+file(WRITE ${OUTPUT} "${_out}")
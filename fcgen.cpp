@@ -0,0 +1,620 @@
+/* Copyright (c) 2011-2014 ETH Zürich. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ *    * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *    * The name of ETH Zürich nor the names of other contributors 
+ *      may be used to endorse or promote products derived from this software 
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL ETH 
+ * ZURICH BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, 
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, 
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR 
+ * PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER 
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR 
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF 
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE
+ */
+
+/** Generate synthetic IPFIX or Netflow v9 workloads.
+ *
+ * Syntax: fcgen [options] file
+ *
+ * Writes a file of flow records with random, but reproducible,
+ * content: the same options and seed always give the same file,
+ * byte for byte.  The records are placed through PlacementExporter,
+ * so the output exercises the same code paths as any other libfc
+ * exporter.  The workload is described by
+ *
+ *   a template mix     a comma-separated list of kind=weight, where
+ *                      kind is one of
+ *                        ipv4    IPv4 five-tuple flow records;
+ *                        ipv6    IPv6 five-tuple flow records;
+ *                        varlen  IPv4 flow records with two string
+ *                                IEs of varying length (IPFIX only);
+ *                      each record picks a template at random with
+ *                      probability proportional to its weight;
+ *   a varlen size      fixed:N, uniform:MIN:MAX or exp:MEAN, giving
+ *     distribution     the length of each string IE;
+ *   domains            the number of observation domains; each
+ *                      record goes to a random domain, each domain
+ *                      has its own exporter and templates;
+ *   template refresh   the number of messages after which an
+ *                      exporter sends its templates again.
+ *
+ * Records are stamped with a simulated clock that advances by a fixed
+ * amount per record, and message export times follow that clock, so
+ * the output does not depend on when it was generated.
+ *
+ * @author Stephan Neuhaus <neuhaust@tik.ee.ethz.ch>
+ */
+#include <cerrno>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <getopt.h>
+#include <unistd.h>
+
+#include "BasicOctetArray.h"
+#include "Constants.h"
+#include "ExportDestination.h"
+#include "FileExportDestination.h"
+#include "InfoModel.h"
+#include "PlacementExporter.h"
+#include "PlacementTemplate.h"
+#include "WandioExportDestination.h"
+
+#include "exceptions/ExportError.h"
+
+#ifdef _libfc_HAVE_LOG4CPLUS_
+#  include <log4cplus/configurator.h>
+#endif /* _libfc_HAVE_LOG4CPLUS_ */
+
+using namespace libfc;
+
+static const char* spec_file_name = 0;
+static int help_flag = false;
+static uint64_t n_records = 1000000;
+static uint16_t protocol_version = kIpfixVersion;
+static const char* template_mix = "ipv4=70,ipv6=20,varlen=10";
+static const char* varlen_sizes = "uniform:4:32";
+static unsigned int n_domains = 1;
+static unsigned int template_refresh = 0;
+static uint64_t seed = 1;
+static uint64_t start_time = 1400000000;
+static unsigned int records_per_second = 100000;
+static int compression_level = -1;
+static const char* filename = 0;
+
+static uint64_t
+parse_number(const char* option, const char* arg) {
+  char* end = 0;
+  errno = 0;
+  unsigned long long ret = strtoull(arg, &end, 0);
+  if (errno != 0 || end == arg || *end != '\0') {
+    std::cerr << "Option " << option << " needs a number, got \""
+              << arg << "\"" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  return ret;
+}
+
+static void parse_options(int argc, char* const* argv) {
+  while (1) {
+    static struct option options[] = {
+      { "domains", required_argument, 0, 'd' },
+      { "help", no_argument, &help_flag, 1 },
+      { "mode", required_argument, 0, 'm' },
+      { "records", required_argument, 0, 'n' },
+      { "rate", required_argument, 0, 'R' },
+      { "refresh", required_argument, 0, 'r' },
+      { "seed", required_argument, 0, 'S' },
+      { "specfile", required_argument, 0, 's' },
+      { "start-time", required_argument, 0, 'T' },
+      { "templates", required_argument, 0, 't' },
+      { "varlen", required_argument, 0, 'l' },
+      { "compress", required_argument, 0, 'z' },
+      { 0, 0, 0, 0 },
+    };
+
+    int option_index = 0;
+
+    int c = getopt_long(argc, argv, "d:hl:m:n:R:r:S:s:T:t:z:", options,
+                        &option_index);
+
+    if (c == -1)
+      break;
+
+    switch(c) {
+    case 0:
+      break;
+    case 'd':
+      n_domains = parse_number("-d", optarg);
+      if (n_domains == 0) {
+        std::cerr << "Need at least one observation domain" << std::endl;
+        exit(EXIT_FAILURE);
+      }
+      break;
+    case 'h':
+      help_flag = 1;
+      break;
+    case 'l':
+      varlen_sizes = optarg;
+      break;
+    case 'm':
+      protocol_version = parse_number("-m", optarg);
+      if (protocol_version != kIpfixVersion
+          && protocol_version != kV9Version) {
+        std::cerr << "Mode must be " << kV9Version << " or " << kIpfixVersion
+                  << ", got " << optarg << std::endl;
+        exit(EXIT_FAILURE);
+      }
+      break;
+    case 'n':
+      n_records = parse_number("-n", optarg);
+      break;
+    case 'R':
+      records_per_second = parse_number("-R", optarg);
+      if (records_per_second == 0) {
+        std::cerr << "Rate must be positive" << std::endl;
+        exit(EXIT_FAILURE);
+      }
+      break;
+    case 'r':
+      template_refresh = parse_number("-r", optarg);
+      break;
+    case 'S':
+      seed = parse_number("-S", optarg);
+      break;
+    case 's':
+      spec_file_name = optarg;
+      break;
+    case 'T':
+      start_time = parse_number("-T", optarg);
+      break;
+    case 't':
+      template_mix = optarg;
+      break;
+    case 'z':
+      compression_level = parse_number("-z", optarg);
+      if (compression_level > 9) {
+        std::cerr << "Compression level must be between 0 and 9, got "
+                  << optarg << std::endl;
+        exit(EXIT_FAILURE);
+      }
+      break;
+    default:
+      std::cerr << "Unrecognised option character '" << c 
+                << "', aborting" << std::endl;
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  if (optind < argc)
+    filename = argv[optind++];
+}
+
+static void help() {
+  std::cerr << "usage: ./fcgen [options] file" << std::endl
+            << "Options:" << std::endl
+            << "  -n n|--records=n\tgenerate N records" << std::endl
+            << "  -m 9|10|--mode=9|10" << std::endl
+            << "\twrite Netflow v9 or IPFIX (default)" << std::endl
+            << "  -t mix|--templates=mix" << std::endl
+            << "\ttemplate mix, e.g. ipv4=70,ipv6=20,varlen=10" << std::endl
+            << "  -l dist|--varlen=dist" << std::endl
+            << "\tstring lengths: fixed:N, uniform:MIN:MAX or exp:MEAN"
+            << std::endl
+            << "  -d n|--domains=n\tspread records over N domains"
+            << std::endl
+            << "  -r n|--refresh=n\tresend templates every N messages"
+            << std::endl
+            << "  -S n|--seed=n\tseed for the random generator" << std::endl
+            << "  -T t|--start-time=t" << std::endl
+            << "\tsimulated clock starts at T seconds since the epoch"
+            << std::endl
+            << "  -R n|--rate=n\tsimulate N records per second" << std::endl
+            << "  -z n|--compress=n\tgzip the output at level N"
+            << std::endl
+            << "  -s file|--specfile=file" << std::endl
+            << "\tuse FILE as IE spec filename" << std::endl
+            << "  -h|--help\tprint this help text" << std::endl;
+}
+
+static void
+add_ies_from_spec_file() {
+  if (spec_file_name != 0) {
+    std::ifstream iespecs(spec_file_name);
+    if (!iespecs)
+      /* Silently ignore open error */
+      return;
+
+    std::string line;
+    while (std::getline(iespecs, line))
+      InfoModel::instance().add(line);
+
+    /* Silently ignore close error */
+    iespecs.close();
+  }
+}
+
+/** Pseudo-random number generator.
+ *
+ * This is SplitMix64.  We don't use <random>, because the standard
+ * distributions are allowed to differ between library
+ * implementations, and the output of this program must not.
+ */
+class Random {
+public:
+  explicit Random(uint64_t seed) : state(seed) {
+  }
+
+  uint64_t next() {
+    uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+  }
+
+  /** Returns a number in [0, n), for n < 2^32. */
+  uint32_t below(uint32_t n) {
+    return static_cast<uint32_t>(((next() >> 32) * n) >> 32);
+  }
+
+  /** Returns a number in [0, 1). */
+  double uniform() {
+    return (next() >> 11) * (1.0 / 9007199254740992.0);
+  }
+
+private:
+  uint64_t state;
+};
+
+/** Distribution of the lengths of varlen IEs. */
+class LengthDistribution {
+public:
+  /** The longest string we generate, so that a record always fits
+   * into a message. */
+  static const unsigned int max_length = 1024;
+
+  explicit LengthDistribution(const std::string& spec)
+    : kind(fixed), a(0), b(0), mean(0) {
+    std::vector<std::string> parts;
+    std::stringstream sstr(spec);
+    std::string part;
+    while (std::getline(sstr, part, ':'))
+      parts.push_back(part);
+
+    if (parts.size() == 2 && parts[0] == "fixed") {
+      kind = fixed;
+      a = parse_number("-l", parts[1].c_str());
+    } else if (parts.size() == 3 && parts[0] == "uniform") {
+      kind = uniform;
+      a = parse_number("-l", parts[1].c_str());
+      b = parse_number("-l", parts[2].c_str());
+    } else if (parts.size() == 2 && parts[0] == "exp") {
+      kind = exponential;
+      mean = parse_number("-l", parts[1].c_str());
+    } else {
+      std::cerr << "Can't parse varlen size distribution \"" << spec
+                << "\"" << std::endl;
+      exit(EXIT_FAILURE);
+    }
+
+    if (a > max_length || b > max_length || (kind == uniform && a > b)) {
+      std::cerr << "Bad varlen size distribution \"" << spec
+                << "\", sizes must be ordered and at most " << max_length
+                << std::endl;
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  unsigned int draw(Random& random) const {
+    switch (kind) {
+    case fixed:
+      return a;
+    case uniform:
+      return a + random.below(b - a + 1);
+    case exponential: {
+      double len = -std::log(1.0 - random.uniform()) * mean;
+      return len < max_length ? static_cast<unsigned int>(len) : max_length;
+    }
+    }
+    return 0; /* Can't happen */
+  }
+
+private:
+  enum { fixed, uniform, exponential } kind;
+  unsigned int a;
+  unsigned int b;
+  double mean;
+};
+
+/** The values of the record currently being generated.  All
+ * templates place their values from here. */
+struct FlowRecord {
+  FlowRecord() {
+    memset(source_ipv6_address, 0, sizeof(source_ipv6_address));
+    memset(destination_ipv6_address, 0, sizeof(destination_ipv6_address));
+  }
+
+  uint64_t flow_start_milliseconds;
+  uint64_t flow_end_milliseconds;
+  uint32_t source_ipv4_address;
+  uint32_t destination_ipv4_address;
+  uint8_t source_ipv6_address[16];
+  uint8_t destination_ipv6_address[16];
+  uint16_t source_transport_port;
+  uint16_t destination_transport_port;
+  uint8_t protocol_identifier;
+  uint8_t tcp_control_bits;
+  uint64_t octet_delta_count;
+  uint64_t packet_delta_count;
+  uint32_t ingress_interface;
+  uint32_t egress_interface;
+  BasicOctetArray interface_name;
+  BasicOctetArray application_name;
+};
+
+/** One entry of the template mix. */
+struct TemplateKind {
+  std::string name;
+  unsigned int weight;
+  bool has_varlen;
+  uint64_t records;
+};
+
+static void
+add(PlacementTemplate* tmpl, const char* ie_name, void* p) {
+  const InfoElement* ie = InfoModel::instance().lookupIE(ie_name);
+  if (ie == 0) {
+    std::cerr << "Unknown IE " << ie_name << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  tmpl->register_placement(ie, p, 0);
+}
+
+static PlacementTemplate*
+make_template(const std::string& kind, FlowRecord& r) {
+  PlacementTemplate* tmpl = new PlacementTemplate();
+
+  add(tmpl, "flowStartMilliseconds", &r.flow_start_milliseconds);
+  add(tmpl, "flowEndMilliseconds", &r.flow_end_milliseconds);
+  if (kind == "ipv6") {
+    add(tmpl, "sourceIPv6Address", r.source_ipv6_address);
+    add(tmpl, "destinationIPv6Address", r.destination_ipv6_address);
+  } else {
+    add(tmpl, "sourceIPv4Address", &r.source_ipv4_address);
+    add(tmpl, "destinationIPv4Address", &r.destination_ipv4_address);
+  }
+  add(tmpl, "sourceTransportPort", &r.source_transport_port);
+  add(tmpl, "destinationTransportPort", &r.destination_transport_port);
+  add(tmpl, "protocolIdentifier", &r.protocol_identifier);
+  add(tmpl, "tcpControlBits", &r.tcp_control_bits);
+  add(tmpl, "octetDeltaCount", &r.octet_delta_count);
+  add(tmpl, "packetDeltaCount", &r.packet_delta_count);
+  add(tmpl, "ingressInterface", &r.ingress_interface);
+  add(tmpl, "egressInterface", &r.egress_interface);
+  if (kind == "varlen") {
+    add(tmpl, "interfaceName", &r.interface_name);
+    add(tmpl, "applicationName", &r.application_name);
+  }
+
+  return tmpl;
+}
+
+static std::vector<TemplateKind>
+parse_template_mix(const std::string& mix) {
+  std::vector<TemplateKind> ret;
+  std::stringstream sstr(mix);
+  std::string entry;
+
+  while (std::getline(sstr, entry, ',')) {
+    TemplateKind k;
+    size_t eq = entry.find('=');
+    k.name = entry.substr(0, eq);
+    k.weight = eq == std::string::npos
+      ? 1 : parse_number("-t", entry.substr(eq + 1).c_str());
+    k.has_varlen = k.name == "varlen";
+    k.records = 0;
+
+    if (k.name != "ipv4" && k.name != "ipv6" && k.name != "varlen") {
+      std::cerr << "Unknown template kind \"" << k.name
+                << "\", must be ipv4, ipv6 or varlen" << std::endl;
+      exit(EXIT_FAILURE);
+    }
+    if (k.weight != 0)
+      ret.push_back(k);
+  }
+
+  if (ret.empty()) {
+    std::cerr << "Template mix \"" << mix << "\" is empty" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  return ret;
+}
+
+/** Fills a string IE with a prefix of a fixed pool of printable
+ * characters, starting at a random position. */
+static void
+fill_string(BasicOctetArray& s, unsigned int length, Random& random) {
+  static const size_t pool_size = 2*LengthDistribution::max_length;
+  static uint8_t pool[pool_size];
+  static bool initialised = false;
+
+  if (!initialised) {
+    for (size_t i = 0; i < pool_size; ++i)
+      pool[i] = 'a' + i % 26;
+    initialised = true;
+  }
+
+  s.copy_content(pool + random.below(pool_size - length + 1), length);
+}
+
+static void
+fill_record(FlowRecord& r, uint64_t now_ms, bool has_varlen,
+            const LengthDistribution& lengths, Random& random) {
+  static const uint16_t common_ports[]
+    = { 80, 443, 53, 22, 25, 123, 8080, 993 };
+  static const uint8_t tcp = 6;
+  static const uint8_t udp = 17;
+  static const uint8_t icmp = 1;
+
+  /* Most flows are short, a few last up to a minute. */
+  r.flow_end_milliseconds = now_ms;
+  r.flow_start_milliseconds = now_ms - random.below(60000);
+
+  /* Addresses are drawn from a /16 of clients and a /20 of servers
+   * so that the address space looks like a network, not like noise. */
+  r.source_ipv4_address = 0x0a000000 | random.below(1 << 16);
+  r.destination_ipv4_address = 0xc0a80000 | random.below(1 << 12);
+  uint64_t a = random.next();
+  uint64_t b = random.next();
+  r.source_ipv6_address[0] = 0x20;
+  r.source_ipv6_address[1] = 0x01;
+  memcpy(r.source_ipv6_address + 8, &a, sizeof(a));
+  r.destination_ipv6_address[0] = 0x2a;
+  r.destination_ipv6_address[1] = 0x02;
+  memcpy(r.destination_ipv6_address + 8, &b, sizeof(b));
+
+  uint32_t p = random.below(100);
+  r.protocol_identifier = p < 80 ? tcp : p < 98 ? udp : icmp;
+  r.source_transport_port = 1024 + random.below(64512);
+  r.destination_transport_port = random.below(4) != 0
+    ? common_ports[random.below(sizeof(common_ports)/sizeof(common_ports[0]))]
+    : random.below(65536);
+  r.tcp_control_bits = r.protocol_identifier == tcp ? random.below(64) : 0;
+
+  /* Heavy-tailed packet counts. */
+  r.packet_delta_count
+    = 1 + static_cast<uint64_t>(-std::log(1.0 - random.uniform()) * 20);
+  r.octet_delta_count = r.packet_delta_count * (40 + random.below(1461));
+  r.ingress_interface = 1 + random.below(8);
+  r.egress_interface = 1 + random.below(8);
+
+  if (has_varlen) {
+    fill_string(r.interface_name, lengths.draw(random), random);
+    fill_string(r.application_name, lengths.draw(random), random);
+  }
+}
+
+int main(int argc, char* const* argv) {
+#ifdef _libfc_HAVE_LOG4CPLUS_
+  log4cplus::PropertyConfigurator config("log4cplus.properties");
+  config.configure();
+#endif /* _libfc_HAVE_LOG4CPLUS_ */
+
+  parse_options(argc, argv);
+
+  if (help_flag || filename == 0) {
+    help();
+    return help_flag ? EXIT_SUCCESS : EXIT_FAILURE;
+  }
+
+  InfoModel::instance().defaultIPFIX();
+  add_ies_from_spec_file();
+
+  std::vector<TemplateKind> kinds = parse_template_mix(template_mix);
+  LengthDistribution lengths(varlen_sizes);
+
+  unsigned int total_weight = 0;
+  for (auto k = kinds.begin(); k != kinds.end(); ++k) {
+    if (k->has_varlen && protocol_version == kV9Version) {
+      std::cerr << "Netflow v9 has no varlen IEs; "
+                << "remove \"varlen\" from the template mix" << std::endl;
+      return EXIT_FAILURE;
+    }
+    total_weight += k->weight;
+  }
+
+  FlowRecord record;
+  Random random(seed);
+
+  try {
+    std::unique_ptr<ExportDestination> destination;
+    int fd = -1;
+    if (compression_level >= 0)
+      destination.reset(new WandioExportDestination(filename,
+                                                    WANDIO_COMPRESS_ZLIB,
+                                                    compression_level));
+    else {
+      fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+      if (fd < 0) {
+        std::cerr << "Can't create " << filename << ": " << strerror(errno)
+                  << std::endl;
+        return EXIT_FAILURE;
+      }
+      destination.reset(new FileExportDestination(fd));
+    }
+
+    /* Each domain gets its own templates, since a template's ID is
+     * assigned by the first exporter that sends it. */
+    std::vector<std::unique_ptr<PlacementExporter> > exporters;
+    std::vector<std::vector<std::unique_ptr<PlacementTemplate> > > templates;
+    for (unsigned int d = 0; d < n_domains; ++d) {
+      exporters.emplace_back(new PlacementExporter(*destination, d + 1));
+      exporters.back()->set_protocol_version(protocol_version);
+      exporters.back()->set_template_refresh(template_refresh);
+
+      templates.emplace_back();
+      for (auto k = kinds.begin(); k != kinds.end(); ++k)
+        templates.back().emplace_back(make_template(k->name, record));
+    }
+
+    for (uint64_t i = 0; i < n_records; ++i) {
+      uint64_t now_ms = start_time * 1000 + i * 1000 / records_per_second;
+      unsigned int d = n_domains == 1 ? 0 : random.below(n_domains);
+
+      unsigned int w = random.below(total_weight);
+      unsigned int k = 0;
+      while (w >= kinds[k].weight)
+        w -= kinds[k++].weight;
+
+      fill_record(record, now_ms, kinds[k].has_varlen, lengths, random);
+      kinds[k].records++;
+
+      exporters[d]->set_export_time(now_ms / 1000);
+      exporters[d]->place_values(templates[d][k].get());
+    }
+
+    /* Exporters flush on destruction, and need the destination for
+     * that. */
+    exporters.clear();
+    if (destination->flush() < 0) {
+      std::cerr << "Can't write " << filename << std::endl;
+      return EXIT_FAILURE;
+    }
+    destination.reset();
+    if (fd >= 0 && close(fd) < 0) {
+      std::cerr << "Can't close " << filename << ": " << strerror(errno)
+                << std::endl;
+      return EXIT_FAILURE;
+    }
+  } catch (const ExportError& e) {
+    std::cerr << "Export error: " << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  for (auto k = kinds.begin(); k != kinds.end(); ++k)
+    std::cerr << k->name << ": " << k->records << " records" << std::endl;
+
+  return EXIT_SUCCESS;
+}
@@ -25,9 +25,709 @@
  * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE
  */
 
-/* This file remains only as a skeleton since the Great API Cleanup of
-   April 2014.  Please look at repository versions before that date to
-   see what was originally in here. */
+/** Profile the stages of IPFIX collection on a capture.
+ *
+ * Syntax: fcprof [-r repeat] [-s iespec-file] [-p port] file
+ *
+ * The file (which may be compressed) is read into memory once and
+ * then replayed through each stage of collection in isolation:
+ *
+ *   read       reading the file through libwandio or, with -p, the
+ *              payloads of the UDP datagrams to the given port of a
+ *              pcap or pcapng capture through PcapInputSource;
+ *   deframe    splitting messages into sets, with a content handler
+ *              that does nothing;
+ *   templates  the same, but with a PlacementContentHandler that has
+ *              no placements, i.e., deframing plus template
+ *              processing plus data set dispatch;
+ *   decode     DecodePlan::execute() on every record, with one
+ *              placement per wire template;
+ *   callback   full collection through a PlacementCollector;
+ *   encode     decoding each record and placing it again with a
+ *              PlacementExporter, into a destination that discards
+ *              the messages.
+ *
+ * For each stage it prints records/s, MB/s and ns/record, followed by
+ * a breakdown of decoding and encoding by template.
+ *
+ * @author Stephan Neuhaus <neuhaust@tik.ee.ethz.ch>
+ */
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <list>
+#include <map>
+#include <vector>
+
+#include <fcntl.h>
+#include <getopt.h>
+
+extern "C" {
+#  include <wandio.h>
+}
+
+#include "BasicOctetArray.h"
+#include "BufferInputSource.h"
+#include "Constants.h"
+#include "ContentHandler.h"
+#include "DecodePlan.h"
+#include "ExportDestination.h"
+#include "IETemplate.h"
+#include "IEType.h"
+#include "IPFIXMessageStreamParser.h"
+#include "InfoModel.h"
+#include "PcapInputSource.h"
+#include "PlacementCollector.h"
+#include "PlacementExporter.h"
+#include "PlacementTemplate.h"
+#include "decode_util.h"
+
+#include "exceptions/FormatError.h"
+
+#ifdef _libfc_HAVE_LOG4CPLUS_
+#  include <log4cplus/configurator.h>
+#endif /* _libfc_HAVE_LOG4CPLUS_ */
+
+using namespace libfc;
+
+typedef std::chrono::steady_clock Clock;
+
+static const char* spec_file_name = 0;
+static int help_flag = false;
+static unsigned int repeat = 1;
+static const char* filename = 0;
+static int pcap_port = -1;
+
+static void parse_options(int argc, char* const* argv) {
+  while (1) {
+    static struct option options[] = {
+      { "help", no_argument, &help_flag, 1 },
+      { "pcap", required_argument, 0, 'p' },
+      { "repeat", required_argument, 0, 'r' },
+      { "specfile", required_argument, 0, 's' },
+      { 0, 0, 0, 0 },
+    };
+
+    int option_index = 0;
+
+    int c = getopt_long(argc, argv, "hp:r:s:", options, &option_index);
+
+    if (c == -1)
+      break;
+
+    switch(c) {
+    case 0:
+      break;
+    case 'h':
+      help_flag = 1;
+      break;
+    case 'p':
+      pcap_port = atoi(optarg);
+      if (pcap_port < 0 || pcap_port > 65535) {
+        std::cerr << "Port must be between 0 and 65535, got " << optarg
+                  << std::endl;
+        exit(EXIT_FAILURE);
+      }
+      break;
+    case 'r':
+      repeat = atoi(optarg);
+      if (repeat == 0) {
+        std::cerr << "Repeat count must be positive, got " << optarg
+                  << std::endl;
+        exit(EXIT_FAILURE);
+      }
+      break;
+    case 's':
+      spec_file_name = optarg;
+      break;
+    default:
+      std::cerr << "Unrecognised option character '" << c 
+                << "', aborting" << std::endl;
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  if (optind < argc)
+    filename = argv[optind++];
+}
+
+static void help() {
+  std::cerr << "usage: ./fcprof [options] file" << std::endl
+            << "Options:" << std::endl
+            << "  -s file|--specfile=file" << std::endl
+            << "\tuse FILE as IE spec filename" << std::endl
+            << "  -p port|--pcap=port" << std::endl
+            << "\tread UDP datagrams to PORT (0 for all) from a pcap file"
+            << std::endl
+            << "  -r n|--repeat=n\trun each stage N times" << std::endl
+            << "  -h|--help\tprint this help text" << std::endl;
+}
+
+static void
+add_ies_from_spec_file() {
+  if (spec_file_name != 0) {
+    std::ifstream iespecs(spec_file_name);
+    if (!iespecs)
+      /* Silently ignore open error */
+      return;
+
+    std::string line;
+    while (std::getline(iespecs, line))
+      InfoModel::instance().add(line);
+
+    /* Silently ignore close error */
+    iespecs.close();
+  }
+}
+
+static uint64_t
+ns_since(Clock::time_point start) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+    Clock::now() - start).count();
+}
+
+/** A wire template from the input, with a placement that takes all
+ * of its fields, and the per-template counters. */
+struct TemplateInfo {
+  TemplateInfo(uint32_t domain, uint16_t id, size_t n_fields)
+    : domain(domain), id(id), fixed_values(16*n_fields), plan(0),
+      records(0), octets(0), decode_ns(0), encode_ns(0) {
+  }
+
+  ~TemplateInfo() {
+    delete plan;
+  }
+
+  /** Registers placements for all fields and makes the decode plan.
+   *
+   * @return true if the template can be decoded
+   */
+  bool prepare() {
+    unsigned int i = 0;
+    for (auto ie = wire_template.begin(); ie != wire_template.end(); ++ie) {
+      size_t size = (*ie)->ietype()->placedWidth();
+      if (size == 0) {
+        varlen_values.push_back(BasicOctetArray());
+        placement.register_placement(*ie, &varlen_values.back(), 0);
+      } else
+        placement.register_placement(*ie, &fixed_values[16*i], size);
+      ++i;
+    }
+
+    try {
+      plan = new DecodePlan(&placement, &wire_template);
+    } catch (FormatError& e) {
+      std::cerr << "Template " << domain << "/" << id
+                << " can't be decoded: " << e.what() << std::endl;
+      return false;
+    }
+    return true;
+  }
+
+  uint32_t domain;
+  uint16_t id;
+  IETemplate wire_template;
+  PlacementTemplate placement;
+  std::vector<uint8_t> fixed_values;
+  std::list<BasicOctetArray> varlen_values;
+  DecodePlan* plan;
+
+  uint64_t records;
+  uint64_t octets;
+  uint64_t decode_ns;
+  uint64_t encode_ns;
+};
+
+/** A data set from the input, copied out of its message. */
+struct DataSet {
+  TemplateInfo* tmpl;
+  std::vector<uint8_t> data;
+};
+
+/** Executes a template's decode plan on every record of a data set.
+ *
+ * @return the number of records decoded
+ */
+static unsigned int
+decode_data_set(const DataSet& ds) {
+  const uint8_t* cur = ds.data.data();
+  size_t left = ds.data.size();
+  size_t minlen = std::max<size_t>(1, ds.tmpl->wire_template.minlen());
+  unsigned int n = 0;
+
+  while (left >= minlen) {
+    uint16_t consumed = ds.tmpl->plan->execute(cur, left);
+    if (consumed == 0)
+      break;
+    cur += consumed;
+    left -= consumed;
+    ++n;
+  }
+  return n;
+}
+
+/** Does nothing; used to time message deframing alone. */
+class NullContentHandler : public ContentHandler {
+public:
+  std::shared_ptr<ErrorContext> start_session() { libfc_RETURN_OK(); }
+  std::shared_ptr<ErrorContext> end_session() { libfc_RETURN_OK(); }
+  std::shared_ptr<ErrorContext> start_message(uint16_t version,
+                                              uint16_t length,
+                                              uint32_t export_time,
+                                              uint32_t sequence_number,
+                                              uint32_t observation_domain,
+                                              uint64_t base_time) {
+    libfc_RETURN_OK();
+  }
+  std::shared_ptr<ErrorContext> end_message() { libfc_RETURN_OK(); }
+  std::shared_ptr<ErrorContext> start_template_set(uint16_t set_id,
+                                                   uint16_t set_length,
+                                                   const uint8_t* buf) {
+    libfc_RETURN_OK();
+  }
+  std::shared_ptr<ErrorContext> end_template_set() { libfc_RETURN_OK(); }
+  std::shared_ptr<ErrorContext> start_options_template_set(
+      uint16_t set_id, uint16_t set_length, const uint8_t* buf) {
+    libfc_RETURN_OK();
+  }
+  std::shared_ptr<ErrorContext> end_options_template_set() {
+    libfc_RETURN_OK();
+  }
+  std::shared_ptr<ErrorContext> start_data_set(uint16_t id, uint16_t length,
+                                               const uint8_t* buf) {
+    libfc_RETURN_OK();
+  }
+  std::shared_ptr<ErrorContext> end_data_set() { libfc_RETURN_OK(); }
+};
+
+/** Collects the templates and data sets of the input, so that the
+ * later stages can be run on them without parsing. */
+class CaptureHandler : public NullContentHandler {
+public:
+  CaptureHandler() : domain(0), n_messages(0), n_unknown_sets(0) {
+  }
+
+  std::shared_ptr<ErrorContext> start_message(uint16_t version,
+                                              uint16_t length,
+                                              uint32_t export_time,
+                                              uint32_t sequence_number,
+                                              uint32_t observation_domain,
+                                              uint64_t base_time) {
+    domain = observation_domain;
+    n_messages++;
+    libfc_RETURN_OK();
+  }
+
+  std::shared_ptr<ErrorContext> start_template_set(uint16_t set_id,
+                                                   uint16_t set_length,
+                                                   const uint8_t* buf) {
+    parse_templates(buf, buf + set_length, false);
+    libfc_RETURN_OK();
+  }
+
+  std::shared_ptr<ErrorContext> start_options_template_set(
+      uint16_t set_id, uint16_t set_length, const uint8_t* buf) {
+    parse_templates(buf, buf + set_length, true);
+    libfc_RETURN_OK();
+  }
+
+  std::shared_ptr<ErrorContext> start_data_set(uint16_t id, uint16_t length,
+                                               const uint8_t* buf) {
+    auto t = current.find(std::make_pair(domain, id));
+    if (t == current.end() || t->second->plan == 0) {
+      n_unknown_sets++;
+      libfc_RETURN_OK();
+    }
+
+    data_sets.push_back(DataSet());
+    DataSet& ds = data_sets.back();
+    ds.tmpl = t->second;
+    ds.data.assign(buf, buf + length);
+
+    ds.tmpl->records += decode_data_set(ds);
+    ds.tmpl->octets += length;
+    libfc_RETURN_OK();
+  }
+
+  /** All wire templates, including redefined ones. */
+  std::list<TemplateInfo> templates;
+
+  std::list<DataSet> data_sets;
+
+  uint32_t domain;
+  uint64_t n_messages;
+  uint64_t n_unknown_sets;
+
+private:
+  void parse_templates(const uint8_t* cur, const uint8_t* end,
+                       bool is_options) {
+    const size_t header_len = is_options ? 6 : 4;
+
+    while (cur + header_len <= end) {
+      uint16_t id = decode_uint16(cur);
+      uint16_t field_count = decode_uint16(cur + 2);
+      cur += header_len;
+
+      if (field_count == 0) {
+        /* Template withdrawal. */
+        current.erase(std::make_pair(domain, id));
+        continue;
+      }
+
+      templates.emplace_back(domain, id, field_count);
+      TemplateInfo& t = templates.back();
+
+      for (unsigned int i = 0; i < field_count; ++i) {
+        if (cur + 4 > end)
+          return;
+        uint16_t ie_id = decode_uint16(cur);
+        uint16_t ie_length = decode_uint16(cur + 2);
+        uint32_t pen = 0;
+        cur += 4;
+        if (ie_id & 0x8000) {
+          if (cur + 4 > end)
+            return;
+          ie_id &= 0x7fff;
+          pen = decode_uint32(cur);
+          cur += 4;
+        }
+
+        InfoModel& model = InfoModel::instance();
+        const InfoElement* ie = model.lookupIE(pen, ie_id, ie_length);
+        if (ie == 0)
+          ie = model.add_unknown(pen, ie_id, ie_length);
+        t.wire_template.add(ie);
+      }
+
+      t.prepare();
+      current[std::make_pair(domain, id)] = &t;
+    }
+  }
+
+  std::map<std::pair<uint32_t, uint16_t>, TemplateInfo*> current;
+};
+
+/** Collects everything and counts the records. */
+class CountingCollector : public PlacementCollector {
+public:
+  CountingCollector(const std::list<TemplateInfo>& templates)
+    : PlacementCollector(PlacementCollector::ipfix), n_records(0) {
+    for (auto t = templates.begin(); t != templates.end(); ++t)
+      if (t->plan != 0)
+        register_placement_template(&t->placement);
+  }
+
+  std::shared_ptr<ErrorContext>
+  start_placement(const PlacementTemplate* tmpl) {
+    libfc_RETURN_OK();
+  }
+
+  std::shared_ptr<ErrorContext>
+  end_placement(const PlacementTemplate* tmpl) {
+    n_records++;
+    libfc_RETURN_OK();
+  }
+
+  uint64_t n_records;
+};
+
+/** Collects nothing: all data sets are unhandled. */
+class EmptyCollector : public PlacementCollector {
+public:
+  EmptyCollector() : PlacementCollector(PlacementCollector::ipfix) {
+  }
+
+  std::shared_ptr<ErrorContext>
+  start_placement(const PlacementTemplate* tmpl) {
+    libfc_RETURN_OK();
+  }
+
+  std::shared_ptr<ErrorContext>
+  end_placement(const PlacementTemplate* tmpl) {
+    libfc_RETURN_OK();
+  }
+};
+
+/** Counts exported octets and throws them away. */
+class NullExportDestination : public ExportDestination {
+public:
+  NullExportDestination() : n_octets(0) {
+  }
+
+  ssize_t writev(const std::vector< ::iovec>& iovecs) {
+    size_t n = 0;
+    for (auto i = iovecs.begin(); i != iovecs.end(); ++i)
+      n += i->iov_len;
+    n_octets += n;
+    return n;
+  }
+
+  int flush() {
+    return 0;
+  }
+
+  bool is_connectionless() const {
+    return false;
+  }
+
+  size_t preferred_maximum_message_size() const {
+    return kMaxMessageLen;
+  }
+
+  uint64_t n_octets;
+};
+
+static void
+print_stage(const char* name, uint64_t ns, uint64_t records,
+            uint64_t octets) {
+  double seconds = ns / 1e9;
+
+  std::cout << std::left << std::setw(12) << name << std::right
+            << std::fixed << std::setprecision(3)
+            << std::setw(10) << seconds
+            << std::setprecision(0)
+            << std::setw(14) << (seconds > 0 ? records / seconds : 0)
+            << std::setprecision(1)
+            << std::setw(10) << (seconds > 0 ? octets / seconds / 1e6 : 0)
+            << std::setw(12) << (records > 0 ? double(ns) / records : 0)
+            << std::endl;
+}
+
+static bool
+run_parser(InputSource& is, ContentHandler& handler) {
+  IPFIXMessageStreamParser parser;
+  parser.set_content_handler(&handler);
+  std::shared_ptr<ErrorContext> e = parser.parse(is);
+  if (e != 0) {
+    std::cerr << e->to_string() << std::endl;
+    return false;
+  }
+  return true;
+}
+
+/** Appends the datagrams from a capture to input. */
+static bool read_pcap(std::vector<uint8_t>& input) {
+  int fd = open(filename, O_RDONLY);
+  if (fd < 0) {
+    std::cerr << "Can't open " << filename << std::endl;
+    return false;
+  }
+
+  try {
+    PcapInputSource is(fd, filename, pcap_port);
+    uint8_t buf[1 << 16];
+    ssize_t n;
+    /* Reads never span datagrams. */
+    while ((n = is.read(buf, sizeof(buf) - 1)) > 0)
+      input.insert(input.end(), buf, buf + n);
+  } catch (FormatError& e) {
+    std::cerr << e.what() << std::endl;
+    return false;
+  }
+  return true;
+}
+
 int main(int argc, char* const* argv) {
-  return 0;
+#ifdef _libfc_HAVE_LOG4CPLUS_
+  log4cplus::PropertyConfigurator config("log4cplus.properties");
+  config.configure();
+#endif /* _libfc_HAVE_LOG4CPLUS_ */
+
+  parse_options(argc, argv);
+
+  if (help_flag || filename == 0) {
+    help();
+    return help_flag ? EXIT_SUCCESS : EXIT_FAILURE;
+  }
+
+  InfoModel::instance().defaultIPFIX();
+  add_ies_from_spec_file();
+
+  /* Stage: read. */
+  std::vector<uint8_t> input;
+  uint64_t read_ns = 0;
+  for (unsigned int r = 0; r < repeat; ++r) {
+    input.clear();
+    Clock::time_point start = Clock::now();
+
+    if (pcap_port >= 0) {
+      if (!read_pcap(input))
+        return EXIT_FAILURE;
+      read_ns += ns_since(start);
+      continue;
+    }
+
+    io_t* io = wandio_create(filename);
+    if (io == 0) {
+      std::cerr << "Can't open " << filename << std::endl;
+      return EXIT_FAILURE;
+    }
+    uint8_t buf[1 << 16];
+    off_t n;
+    while ((n = wandio_read(io, buf, sizeof(buf))) > 0)
+      input.insert(input.end(), buf, buf + n);
+    wandio_destroy(io);
+
+    read_ns += ns_since(start);
+    if (n < 0) {
+      std::cerr << "Can't read " << filename << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  /* Capture templates and data sets, untimed. */
+  CaptureHandler capture;
+  {
+    BufferInputSource is(input.data(), input.size());
+    if (!run_parser(is, capture))
+      return EXIT_FAILURE;
+  }
+
+  uint64_t records = 0;
+  for (auto t = capture.templates.begin(); t != capture.templates.end(); ++t)
+    records += t->records;
+  uint64_t octets = input.size();
+
+  /* Stage: deframe. */
+  uint64_t deframe_ns = 0;
+  for (unsigned int r = 0; r < repeat; ++r) {
+    BufferInputSource is(input.data(), input.size());
+    NullContentHandler handler;
+    Clock::time_point start = Clock::now();
+    run_parser(is, handler);
+    deframe_ns += ns_since(start);
+  }
+
+  /* Stage: templates. */
+  uint64_t templates_ns = 0;
+  for (unsigned int r = 0; r < repeat; ++r) {
+    BufferInputSource is(input.data(), input.size());
+    EmptyCollector collector;
+    Clock::time_point start = Clock::now();
+    collector.collect(is);
+    templates_ns += ns_since(start);
+  }
+
+  /* Stage: decode. */
+  uint64_t decode_ns = 0;
+  for (unsigned int r = 0; r < repeat; ++r) {
+    for (auto ds = capture.data_sets.begin(); ds != capture.data_sets.end();
+         ++ds) {
+      Clock::time_point start = Clock::now();
+      decode_data_set(*ds);
+      uint64_t ns = ns_since(start);
+      ds->tmpl->decode_ns += ns;
+      decode_ns += ns;
+    }
+  }
+
+  /* Stage: callback. */
+  uint64_t callback_ns = 0;
+  uint64_t callback_records = 0;
+  for (unsigned int r = 0; r < repeat; ++r) {
+    BufferInputSource is(input.data(), input.size());
+    CountingCollector collector(capture.templates);
+    Clock::time_point start = Clock::now();
+    collector.collect(is);
+    callback_ns += ns_since(start);
+    callback_records = collector.n_records;
+  }
+
+  /* Stage: encode round trip. */
+  uint64_t encode_ns = 0;
+  uint64_t encoded_octets = 0;
+  for (unsigned int r = 0; r < repeat; ++r) {
+    NullExportDestination d;
+    PlacementExporter e(d, 0);
+
+    for (auto ds = capture.data_sets.begin(); ds != capture.data_sets.end();
+         ++ds) {
+      TemplateInfo* t = ds->tmpl;
+      const uint8_t* cur = ds->data.data();
+      size_t left = ds->data.size();
+      size_t minlen = std::max<size_t>(1, t->wire_template.minlen());
+
+      Clock::time_point start = Clock::now();
+      while (left >= minlen) {
+        uint16_t consumed = t->plan->execute(cur, left);
+        if (consumed == 0)
+          break;
+        cur += consumed;
+        left -= consumed;
+        e.place_values(&t->placement);
+      }
+      uint64_t ns = ns_since(start);
+      t->encode_ns += ns;
+      encode_ns += ns;
+    }
+
+    Clock::time_point start = Clock::now();
+    e.flush();
+    encode_ns += ns_since(start);
+    encoded_octets = d.n_octets;
+  }
+
+  /* Report. */
+  std::cout << filename << ": " << octets << " octets, "
+            << capture.n_messages << " messages, "
+            << capture.data_sets.size() << " data sets, "
+            << records << " records";
+  if (capture.n_unknown_sets > 0)
+    std::cout << ", " << capture.n_unknown_sets
+              << " data sets without template";
+  std::cout << std::endl;
+  if (callback_records != records)
+    std::cout << "note: callback stage saw " << callback_records
+              << " records" << std::endl;
+  std::cout << std::endl;
+
+  std::cout << std::left << std::setw(12) << "stage" << std::right
+            << std::setw(10) << "seconds"
+            << std::setw(14) << "records/s"
+            << std::setw(10) << "MB/s"
+            << std::setw(12) << "ns/record" << std::endl;
+
+  uint64_t total_records = records * repeat;
+  uint64_t total_octets = octets * repeat;
+  print_stage("read", read_ns, total_records, total_octets);
+  print_stage("deframe", deframe_ns, total_records, total_octets);
+  print_stage("templates", templates_ns, total_records, total_octets);
+  print_stage("decode", decode_ns, total_records, total_octets);
+  print_stage("callback", callback_ns, total_records, total_octets);
+  print_stage("encode", encode_ns, total_records,
+              encoded_octets * repeat);
+
+  std::cout << std::endl
+            << "templates and callback include deframing; encode includes "
+            << "decoding," << std::endl
+            << "and its MB/s are for the encoded output."
+            << std::endl << std::endl;
+
+  std::cout << std::setw(10) << "domain"
+            << std::setw(10) << "template"
+            << std::setw(8) << "fields"
+            << std::setw(12) << "records"
+            << std::setw(12) << "octets"
+            << std::setw(12) << "decode ns"
+            << std::setw(12) << "encode ns" << std::endl;
+  for (auto t = capture.templates.begin(); t != capture.templates.end();
+       ++t) {
+    if (t->records == 0)
+      continue;
+    uint64_t n = t->records * repeat;
+    std::cout << std::setw(10) << t->domain
+              << std::setw(10) << t->id
+              << std::setw(8) << t->wire_template.size()
+              << std::setw(12) << t->records
+              << std::setw(12) << t->octets
+              << std::setprecision(1)
+              << std::setw(12) << double(t->decode_ns) / n
+              << std::setw(12) << double(t->encode_ns) / n << std::endl;
+  }
+
+  return EXIT_SUCCESS;
 }
@@ -0,0 +1,649 @@
+/* Copyright (c) 2011-2014 ETH Zürich. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ *    * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *    * The name of ETH Zürich nor the names of other contributors 
+ *      may be used to endorse or promote products derived from this software 
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL ETH 
+ * ZURICH BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, 
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, 
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR 
+ * PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER 
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR 
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF 
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE
+ */
+
+/** Replay IPFIX files to a collector at a controlled rate.
+ *
+ * Syntax: fcreplay [options] [file]
+ *
+ * Reads an IPFIX file (compressed or not, or standard input if no
+ * file is given) into memory and sends its messages over UDP to a
+ * collector, as if they came from a number of independent exporters.
+ * This is meant for load-testing collectors: run it against a
+ * collector on the loopback interface, raise the rate until the
+ * collector starts losing records, and you have found its breaking
+ * point.
+ *
+ * The file is first passed through a RelayContentHandler, which
+ * drops data sets without templates and renumbers the messages of
+ * every observation domain so that their sequence numbers count
+ * records from zero.  The relay also splits messages that do not fit
+ * into a UDP datagram at record boundaries; a single record too large
+ * for a datagram is an error.  Every simulated exporter then gets its
+ * own UDP socket, and therefore its own source port, and its own copy of
+ * each of the file's observation domains:  input domain i of
+ * exporter e is sent as domain B + e*n + i, where B is the domain
+ * base and n the number of domains in the file.  Exporters take
+ * turns message by message, so all of them make progress at the same
+ * rate.  Export times are set to the time of sending, and sequence
+ * numbers continue across loops, so a collector sees neither
+ * duplicates nor gaps unless it actually loses messages.
+ *
+ * Output is paced by a token bucket that fills at the target rate in
+ * records per second, and a message is sent only once the bucket
+ * holds as many tokens as the message has records.  The bucket holds
+ * at most a burst's worth of tokens, which bounds how far the tool
+ * catches up after it has been delayed.  Target and achieved rates
+ * are reported on standard error at regular intervals and at the
+ * end; octet rates count IPFIX octets, not UDP or IP headers.
+ *
+ * @author Stephan Neuhaus <neuhaust@tik.ee.ethz.ch>
+ */
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <getopt.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "Constants.h"
+#include "ExportDestination.h"
+#include "FileInputSource.h"
+#include "IPFIXMessageStreamParser.h"
+#include "RelayContentHandler.h"
+#include "WandioInputSource.h"
+
+#include "exceptions/FormatError.h"
+
+#ifdef _libfc_HAVE_LOG4CPLUS_
+#  include <log4cplus/configurator.h>
+#endif /* _libfc_HAVE_LOG4CPLUS_ */
+
+using namespace libfc;
+
+/** The largest UDP payload over IPv4. */
+static const size_t max_datagram_len = 65507;
+
+static int help_flag = false;
+static int keep_time_flag = false;
+static const char* collector_host = "127.0.0.1";
+static const char* collector_port = "4739";
+static unsigned int n_exporters = 1;
+static uint32_t domain_base = 1;
+static uint64_t records_per_second = 0;
+static uint64_t burst = 0;
+static uint64_t n_loops = 1;
+static uint64_t duration = 0;
+static uint64_t report_interval = 1;
+static const char* filename = 0;
+
+static volatile sig_atomic_t stop_flag = 0;
+
+static uint64_t
+parse_number(const char* option, const char* arg) {
+  char* end = 0;
+  errno = 0;
+  unsigned long long ret = strtoull(arg, &end, 0);
+  if (errno != 0 || end == arg || *end != '\0') {
+    std::cerr << "Option " << option << " needs a number, got \""
+              << arg << "\"" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  return ret;
+}
+
+static void parse_options(int argc, char* const* argv) {
+  while (1) {
+    static struct option options[] = {
+      { "burst", required_argument, 0, 'b' },
+      { "collector", required_argument, 0, 'c' },
+      { "domain-base", required_argument, 0, 'd' },
+      { "exporters", required_argument, 0, 'e' },
+      { "help", no_argument, &help_flag, 1 },
+      { "interval", required_argument, 0, 'i' },
+      { "keep-time", no_argument, &keep_time_flag, 1 },
+      { "loops", required_argument, 0, 'l' },
+      { "port", required_argument, 0, 'p' },
+      { "rate", required_argument, 0, 'R' },
+      { "time", required_argument, 0, 't' },
+      { 0, 0, 0, 0 },
+    };
+
+    int option_index = 0;
+
+    int c = getopt_long(argc, argv, "b:c:d:e:hi:kl:p:R:t:", options,
+                        &option_index);
+
+    if (c == -1)
+      break;
+
+    switch(c) {
+    case 0:
+      break;
+    case 'b':
+      burst = parse_number("-b", optarg);
+      break;
+    case 'c':
+      collector_host = optarg;
+      break;
+    case 'd':
+      domain_base = parse_number("-d", optarg);
+      break;
+    case 'e':
+      n_exporters = parse_number("-e", optarg);
+      if (n_exporters == 0) {
+        std::cerr << "Need at least one exporter" << std::endl;
+        exit(EXIT_FAILURE);
+      }
+      break;
+    case 'h':
+      help_flag = 1;
+      break;
+    case 'i':
+      report_interval = parse_number("-i", optarg);
+      break;
+    case 'k':
+      keep_time_flag = 1;
+      break;
+    case 'l':
+      n_loops = parse_number("-l", optarg);
+      break;
+    case 'p':
+      collector_port = optarg;
+      break;
+    case 'R':
+      records_per_second = parse_number("-R", optarg);
+      break;
+    case 't':
+      duration = parse_number("-t", optarg);
+      break;
+    default:
+      std::cerr << "Unrecognised option character '" << c 
+                << "', aborting" << std::endl;
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  if (optind < argc)
+    filename = argv[optind++];
+}
+
+static void help() {
+  std::cerr << "usage: ./fcreplay [options] [file]" << std::endl
+            << "Options:" << std::endl
+            << "  -c host|--collector=host" << std::endl
+            << "\tsend to HOST (default 127.0.0.1)" << std::endl
+            << "  -p port|--port=port\tsend to PORT (default 4739)"
+            << std::endl
+            << "  -e n|--exporters=n\tsimulate N exporters" << std::endl
+            << "  -d n|--domain-base=n" << std::endl
+            << "\tnumber output observation domains from N (default 1)"
+            << std::endl
+            << "  -R n|--rate=n\tsend N records per second (0 = no limit)"
+            << std::endl
+            << "  -b n|--burst=n\tlet the rate burst by up to N records"
+            << std::endl
+            << "  -l n|--loops=n\treplay the file N times (0 = forever)"
+            << std::endl
+            << "  -t n|--time=n\tstop after N seconds" << std::endl
+            << "  -i n|--interval=n" << std::endl
+            << "\treport rates every N seconds (0 = only at the end)"
+            << std::endl
+            << "  -k|--keep-time\tkeep the export times from the file"
+            << std::endl
+            << "  -h|--help\tprint this help text" << std::endl;
+}
+
+static void handle_signal(int) {
+  stop_flag = 1;
+}
+
+/** A message from the input, with its header taken apart. */
+struct Message {
+  /** Index of the message's observation domain in the input. */
+  unsigned int domain_index;
+  uint32_t export_time;
+  uint32_t sequence_number;
+  uint32_t n_records;
+
+  /** Where the message's sets start in the body buffer. */
+  size_t offset;
+  uint16_t length;
+};
+
+/** Everything fcreplay needs to know about its input. */
+struct Replay {
+  std::vector<Message> messages;
+
+  /** The sets of all messages, back to back. */
+  std::vector<uint8_t> bodies;
+
+  /** The observation domains in the input, in order of appearance. */
+  std::vector<uint32_t> domains;
+
+  /** Number of data records per domain, indexed like domains. */
+  std::vector<uint32_t> domain_records;
+};
+
+/** Collects the messages that a RelayContentHandler writes.
+ *
+ * Messages stay in memory, so that they can be replayed without
+ * touching the input again; the header of each message is kept apart
+ * from the sets, since it is rewritten on each send.
+ */
+class ReplayDestination : public ExportDestination {
+public:
+  explicit ReplayDestination(Replay& replay)
+    : replay(replay) {
+  }
+
+  ssize_t writev(const std::vector< ::iovec>& iovecs) {
+    std::vector<uint8_t> message;
+    for (auto v = iovecs.begin(); v != iovecs.end(); ++v) {
+      const uint8_t* p = static_cast<const uint8_t*>(v->iov_base);
+      message.insert(message.end(), p, p + v->iov_len);
+    }
+
+    /* The relay keeps to preferred_maximum_message_size(). */
+    if (message.size() > max_datagram_len) {
+      errno = EMSGSIZE;
+      return -1;
+    }
+
+    uint32_t domain = decode32(&message[12]);
+    auto d = domain_indices.find(domain);
+    if (d == domain_indices.end()) {
+      d = domain_indices.insert(
+        std::make_pair(domain, replay.domains.size())).first;
+      replay.domains.push_back(domain);
+      replay.domain_records.push_back(0);
+    }
+
+    Message m;
+    m.domain_index = d->second;
+    m.export_time = decode32(&message[4]);
+    m.sequence_number = decode32(&message[8]);
+    m.n_records = 0;
+    m.offset = replay.bodies.size();
+    m.length = message.size() - kIpfixMessageHeaderLen;
+
+    replay.bodies.insert(replay.bodies.end(),
+                         message.begin() + kIpfixMessageHeaderLen,
+                         message.end());
+    replay.messages.push_back(m);
+    return message.size();
+  }
+
+  int flush() {
+    return 0;
+  }
+
+  bool is_connectionless() const {
+    return false;
+  }
+
+  size_t preferred_maximum_message_size() const {
+    return max_datagram_len;
+  }
+
+private:
+  static uint32_t decode32(const uint8_t* p) {
+    return (static_cast<uint32_t>(p[0]) << 24)
+      | (static_cast<uint32_t>(p[1]) << 16)
+      | (static_cast<uint32_t>(p[2]) << 8)
+      | (static_cast<uint32_t>(p[3]) << 0);
+  }
+
+  Replay& replay;
+  std::map<uint32_t, unsigned int> domain_indices;
+};
+
+/** Reads the input into replay.
+ *
+ * The number of records in a message is the difference between its
+ * sequence number and that of the next message in the same domain,
+ * or the relay's final sequence number for the last one.
+ */
+static bool load(Replay& replay) {
+  ReplayDestination destination(replay);
+  RelayContentHandler relay;
+  relay.add_destination(destination);
+
+  IPFIXMessageStreamParser parser;
+  parser.set_content_handler(&relay);
+
+  io_t* io = 0;
+  InputSource* is = 0;
+  if (filename == 0)
+    is = new FileInputSource(0, "<stdin>"); // 0 == stdin
+  else {
+    io = wandio_create(filename);
+    if (io == 0) {
+      std::cerr << "Can't open input " << filename << std::endl;
+      return false;
+    }
+    is = new WandioInputSource(io, filename);
+  }
+
+  std::shared_ptr<ErrorContext> e;
+  bool ok = true;
+  try {
+    e = parser.parse(*is);
+  } catch (FormatError& f) {
+    std::cerr << f.what() << std::endl;
+    ok = false;
+  }
+
+  delete is;
+  if (io != 0)
+    wandio_destroy(io);
+
+  if (e != 0) {
+    std::cerr << e->to_string() << std::endl;
+    return false;
+  }
+  if (!ok)
+    return false;
+
+  std::vector<Message*> last(replay.domains.size(), 0);
+  for (auto m = replay.messages.begin(); m != replay.messages.end(); ++m) {
+    Message*& prev = last[m->domain_index];
+    if (prev != 0)
+      prev->n_records = m->sequence_number - prev->sequence_number;
+    prev = &*m;
+  }
+  for (unsigned int i = 0; i < replay.domains.size(); ++i)
+    if (last[i] != 0)
+      last[i]->n_records
+        = relay.get_sequence_number(replay.domains[i])
+        - last[i]->sequence_number;
+
+  for (auto m = replay.messages.begin(); m != replay.messages.end(); ++m)
+    replay.domain_records[m->domain_index] += m->n_records;
+
+  return true;
+}
+
+/** Opens one UDP socket per exporter, connected to the collector. */
+static bool open_sockets(std::vector<int>& sockets) {
+  struct addrinfo hints;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_DGRAM;
+
+  struct addrinfo* addresses = 0;
+  int ret = getaddrinfo(collector_host, collector_port, &hints, &addresses);
+  if (ret != 0) {
+    std::cerr << "Can't resolve " << collector_host << " port "
+              << collector_port << ": " << gai_strerror(ret) << std::endl;
+    return false;
+  }
+
+  bool ok = true;
+  for (unsigned int e = 0; ok && e < n_exporters; ++e) {
+    int fd = socket(addresses->ai_family, addresses->ai_socktype,
+                    addresses->ai_protocol);
+    if (fd < 0 || connect(fd, addresses->ai_addr, addresses->ai_addrlen) < 0) {
+      std::cerr << "Can't create socket for exporter " << e << ": "
+                << strerror(errno) << std::endl;
+      if (fd >= 0)
+        close(fd);
+      ok = false;
+    } else
+      sockets.push_back(fd);
+  }
+
+  freeaddrinfo(addresses);
+  return ok;
+}
+
+static double now() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/** Limits the rate at which records are sent. */
+class TokenBucket {
+public:
+  /** Creates a bucket.
+   *
+   * @param rate tokens per second, or 0 for no limit
+   * @param capacity the maximum number of tokens in the bucket
+   */
+  TokenBucket(double rate, double capacity)
+    : rate(rate), capacity(capacity), tokens(capacity), last(now()) {
+  }
+
+  /** Waits until the bucket holds n tokens, then takes them out. */
+  void take(uint32_t n) {
+    if (rate == 0)
+      return;
+
+    refill();
+    while (tokens < n && !stop_flag) {
+      double wait = (n - tokens) / rate;
+      struct timespec ts;
+      ts.tv_sec = static_cast<time_t>(wait);
+      ts.tv_nsec = static_cast<long>((wait - ts.tv_sec) * 1e9);
+      nanosleep(&ts, 0);
+      refill();
+    }
+    tokens -= n;
+  }
+
+private:
+  void refill() {
+    double t = now();
+    tokens = std::min(capacity, tokens + (t - last) * rate);
+    last = t;
+  }
+
+  double rate;
+  double capacity;
+  double tokens;
+  double last;
+};
+
+/** What has been sent so far. */
+struct Counters {
+  uint64_t messages;
+  uint64_t records;
+  uint64_t octets;
+  uint64_t errors;
+};
+
+static void
+report(const char* label, double seconds, const Counters& c) {
+  std::cerr << std::fixed << std::setprecision(1)
+            << label << std::setw(8) << seconds << " s:"
+            << std::setprecision(0)
+            << std::setw(12) << c.records / seconds << " rec/s";
+  if (records_per_second != 0)
+    std::cerr << std::setprecision(1)
+              << " (" << std::setw(5)
+              << 100.0 * c.records / seconds / records_per_second
+              << "% of " << records_per_second << ")";
+  std::cerr << std::setprecision(0)
+            << std::setw(10) << c.messages / seconds << " msg/s"
+            << std::setprecision(1)
+            << std::setw(9) << c.octets * 8 / seconds / 1e6 << " Mbit/s"
+            << std::setw(8) << c.errors << " errors" << std::endl;
+}
+
+static void encode32(uint32_t val, uint8_t* buf) {
+  buf[0] = (val >> 24) & 0xff;
+  buf[1] = (val >> 16) & 0xff;
+  buf[2] = (val >>  8) & 0xff;
+  buf[3] = (val >>  0) & 0xff;
+}
+
+static Counters replay_messages(Replay& replay,
+                                const std::vector<int>& sockets) {
+  uint32_t max_records = 0;
+  for (auto m = replay.messages.begin(); m != replay.messages.end(); ++m)
+    max_records = std::max(max_records, m->n_records);
+
+  /* A bucket smaller than the largest message would never fill up
+   * enough to send it.  By default, allow a burst of 10 ms. */
+  uint64_t capacity = burst != 0 ? burst : records_per_second / 100;
+  TokenBucket bucket(records_per_second, std::max<uint64_t>(capacity,
+                                                            max_records));
+
+  size_t n_domains = replay.domains.size();
+  Counters total = { 0, 0, 0, 0 };
+  Counters interval = total;
+
+  double start = now();
+  double last_report = start;
+
+  uint8_t header[kIpfixMessageHeaderLen];
+  ::iovec iov[2];
+  iov[0].iov_base = header;
+  iov[0].iov_len = sizeof(header);
+
+  struct msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = iov;
+  msg.msg_iovlen = 2;
+
+  for (uint64_t loop = 0; n_loops == 0 || loop < n_loops; ++loop) {
+    for (auto m = replay.messages.begin(); m != replay.messages.end(); ++m) {
+      iov[1].iov_base = &replay.bodies[m->offset];
+      iov[1].iov_len = m->length;
+
+      uint32_t sequence_number = m->sequence_number
+        + loop * replay.domain_records[m->domain_index];
+
+      for (unsigned int e = 0; e < sockets.size(); ++e) {
+        bucket.take(m->n_records);
+        if (stop_flag)
+          goto done;
+
+        uint32_t export_time = keep_time_flag ? m->export_time : time(0);
+        uint32_t domain = domain_base + e*n_domains + m->domain_index;
+
+        header[0] = kIpfixVersion >> 8;
+        header[1] = kIpfixVersion & 0xff;
+        header[2] = (kIpfixMessageHeaderLen + m->length) >> 8;
+        header[3] = (kIpfixMessageHeaderLen + m->length) & 0xff;
+        encode32(export_time, header + 4);
+        encode32(sequence_number, header + 8);
+        encode32(domain, header + 12);
+
+        if (sendmsg(sockets[e], &msg, 0) < 0)
+          interval.errors++;
+        else {
+          interval.messages++;
+          interval.records += m->n_records;
+          interval.octets += kIpfixMessageHeaderLen + m->length;
+        }
+      }
+
+      double t = now();
+      if (report_interval != 0 && t - last_report >= report_interval) {
+        report("  ", t - last_report, interval);
+        total.messages += interval.messages;
+        total.records += interval.records;
+        total.octets += interval.octets;
+        total.errors += interval.errors;
+        interval = Counters { 0, 0, 0, 0 };
+        last_report = t;
+      }
+      if (duration != 0 && t - start >= duration)
+        goto done;
+    }
+  }
+
+ done:
+  total.messages += interval.messages;
+  total.records += interval.records;
+  total.octets += interval.octets;
+  total.errors += interval.errors;
+  report("total", now() - start, total);
+  return total;
+}
+
+int main(int argc, char* const* argv) {
+#ifdef _libfc_HAVE_LOG4CPLUS_
+  log4cplus::PropertyConfigurator config("log4cplus.properties");
+  config.configure();
+#endif /* _libfc_HAVE_LOG4CPLUS_ */
+
+  parse_options(argc, argv);
+
+  if (help_flag) {
+    help();
+    return EXIT_SUCCESS;
+  }
+
+  Replay replay;
+  if (!load(replay))
+    return EXIT_FAILURE;
+
+  if (replay.messages.empty()) {
+    std::cerr << "Nothing to replay" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  uint64_t n_records = 0;
+  for (auto r = replay.domain_records.begin();
+       r != replay.domain_records.end(); ++r)
+    n_records += *r;
+  std::cerr << "Replaying " << replay.messages.size() << " messages with "
+            << n_records << " records in " << replay.domains.size()
+            << " domains as " << n_exporters << " exporters to "
+            << collector_host << " port " << collector_port << std::endl;
+
+  std::vector<int> sockets;
+  bool ok = open_sockets(sockets);
+
+  if (ok) {
+    signal(SIGINT, handle_signal);
+    signal(SIGTERM, handle_signal);
+    Counters total = replay_messages(replay, sockets);
+    ok = total.errors == 0;
+  }
+
+  for (auto s = sockets.begin(); s != sockets.end(); ++s)
+    close(*s);
+
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -58,12 +58,29 @@ struct libftrace_st {
     pthread_cond_t          rok;
     /** reader thread */
     pthread_t               rt;
-    /* storage for uniflow */
+    /* storage for uniflow returned by ftrace_next_uniflow() */
     libftrace_uniflow_t     uf;
+    /* placement target for the record being read */
+    libftrace_uniflow_t     cur;
     /** valid record flag */
     int                     valid;
     /* abort flag */
     int                     terminate;
+    /** reader thread has exited */
+    int                     done;
+    /** reader wants records; the destination belongs to the
+        reader thread while this is set */
+    int                     want;
+    /** destination rows, or NULL */
+    libftrace_uniflow_t     *dest_rows;
+    /** destination columns, or NULL */
+    libftrace_uniflow_columns_t *dest_cols;
+    /** capacity of the destination */
+    int                     dest_cap;
+    /** records stored in the destination */
+    int                     dest_len;
+    /** reader thread is filling the destination; reader thread only */
+    int                     filling;
 };
 
 /** Open a libftrace source on an IPFIX/PDU file */
@@ -131,24 +148,69 @@ void ftrace_destroy(libftrace_t *ft)
     }
 }
 
+#define FTRACE_COL(col, type, val) \
+    if (c->col) ((type *)c->col)[i] = (val)
+
+/* Store the current uniflow in the destination. Reader thread only. */
+static void _ftrace_store(libftrace_t *ft)
+{
+    libftrace_uniflow_columns_t *c = ft->dest_cols;
+    int i = ft->dest_len++;
+
+    if (!c) {
+        ft->dest_rows[i] = ft->cur;
+        return;
+    }
+
+    FTRACE_COL(time_start, uint64_t, ft->cur.time_start);
+    FTRACE_COL(time_end, uint64_t, ft->cur.time_end);
+    FTRACE_COL(packets, uint64_t, ft->cur.packets);
+    FTRACE_COL(octets, uint64_t, ft->cur.octets);
+    FTRACE_COL(port_src, uint16_t, ft->cur.port_src);
+    FTRACE_COL(port_dst, uint16_t, ft->cur.port_dst);
+    FTRACE_COL(ip_ver, uint8_t, ft->cur.ip_ver);
+    FTRACE_COL(ip_proto, uint8_t, ft->cur.ip_proto);
+    if (ft->cur.ip_ver == 4) {
+        FTRACE_COL(src_v4, uint32_t, ft->cur.ip.v4.src);
+        FTRACE_COL(dst_v4, uint32_t, ft->cur.ip.v4.dst);
+    } else {
+        if (c->src_v6) memcpy(c->src_v6[i], ft->cur.ip.v6.src, 16);
+        if (c->dst_v6) memcpy(c->dst_v6[i], ft->cur.ip.v6.dst, 16);
+    }
+}
+
+#undef FTRACE_COL
+
 static int _ftrace_semcb_inner(libftrace_t *ft)
 {
+    /* wait for a destination, unless we're already filling one;
+       this is the only place where the reader thread blocks */
+    if (!ft->filling) {
+        pthread_mutex_lock(&ft->mux);
+        while (!ft->want && !ft->terminate)
+            pthread_cond_wait(&ft->wok, &ft->mux);
+        pthread_mutex_unlock(&ft->mux);
+        ft->filling = 1;
+    }
+
     /* check terminate signal */
     if (ft->terminate) {
         fprintf(stderr,"_ftrace_semcb_inner() telling placement collector to stop.\n");
         return 0;
     }
 
-    /* signal read ready, outer thread will now return a record */
-    pthread_mutex_lock(&ft->mux);
-    pthread_cond_signal(&ft->rok);
-//    fprintf(stderr,"_ftrace_semcb_inner() signaled rok, waiting for wok.\n");
+    _ftrace_store(ft);
+
+    /* hand the destination back only once it is full, so that the
+       threads synchronize once per batch, not once per record */
+    if (ft->dest_len == ft->dest_cap) {
+        ft->filling = 0;
+        pthread_mutex_lock(&ft->mux);
+        ft->want = 0;
+        pthread_cond_signal(&ft->rok);
+        pthread_mutex_unlock(&ft->mux);
+    }
 
-    /* wait write ready, since next placement will happen after return */
-    pthread_cond_wait(&ft->wok, &ft->mux);
-    pthread_mutex_unlock(&ft->mux);
-//    fprintf(stderr,"_ftrace_semcb_inner() got wok.\n");
-    
     /* tell placement collector to keep going */
     return 1;
 }
@@ -157,7 +219,7 @@ static int _ftrace_semcb_v4(const struct libfc_template_t *t, void *vpft) {
     libftrace_t *ft = (libftrace_t *)vpft;
 
     /* set version */
-    ft->uf.ip_ver = 4;
+    ft->cur.ip_ver = 4;
 
     /* signal flow ready */
     return _ftrace_semcb_inner(ft);
@@ -167,7 +229,7 @@ static int _ftrace_semcb_v6(const struct libfc_template_t *t, void *vpft) {
     libftrace_t *ft = (libftrace_t *)vpft;
 
     /* set version */
-    ft->uf.ip_ver = 6;
+    ft->cur.ip_ver = 6;
 
     /* signal flow ready */
     return _ftrace_semcb_inner(ft);
@@ -194,8 +256,11 @@ void *_ftrace_rthread(void *vpft) {
     
     fprintf(stderr, "reader thread exiting, return value %d\n", rv);
 
-    /* signal read ready, outer thread will react to invalid record. */
+    /* signal read ready, outer thread will return the partial batch
+       and then react to the invalid record. */
     pthread_mutex_lock(&ft->mux);
+    ft->done = 1;
+    ft->want = 0;
     pthread_cond_signal(&ft->rok);
     pthread_mutex_unlock(&ft->mux);
     fprintf(stderr,"_ftrace_rthread() signaled rok on exit.\n");
@@ -216,51 +281,52 @@ libftrace_uniflow_t *ftrace_start_uniflow(libftrace_t *ft)
     /* register base template v4 */
     t = libfc_template_new(ft->tg);
     libfc_register_placement(t, "flowStartMilliseconds", 
-        &ft->uf.time_start, sizeof(ft->uf.time_start));
+        &ft->cur.time_start, sizeof(ft->cur.time_start));
     libfc_register_placement(t, "flowEndMilliseconds", 
-        &ft->uf.time_end, sizeof(ft->uf.time_end));
+        &ft->cur.time_end, sizeof(ft->cur.time_end));
     libfc_register_placement(t, "packetDeltaCount", 
-        &ft->uf.packets, sizeof(ft->uf.packets));
+        &ft->cur.packets, sizeof(ft->cur.packets));
     libfc_register_placement(t, "octetDeltaCount", 
-        &ft->uf.octets, sizeof(ft->uf.octets));
+        &ft->cur.octets, sizeof(ft->cur.octets));
     libfc_register_placement(t, "sourceIPv4Address", 
-        &ft->uf.ip.v4.src, sizeof(ft->uf.ip.v4.src));
+        &ft->cur.ip.v4.src, sizeof(ft->cur.ip.v4.src));
     libfc_register_placement(t, "destinationIPv4Address", 
-        &ft->uf.ip.v4.dst, sizeof(ft->uf.ip.v4.dst));
+        &ft->cur.ip.v4.dst, sizeof(ft->cur.ip.v4.dst));
     libfc_register_placement(t, "sourceTransportPort",
-        &ft->uf.port_src, sizeof(ft->uf.port_src));
+        &ft->cur.port_src, sizeof(ft->cur.port_src));
     libfc_register_placement(t, "destinationTransportPort",
-        &ft->uf.port_dst, sizeof(ft->uf.port_dst));
+        &ft->cur.port_dst, sizeof(ft->cur.port_dst));
     libfc_register_placement(t, "protocolIdentifier",
-        &ft->uf.ip_proto, sizeof(ft->uf.ip_proto));
+        &ft->cur.ip_proto, sizeof(ft->cur.ip_proto));
     libfc_register_callback(t, _ftrace_semcb_v4, ft);
 
     /* register base template v6 */
     t = libfc_template_new(ft->tg);
     libfc_register_placement(t, "flowStartMilliseconds", 
-        &ft->uf.time_start, sizeof(ft->uf.time_start));
+        &ft->cur.time_start, sizeof(ft->cur.time_start));
     libfc_register_placement(t, "flowEndMilliseconds", 
-        &ft->uf.time_end, sizeof(ft->uf.time_end));
+        &ft->cur.time_end, sizeof(ft->cur.time_end));
     libfc_register_placement(t, "packetDeltaCount", 
-        &ft->uf.packets, sizeof(ft->uf.packets));
+        &ft->cur.packets, sizeof(ft->cur.packets));
     libfc_register_placement(t, "octetDeltaCount", 
-        &ft->uf.octets, sizeof(ft->uf.octets));
+        &ft->cur.octets, sizeof(ft->cur.octets));
     libfc_register_placement(t, "sourceIPv6Address", 
-        &ft->uf.ip.v4.src, sizeof(ft->uf.ip.v4.src));
+        ft->cur.ip.v6.src, sizeof(ft->cur.ip.v6.src));
     libfc_register_placement(t, "destinationIPv6Address", 
-        &ft->uf.ip.v4.dst, sizeof(ft->uf.ip.v4.dst));
+        ft->cur.ip.v6.dst, sizeof(ft->cur.ip.v6.dst));
     libfc_register_placement(t, "sourceTransportPort",
-        &ft->uf.port_src, sizeof(ft->uf.port_src));
+        &ft->cur.port_src, sizeof(ft->cur.port_src));
     libfc_register_placement(t, "destinationTransportPort",
-        &ft->uf.port_dst, sizeof(ft->uf.port_dst));
+        &ft->cur.port_dst, sizeof(ft->cur.port_dst));
     libfc_register_placement(t, "protocolIdentifier",
-        &ft->uf.ip_proto, sizeof(ft->uf.ip_proto));
+        &ft->cur.ip_proto, sizeof(ft->cur.ip_proto));
     libfc_register_callback(t, _ftrace_semcb_v6, ft);
 
     /* FIXME more templates */
 
     /* make the reference circular so we know we started a uniflow */
     ft->uf._ft = ft;
+    ft->cur._ft = ft;
     
     /* then start the reader thread */
     if ((pterrno = pthread_create(&ft->rt, NULL, _ftrace_rthread, ft)) != 0) {
@@ -273,13 +339,11 @@ libftrace_uniflow_t *ftrace_start_uniflow(libftrace_t *ft)
 
 /** Stop reading a uniflow source */
 void ftrace_destroy_uniflow(libftrace_uniflow_t *uf) {
-    if (!uf->_ft->terminate) {
-        /* signal inner uniflow to stop reading unless eof */
-        pthread_mutex_lock(&uf->_ft->mux);
-        uf->_ft->terminate++;
-        pthread_cond_signal(&uf->_ft->wok);
-        pthread_mutex_unlock(&uf->_ft->mux);
-    }
+    /* signal inner uniflow to stop reading unless eof */
+    pthread_mutex_lock(&uf->_ft->mux);
+    uf->_ft->terminate++;
+    pthread_cond_signal(&uf->_ft->wok);
+    pthread_mutex_unlock(&uf->_ft->mux);
 
     if (pthread_join(uf->_ft->rt, NULL) != 0) {
         /* FIXME error */
@@ -287,22 +351,51 @@ void ftrace_destroy_uniflow(libftrace_uniflow_t *uf) {
     }
 }
 
+/* Let the reader thread fill a destination, and wait until it is
+   full or the reader thread has exited. Returns the number of
+   records stored, 0 at end of file, or -1 on error. */
+static int _ftrace_fill(libftrace_t *ft, libftrace_uniflow_t *rows,
+                        libftrace_uniflow_columns_t *cols, int n)
+{
+    int len;
+
+    if (n <= 0) return 0;
+
+    pthread_mutex_lock(&ft->mux);
+    if (!ft->done) {
+        ft->dest_rows = rows;
+        ft->dest_cols = cols;
+        ft->dest_cap = n;
+        ft->dest_len = 0;
+        ft->want = 1;
+        pthread_cond_signal(&ft->wok);
+        while (ft->want)
+            pthread_cond_wait(&ft->rok, &ft->mux);
+        len = ft->dest_len;
+        ft->dest_len = 0;
+    } else {
+        len = 0;
+    }
+    pthread_mutex_unlock(&ft->mux);
+
+    if (len > 0) return len;
+    return ft->valid < 0 ? -1 : 0;
+}
+
 /** Read the next uniflow from a libftrace reader. 
     Skips records in the stream which do not match uniflows. */
 int ftrace_next_uniflow(libftrace_uniflow_t *uf) {
-    
-    /* signal write ready */
-    pthread_mutex_lock(&uf->_ft->mux);
-    pthread_cond_signal(&uf->_ft->wok);
-//    fprintf(stderr,"next_uniflow() signaled wok, waiting for rok.\n");
+    return _ftrace_fill(uf->_ft, uf, NULL, 1);
+}
 
-    /* wait read ready */
-    pthread_cond_wait(&uf->_ft->rok, &uf->_ft->mux);
-    pthread_mutex_unlock(&uf->_ft->mux);
-//    fprintf(stderr,"next_uniflow() got rok.\n");
+int ftrace_next_uniflows(libftrace_t *ft, libftrace_uniflow_t *uf_array,
+                         int n) {
+    return _ftrace_fill(ft, uf_array, NULL, n);
+}
 
-    /* check valid */
-    return uf->_ft->valid;
+int ftrace_next_uniflow_columns(libftrace_t *ft,
+                                libftrace_uniflow_columns_t *cols, int n) {
+    return _ftrace_fill(ft, NULL, cols, n);
 }
 
 int ftrace_add_specfile(libftrace_t *ft, const char *specfilename) {
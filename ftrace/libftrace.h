@@ -47,6 +47,10 @@
 
 #include "libfc.h"
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 /** Opaque structure representing a libftrace source */
 struct libftrace_st;
 typedef struct libftrace_st libftrace_t;
@@ -105,6 +109,38 @@ typedef struct libftrace_uniflow_st {
   uint8_t         tcp_flags;
 } libftrace_uniflow_t;
 
+/** Column-major storage for a batch of unidirectional flows.
+    Each member points to an array with room for as many flows as
+    are requested; members that are NULL are not filled in. Only one
+    of the IPv4 and IPv6 address arrays is filled in for each flow,
+    according to ip_ver. */
+typedef struct libftrace_uniflow_columns_st {
+  /** Flow start times in POSIX epoch milliseconds */
+  uint64_t        *time_start;
+  /** Flow end times in POSIX epoch milliseconds */
+  uint64_t        *time_end;
+  /** Packet counts */
+  uint64_t        *packets;
+  /** Octet counts */
+  uint64_t        *octets;
+  /** IPv4 source addresses */
+  uint32_t        *src_v4;
+  /** IPv4 destination addresses */
+  uint32_t        *dst_v4;
+  /** IPv6 source addresses (network byte order) */
+  uint8_t         (*src_v6)[16];
+  /** IPv6 destination addresses (network byte order) */
+  uint8_t         (*dst_v6)[16];
+  /** Source TCP or UDP ports */
+  uint16_t        *port_src;
+  /** Destination TCP or UDP ports */
+  uint16_t        *port_dst;
+  /** IP versions (4 or 6) */
+  uint8_t         *ip_ver;
+  /** IP protocol identifiers */
+  uint8_t         *ip_proto;
+} libftrace_uniflow_columns_t;
+
 /** Add IESpecs from a specfile to the information model */
 int ftrace_add_specfile(libftrace_t *ft, const char *specfilename);
 
@@ -126,5 +162,24 @@ void ftrace_destroy_uniflow(libftrace_uniflow_t *uf);
     Skips records in the stream which do not match uniflows. */
 int ftrace_next_uniflow(libftrace_uniflow_t *uf);
 
+/** Read up to n uniflows from a libftrace reader into an array.
+    ftrace_start_uniflow() must have been called first.
+    The reader thread hands over records once per batch instead of
+    once per record, so this is much cheaper per record than
+    ftrace_next_uniflow() for large n. Returns the number of uniflows
+    read, which is less than n only at the end of the stream, 0 at
+    end of stream, or -1 on error. */
+int ftrace_next_uniflows(libftrace_t *ft, libftrace_uniflow_t *uf_array, int n);
+
+/** Read up to n uniflows from a libftrace reader into column arrays.
+    Like ftrace_next_uniflows(), but stores each field in its own
+    array, for consumers that process one field of many flows at a
+    time. */
+int ftrace_next_uniflow_columns(libftrace_t *ft,
+                                libftrace_uniflow_columns_t *cols, int n);
+
+#ifdef __cplusplus
+}
+#endif
 
 #endif /* idem hack */
@@ -30,7 +30,7 @@
  * From Brian's ipfix2csv Python utility.
  *
  * Syntax: ipfix2csv [--version={5|9|10}|-v {5|9|10} [-s iespec-file] \
- *     [ienames...] [message-stream]
+ *     [-i input-glob]... [-j jobs] [-o output-dir] [ienames...]
  *
  * E.g. ./ipfix2csv -s qof.iespec \
  *     sourceIPv4Address destinationIPv4Address 
@@ -44,6 +44,12 @@
  *     sourceIPv4Address destinationIPv4Address             \
  *     meanTcpRttMilliseconds reverseMeanTcpRttMilliseconds
  *
+ * Or, converting a day's worth of files on eight threads into one
+ * CSV stream in file name order:
+ *
+ * ./ipfix2csv -j 8 --input='/zp0/statdat/20140430-*.ipfix.gz' \
+ *     sourceIPv4Address destinationIPv4Address > 20140430.csv
+ *
  * Or:
  *
  * ./ipfix2csv \
@@ -71,16 +77,30 @@
  *
  * @author Stephan Neuhaus <neuhaust@tik.ee.ethz.ch>
  */
+#include <algorithm>
 #include <cassert>
+#include <cerrno>
 #include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <condition_variable>
 #include <ctime>
 #include <fstream>
-#include <iomanip>
 #include <iostream>
 #include <list>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
 
+#include <fcntl.h>
 #include <getopt.h>
+#include <glob.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
+#include "ArrowCollector.h"
+#include "FileExportDestination.h"
 #include "FileInputSource.h"
 #include "InfoElement.h"
 #include "InfoModel.h"
@@ -103,7 +123,27 @@ static int help_flag = false;
 static int message_version = 10;
 static int full_type_flag = 0;
 static std::list<const char*> ie_names;
-static std::string filename;
+static std::vector<std::string> input_names;
+static unsigned int n_jobs = 0;
+static const char* output_dir = 0;
+static int arrow_flag = 0;
+static size_t batch_size = ArrowCollector::default_batch_size;
+
+/** Adds the files matching a glob pattern to the list of inputs. */
+static void add_inputs(const char* pattern) {
+  glob_t g;
+
+  int ret = glob(pattern, GLOB_NOCHECK, 0, &g);
+  if (ret != 0) {
+    std::cerr << "Can't expand input \"" << pattern << "\"" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  for (size_t i = 0; i < g.gl_pathc; ++i)
+    input_names.push_back(g.gl_pathv[i]);
+
+  globfree(&g);
+}
 
 /* Code patterned after http://www.gnu.org/software/libc/
  * manual/html_node/Getopt-Long-Option-Example.html
@@ -112,8 +152,12 @@ static void parse_options(int argc, char* const* argv) {
 
   while (1) {
     static struct option options[] = {
+      { "arrow", no_argument, &arrow_flag, 1 },
+      { "batch-size", required_argument, 0, 'b' },
       { "help", no_argument, &help_flag, 1 },
       { "input", required_argument, 0, 'i' },
+      { "jobs", required_argument, 0, 'j' },
+      { "output-dir", required_argument, 0, 'o' },
       { "verbose", no_argument, &verbose_flag, 1 },
       { "message-version", required_argument, 0, 'm' },
       { "specfile", required_argument, 0, 's' },
@@ -123,7 +167,7 @@ static void parse_options(int argc, char* const* argv) {
 
     int option_index = 0;
 
-    int c = getopt_long(argc, argv, "hi:m:s:tv", options, &option_index);
+    int c = getopt_long(argc, argv, "ab:hi:j:m:o:s:tv", options, &option_index);
 
     if (c == -1)
       break;
@@ -137,8 +181,30 @@ static void parse_options(int argc, char* const* argv) {
         std::cerr << " with arg \"" << optarg << "\"";
       std::cerr << std::endl;
       break;
+    case 'a':
+      arrow_flag = 1;
+      break;
+    case 'b':
+      batch_size = strtoul(optarg, 0, 10);
+      if (batch_size == 0) {
+        std::cerr << "Batch size must be positive, got " << optarg
+                  << std::endl;
+        exit(EXIT_FAILURE);
+      }
+      break;
     case 'i':
-      filename = optarg;
+      add_inputs(optarg);
+      break;
+    case 'j':
+      n_jobs = atoi(optarg);
+      if (n_jobs == 0) {
+        std::cerr << "Number of jobs must be positive, got " << optarg
+                  << std::endl;
+        exit(EXIT_FAILURE);
+      }
+      break;
+    case 'o':
+      output_dir = optarg;
       break;
     case 'm':
       message_version = atoi(optarg);
@@ -168,6 +234,24 @@ static void parse_options(int argc, char* const* argv) {
 static void help() {
   std::cerr << "usage: ./ipfix2csv [options] ie-names..." << std::endl
             << "Options:" << std::endl
+            << "  -a|--arrow\twrite an Arrow IPC (Feather) file instead of CSV;"
+            << std::endl
+            << "\twithout -o, all inputs are collected in order into one file"
+            << std::endl
+            << "  -b n|--batch-size=n" << std::endl
+            << "\tput N rows into each Arrow record batch" << std::endl
+            << "  -i file|--input=file" << std::endl
+            << "\tread FILE (may be a glob and may be given several times;"
+            << std::endl
+            << "\tdefault is stdin)" << std::endl
+            << "  -j n|--jobs=n\tconvert N inputs in parallel" << std::endl
+            << "  -o dir|--output-dir=dir" << std::endl
+            << "\twrite one CSV file per input into DIR instead of merging"
+            << std::endl
+            << "\tall inputs into stdout in input order; the input's path"
+            << std::endl
+            << "\tis kept below DIR, which is created if it doesn't exist"
+            << std::endl
             << "  -s file|--specfile=file" << std::endl
             << "\tuse FILE as IE spec filename" << std::endl
             << "  -h|--help\tprint this help text" << std::endl
@@ -194,215 +278,398 @@ add_ies_from_spec_file() {
 }
 
 
-static void
-print_unsigned(std::ostream& os, const IEType* type, void* v) {
-  switch (type->number()) {
-  case IEType::kUnsigned8: os << static_cast<int>(*static_cast<uint8_t*>(v)); break;
-  case IEType::kUnsigned16: os << *static_cast<uint16_t*>(v); break;
-  case IEType::kUnsigned32: os << *static_cast<uint32_t*>(v); break;
-  case IEType::kUnsigned64: os << *static_cast<uint64_t*>(v); break;
-  default: /* Can't happen, ignore silently */ break;
+/** Buffered writer for CSV output.
+ *
+ * Rows are formatted directly into a large buffer that is handed to
+ * write(2) in blocks, instead of going through an std::ostream with a
+ * flush per record.  Integers, addresses and timestamps are formatted
+ * by hand; the calendar part of a timestamp is cached per second,
+ * since consecutive flow records tend to have nearly identical
+ * timestamps.
+ *
+ * A writer either writes to a file descriptor or appends its blocks
+ * to a string, so that the output of an input converted on a worker
+ * thread can be held back until it is its turn to be printed.
+ */
+class CSVWriter {
+public:
+  /** The maximum number of bytes a single rendered value can take. */
+  static const size_t max_field_len = 64;
+
+  explicit CSVWriter(int fd, size_t capacity = 1 << 20)
+    : fd(fd), sink(0), buf(new char[capacity]), cur(buf),
+      end(buf + capacity - max_field_len), cached_second(-1) {
+    assert(capacity > 2*max_field_len);
   }
-  
-  if (full_type_flag) {
-    switch (type->number()) {
-    case IEType::kUnsigned8: os << "U"; break;
-    case IEType::kUnsigned16: os << "U"; break;
-    case IEType::kUnsigned32: os << "UL"; break;
-    case IEType::kUnsigned64: os << "ULL"; break;
-    default: /* Can't happen, ignore silently */ break;
+
+  explicit CSVWriter(std::string* sink, size_t capacity = 1 << 16)
+    : fd(-1), sink(sink), buf(new char[capacity]), cur(buf),
+      end(buf + capacity - max_field_len), cached_second(-1) {
+    assert(capacity > 2*max_field_len);
+  }
+
+  ~CSVWriter() {
+    flush();
+    delete[] buf;
+  }
+
+  /** Makes sure that at least n bytes can be appended. */
+  void reserve(size_t n) {
+    if (cur + n > end)
+      flush();
+  }
+
+  /** Appends a single character.  There is always room for a few of
+   * these, since the buffer has max_field_len bytes of slack beyond
+   * end. */
+  void put(char c) {
+    *cur++ = c;
+  }
+
+  void put(const char* s, size_t n) {
+    if (cur + n > end) {
+      flush();
+      if (n > static_cast<size_t>(end - buf)) {
+        write_fully(s, n);
+        return;
+      }
     }
+    memcpy(cur, s, n);
+    cur += n;
   }
-}
 
-static void
-print_signed(std::ostream& os, const IEType* type, void* v) {
-  switch (type->number()) {
-  case IEType::kSigned8: os << static_cast<int>(*static_cast<int8_t*>(v)); break;
-  case IEType::kSigned16: os << *static_cast<int16_t*>(v); break;
-  case IEType::kSigned32: os << *static_cast<int32_t*>(v); break;
-  case IEType::kSigned64: os << *static_cast<int64_t*>(v); break;
-  default: /* Can't happen, ignore silently */ break;
+  void put(const char* s) {
+    put(s, strlen(s));
   }
 
-  if (full_type_flag) {
-    switch (type->number()) {
-    case IEType::kSigned8: break;
-    case IEType::kSigned16: break;
-    case IEType::kSigned32: os << "L"; break;
-    case IEType::kSigned64: os << "LL"; break;
-    default: /* Can't happen, ignore silently */ break;
+  void put_unsigned(uint64_t v) {
+    char tmp[20];
+    char* p = tmp + sizeof(tmp);
+
+    while (v >= 100) {
+      p -= 2;
+      memcpy(p, digit_pairs + 2*(v % 100), 2);
+      v /= 100;
     }
+    if (v >= 10) {
+      p -= 2;
+      memcpy(p, digit_pairs + 2*v, 2);
+    } else
+      *--p = '0' + v;
+
+    size_t n = tmp + sizeof(tmp) - p;
+    memcpy(cur, p, n);
+    cur += n;
   }
-}
 
-static void
-print_ipv4address(std::ostream& os, const IEType* type, void* v) {
-  uint32_t val = *static_cast<uint32_t*>(v);
-  os << ((val >> 24) & 0xff) 
-     << '.' << ((val >> 16) & 0xff) 
-     << '.' << ((val >>  8) & 0xff) 
-     << '.' << ((val >>  0) & 0xff);
-}
+  void put_signed(int64_t v) {
+    if (v < 0) {
+      *cur++ = '-';
+      /* Negate in unsigned arithmetic so that INT64_MIN works. */
+      put_unsigned(-static_cast<uint64_t>(v));
+    } else
+      put_unsigned(v);
+  }
 
-static void
-print_ipv6address(std::ostream& os, const IEType* type, void* v) {
-  uint8_t* val = static_cast<uint8_t*>(v);
-  unsigned int i = 0;
-  std::ios_base::fmtflags f = os.flags();
+  /** Appends exactly two decimal digits. */
+  void put_2digits(unsigned int v) {
+    assert(v < 100);
+    memcpy(cur, digit_pairs + 2*v, 2);
+    cur += 2;
+  }
 
-  os << std::hex;
+  void put_hex(unsigned int v) {
+    char tmp[8];
+    char* p = tmp + sizeof(tmp);
 
-  while (i < 16) {
-    if (val[i] == 0) {
-      os << ':';
-      ++i;
-      while (i < 16 && val[i] == 0)
+    do {
+      *--p = hex_digits[v & 0xf];
+      v >>= 4;
+    } while (v != 0);
+
+    size_t n = tmp + sizeof(tmp) - p;
+    memcpy(cur, p, n);
+    cur += n;
+  }
+
+  void put_ipv4address(uint32_t val) {
+    put_unsigned((val >> 24) & 0xff); put('.');
+    put_unsigned((val >> 16) & 0xff); put('.');
+    put_unsigned((val >>  8) & 0xff); put('.');
+    put_unsigned((val >>  0) & 0xff);
+  }
+
+  /** Appends an IPv6 address in the canonical form of RFC 5952. */
+  void put_ipv6address(const uint8_t* val) {
+    uint16_t groups[8];
+    for (unsigned int i = 0; i < 8; ++i)
+      groups[i] = (val[2*i] << 8) | val[2*i + 1];
+
+    /* Find the longest run of at least two zero groups. */
+    int best_start = -1;
+    int best_len = 1;
+    for (int i = 0; i < 8; ) {
+      if (groups[i] != 0) {
         ++i;
-    } else {
+        continue;
+      }
+      int j = i;
+      while (j < 8 && groups[j] == 0)
+        ++j;
+      if (j - i > best_len) {
+        best_start = i;
+        best_len = j - i;
+      }
+      i = j;
+    }
+
+    for (int i = 0; i < 8; ++i) {
+      if (i == best_start) {
+        put(':');
+        if (i == 0)
+          put(':');
+        i += best_len - 1;
+        continue;
+      }
+      put_hex(groups[i]);
+      if (i < 7)
+        put(':');
+    }
+  }
+
+  void put_macaddress(const uint8_t* val) {
+    for (unsigned int i = 0; i < 6; i++) {
       if (i > 0)
-        os << ':';
-      os << val[i];
+        put(':');
+      put(hex_digits[(val[i] >> 4) & 0x0f]);
+      put(hex_digits[(val[i] >> 0) & 0x0f]);
     }
-    ++i;
   }
 
-  os.flags(f);
-}
+  /** Appends a timestamp as YYYY-MM-DDTHH:MM:SS.F, where F are the
+   * significant digits of the nanosecond fraction.  Timestamps whose
+   * year has more than four digits are appended as seconds since the
+   * epoch instead, as S.F. */
+  void put_iso_datetime(time_t seconds, uint32_t fraction) {
+    if (seconds != cached_second) {
+      struct tm tm;
+      if (gmtime_r(&seconds, &tm) == 0
+          || tm.tm_year + 1900 < 0 || tm.tm_year + 1900 > 9999) {
+        put_signed(seconds);
+        put('.');
+        put_fraction(fraction);
+        return;
+      }
+      format_iso_datetime(&tm);
+      cached_second = seconds;
+    }
+    memcpy(cur, cached_datetime, sizeof(cached_datetime));
+    cur += sizeof(cached_datetime);
+    put_fraction(fraction);
+  }
 
-static void
-print_macaddress(std::ostream& os, const IEType* type, void* v) {
-  uint8_t* val = static_cast<uint8_t*>(v);
-  
-  for (unsigned int i = 0; i < 6; i++) {
-    unsigned char un = (val[i] >> 4) & 0x0f;
-    unsigned char ln = (val[i] >> 0) & 0x0f;
+  /** Appends the significant digits of a nanosecond fraction. */
+  void put_fraction(uint32_t fraction) {
+    char digits[9];
+    for (int i = 8; i >= 0; --i) {
+      digits[i] = '0' + fraction % 10;
+      fraction /= 10;
+    }
 
-    if (i > 0)
-      os << ':';
-    os << un << ln;
+    size_t n = sizeof(digits);
+    while (n > 1 && digits[n - 1] == '0')
+      --n;
+    memcpy(cur, digits, n);
+    cur += n;
   }
-}
 
-static char
-to_digit(unsigned int d) {
-  assert(0 <= d && d < 10);
-  switch(d) {
-  case 0: return '0';
-  case 1: return '1';
-  case 2: return '2';
-  case 3: return '3';
-  case 4: return '4';
-  case 5: return '5';
-  case 6: return '6';
-  case 7: return '7';
-  case 8: return '8';
-  case 9: return '9';
-  }
-  assert(d == 0);               /* Will evaluate to false. */
-  return '\0';                  /* Shut up compiler. */
-}
+  /** Appends a double in the same format as std::ostream would. */
+  void put_double(double d) {
+    int n = snprintf(cur, max_field_len, "%g", d);
+    assert(0 < n && static_cast<size_t>(n) < max_field_len);
+    cur += n;
+  }
 
-static void
-print_iso_datetime(std::ostream& os, struct tm* tm, uint64_t fraction) {
-  char buf[21];
-  char* p = buf;
+  /** Ends the current row, writing out the buffer if it is nearly
+   * full. */
+  void end_row() {
+    *cur++ = '\n';
+    if (cur + 2*max_field_len > end)
+      flush();
+  }
 
-  assert(p + 5 < buf + sizeof(buf));
-  tm->tm_year += 1900;
-  assert(tm->tm_year < 10000);
-  *(p + 3) = to_digit(tm->tm_year % 10); tm->tm_year /= 10;
-  *(p + 2) = to_digit(tm->tm_year % 10); tm->tm_year /= 10;
-  *(p + 1) = to_digit(tm->tm_year % 10); tm->tm_year /= 10;
-  *(p + 0) = to_digit(tm->tm_year % 10);
+  void flush() {
+    write_fully(buf, cur - buf);
+    cur = buf;
+  }
 
-  p += 4; *p++ = '-';
+private:
+  void write_fully(const char* p, size_t n) {
+    if (sink != 0) {
+      sink->append(p, n);
+      return;
+    }
 
-  assert(p + 3 < buf + sizeof(buf));
-  tm->tm_mon++;
-  assert(1 <= tm->tm_mon && tm->tm_mon <= 12);
-  *(p + 1) = to_digit(tm->tm_mon % 10); tm->tm_mon /= 10;
-  *(p + 0) = to_digit(tm->tm_mon % 10);
+    while (n > 0) {
+      ssize_t written = ::write(fd, p, n);
+      if (written < 0) {
+        if (errno == EINTR)
+          continue;
+        std::cerr << "Can't write output: " << strerror(errno) << std::endl;
+        exit(EXIT_FAILURE);
+      }
+      p += written;
+      n -= written;
+    }
+  }
 
-  p += 2; *p++ = '-';
+  void format_iso_datetime(const struct tm* tm) {
+    char* saved_cur = cur;
+    unsigned int year = tm->tm_year + 1900;
+
+    assert(0 <= tm->tm_mon && tm->tm_mon < 12);
+    assert(1 <= tm->tm_mday && tm->tm_mday <= 31);
+    assert(0 <= tm->tm_hour && tm->tm_hour < 24);
+    assert(0 <= tm->tm_min && tm->tm_min < 60);
+    assert(0 <= tm->tm_sec && tm->tm_sec <= 60); // Leap second
+
+    cur = cached_datetime;
+    put_2digits(year / 100); put_2digits(year % 100); put('-');
+    put_2digits(tm->tm_mon + 1); put('-');
+    put_2digits(tm->tm_mday); put('T');
+    put_2digits(tm->tm_hour); put(':');
+    put_2digits(tm->tm_min); put(':');
+    put_2digits(tm->tm_sec); put('.');
+    assert(cur == cached_datetime + sizeof(cached_datetime));
+    cur = saved_cur;
+  }
 
-  assert(p + 3 < buf + sizeof(buf));
-  assert(1 <= tm->tm_mday && tm->tm_mday <= 31);
-  *(p + 1) = to_digit(tm->tm_mday % 10); tm->tm_mday /= 10;
-  *(p + 0) = to_digit(tm->tm_mday % 10);
+  static const char digit_pairs[201];
+  static const char hex_digits[17];
 
-  p += 2; *p++ = 'T';
+  int fd;
+  std::string* sink;
+  char* buf;
+  char* cur;
+  /** The end of the usable buffer; the allocation extends
+   * max_field_len bytes beyond it. */
+  char* end;
 
-  assert(p + 3 < buf + sizeof(buf));
-  assert(0 <= tm->tm_hour && tm->tm_hour < 24);
-  *(p + 1) = to_digit(tm->tm_hour % 10); tm->tm_hour /= 10;
-  *(p + 0) = to_digit(tm->tm_hour % 10);
+  /** The second for which cached_datetime is valid, or -1. */
+  time_t cached_second;
 
-  p += 2; *p++ = ':';
+  /** The formatted "YYYY-MM-DDTHH:MM:SS." for cached_second. */
+  char cached_datetime[20];
+};
 
-  assert(p + 3 < buf + sizeof(buf));
-  assert(0 <= tm->tm_min && tm->tm_min < 60);
-  *(p + 1) = to_digit(tm->tm_min % 10); tm->tm_min /= 10;
-  *(p + 0) = to_digit(tm->tm_min % 10);
+const char CSVWriter::digit_pairs[201] =
+  "00010203040506070809"
+  "10111213141516171819"
+  "20212223242526272829"
+  "30313233343536373839"
+  "40414243444546474849"
+  "50515253545556575859"
+  "60616263646566676869"
+  "70717273747576777879"
+  "80818283848586878889"
+  "90919293949596979899";
 
-  p += 2; *p++ = ':';
+const char CSVWriter::hex_digits[17] = "0123456789abcdef";
 
-  assert(p + 4 == buf + sizeof(buf));
-  assert(0 <= tm->tm_sec && tm->tm_sec <= 60); // Leap second
-  *(p + 1) = to_digit(tm->tm_sec % 10); tm->tm_sec /= 10;
-  *(p + 0) = to_digit(tm->tm_sec % 10);
+static void
+print_unsigned(CSVWriter& out, const IEType* type, void* v) {
+  switch (type->number()) {
+  case IEType::kUnsigned8: out.put_unsigned(*static_cast<uint8_t*>(v)); break;
+  case IEType::kUnsigned16: out.put_unsigned(*static_cast<uint16_t*>(v)); break;
+  case IEType::kUnsigned32: out.put_unsigned(*static_cast<uint32_t*>(v)); break;
+  case IEType::kUnsigned64: out.put_unsigned(*static_cast<uint64_t*>(v)); break;
+  default: /* Can't happen, ignore silently */ break;
+  }
 
-  p += 2; *p++ = '.'; *p = '\0';
+  if (full_type_flag) {
+    switch (type->number()) {
+    case IEType::kUnsigned8: out.put('U'); break;
+    case IEType::kUnsigned16: out.put('U'); break;
+    case IEType::kUnsigned32: out.put("UL", 2); break;
+    case IEType::kUnsigned64: out.put("ULL", 3); break;
+    default: /* Can't happen, ignore silently */ break;
+    }
+  }
+}
 
-  os << buf;
+static void
+print_signed(CSVWriter& out, const IEType* type, void* v) {
+  switch (type->number()) {
+  case IEType::kSigned8: out.put_signed(*static_cast<int8_t*>(v)); break;
+  case IEType::kSigned16: out.put_signed(*static_cast<int16_t*>(v)); break;
+  case IEType::kSigned32: out.put_signed(*static_cast<int32_t*>(v)); break;
+  case IEType::kSigned64: out.put_signed(*static_cast<int64_t*>(v)); break;
+  default: /* Can't happen, ignore silently */ break;
+  }
 
-  p = buf + 9;
-  *p-- = '\0';
+  if (full_type_flag) {
+    switch (type->number()) {
+    case IEType::kSigned8: break;
+    case IEType::kSigned16: break;
+    case IEType::kSigned32: out.put('L'); break;
+    case IEType::kSigned64: out.put("LL", 2); break;
+    default: /* Can't happen, ignore silently */ break;
+    }
+  }
+}
 
-  while (fraction != 0 && fraction % 10 == 0)
-    fraction /= 10;
+static void
+print_ipv4address(CSVWriter& out, const IEType* type, void* v) {
+  out.put_ipv4address(*static_cast<uint32_t*>(v));
+}
 
-  do {
-    *p-- = to_digit(fraction % 10);
-    fraction /= 10;
-  } while (fraction != 0);
+static void
+print_ipv6address(CSVWriter& out, const IEType* type, void* v) {
+  out.put_ipv6address(static_cast<uint8_t*>(v));
+}
 
-  os << (p + 1);
+static void
+print_macaddress(CSVWriter& out, const IEType* type, void* v) {
+  out.put_macaddress(static_cast<uint8_t*>(v));
 }
 
 static void
-print_datetime(std::ostream& os, const IEType* type, void* v) {
-  /* Convert to dateTimeNanoseconds. */
-  uint64_t nanos = 0;
+print_datetime(CSVWriter& out, const IEType* type, void* v) {
+  time_t seconds = 0;
+  uint32_t fraction = 0;
 
   switch (type->number()) {
   case IEType::kDateTimeSeconds:
-    nanos = *static_cast<uint32_t*>(v) * 1000000000ULL;
+    seconds = *static_cast<uint32_t*>(v);
     break;
-  case IEType::kDateTimeMilliseconds:
-    nanos = *static_cast<uint64_t*>(v) * 1000000ULL;
+  case IEType::kDateTimeMilliseconds: {
+    uint64_t millis = *static_cast<uint64_t*>(v);
+    seconds = millis / 1000ULL;
+    fraction = (millis % 1000ULL) * 1000000ULL;
     break;
-  case IEType::kDateTimeMicroseconds:
-    nanos = *static_cast<uint64_t*>(v) * 1000ULL;
+  }
+  case IEType::kDateTimeMicroseconds: {
+    uint64_t micros = *static_cast<uint64_t*>(v);
+    seconds = micros / 1000000ULL;
+    fraction = (micros % 1000000ULL) * 1000ULL;
     break;
-  case IEType::kDateTimeNanoseconds:
-    nanos = *static_cast<uint64_t*>(v) * 1ULL;
+  }
+  case IEType::kDateTimeNanoseconds: {
+    uint64_t nanos = *static_cast<uint64_t*>(v);
+    seconds = nanos / 1000000000ULL;
+    fraction = nanos % 1000000000ULL;
     break;
+  }
   default:
     /* Can't happen, ignore silently */
     break;
   }
 
-  time_t seconds = nanos / 1000000000ULL;
-  uint64_t fraction = nanos % 1000000000ULL;
-
-  struct tm tm;
-  gmtime_r(&seconds, &tm);
-  print_iso_datetime(os, &tm, fraction);
+  out.put_iso_datetime(seconds, fraction);
 }
 
 static void
-print_float(std::ostream& os, const IEType* type, void* v) {
+print_float(CSVWriter& out, const IEType* type, void* v) {
   double d = 0.0;
 
   switch(type->number()) {
@@ -413,32 +680,33 @@ print_float(std::ostream& os, const IEType* type, void* v) {
     break;
   }
 
-  os << d;
+  out.put_double(d);
 }
 
 static void
-print_bool(std::ostream& os, const IEType* type, void* v) {
-  bool b = *static_cast<uint8_t*>(v) == 0 ? false : true;
-
-  os << (b ? "true" : "false");
+print_bool(CSVWriter& out, const IEType* type, void* v) {
+  if (*static_cast<uint8_t*>(v) == 0)
+    out.put("false", 5);
+  else
+    out.put("true", 4);
 }
 
 static void
-print_csv_header(std::ostream& os) {
+print_csv_header(CSVWriter& out) {
   bool rest = false;
   for (const char* s : ie_names) {
     if (rest)
-      os << ';';
-    os << s;
+      out.put(';');
+    out.put(s);
     rest = true;
   }
-  os << std::endl;
+  out.put('\n');
 }
 
 class CSVCollector : public PlacementCollector {
 public:
-  CSVCollector(PlacementCollector::Protocol protocol) 
-    : PlacementCollector(protocol) {
+  CSVCollector(PlacementCollector::Protocol protocol, CSVWriter& out)
+    : PlacementCollector(protocol), out(out) {
     InfoModel& model = libfc::InfoModel::instance();
 
     csv_template = new PlacementTemplate();
@@ -579,11 +847,12 @@ public:
   std::shared_ptr<ErrorContext>
       end_placement(const PlacementTemplate* tmpl) {
     for (unsigned int i = 0; i < n_ies; ++i) {
+      out.reserve(CSVWriter::max_field_len + 1);
       if (i > 0)
-        std::cout << ';';
-      ie_values[i].renderer(std::cout, ie_values[i].type, ie_values[i].val);
+        out.put(';');
+      ie_values[i].renderer(out, ie_values[i].type, ie_values[i].val);
     }
-    std::cout << std::endl;
+    out.end_row();
     libfc_RETURN_OK();
   }
 
@@ -600,14 +869,256 @@ private:
   struct IEValue {
     void* val; /* Pointer to fixlen buffer or to varlen object */
     const IEType* type;
-    void (*renderer)(std::ostream& os, const IEType* type, void* v);
+    void (*renderer)(CSVWriter& out, const IEType* type, void* v);
   };
 
+  CSVWriter& out;
   size_t n_ies;
   IEValue* ie_values;
   PlacementTemplate* csv_template;
 };
 
+static std::mutex stderr_lock;
+
+/** Prints a diagnostic without interleaving it with those of other
+ * worker threads. */
+static void
+report(const std::string& message) {
+  std::lock_guard<std::mutex> locker(stderr_lock);
+  std::cerr << message << std::endl;
+}
+
+/** Collects one input.
+ *
+ * @param name the input file name, or 0 for stdin
+ * @param collector the collector to use
+ *
+ * @return true if the input was collected without errors
+ */
+static bool
+collect_input(const char* name, PlacementCollector& collector) {
+  InputSource* is = 0;
+  io_t* io = 0;
+
+  if (name == 0)
+    is = new FileInputSource(0, "<stdin>"); // 0 == stdin
+  else {
+    io = wandio_create(name);
+    if (io == 0) {
+      report(std::string("Can't open input ") + name);
+      return false;
+    }
+    is = new WandioInputSource(io, name);
+  }
+
+  std::shared_ptr<ErrorContext> e;
+  bool ok = true;
+  try {
+    e = collector.collect(*is);
+  } catch (FormatError& f) {
+    report(std::string(name == 0 ? "<stdin>" : name) + ": " + f.what());
+    ok = false;
+  }
+
+  delete is;
+  if (io != 0)
+    wandio_destroy(io);
+
+  if (e != 0) {
+    report(e->to_string());
+    return false;
+  }
+  return ok;
+}
+
+/** Converts one input to CSV rows (without header).
+ *
+ * @param name the input file name, or 0 for stdin
+ * @param protocol the protocol to collect
+ * @param out where to write the rows
+ *
+ * @return true if the input was converted without errors
+ */
+static bool
+convert(const char* name, PlacementCollector::Protocol protocol,
+        CSVWriter& out) {
+  CSVCollector cc{protocol, out};
+  return collect_input(name, cc);
+}
+
+/** The columns of Arrow output. */
+static std::vector<const InfoElement*> arrow_ies;
+
+/** Creates a directory and any missing parent directories, like
+ * mkdir -p.
+ *
+ * @param path the directory
+ *
+ * @return true if path is a directory afterwards
+ */
+static bool
+make_directories(const std::string& path) {
+  size_t end = 0;
+  while (end != std::string::npos) {
+    end = path.find('/', end + 1);
+    std::string prefix = path.substr(0, end);
+    if (mkdir(prefix.c_str(), 0755) < 0 && errno != EEXIST) {
+      report("Can't create " + prefix + ": " + strerror(errno));
+      return false;
+    }
+  }
+
+  struct stat st;
+  if (stat(path.c_str(), &st) < 0) {
+    report("Can't create " + path + ": " + strerror(errno));
+    return false;
+  }
+  if (!S_ISDIR(st.st_mode)) {
+    report("Can't write output into " + path + ": Not a directory");
+    return false;
+  }
+  return true;
+}
+
+/** Finds the name of the output file for an input.
+ *
+ * The input's path is kept below output_dir, so that inputs with the
+ * same name in different directories don't overwrite each other.
+ * Leading slashes and "." and ".." components are dropped, so that
+ * the output stays in output_dir.  Missing directories below
+ * output_dir are created; output_dir itself is created by main()
+ * before any worker starts.
+ *
+ * @param name the input file name
+ * @param out_name where to put the output file name
+ *
+ * @return true if the directories of out_name exist
+ */
+static bool
+make_output_name(const std::string& name, std::string& out_name) {
+  out_name = output_dir;
+
+  size_t start = 0;
+  while (start < name.size()) {
+    size_t end = name.find('/', start);
+    if (end == std::string::npos)
+      break;
+    std::string component = name.substr(start, end - start);
+    start = end + 1;
+    if (component.empty() || component == "." || component == "..")
+      continue;
+
+    out_name += "/" + component;
+    /* Other workers may be creating the same directory. */
+    if (mkdir(out_name.c_str(), 0755) < 0 && errno != EEXIST) {
+      report("Can't create " + out_name + ": " + strerror(errno));
+      return false;
+    }
+  }
+
+  out_name += "/" + name.substr(start) + (arrow_flag ? ".arrow" : ".csv");
+  return true;
+}
+
+/** Converts one input into its own CSV or Arrow file in output_dir. */
+static bool
+convert_to_file(const std::string& name,
+                PlacementCollector::Protocol protocol) {
+  std::string out_name;
+  if (!make_output_name(name, out_name))
+    return false;
+
+  int fd = open(out_name.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    report("Can't create " + out_name + ": " + strerror(errno));
+    return false;
+  }
+
+  bool ok;
+  if (arrow_flag) {
+    FileExportDestination d(fd);
+    ArrowCollector ac(protocol, d, arrow_ies, batch_size);
+    ok = collect_input(name.c_str(), ac);
+    if (!ac.finish()) {
+      report("Can't write " + out_name + ": " + strerror(errno));
+      ok = false;
+    }
+  } else {
+    CSVWriter out(fd);
+    print_csv_header(out);
+    ok = convert(name.c_str(), protocol, out);
+  }
+
+  if (close(fd) < 0) {
+    report("Can't close " + out_name + ": " + strerror(errno));
+    ok = false;
+  }
+  return ok;
+}
+
+/** Hands out inputs to worker threads.
+ *
+ * When all inputs are merged into stdout, workers convert into
+ * in-memory buffers that the main thread prints in input order.
+ * Workers may run at most `window' inputs ahead of the one that is
+ * printed next, so that held-back output does not pile up.
+ */
+struct WorkQueue {
+  WorkQueue(size_t window)
+    : next_input(0), next_output(0), window(window),
+      results(input_names.size()), done(input_names.size(), false),
+      ok(true) {
+  }
+
+  std::mutex lock;
+  std::condition_variable changed;
+  size_t next_input;
+  size_t next_output;
+  size_t window;
+  std::vector<std::string> results;
+  std::vector<bool> done;
+  bool ok;
+};
+
+static void
+work(WorkQueue* q, PlacementCollector::Protocol protocol) {
+  while (true) {
+    size_t i;
+    {
+      std::unique_lock<std::mutex> locker(q->lock);
+      q->changed.wait(locker, [q] {
+          return output_dir != 0
+            || q->next_input >= input_names.size()
+            || q->next_input < q->next_output + q->window;
+        });
+      if (q->next_input >= input_names.size())
+        return;
+      i = q->next_input++;
+    }
+
+    bool ok;
+    if (output_dir != 0)
+      ok = convert_to_file(input_names[i], protocol);
+    else {
+      std::string result;
+      {
+        CSVWriter out(&result);
+        ok = convert(input_names[i].c_str(), protocol, out);
+      }
+
+      std::lock_guard<std::mutex> locker(q->lock);
+      q->results[i].swap(result);
+      q->done[i] = true;
+      q->changed.notify_all();
+    }
+
+    if (!ok) {
+      std::lock_guard<std::mutex> locker(q->lock);
+      q->ok = false;
+    }
+  }
+}
+
 int main(int argc, char* const* argv) {
 #ifdef _libfc_HAVE_LOG4CPLUS_
   log4cplus::PropertyConfigurator config("log4cplus.properties");
@@ -615,18 +1126,15 @@ int main(int argc, char* const* argv) {
 #endif /* _libfc_HAVE_LOG4CPLUS_ */
 
   libfc::PlacementCollector::Protocol protocol;
-  InputSource* is = 0;
 
   parse_options(argc, argv);
 
   if (message_version == 10) {
     InfoModel::instance().default5103();
     protocol = libfc::PlacementCollector::ipfix;
-    is = new FileInputSource(0, "<stdin>"); // 0 == stdin
   } else if (message_version == 9) {
     InfoModel::instance().default5103();
     protocol = libfc::PlacementCollector::netflowv9;
-    is = new WandioInputSource(filename);
   } else {
     std::cerr << "Unsupported message version " << message_version << std::endl;
     exit(EXIT_FAILURE);
@@ -639,18 +1147,80 @@ int main(int argc, char* const* argv) {
     return EXIT_SUCCESS;
   }
 
-  std::cout.fill('0');
+  if (arrow_flag) {
+    for (const char* s : ie_names) {
+      const InfoElement* ie = InfoModel::instance().lookupIE(s);
+      if (ie == 0) {
+        std::cerr << "Unknown IE " << s << std::endl;
+        exit(EXIT_FAILURE);
+      }
+      arrow_ies.push_back(ie);
+    }
 
-  CSVCollector cc{protocol};
+    /* A single Arrow file can't be pieced together from parts
+     * converted in parallel, so merged output is collected here. */
+    if (output_dir == 0) {
+      FileExportDestination d(1); // 1 == stdout
+      ArrowCollector ac(protocol, d, arrow_ies, batch_size);
+      bool ok = true;
+
+      if (input_names.empty())
+        ok = collect_input(0, ac);
+      for (const std::string& name : input_names)
+        ok = collect_input(name.c_str(), ac) && ok;
+
+      if (!ac.finish()) {
+        report(std::string("Can't write Arrow output: ") + strerror(errno));
+        ok = false;
+      }
+      return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+  }
 
-  print_csv_header(std::cout);
+  CSVWriter out(1); // 1 == stdout
 
-  std::shared_ptr<ErrorContext> e = cc.collect(*is);
-  if (e != 0) {
-    std::cerr << e->to_string() << std::endl;
+  /* Check the IE names before any worker thread gets to it. */
+  if (!arrow_flag) {
+    CSVCollector probe{protocol, out};
+  }
+
+  if (output_dir == 0)
+    print_csv_header(out);
+  else if (!make_directories(output_dir))
     return EXIT_FAILURE;
+
+  if (input_names.empty())
+    return convert(0, protocol, out) ? EXIT_SUCCESS : EXIT_FAILURE;
+
+  if (n_jobs == 0)
+    n_jobs = std::max(1U, std::thread::hardware_concurrency());
+  if (n_jobs > input_names.size())
+    n_jobs = input_names.size();
+
+  WorkQueue q(2*n_jobs);
+  std::vector<std::thread> workers;
+  for (unsigned int i = 0; i < n_jobs; ++i)
+    workers.push_back(std::thread(work, &q, protocol));
+
+  if (output_dir == 0) {
+    for (size_t i = 0; i < input_names.size(); ++i) {
+      std::string result;
+      {
+        std::unique_lock<std::mutex> locker(q.lock);
+        q.changed.wait(locker, [&q, i] { return q.done[i]; });
+        result.swap(q.results[i]);
+      }
+
+      out.put(result.data(), result.size());
+
+      std::lock_guard<std::mutex> locker(q.lock);
+      q.next_output = i + 1;
+      q.changed.notify_all();
+    }
   }
 
-  delete is;
-  return EXIT_SUCCESS;
+  for (std::thread& t : workers)
+    t.join();
+
+  return q.ok ? EXIT_SUCCESS : EXIT_FAILURE;
 }
@@ -0,0 +1,726 @@
+/* Copyright (c) 2011-2014 ETH Zürich. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ *    * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *    * Neither the names of ETH Zürich nor the names of other contributors 
+ *      may be used to endorse or promote products derived from this software 
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL ETH 
+ * ZURICH BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, 
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, 
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR 
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY 
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <string>
+
+#if defined(_libfc_HAVE_LOG4CPLUS_)
+#  include <log4cplus/loggingmacros.h>
+#else
+#  define LOG4CPLUS_TRACE(logger, expr)
+#endif /* defined(_libfc_HAVE_LOG4CPLUS_) */
+
+#include "ArrowCollector.h"
+#include "BasicOctetArray.h"
+#include "ipfix_endian.h"
+
+#include "exceptions/ExportError.h"
+
+/** A minimal FlatBuffers builder, just enough for Arrow metadata.
+ *
+ * The FlatBuffers library builds buffers back to front.  This one
+ * builds them front to back instead: a table is written first, with
+ * its offset fields left as slots, and the objects that these fields
+ * refer to are written after it and patched in with set_offset().
+ * Since FlatBuffers offsets to subobjects are unsigned and point
+ * forward, this yields a valid buffer.
+ *
+ * The buffer starts with the offset to the root table, which must
+ * be set with set_root().  All scalars are little-endian.
+ */
+class FlatBufferBuilder {
+public:
+  FlatBufferBuilder() : buf(4, 0) {
+  }
+
+  /** Begins describing a table. */
+  void start_table() {
+    fields.clear();
+  }
+
+  /** Adds a scalar field with the given field id and size in octets. */
+  void add_scalar(unsigned int id, uint64_t value, size_t size) {
+    Field f = { id, size, value, false, 0 };
+    fields.push_back(f);
+  }
+
+  /** Adds an offset field, to be filled in later with set_offset(). */
+  void add_offset(unsigned int id) {
+    Field f = { id, 4, 0, true, 0 };
+    fields.push_back(f);
+  }
+
+  /** Writes the table described since start_table(), preceded by its
+   * vtable.
+   *
+   * @return the position of the table
+   */
+  size_t end_table() {
+    unsigned int n_ids = 0;
+    for (auto f = fields.begin(); f != fields.end(); ++f)
+      n_ids = std::max(n_ids, f->id + 1);
+
+    /* Lay out the fields, largest first, after the vtable offset. */
+    std::vector<Field*> by_size;
+    for (auto f = fields.begin(); f != fields.end(); ++f)
+      by_size.push_back(&*f);
+    std::stable_sort(by_size.begin(), by_size.end(),
+                     [](const Field* a, const Field* b) {
+                       return a->size > b->size;
+                     });
+
+    size_t table_size = 4;
+    for (auto f = by_size.begin(); f != by_size.end(); ++f) {
+      table_size = (table_size + (*f)->size - 1) / (*f)->size * (*f)->size;
+      (*f)->position = table_size;
+      table_size += (*f)->size;
+    }
+
+    align(2);
+    size_t vtable = append(4 + 2*n_ids);
+    align(8);
+    size_t table = append(table_size);
+
+    put(vtable + 0, 4 + 2*n_ids, 2);
+    put(vtable + 2, table_size, 2);
+    put(table, table - vtable, 4);
+    for (auto f = fields.begin(); f != fields.end(); ++f) {
+      put(vtable + 4 + 2*f->id, f->position, 2);
+      f->position += table;
+      if (!f->is_offset)
+        put(f->position, f->value, f->size);
+    }
+
+    return table;
+  }
+
+  /** Returns the position of an offset field of the table most
+   * recently written with end_table(). */
+  size_t slot(unsigned int id) const {
+    for (auto f = fields.begin(); f != fields.end(); ++f)
+      if (f->id == id) {
+        assert(f->is_offset);
+        return f->position;
+      }
+    assert(0 == "no such field");
+    return 0;
+  }
+
+  /** Writes a string and returns its position. */
+  size_t add_string(const std::string& s) {
+    align(4);
+    size_t pos = append(4 + s.size() + 1);
+    put(pos, s.size(), 4);
+    memcpy(buf.data() + pos + 4, s.data(), s.size());
+    return pos;
+  }
+
+  /** Writes a vector of n offsets and returns its position.  The
+   * slot for element i is at position + 4 + 4*i. */
+  size_t add_offset_vector(size_t n) {
+    align(4);
+    size_t pos = append(4 + 4*n);
+    put(pos, n, 4);
+    return pos;
+  }
+
+  /** Writes a vector of n structs whose alignment is 8, and returns
+   * its position. */
+  size_t add_struct_vector(const uint8_t* structs, size_t n,
+                           size_t struct_size) {
+    while ((buf.size() + 4) % 8 != 0)
+      buf.push_back(0);
+    size_t pos = append(4 + n*struct_size);
+    put(pos, n, 4);
+    if (n > 0)
+      memcpy(buf.data() + pos + 4, structs, n*struct_size);
+    return pos;
+  }
+
+  /** Makes the offset in slot refer to the object at target. */
+  void set_offset(size_t slot, size_t target) {
+    assert(target > slot);
+    put(slot, target - slot, 4);
+  }
+
+  void set_root(size_t table) {
+    set_offset(0, table);
+  }
+
+  const std::vector<uint8_t>& get_buffer() const {
+    return buf;
+  }
+
+private:
+  struct Field {
+    unsigned int id;
+    size_t size;
+    uint64_t value;
+    bool is_offset;
+    size_t position;
+  };
+
+  void align(size_t alignment) {
+    while (buf.size() % alignment != 0)
+      buf.push_back(0);
+  }
+
+  size_t append(size_t n) {
+    size_t pos = buf.size();
+    buf.resize(pos + n, 0);
+    return pos;
+  }
+
+  void put(size_t pos, uint64_t value, size_t size) {
+    for (size_t i = 0; i < size; ++i)
+      buf[pos + i] = (value >> (8*i)) & 0xff;
+  }
+
+  std::vector<Field> fields;
+  std::vector<uint8_t> buf;
+};
+
+/* Constants from the Arrow format definition (Schema.fbs, Message.fbs
+ * and File.fbs). */
+static const uint16_t kArrowMetadataV5 = 4;
+static const uint8_t kArrowHeaderSchema = 1;
+static const uint8_t kArrowHeaderRecordBatch = 3;
+static const uint8_t kArrowTypeInt = 2;
+static const uint8_t kArrowTypeFloatingPoint = 3;
+static const uint8_t kArrowTypeBinary = 4;
+static const uint8_t kArrowTypeUtf8 = 5;
+static const uint8_t kArrowTypeBool = 6;
+static const uint8_t kArrowTypeTimestamp = 10;
+static const uint8_t kArrowTypeFixedSizeBinary = 15;
+static const uint16_t kArrowPrecisionSingle = 1;
+static const uint16_t kArrowPrecisionDouble = 2;
+static const uint16_t kArrowTimeUnitSecond = 0;
+static const uint16_t kArrowTimeUnitMillisecond = 1;
+static const uint16_t kArrowTimeUnitMicrosecond = 2;
+static const uint16_t kArrowTimeUnitNanosecond = 3;
+static const uint32_t kArrowContinuation = 0xffffffff;
+static const char kArrowMagic[] = "ARROW1";
+
+/** The largest varlen column we let grow before ending a batch, so
+ * that 32-bit offsets cannot overflow. */
+static const size_t kMaxVarlenColumnSize = 1 << 30;
+
+static const uint8_t zeros[8] = { 0 };
+
+static uint8_t arrow_type_id(unsigned int ietype) {
+  switch (ietype) {
+  case libfc::IEType::kOctetArray: return kArrowTypeBinary;
+  case libfc::IEType::kString: return kArrowTypeUtf8;
+  case libfc::IEType::kBoolean: return kArrowTypeBool;
+  case libfc::IEType::kFloat32:
+  case libfc::IEType::kFloat64: return kArrowTypeFloatingPoint;
+  case libfc::IEType::kMacAddress:
+  case libfc::IEType::kIpv6Address: return kArrowTypeFixedSizeBinary;
+  case libfc::IEType::kDateTimeSeconds:
+  case libfc::IEType::kDateTimeMilliseconds:
+  case libfc::IEType::kDateTimeMicroseconds:
+  case libfc::IEType::kDateTimeNanoseconds: return kArrowTypeTimestamp;
+  default: return kArrowTypeInt;
+  }
+}
+
+/** Writes the Arrow type table for an IE type and returns its
+ * position. */
+static size_t build_type(FlatBufferBuilder& fb, unsigned int ietype) {
+  uint16_t unit = kArrowTimeUnitSecond;
+
+  fb.start_table();
+  switch (ietype) {
+  case libfc::IEType::kUnsigned8: 
+    fb.add_scalar(0, 8, 4); fb.add_scalar(1, false, 1); break;
+  case libfc::IEType::kUnsigned16:
+    fb.add_scalar(0, 16, 4); fb.add_scalar(1, false, 1); break;
+  case libfc::IEType::kUnsigned32:
+  case libfc::IEType::kIpv4Address:
+    fb.add_scalar(0, 32, 4); fb.add_scalar(1, false, 1); break;
+  case libfc::IEType::kUnsigned64:
+    fb.add_scalar(0, 64, 4); fb.add_scalar(1, false, 1); break;
+  case libfc::IEType::kSigned8:
+    fb.add_scalar(0, 8, 4); fb.add_scalar(1, true, 1); break;
+  case libfc::IEType::kSigned16:
+    fb.add_scalar(0, 16, 4); fb.add_scalar(1, true, 1); break;
+  case libfc::IEType::kSigned32:
+    fb.add_scalar(0, 32, 4); fb.add_scalar(1, true, 1); break;
+  case libfc::IEType::kSigned64:
+    fb.add_scalar(0, 64, 4); fb.add_scalar(1, true, 1); break;
+  case libfc::IEType::kFloat32:
+    fb.add_scalar(0, kArrowPrecisionSingle, 2); break;
+  case libfc::IEType::kFloat64:
+    fb.add_scalar(0, kArrowPrecisionDouble, 2); break;
+  case libfc::IEType::kMacAddress:
+    fb.add_scalar(0, 6, 4); break;
+  case libfc::IEType::kIpv6Address:
+    fb.add_scalar(0, 16, 4); break;
+  case libfc::IEType::kDateTimeSeconds:
+  case libfc::IEType::kDateTimeMilliseconds:
+  case libfc::IEType::kDateTimeMicroseconds:
+  case libfc::IEType::kDateTimeNanoseconds:
+    if (ietype == libfc::IEType::kDateTimeMilliseconds)
+      unit = kArrowTimeUnitMillisecond;
+    else if (ietype == libfc::IEType::kDateTimeMicroseconds)
+      unit = kArrowTimeUnitMicrosecond;
+    else if (ietype == libfc::IEType::kDateTimeNanoseconds)
+      unit = kArrowTimeUnitNanosecond;
+    fb.add_scalar(0, unit, 2);
+    fb.add_offset(1);
+    break;
+  default:
+    /* Binary, Utf8 and Bool have no parameters. */
+    break;
+  }
+  size_t type = fb.end_table();
+
+  if (arrow_type_id(ietype) == kArrowTypeTimestamp)
+    fb.set_offset(fb.slot(1), fb.add_string("UTC"));
+
+  return type;
+}
+
+static void encode_le32(uint32_t value, uint8_t* p) {
+  p[0] = (value >>  0) & 0xff;
+  p[1] = (value >>  8) & 0xff;
+  p[2] = (value >> 16) & 0xff;
+  p[3] = (value >> 24) & 0xff;
+}
+
+static void encode_le64(uint64_t value, uint8_t* p) {
+  encode_le32(value & 0xffffffff, p);
+  encode_le32(value >> 32, p + 4);
+}
+
+namespace libfc {
+
+  ArrowCollector::ArrowCollector(Protocol protocol, ExportDestination& os,
+                                 const std::vector<const InfoElement*>& ies,
+                                 size_t batch_size)
+    : PlacementCollector(protocol),
+      os(os),
+      batch_size(batch_size),
+      columns(ies.size()),
+      n_rows(0),
+      total_rows(0),
+      file_offset(0),
+      started(false),
+      finished(false),
+      ok(true)
+#if defined(_libfc_HAVE_LOG4CPLUS_)
+    , logger(log4cplus::Logger::getInstance(LOG4CPLUS_TEXT("ArrowCollector")))
+#endif /* defined(_libfc_HAVE_LOG4CPLUS_) */
+  {
+    assert(batch_size > 0);
+
+    for (unsigned int i = 0; i < ies.size(); ++i) {
+      Column& c = columns[i];
+      c.ie = ies[i];
+      c.kind = fixed;
+      c.width = c.ie->ietype()->placedWidth();
+
+      switch (c.ie->ietype()->number()) {
+      case IEType::kBoolean:
+        c.kind = bit;
+        break;
+      case IEType::kDateTimeSeconds:
+        c.kind = widened_seconds;
+        break;
+      case IEType::kOctetArray:
+      case IEType::kString:
+        c.kind = varlen;
+        break;
+      default:
+        if (c.width == 0)
+          throw ExportError("Can't map type of IE " + c.ie->toIESpec()
+                            + " to an Arrow type");
+        break;
+      }
+
+      if (c.kind == varlen) {
+        c.value = new BasicOctetArray();
+        c.offsets.push_back(0);
+      } else
+        c.value = new uint8_t[c.width];
+
+      placement_template.register_placement(c.ie, c.value, 0);
+    }
+
+    register_placement_template(&placement_template);
+  }
+
+  ArrowCollector::~ArrowCollector() {
+    if (!finished)
+      finish();
+
+    for (auto c = columns.begin(); c != columns.end(); ++c) {
+      if (c->kind == varlen)
+        delete static_cast<BasicOctetArray*>(c->value);
+      else
+        delete[] static_cast<uint8_t*>(c->value);
+    }
+  }
+
+  uint64_t ArrowCollector::get_row_count() const {
+    return total_rows;
+  }
+
+  std::shared_ptr<ErrorContext>
+  ArrowCollector::start_placement(const PlacementTemplate* tmpl) {
+    libfc_RETURN_OK();
+  }
+
+  std::shared_ptr<ErrorContext>
+  ArrowCollector::end_placement(const PlacementTemplate* tmpl) {
+    if (finished)
+      libfc_RETURN_OK();
+
+    bool batch_full = false;
+
+    for (auto c = columns.begin(); c != columns.end(); ++c) {
+      const uint8_t* value = static_cast<const uint8_t*>(c->value);
+
+      switch (c->kind) {
+      case fixed:
+        c->data.insert(c->data.end(), value, value + c->width);
+        break;
+      case widened_seconds:
+        {
+          int64_t seconds = *reinterpret_cast<const uint32_t*>(value);
+          const uint8_t* p = reinterpret_cast<const uint8_t*>(&seconds);
+          c->data.insert(c->data.end(), p, p + sizeof(seconds));
+        }
+        break;
+      case bit:
+        if (n_rows % 8 == 0)
+          c->data.push_back(0);
+        if (*value != 0)
+          c->data.back() |= 1 << (n_rows % 8);
+        break;
+      case varlen:
+        {
+          const BasicOctetArray* a
+            = static_cast<const BasicOctetArray*>(c->value);
+          c->data.insert(c->data.end(), a->get_buf(),
+                         a->get_buf() + a->get_length());
+          c->offsets.push_back(static_cast<int32_t>(c->data.size()));
+          if (c->data.size() >= kMaxVarlenColumnSize)
+            batch_full = true;
+        }
+        break;
+      }
+    }
+
+    ++n_rows;
+    ++total_rows;
+
+    if ((n_rows == batch_size || batch_full) && !write_batch())
+      libfc_RETURN_ERROR(fatal, system_error,
+                         "Can't write Arrow record batch of "
+                         << batch_size << " rows",
+                         errno, 0, 0, 0, 0);
+
+    libfc_RETURN_OK();
+  }
+
+  bool ArrowCollector::finish() {
+    if (finished)
+      return ok;
+    finished = true;
+
+    if (!write_batch())
+      return false;
+
+    uint8_t eos[8];
+    encode_le32(kArrowContinuation, eos);
+    encode_le32(0, eos + 4);
+
+    FlatBufferBuilder fb;
+    fb.start_table();
+    fb.add_scalar(0, kArrowMetadataV5, 2);
+    fb.add_offset(1);
+    fb.add_offset(2);
+    fb.add_offset(3);
+    size_t footer = fb.end_table();
+    size_t schema_slot = fb.slot(1);
+    size_t dictionaries_slot = fb.slot(2);
+    size_t record_batches_slot = fb.slot(3);
+
+    fb.set_offset(schema_slot, build_schema(fb));
+    fb.set_offset(dictionaries_slot, fb.add_struct_vector(0, 0, 24));
+
+    std::vector<uint8_t> block_structs(24*blocks.size());
+    uint8_t* p = block_structs.data();
+    for (auto b = blocks.begin(); b != blocks.end(); ++b, p += 24) {
+      encode_le64(b->offset, p + 0);
+      encode_le32(b->metadata_length, p + 8);
+      encode_le64(b->body_length, p + 16);
+    }
+    fb.set_offset(record_batches_slot,
+                  fb.add_struct_vector(block_structs.data(), blocks.size(),
+                                       24));
+    fb.set_root(footer);
+
+    const std::vector<uint8_t>& footer_buf = fb.get_buffer();
+    uint8_t trailer[4 + 6];
+    encode_le32(footer_buf.size(), trailer);
+    memcpy(trailer + 4, kArrowMagic, 6);
+
+    std::vector< ::iovec> iovecs;
+    ::iovec iov;
+    iov.iov_base = eos;
+    iov.iov_len = sizeof(eos);
+    iovecs.push_back(iov);
+    iov.iov_base = const_cast<uint8_t*>(footer_buf.data());
+    iov.iov_len = footer_buf.size();
+    iovecs.push_back(iov);
+    iov.iov_base = trailer;
+    iov.iov_len = sizeof(trailer);
+    iovecs.push_back(iov);
+
+    if (!write(iovecs, sizeof(eos) + footer_buf.size() + sizeof(trailer)))
+      return false;
+
+    if (os.flush() < 0)
+      ok = false;
+
+    return ok;
+  }
+
+  size_t ArrowCollector::build_schema(FlatBufferBuilder& fb) const {
+    fb.start_table();
+#if defined(IPFIX_BIG_ENDIAN)
+    fb.add_scalar(0, 1, 2);     // Endianness.Big
+#else
+    fb.add_scalar(0, 0, 2);     // Endianness.Little
+#endif
+    fb.add_offset(1);
+    size_t schema = fb.end_table();
+    size_t fields_slot = fb.slot(1);
+
+    size_t fields = fb.add_offset_vector(columns.size());
+    fb.set_offset(fields_slot, fields);
+
+    for (unsigned int i = 0; i < columns.size(); ++i) {
+      unsigned int ietype = columns[i].ie->ietype()->number();
+
+      fb.start_table();
+      fb.add_offset(0);                             // name
+      fb.add_scalar(1, false, 1);                   // nullable
+      fb.add_scalar(2, arrow_type_id(ietype), 1);   // type_type
+      fb.add_offset(3);                             // type
+      fb.add_offset(5);                             // children
+      size_t field = fb.end_table();
+      size_t name_slot = fb.slot(0);
+      size_t type_slot = fb.slot(3);
+      size_t children_slot = fb.slot(5);
+
+      fb.set_offset(fields + 4 + 4*i, field);
+      fb.set_offset(name_slot, fb.add_string(columns[i].ie->name()));
+      fb.set_offset(type_slot, build_type(fb, ietype));
+      fb.set_offset(children_slot, fb.add_offset_vector(0));
+    }
+
+    return schema;
+  }
+
+  bool ArrowCollector::write_schema_message() {
+    started = true;
+
+    FlatBufferBuilder fb;
+    fb.start_table();
+    fb.add_scalar(0, kArrowMetadataV5, 2);
+    fb.add_scalar(1, kArrowHeaderSchema, 1);
+    fb.add_offset(2);
+    fb.add_scalar(3, 0, 8);
+    size_t message = fb.end_table();
+    size_t header_slot = fb.slot(2);
+
+    fb.set_offset(header_slot, build_schema(fb));
+    fb.set_root(message);
+
+    /* The file starts with the magic, padded to 8 octets. */
+    uint8_t magic[8] = { 0 };
+    memcpy(magic, kArrowMagic, 6);
+
+    std::vector< ::iovec> iovecs;
+    ::iovec iov;
+    iov.iov_base = magic;
+    iov.iov_len = sizeof(magic);
+    iovecs.push_back(iov);
+    if (!write(iovecs, sizeof(magic)))
+      return false;
+
+    size_t metadata_length;
+    return write_message(fb, std::vector< ::iovec>(), 0, &metadata_length);
+  }
+
+  bool ArrowCollector::write_batch() {
+    if (!ok)
+      return false;
+    if (!started && !write_schema_message())
+      return false;
+    if (n_rows == 0)
+      return true;
+
+    LOG4CPLUS_TRACE(logger, "writing batch of " << n_rows << " rows");
+
+    std::vector<uint8_t> nodes(16*columns.size());
+    std::vector<uint8_t> buffers;
+    std::vector< ::iovec> body;
+    size_t body_length = 0;
+
+    auto add_buffer = [&](const void* p, size_t length) {
+      uint8_t b[16];
+      encode_le64(body_length, b + 0);
+      encode_le64(length, b + 8);
+      buffers.insert(buffers.end(), b, b + sizeof(b));
+
+      ::iovec iov;
+      if (length > 0) {
+        iov.iov_base = const_cast<void*>(p);
+        iov.iov_len = length;
+        body.push_back(iov);
+      }
+      size_t padding = (8 - length % 8) % 8;
+      if (padding > 0) {
+        iov.iov_base = const_cast<uint8_t*>(zeros);
+        iov.iov_len = padding;
+        body.push_back(iov);
+      }
+      body_length += length + padding;
+    };
+
+    for (unsigned int i = 0; i < columns.size(); ++i) {
+      Column& c = columns[i];
+
+      encode_le64(n_rows, &nodes[16*i + 0]);
+      encode_le64(0, &nodes[16*i + 8]);    // null_count
+
+      add_buffer(0, 0);                     // validity, all valid
+      if (c.kind == varlen)
+        add_buffer(c.offsets.data(), c.offsets.size()*sizeof(int32_t));
+      add_buffer(c.data.data(), c.data.size());
+    }
+
+    FlatBufferBuilder fb;
+    fb.start_table();
+    fb.add_scalar(0, kArrowMetadataV5, 2);
+    fb.add_scalar(1, kArrowHeaderRecordBatch, 1);
+    fb.add_offset(2);
+    fb.add_scalar(3, body_length, 8);
+    size_t message = fb.end_table();
+    size_t header_slot = fb.slot(2);
+
+    fb.start_table();
+    fb.add_scalar(0, n_rows, 8);
+    fb.add_offset(1);
+    fb.add_offset(2);
+    size_t record_batch = fb.end_table();
+    size_t nodes_slot = fb.slot(1);
+    size_t buffers_slot = fb.slot(2);
+
+    fb.set_offset(header_slot, record_batch);
+    fb.set_offset(nodes_slot,
+                  fb.add_struct_vector(nodes.data(), columns.size(), 16));
+    fb.set_offset(buffers_slot,
+                  fb.add_struct_vector(buffers.data(), buffers.size()/16,
+                                       16));
+    fb.set_root(message);
+
+    Block block;
+    block.offset = file_offset;
+    block.body_length = body_length;
+    size_t metadata_length;
+    if (!write_message(fb, body, body_length, &metadata_length))
+      return false;
+    block.metadata_length = metadata_length;
+    blocks.push_back(block);
+
+    for (auto c = columns.begin(); c != columns.end(); ++c) {
+      c->data.clear();
+      if (c->kind == varlen)
+        c->offsets.assign(1, 0);
+    }
+    n_rows = 0;
+
+    return true;
+  }
+
+  bool ArrowCollector::write_message(const FlatBufferBuilder& metadata,
+                                     const std::vector< ::iovec>& body,
+                                     size_t body_length,
+                                     size_t* metadata_length) {
+    const std::vector<uint8_t>& buf = metadata.get_buffer();
+    size_t padded_length = (buf.size() + 7) & ~static_cast<size_t>(7);
+
+    uint8_t prefix[8];
+    encode_le32(kArrowContinuation, prefix);
+    encode_le32(padded_length, prefix + 4);
+
+    std::vector< ::iovec> iovecs;
+    ::iovec iov;
+    iov.iov_base = prefix;
+    iov.iov_len = sizeof(prefix);
+    iovecs.push_back(iov);
+    iov.iov_base = const_cast<uint8_t*>(buf.data());
+    iov.iov_len = buf.size();
+    iovecs.push_back(iov);
+    if (padded_length > buf.size()) {
+      iov.iov_base = const_cast<uint8_t*>(zeros);
+      iov.iov_len = padded_length - buf.size();
+      iovecs.push_back(iov);
+    }
+    iovecs.insert(iovecs.end(), body.begin(), body.end());
+
+    *metadata_length = sizeof(prefix) + padded_length;
+    return write(iovecs, *metadata_length + body_length);
+  }
+
+  bool ArrowCollector::write(const std::vector< ::iovec>& iovecs,
+                             size_t length) {
+    /* Stay well below IOV_MAX. */
+    static const size_t max_iovecs = 64;
+
+    for (size_t i = 0; ok && i < iovecs.size(); i += max_iovecs) {
+      size_t n = std::min(max_iovecs, iovecs.size() - i);
+      std::vector< ::iovec> chunk(iovecs.begin() + i,
+                                  iovecs.begin() + i + n);
+      errno = 0;
+      if (os.writev(chunk) < 0)
+        ok = false;
+    }
+
+    if (ok)
+      file_offset += length;
+    return ok;
+  }
+
+} // namespace libfc
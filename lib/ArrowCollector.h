@@ -0,0 +1,189 @@
+/* Hi Emacs, please use -*- mode: C++; -*- */
+/* Copyright (c) 2011-2014 ETH Zürich. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ *    * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *    * Neither the names of ETH Zürich nor the names of other contributors 
+ *      may be used to endorse or promote products derived from this software 
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL ETH 
+ * ZURICH BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, 
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, 
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR 
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY 
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ * @author Stephan Neuhaus <neuhaust@tik.ee.ethz.ch>
+ */
+
+#ifndef _libfc_ARROWCOLLECTOR_H_
+#  define _libfc_ARROWCOLLECTOR_H_
+
+#  include <cstdint>
+#  include <list>
+#  include <vector>
+
+#  include <sys/uio.h>
+
+#  if defined(_libfc_HAVE_LOG4CPLUS_)
+#    include <log4cplus/logger.h>
+#  endif /* defined(_libfc_HAVE_LOG4CPLUS_) */
+
+#  include "ExportDestination.h"
+#  include "InfoElement.h"
+#  include "PlacementCollector.h"
+#  include "PlacementTemplate.h"
+
+class FlatBufferBuilder;
+
+namespace libfc {
+
+  /** Collects records into columns and writes them as an Arrow IPC
+   * file (also known as Feather version 2).
+   *
+   * The collector is given a list of information elements.  Every
+   * data record that contains all of them becomes a row; each IE
+   * becomes a column whose Arrow type follows from the IE type:
+   *
+   *   - unsigned8..64 and signed8..64 become uint8..64 and int8..64;
+   *   - float32 and float64 become float and double;
+   *   - boolean becomes bool;
+   *   - ipv4Address becomes uint32 (in host byte order, as placed);
+   *   - ipv6Address and macAddress become fixed_size_binary[16] and
+   *     fixed_size_binary[6];
+   *   - dateTimeSeconds..Nanoseconds become timestamp[s]..[ns] in
+   *     UTC; as in the rest of libfc, the micro- and nanosecond
+   *     values are taken as counts since the epoch;
+   *   - string becomes utf8, and octetArray becomes binary.
+   *
+   * Rows are buffered and written as one record batch every
+   * batch_size rows.  The file is complete only after finish() has
+   * been called, which writes the last, partial, batch and the file
+   * footer.  Several inputs can be collected into the same file by
+   * calling collect() repeatedly before calling finish().
+   *
+   * The file is written from scratch, without the Arrow libraries.
+   */
+  class ArrowCollector : public PlacementCollector {
+  public:
+    /** Creates an Arrow collector.
+     *
+     * @param protocol the protocol to collect
+     * @param os where to write the Arrow file; must outlive this object
+     * @param ies the information elements that make up the columns
+     * @param batch_size the number of rows per record batch
+     */
+    ArrowCollector(Protocol protocol, ExportDestination& os,
+                   const std::vector<const InfoElement*>& ies,
+                   size_t batch_size = default_batch_size);
+
+    /** Destroys this collector, calling finish() if necessary. */
+    ~ArrowCollector();
+
+    /** Writes outstanding rows and the file footer.
+     *
+     * Rows collected after this call are ignored.
+     *
+     * @return true if the file was written successfully
+     */
+    bool finish();
+
+    /** Returns the number of rows collected so far.
+     *
+     * @return the number of rows collected so far
+     */
+    uint64_t get_row_count() const;
+
+    static const size_t default_batch_size = 65536;
+
+    /* From PlacementCollector */
+    std::shared_ptr<ErrorContext>
+      start_placement(const PlacementTemplate* tmpl);
+    std::shared_ptr<ErrorContext>
+      end_placement(const PlacementTemplate* tmpl);
+
+  private:
+    /** How values of a column are appended. */
+    enum ColumnKind {
+      /** Copy the placed value as is. */
+      fixed,
+      /** Widen a placed uint32_t to an int64_t (dateTimeSeconds). */
+      widened_seconds,
+      /** Set one bit per row. */
+      bit,
+      /** Append offset and octets from a BasicOctetArray. */
+      varlen,
+    };
+
+    struct Column {
+      const InfoElement* ie;
+      ColumnKind kind;
+
+      /** Size of a placed value in octets. */
+      size_t width;
+
+      /** Where the PlacementTemplate places values for this column. */
+      void* value;
+
+      std::vector<uint8_t> data;
+      std::vector<int32_t> offsets;
+    };
+
+    bool write_schema_message();
+    bool write_batch();
+    bool write_message(const FlatBufferBuilder& metadata,
+                       const std::vector< ::iovec>& body,
+                       size_t body_length,
+                       size_t* metadata_length);
+    bool write(const std::vector< ::iovec>& iovecs, size_t length);
+
+    size_t build_schema(FlatBufferBuilder& fb) const;
+
+    ExportDestination& os;
+    size_t batch_size;
+    std::vector<Column> columns;
+    PlacementTemplate placement_template;
+
+    /** Rows in the current batch. */
+    size_t n_rows;
+
+    /** Rows collected in total. */
+    uint64_t total_rows;
+
+    /** Number of octets written so far. */
+    uint64_t file_offset;
+
+    /** Location of record batches, for the footer. */
+    struct Block {
+      uint64_t offset;
+      uint32_t metadata_length;
+      uint64_t body_length;
+    };
+    std::list<Block> blocks;
+
+    bool started;
+    bool finished;
+    bool ok;
+
+#  if defined(_libfc_HAVE_LOG4CPLUS_)
+    log4cplus::Logger logger;
+#  endif /* defined(_libfc_HAVE_LOG4CPLUS_) */
+  };
+
+} // namespace libfc
+
+#endif // _libfc_ARROWCOLLECTOR_H_
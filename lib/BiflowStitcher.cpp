@@ -0,0 +1,491 @@
+/* Copyright (c) 2011-2014 ETH Zürich. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ *    * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *    * Neither the names of ETH Zürich nor the names of other contributors 
+ *      may be used to endorse or promote products derived from this software 
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL ETH 
+ * ZURICH BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, 
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, 
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR 
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY 
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cassert>
+#include <cstring>
+
+#include "BiflowStitcher.h"
+#include "IEType.h"
+#include "InfoModel.h"
+
+#include "exceptions/IESpecError.h"
+
+#include "hash_util.h"
+
+/** Private enterprise number of the RFC 5103 reverse IEs. */
+static const uint32_t kReversePEN = 29305;
+
+/* Layout of a ring entry, in 64-bit words. */
+static const size_t kEntryHash = 0;
+static const size_t kEntryFlags = 1;
+static const size_t kEntryStart = 2;
+static const size_t kEntryEnd = 3;
+static const size_t kEntryArrival = 4;
+static const size_t kEntryKey = 5;
+static const size_t kKeyWords = 5;
+static const size_t kEntryValues = kEntryKey + kKeyWords;
+
+/* Flags of a ring entry. */
+static const uint64_t kLive = 1;
+static const uint64_t kSourceIsA = 2;
+static const uint64_t kIpv6 = 4;
+
+static bool is_time(const libfc::InfoElement* ie) {
+  switch (ie->ietype()->number()) {
+  case libfc::IEType::kDateTimeSeconds:
+  case libfc::IEType::kDateTimeMilliseconds:
+  case libfc::IEType::kDateTimeMicroseconds:
+  case libfc::IEType::kDateTimeNanoseconds:
+    return true;
+  default:
+    return false;
+  }
+}
+
+static uint64_t hash_key(const uint64_t* key, size_t n) {
+  uint64_t h = libfc::hash_seed;
+  for (size_t i = 0; i < n; ++i)
+    h = libfc::hash_mix(h, key[i]);
+  return libfc::hash_finish(h);
+}
+
+namespace libfc {
+
+  BiflowStitcher::BiflowStitcher(size_t max_pending)
+    : start_ie(InfoModel::instance().lookupIE("flowStartMilliseconds")),
+      end_ie(InfoModel::instance().lookupIE("flowEndMilliseconds")),
+      window(default_window),
+      exporter(0),
+      frozen(false),
+      entry_words(0),
+      max_pending(max_pending),
+      head(0),
+      tail(0),
+      n_pending(0),
+      index_mask(0),
+      clock(0),
+      n_uniflows(0),
+      n_biflows(0),
+      n_unmatched(0),
+      n_evicted(0) {
+    assert(0 < max_pending && max_pending < UINT32_MAX);
+    memset(&input, 0, sizeof(input));
+    memset(&output, 0, sizeof(output));
+  }
+
+  BiflowStitcher::~BiflowStitcher() {
+  }
+
+  void BiflowStitcher::add_value(const InfoElement* ie) {
+    assert(!frozen);
+
+    size_t width = ie->ietype()->placedWidth();
+    if (width == 0 || ie->len() == kIpfixVarlen)
+      throw IESpecError("Can't stitch IE " + ie->toIESpec());
+
+    const InfoElement* reverse_ie = 0;
+    if (ie->pen() == 0)
+      reverse_ie = InfoModel::instance().lookupIE(kReversePEN, ie->number(),
+                                                  ie->len());
+    if (reverse_ie == 0)
+      throw IESpecError("No reverse IE for " + ie->toIESpec());
+
+    for (auto v = values.begin(); v != values.end(); ++v)
+      if (v->ie == ie)
+        throw IESpecError("IE " + ie->toIESpec() + " is already a value");
+
+    Value v;
+    v.ie = ie;
+    v.reverse_ie = reverse_ie;
+    v.width = width;
+    v.offset = 0;
+    values.push_back(v);
+  }
+
+  void BiflowStitcher::set_time_ies(const InfoElement* start,
+                                    const InfoElement* end) {
+    assert(!frozen);
+
+    if (!is_time(start))
+      throw IESpecError("Can't take start time from IE " + start->toIESpec());
+    if (!is_time(end))
+      throw IESpecError("Can't take end time from IE " + end->toIESpec());
+
+    start_ie = start;
+    end_ie = end;
+  }
+
+  void BiflowStitcher::set_window(uint64_t _window) {
+    window = _window;
+  }
+
+  void BiflowStitcher::set_exporter(PlacementExporter* _exporter) {
+    exporter = _exporter;
+  }
+
+  const PlacementTemplate* BiflowStitcher::get_input_template(bool ipv6) {
+    freeze();
+    return ipv6 ? &input_ipv6 : &input_ipv4;
+  }
+
+  const PlacementTemplate* BiflowStitcher::get_output_template(bool ipv6) {
+    freeze();
+    return ipv6 ? &output_ipv6 : &output_ipv4;
+  }
+
+  void BiflowStitcher::register_tuple(PlacementTemplate& tmpl, Record& r,
+                                      bool ipv6) {
+    InfoModel& model = InfoModel::instance();
+
+    if (ipv6) {
+      tmpl.register_placement(model.lookupIE("sourceIPv6Address"),
+                              r.source_ipv6_address, 0);
+      tmpl.register_placement(model.lookupIE("destinationIPv6Address"),
+                              r.destination_ipv6_address, 0);
+    } else {
+      tmpl.register_placement(model.lookupIE("sourceIPv4Address"),
+                              &r.source_ipv4_address, 0);
+      tmpl.register_placement(model.lookupIE("destinationIPv4Address"),
+                              &r.destination_ipv4_address, 0);
+    }
+    tmpl.register_placement(model.lookupIE("sourceTransportPort"),
+                            &r.source_transport_port, 0);
+    tmpl.register_placement(model.lookupIE("destinationTransportPort"),
+                            &r.destination_transport_port, 0);
+    tmpl.register_placement(model.lookupIE("protocolIdentifier"),
+                            &r.protocol_identifier, 0);
+    tmpl.register_placement(start_ie, &r.start, 0);
+    tmpl.register_placement(end_ie, &r.end, 0);
+  }
+
+  void BiflowStitcher::freeze() {
+    if (frozen)
+      return;
+
+    size_t n = 0;
+    for (auto v = values.begin(); v != values.end(); ++v) {
+      v->offset = n;
+      n += words(v->width);
+    }
+    input_values.assign(n, 0);
+    output_values.assign(n, 0);
+    output_reverse_values.assign(n, 0);
+
+    for (int ipv6 = 0; ipv6 <= 1; ++ipv6) {
+      PlacementTemplate& in = ipv6 ? input_ipv6 : input_ipv4;
+      PlacementTemplate& out = ipv6 ? output_ipv6 : output_ipv4;
+
+      register_tuple(in, input, ipv6);
+      register_tuple(out, output, ipv6);
+      for (auto v = values.begin(); v != values.end(); ++v) {
+        in.register_placement(v->ie, &input_values[v->offset], 0);
+        out.register_placement(v->ie, &output_values[v->offset], 0);
+        out.register_placement(v->reverse_ie,
+                               &output_reverse_values[v->offset], 0);
+      }
+    }
+
+    entry_words = kEntryValues + n;
+    ring.assign((max_pending + 1)*entry_words, 0);
+
+    size_t index_size = 16;
+    while (index_size < 2*max_pending)
+      index_size *= 2;
+    index.assign(index_size, 0);
+    index_mask = index_size - 1;
+
+    frozen = true;
+  }
+
+  uint64_t* BiflowStitcher::entry(size_t i) {
+    return &ring[i*entry_words];
+  }
+
+  size_t BiflowStitcher::find(const uint64_t* key, uint32_t tag) const {
+    for (size_t pos = tag & index_mask; index[pos] != 0;
+         pos = (pos + 1) & index_mask) {
+      if ((index[pos] >> 32) != tag)
+        continue;
+      size_t i = (index[pos] & 0xffffffff) - 1;
+      if (memcmp(&ring[i*entry_words + kEntryKey], key,
+                 kKeyWords*sizeof(uint64_t)) == 0)
+        return pos;
+    }
+    return index.size();
+  }
+
+  void BiflowStitcher::index_insert(uint32_t tag, size_t i) {
+    size_t pos = tag & index_mask;
+    while (index[pos] != 0)
+      pos = (pos + 1) & index_mask;
+    index[pos] = (static_cast<uint64_t>(tag) << 32) | (i + 1);
+  }
+
+  void BiflowStitcher::index_remove(size_t pos) {
+    /* Backward-shift deletion: move later slots of the probe
+     * sequence into the hole as long as that doesn't move them
+     * before their home slot. */
+    size_t hole = pos;
+    for (size_t j = (hole + 1) & index_mask; index[j] != 0;
+         j = (j + 1) & index_mask) {
+      size_t home = (index[j] >> 32) & index_mask;
+      if (((j - home) & index_mask) >= ((j - hole) & index_mask)) {
+        index[hole] = index[j];
+        hole = j;
+      }
+    }
+    index[hole] = 0;
+  }
+
+  /* dateTimeSeconds values are placed as uint32_t. */
+  uint64_t BiflowStitcher::read_time(const InfoElement* ie,
+                                     const uint64_t* p) const {
+    if (ie->ietype()->number() == IEType::kDateTimeSeconds) {
+      uint32_t t;
+      memcpy(&t, p, sizeof(t));
+      return t;
+    }
+    return *p;
+  }
+
+  void BiflowStitcher::write_time(const InfoElement* ie, uint64_t* p,
+                                  uint64_t t) const {
+    if (ie->ietype()->number() == IEType::kDateTimeSeconds) {
+      uint32_t t32 = static_cast<uint32_t>(t);
+      memcpy(p, &t32, sizeof(t32));
+    } else
+      *p = t;
+  }
+
+  uint64_t BiflowStitcher::to_milliseconds(const InfoElement* ie,
+                                           uint64_t t) const {
+    switch (ie->ietype()->number()) {
+    case IEType::kDateTimeSeconds: return t*1000;
+    case IEType::kDateTimeMicroseconds: return t/1000;
+    case IEType::kDateTimeNanoseconds: return t/1000000;
+    default: return t;
+    }
+  }
+
+  void BiflowStitcher::add_record(const PlacementTemplate* tmpl) {
+    freeze();
+    assert(tmpl == &input_ipv4 || tmpl == &input_ipv6);
+
+    bool ipv6 = tmpl == &input_ipv6;
+    ++n_uniflows;
+
+    /* Build the entry for this uniflow in the spare entry at the end
+     * of the ring. */
+    uint64_t* e = entry(max_pending);
+    memset(e, 0, entry_words*sizeof(uint64_t));
+    e[kEntryStart] = read_time(start_ie, &input.start);
+    e[kEntryEnd] = read_time(end_ie, &input.end);
+
+    uint64_t t = to_milliseconds(end_ie, e[kEntryEnd]);
+    if (t > clock)
+      clock = t;
+    e[kEntryArrival] = clock;
+
+    uint8_t src[16] = { 0 };
+    uint8_t dst[16] = { 0 };
+    if (ipv6) {
+      memcpy(src, input.source_ipv6_address, sizeof(src));
+      memcpy(dst, input.destination_ipv6_address, sizeof(dst));
+    } else {
+      memcpy(src, &input.source_ipv4_address, 4);
+      memcpy(dst, &input.destination_ipv4_address, 4);
+    }
+
+    /* Both directions get the same key: the smaller endpoint is a,
+     * the other one b. */
+    int cmp = memcmp(src, dst, sizeof(src));
+    bool source_is_a = cmp < 0 || (cmp == 0 && input.source_transport_port
+                                    <= input.destination_transport_port);
+    uint8_t* key = reinterpret_cast<uint8_t*>(e + kEntryKey);
+    memcpy(key, source_is_a ? src : dst, 16);
+    memcpy(key + 16, source_is_a ? dst : src, 16);
+    uint16_t port_a = source_is_a ? input.source_transport_port
+                                  : input.destination_transport_port;
+    uint16_t port_b = source_is_a ? input.destination_transport_port
+                                  : input.source_transport_port;
+    e[kEntryKey + 4] = port_a | (static_cast<uint64_t>(port_b) << 16)
+      | (static_cast<uint64_t>(input.protocol_identifier) << 32)
+      | (static_cast<uint64_t>(ipv6) << 40);
+
+    e[kEntryFlags] = kLive | (source_is_a ? kSourceIsA : 0)
+      | (ipv6 ? kIpv6 : 0);
+    memcpy(e + kEntryValues, input_values.data(),
+           input_values.size()*sizeof(uint64_t));
+
+    uint64_t hash = hash_key(e + kEntryKey, kKeyWords);
+    e[kEntryHash] = hash;
+    uint32_t tag = hash >> 32;
+
+    size_t pos = find(e + kEntryKey, tag);
+    if (pos != index.size()) {
+      uint64_t* pending = entry((index[pos] & 0xffffffff) - 1);
+      index_remove(pos);
+      pending[kEntryFlags] &= ~kLive;
+      --n_pending;
+
+      if ((pending[kEntryFlags] & kSourceIsA)
+          != (e[kEntryFlags] & kSourceIsA)) {
+        emit_joined(pending, e);
+        expire(clock);
+        return;
+      }
+
+      /* Another uniflow in the same direction; the pending one won't
+       * be joined any more. */
+      emit_single(pending);
+    }
+
+    while (tail - head >= max_pending)
+      pop_head(true);
+
+    size_t i = tail % max_pending;
+    memcpy(entry(i), e, entry_words*sizeof(uint64_t));
+    index_insert(tag, i);
+    ++tail;
+    ++n_pending;
+
+    expire(clock);
+  }
+
+  void BiflowStitcher::pop_head(bool evicted) {
+    uint64_t* e = entry(head % max_pending);
+    if (e[kEntryFlags] & kLive) {
+      size_t pos = find(e + kEntryKey, e[kEntryHash] >> 32);
+      assert(pos != index.size());
+      index_remove(pos);
+      e[kEntryFlags] &= ~kLive;
+      --n_pending;
+      emit_single(e);
+      if (evicted)
+        ++n_evicted;
+    }
+    ++head;
+  }
+
+  void BiflowStitcher::expire(uint64_t now) {
+    freeze();
+
+    while (head < tail) {
+      const uint64_t* e = entry(head % max_pending);
+      if ((e[kEntryFlags] & kLive) && e[kEntryArrival] + window > now)
+        break;
+      pop_head(false);
+    }
+  }
+
+  void BiflowStitcher::flush() {
+    freeze();
+
+    while (head < tail)
+      pop_head(false);
+  }
+
+  void BiflowStitcher::emit_single(const uint64_t* e) {
+    ++n_unmatched;
+    place(e, 0);
+  }
+
+  void BiflowStitcher::emit_joined(const uint64_t* first,
+                                   const uint64_t* second) {
+    ++n_biflows;
+    if (second[kEntryStart] < first[kEntryStart])
+      place(second, first);
+    else
+      place(first, second);
+  }
+
+  void BiflowStitcher::place(const uint64_t* fwd, const uint64_t* rev) {
+    bool ipv6 = (fwd[kEntryFlags] & kIpv6) != 0;
+    bool source_is_a = (fwd[kEntryFlags] & kSourceIsA) != 0;
+    const uint8_t* key = reinterpret_cast<const uint8_t*>(fwd + kEntryKey);
+    const uint8_t* src = source_is_a ? key : key + 16;
+    const uint8_t* dst = source_is_a ? key + 16 : key;
+    uint16_t port_a = fwd[kEntryKey + 4] & 0xffff;
+    uint16_t port_b = (fwd[kEntryKey + 4] >> 16) & 0xffff;
+
+    if (ipv6) {
+      memcpy(output.source_ipv6_address, src, 16);
+      memcpy(output.destination_ipv6_address, dst, 16);
+    } else {
+      memcpy(&output.source_ipv4_address, src, 4);
+      memcpy(&output.destination_ipv4_address, dst, 4);
+    }
+    output.source_transport_port = source_is_a ? port_a : port_b;
+    output.destination_transport_port = source_is_a ? port_b : port_a;
+    output.protocol_identifier = (fwd[kEntryKey + 4] >> 32) & 0xff;
+
+    uint64_t start = fwd[kEntryStart];
+    uint64_t end = fwd[kEntryEnd];
+    if (rev != 0) {
+      if (rev[kEntryStart] < start)
+        start = rev[kEntryStart];
+      if (rev[kEntryEnd] > end)
+        end = rev[kEntryEnd];
+    }
+    write_time(start_ie, &output.start, start);
+    write_time(end_ie, &output.end, end);
+
+    size_t n = output_values.size()*sizeof(uint64_t);
+    memcpy(output_values.data(), fwd + kEntryValues, n);
+    if (rev != 0)
+      memcpy(output_reverse_values.data(), rev + kEntryValues, n);
+    else
+      memset(output_reverse_values.data(), 0, n);
+
+    emit(ipv6 ? &output_ipv6 : &output_ipv4);
+  }
+
+  void BiflowStitcher::emit(const PlacementTemplate* tmpl) {
+    if (exporter != 0)
+      exporter->place_values(tmpl);
+  }
+
+  size_t BiflowStitcher::get_pending_count() const {
+    return n_pending;
+  }
+
+  uint64_t BiflowStitcher::get_uniflow_count() const {
+    return n_uniflows;
+  }
+
+  uint64_t BiflowStitcher::get_biflow_count() const {
+    return n_biflows;
+  }
+
+  uint64_t BiflowStitcher::get_unmatched_count() const {
+    return n_unmatched;
+  }
+
+  uint64_t BiflowStitcher::get_evicted_count() const {
+    return n_evicted;
+  }
+
+} // namespace libfc
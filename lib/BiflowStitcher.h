@@ -0,0 +1,310 @@
+/* Hi Emacs, please use -*- mode: C++; -*- */
+/* Copyright (c) 2011-2014 ETH Zürich. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ *    * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *    * Neither the names of ETH Zürich nor the names of other contributors 
+ *      may be used to endorse or promote products derived from this software 
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL ETH 
+ * ZURICH BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, 
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, 
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR 
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY 
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ * @author Stephan Neuhaus <neuhaust@tik.ee.ethz.ch>
+ */
+
+#ifndef _libfc_BIFLOWSTITCHER_H_
+#  define _libfc_BIFLOWSTITCHER_H_
+
+#  include <cstdint>
+#  include <vector>
+
+#  include "InfoElement.h"
+#  include "PlacementExporter.h"
+#  include "PlacementTemplate.h"
+
+namespace libfc {
+
+  /** Joins uniflows into biflows as described in RFC 5103.
+   *
+   * Uniflows are keyed by their 5-tuple, canonicalized so that both
+   * directions of a connection have the same key.  When a uniflow
+   * arrives and a uniflow in the opposite direction has arrived
+   * within the time window, the two are joined into a biflow record,
+   * and the pending uniflow is removed.  Otherwise the uniflow waits
+   * for its reverse direction until the window has passed, and is
+   * then emitted alone.
+   *
+   * Biflow records contain the 5-tuple of the direction that started
+   * first, the earliest start time and the latest end time of both
+   * directions, and for each value IE given with add_value() the
+   * forward value in that IE and the reverse value in the
+   * corresponding reverse IE (PEN 29305).  A uniflow that is emitted
+   * alone has zero reverse values.  The reverse IEs must be in the
+   * information model, for example through InfoModel::default5103().
+   *
+   * There are two input templates, one with IPv4 and one with IPv6
+   * addresses.  To stitch collected records, register both with a
+   * collector and call add_record() from end_placement():
+   *
+   * @code
+   * MyCollector(BiflowStitcher& s)
+   *   : PlacementCollector(PlacementCollector::ipfix), s(s) {
+   *   register_placement_template(s.get_input_template(false));
+   *   register_placement_template(s.get_input_template(true));
+   * }
+   *
+   * std::shared_ptr<ErrorContext>
+   *   end_placement(const PlacementTemplate* tmpl) {
+   *   s.add_record(tmpl);
+   *   libfc_RETURN_OK();
+   * }
+   * @endcode
+   *
+   * Pending uniflows are kept in a ring buffer in order of arrival,
+   * and found through an open-addressing hash index.  When the ring
+   * is full, the oldest pending uniflow is emitted alone to make
+   * room, so that memory stays bounded however many uniflows never
+   * see their reverse direction.
+   *
+   * The time window is measured against the largest end time seen
+   * so far, in milliseconds.  The value IEs must all be added before
+   * the first call to get_input_template() or add_record().  Pending
+   * uniflows are discarded when the stitcher is destroyed; call
+   * flush() first.
+   */
+  class BiflowStitcher {
+  public:
+    /** Creates a stitcher.
+     *
+     * @param max_pending the largest number of uniflows that wait for
+     *   their reverse direction
+     */
+    explicit BiflowStitcher(size_t max_pending = default_max_pending);
+
+    virtual ~BiflowStitcher();
+
+    /** Adds an IE that is reported for both directions.
+     *
+     * @param ie a fixed-length IANA information element with an RFC
+     *   5103 reverse counterpart, for example octetDeltaCount
+     *
+     * @throw IESpecError if the IE has no reverse IE, or if it is
+     *   varlen encoded
+     */
+    void add_value(const InfoElement* ie);
+
+    /** Sets the IEs from which start and end of a uniflow are taken.
+     *
+     * The defaults are flowStartMilliseconds and flowEndMilliseconds.
+     *
+     * @param start an IE with a dateTime type
+     * @param end an IE with a dateTime type
+     *
+     * @throw IESpecError if an IE doesn't have a dateTime type
+     */
+    void set_time_ies(const InfoElement* start, const InfoElement* end);
+
+    /** Sets how long a uniflow waits for its reverse direction.
+     *
+     * The default is default_window, 30 seconds, a common active
+     * timeout for exporters: the reverse direction of a flow is
+     * usually exported within one active timeout of the forward
+     * direction.  With a window of 0, every uniflow is emitted alone
+     * at once.
+     *
+     * @param window the time window, in milliseconds
+     */
+    void set_window(uint64_t window);
+
+    /** Sets the exporter to which the default emit() hands records.
+     *
+     * @param exporter the exporter, or 0 to drop records
+     */
+    void set_exporter(PlacementExporter* exporter);
+
+    /** Returns an input template.
+     *
+     * @param ipv6 whether to return the template with IPv6 addresses
+     *
+     * @return the input template
+     */
+    const PlacementTemplate* get_input_template(bool ipv6);
+
+    /** Returns an output template.
+     *
+     * @param ipv6 whether to return the template with IPv6 addresses
+     *
+     * @return the output template
+     */
+    const PlacementTemplate* get_output_template(bool ipv6);
+
+    /** Processes the uniflow currently placed on an input template.
+     *
+     * @param tmpl the input template on which the uniflow was placed
+     */
+    void add_record(const PlacementTemplate* tmpl);
+
+    /** Emits pending uniflows whose window has passed.
+     *
+     * This is useful when stitching live input that may pause.
+     *
+     * @param now the current time, in milliseconds
+     */
+    void expire(uint64_t now);
+
+    /** Emits all pending uniflows. */
+    void flush();
+
+    /** Returns the number of uniflows waiting for their reverse
+     * direction.
+     *
+     * @return the number of pending uniflows
+     */
+    size_t get_pending_count() const;
+
+    /** Returns the number of uniflows processed so far.
+     *
+     * @return the number of uniflows processed so far
+     */
+    uint64_t get_uniflow_count() const;
+
+    /** Returns the number of biflows joined from two uniflows.
+     *
+     * @return the number of joined biflows
+     */
+    uint64_t get_biflow_count() const;
+
+    /** Returns the number of uniflows emitted alone, including those
+     * evicted.
+     *
+     * @return the number of uniflows emitted alone
+     */
+    uint64_t get_unmatched_count() const;
+
+    /** Returns the number of uniflows emitted alone because the ring
+     * of pending uniflows was full.
+     *
+     * @return the number of evicted uniflows
+     */
+    uint64_t get_evicted_count() const;
+
+    static const size_t default_max_pending = 65536;
+
+    /** The default time window, in milliseconds. */
+    static const uint64_t default_window = 30000;
+
+  protected:
+    /** Called for every emitted record.
+     *
+     * The default implementation passes the record to the exporter,
+     * if there is one.
+     *
+     * @param tmpl the output template on which the record is placed
+     */
+    virtual void emit(const PlacementTemplate* tmpl);
+
+  private:
+    struct Value {
+      const InfoElement* ie;
+      const InfoElement* reverse_ie;
+      size_t width;
+      /** Offset in the values of an entry, in 64-bit words. */
+      size_t offset;
+    };
+
+    /** The placements of a uniflow or a biflow. */
+    struct Record {
+      uint32_t source_ipv4_address;
+      uint32_t destination_ipv4_address;
+      uint8_t source_ipv6_address[16];
+      uint8_t destination_ipv6_address[16];
+      uint16_t source_transport_port;
+      uint16_t destination_transport_port;
+      uint8_t protocol_identifier;
+      uint64_t start;
+      uint64_t end;
+    };
+
+    void freeze();
+    void register_tuple(PlacementTemplate& tmpl, Record& r, bool ipv6);
+
+    uint64_t* entry(size_t i);
+    size_t find(const uint64_t* key, uint32_t tag) const;
+    void index_insert(uint32_t tag, size_t i);
+    void index_remove(size_t pos);
+
+    void emit_single(const uint64_t* e);
+    void emit_joined(const uint64_t* first, const uint64_t* second);
+    void place(const uint64_t* fwd, const uint64_t* rev);
+    void pop_head(bool evicted);
+
+    uint64_t read_time(const InfoElement* ie, const uint64_t* p) const;
+    void write_time(const InfoElement* ie, uint64_t* p, uint64_t t) const;
+    uint64_t to_milliseconds(const InfoElement* ie, uint64_t t) const;
+
+    std::vector<Value> values;
+    const InfoElement* start_ie;
+    const InfoElement* end_ie;
+    uint64_t window;
+    PlacementExporter* exporter;
+
+    PlacementTemplate input_ipv4;
+    PlacementTemplate input_ipv6;
+    PlacementTemplate output_ipv4;
+    PlacementTemplate output_ipv6;
+    Record input;
+    Record output;
+    std::vector<uint64_t> input_values;
+    std::vector<uint64_t> output_values;
+    std::vector<uint64_t> output_reverse_values;
+
+    bool frozen;
+
+    /** Number of 64-bit words in a ring entry. */
+    size_t entry_words;
+
+    /** Pending uniflows in order of arrival; max_pending entries. */
+    std::vector<uint64_t> ring;
+    size_t max_pending;
+    /** Number of uniflows ever put into the ring.  The oldest entry
+     * is at head % max_pending. */
+    uint64_t head;
+    uint64_t tail;
+    size_t n_pending;
+
+    /** The hash index.  Each slot holds the upper half of the hash in
+     * the upper 32 bits and the ring position plus one in the lower
+     * 32 bits, or 0 if the slot is empty. */
+    std::vector<uint64_t> index;
+    size_t index_mask;
+
+    /** The largest end time seen so far, in milliseconds. */
+    uint64_t clock;
+
+    uint64_t n_uniflows;
+    uint64_t n_biflows;
+    uint64_t n_unmatched;
+    uint64_t n_evicted;
+  };
+
+} // namespace libfc
+
+#endif // _libfc_BIFLOWSTITCHER_H_
@@ -0,0 +1,208 @@
+/* Copyright (c) 2011-2014 ETH Zürich. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ *    * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *    * Neither the names of ETH Zürich nor the names of other contributors 
+ *      may be used to endorse or promote products derived from this software 
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL ETH 
+ * ZURICH BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, 
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, 
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR 
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY 
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "CollectorStatistics.h"
+
+namespace libfc {
+
+  TemplateStatistics::TemplateStatistics()
+    : template_records(0),
+      data_sets(0),
+      data_octets(0),
+      records(0),
+      filtered_records(0),
+      duplicate_records(0),
+      unmatched_sets(0),
+      unmatched_records(0),
+      missing_template_sets(0),
+      missing_template_octets(0) {
+  }
+
+  TemplateStatistics&
+  TemplateStatistics::operator+=(const TemplateStatistics& rhs) {
+    template_records += rhs.template_records;
+    data_sets += rhs.data_sets;
+    data_octets += rhs.data_octets;
+    records += rhs.records;
+    filtered_records += rhs.filtered_records;
+    duplicate_records += rhs.duplicate_records;
+    unmatched_sets += rhs.unmatched_sets;
+    unmatched_records += rhs.unmatched_records;
+    missing_template_sets += rhs.missing_template_sets;
+    missing_template_octets += rhs.missing_template_octets;
+    return *this;
+  }
+
+  CollectorStatistics::CollectorStatistics()
+    : messages(0),
+      message_octets(0),
+      template_sets(0),
+      options_template_sets(0),
+      data_sets(0) {
+  }
+
+  CollectorStatistics&
+  CollectorStatistics::operator+=(const CollectorStatistics& rhs) {
+    messages += rhs.messages;
+    message_octets += rhs.message_octets;
+    template_sets += rhs.template_sets;
+    options_template_sets += rhs.options_template_sets;
+    data_sets += rhs.data_sets;
+    for (auto i = rhs.templates.begin(); i != rhs.templates.end(); ++i)
+      templates[i->first] += i->second;
+    return *this;
+  }
+
+  TemplateStatistics CollectorStatistics::total() const {
+    TemplateStatistics ret;
+    for (auto i = templates.begin(); i != templates.end(); ++i)
+      ret += i->second;
+    return ret;
+  }
+
+  static void write_stream_counter(std::ostream& os,
+                                   const std::string& name,
+                                   const char* help, uint64_t value) {
+    os << "# HELP " << name << " " << help << "\n"
+       << "# TYPE " << name << " counter\n"
+       << name << " " << value << "\n";
+  }
+
+  static void write_template_counter(
+      std::ostream& os, const std::string& name, const char* help,
+      const std::map<std::pair<uint32_t, uint16_t>, TemplateStatistics>& t,
+      uint64_t TemplateStatistics::* member) {
+    os << "# HELP " << name << " " << help << "\n"
+       << "# TYPE " << name << " counter\n";
+    for (auto i = t.begin(); i != t.end(); ++i)
+      os << name << "{domain=\"" << i->first.first
+         << "\",template=\"" << i->first.second << "\"} "
+         << i->second.*member << "\n";
+  }
+
+  void CollectorStatistics::write_prometheus(std::ostream& os,
+                                             const std::string& prefix) const {
+    write_stream_counter(os, prefix + "_messages_total",
+                         "Messages parsed.", messages);
+    write_stream_counter(os, prefix + "_message_octets_total",
+                         "Octets in parsed messages.", message_octets);
+    write_stream_counter(os, prefix + "_template_sets_total",
+                         "Template sets parsed.", template_sets);
+    write_stream_counter(os, prefix + "_options_template_sets_total",
+                         "Options template sets parsed.",
+                         options_template_sets);
+    write_stream_counter(os, prefix + "_data_sets_total",
+                         "Data sets parsed.", data_sets);
+
+    write_template_counter(os, prefix + "_template_records_total",
+                           "Template records received.", templates,
+                           &TemplateStatistics::template_records);
+    write_template_counter(os, prefix + "_template_data_sets_total",
+                           "Data sets with a known template.", templates,
+                           &TemplateStatistics::data_sets);
+    write_template_counter(os, prefix + "_template_data_octets_total",
+                           "Octets in data sets with a known template.",
+                           templates, &TemplateStatistics::data_octets);
+    write_template_counter(os, prefix + "_records_total",
+                           "Records handed to a collector.", templates,
+                           &TemplateStatistics::records);
+    write_template_counter(os, prefix + "_filtered_records_total",
+                           "Records rejected by a record filter.",
+                           templates, &TemplateStatistics::filtered_records);
+    write_template_counter(os, prefix + "_duplicate_records_total",
+                           "Records suppressed as duplicates.",
+                           templates, &TemplateStatistics::duplicate_records);
+    write_template_counter(os, prefix + "_unmatched_sets_total",
+                           "Data sets that matched no placement template.",
+                           templates, &TemplateStatistics::unmatched_sets);
+    write_template_counter(os, prefix + "_unmatched_records_total",
+                           "Records in data sets that matched no placement "
+                           "template.",
+                           templates, &TemplateStatistics::unmatched_records);
+    write_template_counter(os, prefix + "_missing_template_sets_total",
+                           "Data sets dropped for a missing template.",
+                           templates,
+                           &TemplateStatistics::missing_template_sets);
+    write_template_counter(os, prefix + "_missing_template_octets_total",
+                           "Octets in data sets dropped for a missing "
+                           "template.",
+                           templates,
+                           &TemplateStatistics::missing_template_octets);
+  }
+
+  CollectorCounters::CollectorCounters()
+    : last_key(0), last_template(0) {
+  }
+
+  CollectorCounters::Template&
+  CollectorCounters::get_template(uint32_t observation_domain,
+                                  uint16_t template_id) {
+    uint64_t key = (static_cast<uint64_t>(observation_domain) << 16)
+      | template_id;
+
+    if (last_template == 0 || key != last_key) {
+      /* Only this thread modifies the map, so looking up without the
+       * lock is safe. */
+      auto i = templates.find(key);
+      if (i == templates.end()) {
+        std::lock_guard<std::mutex> guard(templates_lock);
+        last_template = &templates[key];
+      } else
+        last_template = &i->second;
+      last_key = key;
+    }
+    return *last_template;
+  }
+
+  CollectorStatistics CollectorCounters::snapshot() const {
+    CollectorStatistics ret;
+
+    ret.messages = messages.get();
+    ret.message_octets = message_octets.get();
+    ret.template_sets = template_sets.get();
+    ret.options_template_sets = options_template_sets.get();
+    ret.data_sets = data_sets.get();
+
+    std::lock_guard<std::mutex> guard(templates_lock);
+    for (auto i = templates.begin(); i != templates.end(); ++i) {
+      TemplateStatistics& t
+        = ret.templates[std::make_pair(static_cast<uint32_t>(i->first >> 16),
+                                       static_cast<uint16_t>(i->first))];
+      t.template_records = i->second.template_records.get();
+      t.data_sets = i->second.data_sets.get();
+      t.data_octets = i->second.data_octets.get();
+      t.records = i->second.records.get();
+      t.filtered_records = i->second.filtered_records.get();
+      t.duplicate_records = i->second.duplicate_records.get();
+      t.unmatched_sets = i->second.unmatched_sets.get();
+      t.unmatched_records = i->second.unmatched_records.get();
+      t.missing_template_sets = i->second.missing_template_sets.get();
+      t.missing_template_octets = i->second.missing_template_octets.get();
+    }
+    return ret;
+  }
+
+} // namespace libfc
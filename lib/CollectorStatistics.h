@@ -0,0 +1,233 @@
+/* Hi Emacs, please use -*- mode: C++; -*- */
+/* Copyright (c) 2011-2014 ETH Zürich. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ *    * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *    * Neither the names of ETH Zürich nor the names of other contributors 
+ *      may be used to endorse or promote products derived from this software 
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL ETH 
+ * ZURICH BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, 
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, 
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR 
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY 
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ * @author Stephan Neuhaus <neuhaust@tik.ee.ethz.ch>
+ */
+
+#ifndef _libfc_COLLECTORSTATISTICS_H_
+#  define _libfc_COLLECTORSTATISTICS_H_
+
+#  include <atomic>
+#  include <cstdint>
+#  include <map>
+#  include <mutex>
+#  include <ostream>
+#  include <string>
+#  include <utility>
+
+namespace libfc {
+
+  /** Counters for one (observation domain, template ID) pair, as of
+   * some point in time. */
+  struct TemplateStatistics {
+    TemplateStatistics();
+
+    TemplateStatistics& operator+=(const TemplateStatistics& rhs);
+
+    /** Template records received for this template ID, including
+     * repetitions. */
+    uint64_t template_records;
+
+    /** Data sets for which the template was known. */
+    uint64_t data_sets;
+
+    /** Octets in these data sets, excluding set headers. */
+    uint64_t data_octets;
+
+    /** Records handed to a collector. */
+    uint64_t records;
+
+    /** Records rejected by a placement template's record filter. */
+    uint64_t filtered_records;
+
+    /** Records suppressed by a placement template's record
+     * deduplicator. */
+    uint64_t duplicate_records;
+
+    /** Data sets that matched no placement template. */
+    uint64_t unmatched_sets;
+
+    /** Records in these data sets. */
+    uint64_t unmatched_records;
+
+    /** Data sets that were dropped because their template had not
+     * been received. */
+    uint64_t missing_template_sets;
+
+    /** Octets in these data sets, excluding set headers. */
+    uint64_t missing_template_octets;
+  };
+
+  /** A snapshot of the counters of a collector.
+   *
+   * Snapshots of several collectors, for example one per thread, can
+   * be added up with operator+=.
+   */
+  struct CollectorStatistics {
+    CollectorStatistics();
+
+    CollectorStatistics& operator+=(const CollectorStatistics& rhs);
+
+    /** Returns the sum of the per-template counters. */
+    TemplateStatistics total() const;
+
+    /** Writes the counters in the Prometheus text exposition format.
+     *
+     * Stream counters are written without labels, per-template
+     * counters with "domain" and "template" labels, for example
+     *
+     * @code
+     * # TYPE libfc_records_total counter
+     * libfc_records_total{domain="1",template="256"} 1234
+     * @endcode
+     *
+     * @param os the stream to write to
+     * @param prefix the prefix of all metric names
+     */
+    void write_prometheus(std::ostream& os,
+                          const std::string& prefix = "libfc") const;
+
+    /** Messages parsed. */
+    uint64_t messages;
+
+    /** Octets in these messages, including message headers. */
+    uint64_t message_octets;
+
+    /** Template sets parsed. */
+    uint64_t template_sets;
+
+    /** Options template sets parsed. */
+    uint64_t options_template_sets;
+
+    /** Data sets parsed, whether or not their template was known. */
+    uint64_t data_sets;
+
+    /** Per-template counters, keyed by observation domain and
+     * template ID. */
+    std::map<std::pair<uint32_t, uint16_t>, TemplateStatistics> templates;
+  };
+
+  /** A counter that is written by one thread and read by any.
+   *
+   * Since there is only one writer, an increment need not be atomic
+   * as a whole; it is a relaxed load and store, which costs the same
+   * as incrementing a plain integer.  Readers on other threads always
+   * see a value that the counter has actually had.
+   */
+  class StatisticsCounter {
+  public:
+    StatisticsCounter() : value(0) {
+    }
+
+    void add(uint64_t n) {
+      value.store(value.load(std::memory_order_relaxed) + n,
+                  std::memory_order_relaxed);
+    }
+
+    uint64_t get() const {
+      return value.load(std::memory_order_relaxed);
+    }
+
+  private:
+    std::atomic<uint64_t> value;
+  };
+
+  /** The live counters of a collector.
+   *
+   * The counters are updated by the thread that runs the collector,
+   * and only by that thread; the parsers and the content handler
+   * update them once per message or data set, not per record.
+   * snapshot() may be called from any thread at any time.
+   */
+  class CollectorCounters {
+  public:
+    /** Live counters for one (observation domain, template ID) pair.
+     * See TemplateStatistics for their meaning. */
+    struct Template {
+      StatisticsCounter template_records;
+      StatisticsCounter data_sets;
+      StatisticsCounter data_octets;
+      StatisticsCounter records;
+      StatisticsCounter filtered_records;
+      StatisticsCounter duplicate_records;
+      StatisticsCounter unmatched_sets;
+      StatisticsCounter unmatched_records;
+      StatisticsCounter missing_template_sets;
+      StatisticsCounter missing_template_octets;
+    };
+
+    CollectorCounters();
+
+    /** Returns the counters for a template, creating them if needed.
+     *
+     * This may only be called by the thread that updates the
+     * counters.  The returned reference stays valid for the
+     * lifetime of this object.
+     *
+     * @param observation_domain the observation domain
+     * @param template_id the template ID
+     *
+     * @return the counters for this template
+     */
+    Template& get_template(uint32_t observation_domain,
+                           uint16_t template_id);
+
+    /** Returns a consistent copy of the counters.
+     *
+     * "Consistent" means that each counter has a value it actually
+     * had; counters that are updated together may be seen at
+     * slightly different points in time.
+     */
+    CollectorStatistics snapshot() const;
+
+    StatisticsCounter messages;
+    StatisticsCounter message_octets;
+    StatisticsCounter template_sets;
+    StatisticsCounter options_template_sets;
+    StatisticsCounter data_sets;
+
+  private:
+    CollectorCounters(const CollectorCounters&);
+    CollectorCounters& operator=(const CollectorCounters&);
+
+    /** Protects the structure of templates (not the counters in
+     * it).  The writer only needs it to insert; readers need it to
+     * iterate. */
+    mutable std::mutex templates_lock;
+    std::map<uint64_t, Template> templates;
+
+    /** The most recently used entry of templates, so that runs of
+     * data sets with the same template avoid the map lookup. */
+    uint64_t last_key;
+    Template* last_template;
+  };
+
+} // namespace libfc
+
+#endif // _libfc_COLLECTORSTATISTICS_H_
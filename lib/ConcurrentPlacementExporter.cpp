@@ -0,0 +1,167 @@
+/* Copyright (c) 2011-2014 ETH Zürich. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ *    * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *    * Neither the names of ETH Zürich nor the names of other contributors 
+ *      may be used to endorse or promote products derived from this software 
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL ETH 
+ * ZURICH BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, 
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, 
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR 
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY 
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <cassert>
+
+#if defined(_libfc_HAVE_LOG4CPLUS_)
+#  include <log4cplus/loggingmacros.h>
+#else
+#  define LOG4CPLUS_TRACE(logger, expr)
+#endif /* defined(_libfc_HAVE_LOG4CPLUS_) */
+
+#include "Constants.h"
+#include "ConcurrentPlacementExporter.h"
+
+namespace libfc {
+
+  /** Export destination of a single producer.
+   *
+   * Passes finished messages on to the concurrent exporter, which
+   * serialises them into the real export destination.
+   */
+  class ConcurrentPlacementExporter::ProducerDestination
+    : public ExportDestination {
+  public:
+    ProducerDestination(ConcurrentPlacementExporter& exporter);
+
+    ssize_t writev(const std::vector< ::iovec>& iovecs);
+    int flush();
+    bool is_connectionless() const;
+    size_t preferred_maximum_message_size() const;
+
+  private:
+    ConcurrentPlacementExporter& exporter;
+  };
+
+  ConcurrentPlacementExporter::ProducerDestination::ProducerDestination(
+      ConcurrentPlacementExporter& _exporter)
+    : exporter(_exporter) {
+  }
+
+  ssize_t ConcurrentPlacementExporter::ProducerDestination::writev(
+      const std::vector< ::iovec>& iovecs) {
+    return exporter.write_message(iovecs);
+  }
+
+  int ConcurrentPlacementExporter::ProducerDestination::flush() {
+    return 0;
+  }
+
+  bool
+  ConcurrentPlacementExporter::ProducerDestination::is_connectionless() const {
+    return exporter.os.is_connectionless();
+  }
+
+  size_t ConcurrentPlacementExporter::ProducerDestination
+  ::preferred_maximum_message_size() const {
+    return exporter.os.preferred_maximum_message_size();
+  }
+
+  ConcurrentPlacementExporter::ConcurrentPlacementExporter(
+      ExportDestination& _os,
+      uint32_t _observation_domain)
+    : os(_os),
+      observation_domain(_observation_domain),
+      current_template_id(255),
+      sequence_number(0)
+#if defined(_libfc_HAVE_LOG4CPLUS_)
+    , logger(log4cplus::Logger::getInstance(LOG4CPLUS_TEXT("ConcurrentPlacementExporter")))
+#endif /* defined(_libfc_HAVE_LOG4CPLUS_) */
+  {
+  }
+
+  ConcurrentPlacementExporter::~ConcurrentPlacementExporter() {
+    /* Producers flush on destruction, so they must go before their
+     * destinations. */
+    for (auto i = producers.begin(); i != producers.end(); ++i)
+      delete *i;
+    for (auto i = destinations.begin(); i != destinations.end(); ++i)
+      delete *i;
+    os.flush();
+  }
+
+  PlacementExporter& ConcurrentPlacementExporter::make_producer() {
+    std::lock_guard<std::mutex> guard(producer_lock);
+
+    ProducerDestination* d = new ProducerDestination(*this);
+    destinations.push_back(d);
+
+    PlacementExporter* e
+      = new PlacementExporter(*d, observation_domain, this);
+    producers.push_back(e);
+
+    LOG4CPLUS_TRACE(logger, "made producer #" << producers.size());
+    return *e;
+  }
+
+  bool ConcurrentPlacementExporter::flush() {
+    std::lock_guard<std::mutex> guard(producer_lock);
+    bool ret = true;
+
+    for (auto i = producers.begin(); i != producers.end(); ++i)
+      if (!(*i)->flush())
+        ret = false;
+    return ret;
+  }
+
+  void ConcurrentPlacementExporter::assign_template_id(
+      const PlacementTemplate* tmpl, size_t* size) {
+    std::lock_guard<std::mutex> guard(template_lock);
+
+    /* Only the first call for a template assigns an ID (see
+     * PlacementTemplate::wire_template()); otherwise, the ID is
+     * simply skipped.  Doing this under the lock also makes the
+     * template's cached wire representation visible to all
+     * producers. */
+    uint16_t old_id = tmpl->get_template_id();
+    tmpl->wire_template(current_template_id + 1, 0, size);
+    if (old_id == 0)
+      ++current_template_id;
+
+    LOG4CPLUS_TRACE(logger, "template " << tmpl
+                    << " has id " << tmpl->get_template_id());
+  }
+
+  ssize_t ConcurrentPlacementExporter::write_message(
+      const std::vector< ::iovec>& iovecs) {
+    std::lock_guard<std::mutex> guard(write_lock);
+
+    assert(iovecs.size() > 0);
+    assert(iovecs[0].iov_len == kIpfixMessageHeaderLen);
+
+    /* The producer has assembled the message with its own sequence
+     * number; replace it with ours, now that the position of this
+     * message in the output is known. */
+    uint8_t* p = static_cast<uint8_t*>(iovecs[0].iov_base) + 8;
+    p[0] = (sequence_number >> 24) & 0xff;
+    p[1] = (sequence_number >> 16) & 0xff;
+    p[2] = (sequence_number >>  8) & 0xff;
+    p[3] = (sequence_number >>  0) & 0xff;
+    sequence_number++;
+
+    return os.writev(iovecs);
+  }
+
+} // namespace libfc
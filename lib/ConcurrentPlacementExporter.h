@@ -0,0 +1,178 @@
+/* Hi Emacs, please use -*- mode: C++; -*- */
+/* Copyright (c) 2011-2014 ETH Zürich. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ *    * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *    * Neither the names of ETH Zürich nor the names of other contributors 
+ *      may be used to endorse or promote products derived from this software 
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL ETH 
+ * ZURICH BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, 
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, 
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR 
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY 
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ * @author Stephan Neuhaus <neuhaust@tik.ee.ethz.ch>
+ */
+
+#ifndef _libfc_CONCURRENTPLACEMENTEXPORTER_H_
+#  define _libfc_CONCURRENTPLACEMENTEXPORTER_H_
+
+#  include <cstdint>
+#  include <list>
+#  include <mutex>
+
+#  if defined(_libfc_HAVE_LOG4CPLUS_)
+#    include <log4cplus/logger.h>
+#  endif /* defined(_libfc_HAVE_LOG4CPLUS_) */
+
+#  include "ExportDestination.h"
+#  include "PlacementExporter.h"
+#  include "PlacementTemplate.h"
+
+namespace libfc {
+
+  /** Exporter front-end for several producer threads.
+   *
+   * A PlacementExporter keeps the message under construction, the
+   * set of templates it has issued and the message sequence number
+   * as unprotected state, so it can only be used from one thread.
+   * This class lets several threads export into the same
+   * ExportDestination and observation domain without serialising
+   * all of their work behind one lock.
+   *
+   * Each producer thread asks for its own PlacementExporter with
+   * make_producer() and uses it exactly like a stand-alone exporter.
+   * Messages are assembled entirely in that exporter's buffers.  Only
+   * two operations are serialised:
+   *
+   *   - assigning a template ID when a producer issues a template for
+   *     the first time, so that template IDs are unique across
+   *     producers; and
+   *   - handing a finished message to the ExportDestination, at
+   *     which point the message gets its sequence number, so that
+   *     sequence numbers appear in the order in which messages are
+   *     written.
+   *
+   * Every producer announces the templates it uses in its own
+   * messages, so a template may be announced more than once, but
+   * always with the same ID and the same definition, and always
+   * before its first data set from that producer.
+   *
+   * @code
+   * FileExportDestination d(fd);
+   * ConcurrentPlacementExporter e(d, my_observation_domain);
+   *
+   * // In each producer thread:
+   * PlacementExporter& my_exporter = e.make_producer();
+   * PlacementTemplate* my_template = ...; // one per thread
+   * my_exporter.place_values(my_template);
+   * @endcode
+   *
+   * The same PlacementTemplate may not be used by more than one
+   * producer at a time, since it refers to memory locations that
+   * belong to one thread.
+   */
+  class ConcurrentPlacementExporter {
+  public:
+    /** Creates a concurrent exporter.
+     *
+     * @param os the output stream to use
+     * @param observation_domain the observation domain; see RFC5101
+     */
+    ConcurrentPlacementExporter(ExportDestination& os,
+                                uint32_t observation_domain);
+
+    /** Destroys a concurrent exporter.
+     *
+     * Flushes and destroys all producers.  No producer may be in use
+     * when this happens.
+     */
+    ~ConcurrentPlacementExporter();
+
+    /** Creates a new producer.
+     *
+     * This member function may be called from any thread.  The
+     * returned exporter belongs to this object and may be used by
+     * one thread at a time only.
+     *
+     * @return a new producer
+     */
+    PlacementExporter& make_producer();
+
+    /** Flushes all producers.
+     *
+     * No producer may be in use while this is called.
+     *
+     * @return true if all flushes were successful, false otherwise
+     */
+    bool flush();
+
+  private:
+    friend class PlacementExporter;
+
+    /** Assigns a template ID, if the template doesn't have one yet.
+     *
+     * Called by producers when they issue a template.
+     *
+     * @param tmpl the template
+     * @param size will receive the size of the wire template
+     */
+    void assign_template_id(const PlacementTemplate* tmpl, size_t* size);
+
+    /** Writes a finished message, giving it the next sequence number.
+     *
+     * Called by producers through their export destination.
+     *
+     * @param iovecs the message, with the message header in the
+     *   first iovec
+     * @return the return value of the underlying destination's writev
+     */
+    ssize_t write_message(const std::vector< ::iovec>& iovecs);
+
+    class ProducerDestination;
+
+    ExportDestination& os;
+    uint32_t observation_domain;
+
+    /** Protects current_template_id. */
+    std::mutex template_lock;
+
+    /** Most recently assigned template id. */
+    uint16_t current_template_id;
+
+    /** Serialises writes to os and protects sequence_number. */
+    std::mutex write_lock;
+
+    /** Sequence number for messages; see RFC 5101. */
+    uint32_t sequence_number;
+
+    /** Protects producers. */
+    std::mutex producer_lock;
+
+    std::list<ProducerDestination*> destinations;
+    std::list<PlacementExporter*> producers;
+
+#  if defined(_libfc_HAVE_LOG4CPLUS_)
+    log4cplus::Logger logger;
+#  endif /* defined(_libfc_HAVE_LOG4CPLUS_) */
+  };
+
+} // namespace libfc
+
+#endif // _libfc_CONCURRENTPLACEMENTEXPORTER_H_
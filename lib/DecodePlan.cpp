@@ -38,6 +38,7 @@
 
 #include "decode_util.h"
 #include "ipfix_endian.h"
+#include "trace_util.h"
 
 #include "exceptions/FormatError.h"
 
@@ -226,7 +227,7 @@ namespace libfc {
 
         case libfc::IEType::kFloat64:
           assert((*ie)->len() == sizeof(float)
-                 || d.length == sizeof(double));
+                 || (*ie)->len() == sizeof(double));
           d.length = (*ie)->len();
           if (d.length == sizeof(float))
             d.type = transfer_float_into_double_maybe_endianness;
@@ -439,8 +440,21 @@ namespace libfc {
   }
 #endif /* defined(_libfc_HAVE_LOG4CPLUS_) */
 
+  /** Reports a fixed-length IE that extends beyond the buffer.
+   *
+   * This is out of line so that building the IE spec, which happens
+   * only on this error path, does not bloat the decode loop.
+   */
+  static void __attribute__((noinline, cold))
+  report_ie_beyond_buffer(const InfoElement* ie, const uint8_t* cur,
+                          size_t length, const uint8_t* buf_end) {
+    std::string ie_spec = ie->toIESpec();
+    report_error("IE %s length beyond buffer: cur=%p, ielen=%zu, end=%p",
+                 ie_spec.c_str(), cur, length, buf_end);
+  }
+
   uint16_t DecodePlan::execute(const uint8_t* buf, uint16_t length) {
-    LOG4CPLUS_TRACE(logger, "ENTER DecodePlan::execute");
+    libfc_HOT_TRACE(logger, "ENTER DecodePlan::execute");
 
     const uint8_t* cur = buf;
     const uint8_t* buf_end = buf + length;
@@ -448,37 +462,37 @@ namespace libfc {
     for (auto i = plan.begin(); i != plan.end(); ++i) {
       assert(cur < buf_end);
 
-#if defined(_libfc_HAVE_LOG4CPLUS_)
+#if defined(_libfc_HAVE_LOG4CPLUS_) && defined(_libfc_HAVE_HOT_PATH_TRACE_)
       switch (i->type) {
       case Decision::skip_fixlen:
-        LOG4CPLUS_TRACE(logger, "  decision: skip_fixlen");
+        libfc_HOT_TRACE(logger, "  decision: skip_fixlen");
         break;
       case Decision::skip_varlen:
-        LOG4CPLUS_TRACE(logger, "  decision: skip_varlen");
+        libfc_HOT_TRACE(logger, "  decision: skip_varlen");
         break;
       case Decision::transfer_boolean:
-        LOG4CPLUS_TRACE(logger, "  decision: transfer_boolean");
+        libfc_HOT_TRACE(logger, "  decision: transfer_boolean");
         break;
       case Decision::transfer_fixlen:
-        LOG4CPLUS_TRACE(logger, "  decision: transfer_fixlen");
+        libfc_HOT_TRACE(logger, "  decision: transfer_fixlen");
         break;
       case Decision::transfer_fixlen_endianness:
-        LOG4CPLUS_TRACE(logger, "  decision: transfer_fixlen_endianness");
+        libfc_HOT_TRACE(logger, "  decision: transfer_fixlen_endianness");
         break;
       case Decision::transfer_varlen:
-        LOG4CPLUS_TRACE(logger, "  decision: transfer_varlen");
+        libfc_HOT_TRACE(logger, "  decision: transfer_varlen");
         break;
       case Decision::transfer_fixlen_octets:
-        LOG4CPLUS_TRACE(logger, "  decision: transfer_fixlen_octets");
+        libfc_HOT_TRACE(logger, "  decision: transfer_fixlen_octets");
         break;
       case Decision::transfer_float_into_double:
-        LOG4CPLUS_TRACE(logger, "  decision: transfer_float_into_double");
+        libfc_HOT_TRACE(logger, "  decision: transfer_float_into_double");
         break;
       case Decision::transfer_float_into_double_endianness:
-        LOG4CPLUS_TRACE(logger, "  decision: transfer_float_into_double_endianness");
+        libfc_HOT_TRACE(logger, "  decision: transfer_float_into_double_endianness");
         break;
       }
-#endif /* defined(_libfc_HAVE_LOG4CPLUS_) */
+#endif /* defined(_libfc_HAVE_LOG4CPLUS_) && defined(_libfc_HAVE_HOT_PATH_TRACE_) */
 
       switch (i->type) {
       case Decision::skip_fixlen:
@@ -510,11 +524,8 @@ namespace libfc {
         break;
 
       case Decision::transfer_fixlen:
-        if (cur + i->length > buf_end) {
-          std::string ie_spec = i->wire_ie->toIESpec();
-          report_error("IE %s length beyond buffer: cur=%p, ielen=%zu, end=%p",
-                       ie_spec.c_str(), cur, i->length, buf_end);
-        }
+        if (cur + i->length > buf_end)
+          report_ie_beyond_buffer(i->wire_ie, cur, i->length, buf_end);
 
         assert(i->length <= i->destination_size);
 
@@ -524,7 +535,7 @@ namespace libfc {
         // etc).
         {
           uint8_t* q = static_cast<uint8_t*>(i->p);
-          LOG4CPLUS_TRACE(logger, "  fixlen: q == " << static_cast<void*>(q)
+          libfc_HOT_TRACE(logger, "  fixlen: q == " << static_cast<void*>(q)
                           << ", size=" << i->destination_size);
 
           memset(q, '\0', i->destination_size);
@@ -535,11 +546,8 @@ namespace libfc {
         break;
 
       case Decision::transfer_fixlen_endianness:
-        if (cur + i->length > buf_end) {
-          std::string ie_spec = i->wire_ie->toIESpec();
-          report_error("IE %s length beyond buffer: cur=%p, ielen=%zu, end=%p",
-                       ie_spec.c_str(), cur, i->length, buf_end);
-        }
+        if (cur + i->length > buf_end)
+          report_ie_beyond_buffer(i->wire_ie, cur, i->length, buf_end);
 
         assert(i->length <= i->destination_size);
 
@@ -558,13 +566,13 @@ namespace libfc {
         // etc).
         {
           uint8_t* q = static_cast<uint8_t*>(i->p);        
-          LOG4CPLUS_TRACE(logger, "  fixlen_endianness: q == " << static_cast<void*>(q) << ", size=" << i->destination_size);
+          libfc_HOT_TRACE(logger, "  fixlen_endianness: q == " << static_cast<void*>(q) << ", size=" << i->destination_size);
           memset(q, '\0', i->destination_size);
           // Intention: left-justify value at cur in field at i->p
           for (uint16_t k = 0; k < i->length; k++)
             q[k] = cur[i->length - (k + 1)];
         }
-        LOG4CPLUS_TRACE(logger, "  transfer done");
+        libfc_HOT_TRACE(logger, "  transfer done");
         cur += i->length;
         break;
 
@@ -616,7 +624,7 @@ namespace libfc {
           }
 #endif /* defined(_libfc_HAVE_LOG4CPLUS_) */
           uint16_t varlen_length = decode_varlen_length(&cur, buf_end);
-          LOG4CPLUS_TRACE(logger, "  varlen length " << varlen_length);
+          libfc_HOT_TRACE(logger, "  varlen length " << varlen_length);
           assert(cur + varlen_length <= buf_end);
       
           libfc::BasicOctetArray* p
@@ -0,0 +1,162 @@
+/* Copyright (c) 2011-2014 ETH Zürich. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ *    * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *    * Neither the names of ETH Zürich nor the names of other contributors 
+ *      may be used to endorse or promote products derived from this software 
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL ETH 
+ * ZURICH BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, 
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, 
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR 
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY 
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cassert>
+#include <cstring>
+
+#include "Constants.h"
+#include "DeduplicationPlan.h"
+#include "IEType.h"
+
+#include "decode_util.h"
+#include "hash_util.h"
+
+namespace libfc {
+
+  DeduplicationPlan::DeduplicationPlan(RecordDeduplicator* dedup,
+                                       const IETemplate* wire_template)
+    : dedup(dedup),
+      walker(wire_template),
+      field_offsets(walker.get_field_count()),
+      field_sizes(walker.get_field_count()) {
+    assert(dedup != 0);
+    assert(wire_template != 0);
+
+    for (auto k = dedup->keys.begin(); k != dedup->keys.end(); ++k) {
+      Key key;
+      key.field = 0;
+      key.length = 0;
+      key.offset = 0;
+      key.has_offset = true;
+      key.kind = Key::absent;
+
+      uint16_t field_offset = 0;
+      for (auto ie = wire_template->begin(); ie != wire_template->end(); ++ie) {
+        if ((*ie)->matches(**k)) {
+          key.length = (*ie)->len();
+          key.offset = field_offset;
+          key.kind = Key::octets;
+          break;
+        }
+        if ((*ie)->len() == kIpfixVarlen)
+          key.has_offset = false;
+        else
+          field_offset += (*ie)->len();
+        key.field++;
+      }
+
+      /* Numbers may arrive with reduced length; fingerprint their
+       * value so that the encoding doesn't matter. */
+      if (key.kind == Key::octets && key.length <= sizeof(uint64_t)) {
+        switch ((*k)->ietype()->number()) {
+        case IEType::kUnsigned8:
+        case IEType::kUnsigned16:
+        case IEType::kUnsigned32:
+        case IEType::kUnsigned64:
+        case IEType::kDateTimeSeconds:
+        case IEType::kDateTimeMilliseconds:
+        case IEType::kDateTimeMicroseconds:
+        case IEType::kDateTimeNanoseconds:
+          key.kind = Key::unsigned_value;
+          break;
+        case IEType::kSigned8:
+        case IEType::kSigned16:
+        case IEType::kSigned32:
+        case IEType::kSigned64:
+          key.kind = Key::signed_value;
+          break;
+        case IEType::kFloat32:
+        case IEType::kFloat64:
+          if (key.length == sizeof(float) || key.length == sizeof(double))
+            key.kind = Key::float_value;
+          break;
+        default:
+          break;
+        }
+      }
+
+      keys.push_back(key);
+    }
+  }
+
+  uint64_t DeduplicationPlan::fingerprint(const uint8_t* buf,
+                                          uint16_t record_length) {
+    uint64_t h = hash_seed;
+
+    if (keys.empty())
+      h = hash_octets(hash_mix(h, record_length), buf, record_length);
+    else {
+      if (walker.has_varlen()
+          && walker.walk(buf, record_length, field_offsets.data(),
+                         field_sizes.data()) == 0)
+        report_error("Record beyond record length %u", record_length);
+
+      for (auto k = keys.begin(); k != keys.end(); ++k) {
+        if (k->kind == Key::absent) {
+          h = hash_mix(h, 0);
+          continue;
+        }
+
+        unsigned int i = k->field;
+        const uint8_t* p = buf + (k->has_offset ? k->offset
+                                  : field_offsets[i]);
+        uint16_t length = k->length;
+        if (length == kIpfixVarlen)
+          length = field_sizes[i];
+
+        if (k->kind == Key::octets) {
+          h = hash_octets(hash_mix(h, length), p, length);
+          continue;
+        }
+
+        uint64_t v = 0;
+        for (uint16_t n = 0; n < length; n++)
+          v = (v << 8) | p[n];
+        if (k->kind == Key::float_value) {
+          double d;
+          if (length == sizeof(float)) {
+            uint32_t v32 = static_cast<uint32_t>(v);
+            float f;
+            memcpy(&f, &v32, sizeof(f));
+            d = f;
+          } else
+            memcpy(&d, &v, sizeof(d));
+          memcpy(&v, &d, sizeof(v));
+        } else if (k->kind == Key::signed_value && length < sizeof(uint64_t)
+            && (p[0] & 0x80) != 0)
+          v |= ~static_cast<uint64_t>(0) << (8*length);
+        h = hash_mix(h, v);
+      }
+    }
+
+    return hash_finish(h);
+  }
+
+  bool DeduplicationPlan::execute(const uint8_t* buf, uint16_t record_length) {
+    return dedup->check(fingerprint(buf, record_length));
+  }
+
+} // namespace libfc
@@ -0,0 +1,123 @@
+/* Hi Emacs, please use -*- mode: C++; -*- */
+/* Copyright (c) 2011-2014 ETH Zürich. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ *    * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *    * Neither the names of ETH Zürich nor the names of other contributors 
+ *      may be used to endorse or promote products derived from this software 
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL ETH 
+ * ZURICH BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, 
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, 
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR 
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY 
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ * @author Stephan Neuhaus <neuhaust@tik.ee.ethz.ch>
+ */
+
+#ifndef _libfc_DEDUPLICATIONPLAN_H_
+#  define _libfc_DEDUPLICATIONPLAN_H_
+
+#  include <vector>
+
+#  include "IETemplate.h"
+#  include "RecordDeduplicator.h"
+#  include "RecordWalker.h"
+
+namespace libfc {
+
+  /** Deduplication plans fingerprint raw data records.
+   *
+   * A deduplication plan binds the key IEs of a RecordDeduplicator
+   * to the fields of one wire template, in the same way as a
+   * FilterPlan binds predicates.  Fields before which there is no
+   * variable-length field are read at a fixed offset; otherwise the
+   * record is walked once to find the field offsets.
+   *
+   * Integer and float keys are fingerprinted by value, so a record
+   * whose key fields arrive with reduced-length encoding has the
+   * same fingerprint as one with full-length encoding.  Floats are
+   * widened to float64 first.
+   */
+  class DeduplicationPlan {
+  public:
+    /** Creates a deduplication plan.
+     *
+     * @param dedup the deduplicator to use
+     * @param wire_template the wire template for the data set
+     */
+    DeduplicationPlan(RecordDeduplicator* dedup,
+                      const IETemplate* wire_template);
+
+    /** Computes the fingerprint of a data record.
+     *
+     * @param buf the buffer containing the data record
+     * @param record_length the length of the data record
+     *
+     * @return the fingerprint
+     */
+    uint64_t fingerprint(const uint8_t* buf, uint16_t record_length);
+
+    /** Tells whether a data record is a duplicate, and remembers it
+     * if it isn't.
+     *
+     * @param buf the buffer containing the data record
+     * @param record_length the length of the data record
+     *
+     * @return true if the record is a duplicate
+     */
+    bool execute(const uint8_t* buf, uint16_t record_length);
+
+  private:
+    struct Key {
+      /** Index of the field in the wire template. */
+      unsigned int field;
+
+      /** Wire length of the field. */
+      uint16_t length;
+
+      /** Offset of the field in the record, if has_offset. */
+      uint16_t offset;
+
+      /** True if offset is valid, i.e., no varlen field precedes the
+       * field. */
+      bool has_offset;
+
+      /** How the field is fingerprinted. */
+      enum { absent, unsigned_value, signed_value, float_value,
+             octets } kind;
+    };
+
+    RecordDeduplicator* dedup;
+    std::vector<Key> keys;
+
+    /** Finds field boundaries. */
+    RecordWalker walker;
+
+    /** Field offsets of the current record, for templates with
+     * varlen fields. */
+    std::vector<uint16_t> field_offsets;
+
+    /** Field lengths of the current record, for templates with
+     * varlen fields. */
+    std::vector<uint16_t> field_sizes;
+  };
+
+} // namespace libfc
+
+#endif // _libfc_DEDUPLICATIONPLAN_H_
@@ -71,6 +71,8 @@ namespace libfc {
    */
   class ExportDestination {
   public:
+    virtual ~ExportDestination() {}
+
     /** Writes a set of scattered buffers.
      *
      * @param iovecs a vector of struct iovec (see `man writev')
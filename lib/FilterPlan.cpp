@@ -0,0 +1,199 @@
+/* Copyright (c) 2011-2014 ETH Zürich. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ *    * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *    * Neither the names of ETH Zürich nor the names of other contributors 
+ *      may be used to endorse or promote products derived from this software 
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL ETH 
+ * ZURICH BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, 
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, 
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR 
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY 
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+#include "Constants.h"
+#include "FilterPlan.h"
+
+#include "decode_util.h"
+
+namespace libfc {
+
+  FilterPlan::FilterPlan(const RecordFilter* filter,
+                         const IETemplate* wire_template)
+    : walker(wire_template),
+      field_offsets(walker.get_field_count()),
+      never(false) {
+    assert(filter != 0);
+    assert(wire_template != 0);
+
+    for (auto p = filter->predicates.begin();
+         p != filter->predicates.end();
+         ++p) {
+      Test t;
+      t.predicate = &*p;
+      t.field = 0;
+      t.length = 0;
+      t.offset = 0;
+      t.has_offset = true;
+
+      uint16_t field_offset = 0;
+      bool found = false;
+      for (auto ie = wire_template->begin(); ie != wire_template->end(); ++ie) {
+        if ((*ie)->matches(*p->ie)) {
+          t.length = (*ie)->len();
+          t.offset = field_offset;
+          found = true;
+          break;
+        }
+        if ((*ie)->len() == kIpfixVarlen)
+          t.has_offset = false;
+        else
+          field_offset += (*ie)->len();
+        t.field++;
+      }
+
+      /* Integers may arrive with reduced length, but never with
+       * variable length; addresses must have their full length. */
+      bool usable = found && t.length != kIpfixVarlen;
+      if (usable) {
+        if (p->type == RecordFilter::Predicate::prefix)
+          usable = t.length == p->address.size();
+        else
+          usable = t.length <= sizeof(uint64_t);
+      }
+
+      if (!usable) {
+        never = true;
+        break;
+      }
+
+      tests.push_back(t);
+    }
+  }
+
+  bool FilterPlan::rejects_all() const {
+    return never;
+  }
+
+  uint64_t FilterPlan::decode_unsigned(const uint8_t* p, uint16_t length) {
+    uint64_t ret = 0;
+    for (uint16_t i = 0; i < length; i++)
+      ret = (ret << 8) | p[i];
+    return ret;
+  }
+
+  bool FilterPlan::evaluate(const Test& t, const uint8_t* p) {
+    const RecordFilter::Predicate* pred = t.predicate;
+
+    switch (pred->type) {
+    case RecordFilter::Predicate::compare_unsigned:
+      {
+        uint64_t v = decode_unsigned(p, t.length);
+        switch (pred->op) {
+        case RecordFilter::eq: return v == pred->value;
+        case RecordFilter::ne: return v != pred->value;
+        case RecordFilter::lt: return v <  pred->value;
+        case RecordFilter::le: return v <= pred->value;
+        case RecordFilter::gt: return v >  pred->value;
+        case RecordFilter::ge: return v >= pred->value;
+        }
+      }
+      break;
+
+    case RecordFilter::Predicate::compare_signed:
+      {
+        uint64_t u = decode_unsigned(p, t.length);
+        /* Sign-extend reduced-length values. */
+        if (t.length < sizeof(uint64_t) && (p[0] & 0x80) != 0)
+          u |= ~static_cast<uint64_t>(0) << (8*t.length);
+        int64_t v = static_cast<int64_t>(u);
+        int64_t c = static_cast<int64_t>(pred->value);
+        switch (pred->op) {
+        case RecordFilter::eq: return v == c;
+        case RecordFilter::ne: return v != c;
+        case RecordFilter::lt: return v <  c;
+        case RecordFilter::le: return v <= c;
+        case RecordFilter::gt: return v >  c;
+        case RecordFilter::ge: return v >= c;
+        }
+      }
+      break;
+
+    case RecordFilter::Predicate::prefix:
+      {
+        unsigned int full_octets = pred->prefix_length / 8;
+        unsigned int rest = pred->prefix_length % 8;
+
+        if (memcmp(p, pred->address.data(), full_octets) != 0)
+          return false;
+        if (rest == 0)
+          return true;
+
+        uint8_t mask = static_cast<uint8_t>(0xff << (8 - rest));
+        return (p[full_octets] & mask)
+          == (pred->address[full_octets] & mask);
+      }
+
+    case RecordFilter::Predicate::member:
+      {
+        uint64_t v = decode_unsigned(p, t.length);
+        if (!pred->bitmap.empty())
+          return v <= UINT16_MAX
+            && (pred->bitmap[v / 64] & (static_cast<uint64_t>(1) << (v % 64)))
+               != 0;
+        return std::binary_search(pred->values.begin(),
+                                  pred->values.end(), v);
+      }
+    }
+
+    return false;
+  }
+
+  bool FilterPlan::execute(const uint8_t* buf, uint16_t length,
+                           uint16_t* record_length) {
+    bool ret = !never;
+
+    if (!walker.has_varlen()) {
+      size_t fixlen_record_length = walker.get_min_length();
+      if (fixlen_record_length > length)
+        report_error("Record length %zu beyond data set length %u",
+                     fixlen_record_length, length);
+
+      *record_length = static_cast<uint16_t>(fixlen_record_length);
+      for (auto t = tests.begin(); ret && t != tests.end(); ++t)
+        ret = evaluate(*t, buf + t->offset);
+      return ret;
+    }
+
+    /* There are varlen fields: walk the record to find where fields
+     * start and where the record ends. */
+    size_t varlen_record_length
+      = walker.walk(buf, length, field_offsets.data());
+    if (varlen_record_length == 0)
+      report_error("Record beyond data set length %u", length);
+
+    *record_length = static_cast<uint16_t>(varlen_record_length);
+
+    for (auto t = tests.begin(); ret && t != tests.end(); ++t)
+      ret = evaluate(*t, buf + (t->has_offset ? t->offset
+                                : field_offsets[t->field]));
+    return ret;
+  }
+
+} // namespace libfc
@@ -0,0 +1,128 @@
+/* Hi Emacs, please use -*- mode: C++; -*- */
+/* Copyright (c) 2011-2014 ETH Zürich. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ *    * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *    * Neither the names of ETH Zürich nor the names of other contributors 
+ *      may be used to endorse or promote products derived from this software 
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL ETH 
+ * ZURICH BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, 
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, 
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR 
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY 
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ * @author Stephan Neuhaus <neuhaust@tik.ee.ethz.ch>
+ */
+
+#ifndef _libfc_FILTERPLAN_H_
+#  define _libfc_FILTERPLAN_H_
+
+#  include <vector>
+
+#  include "IETemplate.h"
+#  include "RecordFilter.h"
+#  include "RecordWalker.h"
+
+namespace libfc {
+
+  /** Filter plans evaluate a RecordFilter on raw data records.
+   *
+   * A filter plan is to a RecordFilter what a DecodePlan is to a
+   * PlacementTemplate: it binds the filter's predicates to the fields
+   * of one wire template.  For each predicate, the plan knows the
+   * index of the field it tests and, as long as no variable-length
+   * field comes before it, the field's offset within the record.
+   * Evaluating the plan then needs no decoding at all: fields are
+   * compared in their wire representation, with the constants
+   * converted once when the plan is made.
+   *
+   * Records with variable-length fields are walked once to find field
+   * offsets and the record length; everything else is read in place.
+   */
+  class FilterPlan {
+  public:
+    /** Creates a filter plan.
+     *
+     * @param filter the filter to evaluate
+     * @param wire_template the wire template for the data set
+     */
+    FilterPlan(const RecordFilter* filter, const IETemplate* wire_template);
+
+    /** Tells whether no record can ever pass this filter.
+     *
+     * This is the case when a predicate refers to an IE that is not
+     * in the wire template, or to an IE whose wire length is
+     * unsuitable for the predicate.
+     *
+     * @return true if every record will be rejected
+     */
+    bool rejects_all() const;
+
+    /** Evaluates the filter on a data record.
+     *
+     * @param buf the buffer containing the data record (and the
+     *     remaining data set)
+     * @param length length of the remaining data set
+     * @param record_length will receive the length of the record, so
+     *     that rejected records can be skipped
+     *
+     * @return true if the record satisfies all predicates
+     */
+    bool execute(const uint8_t* buf, uint16_t length,
+                 uint16_t* record_length);
+
+  private:
+    struct Test {
+      const RecordFilter::Predicate* predicate;
+
+      /** Index of the tested field in the wire template. */
+      unsigned int field;
+
+      /** Wire length of the tested field. */
+      uint16_t length;
+
+      /** Offset of the field in the record, if has_offset. */
+      uint16_t offset;
+
+      /** True if offset is valid, i.e., no varlen field precedes the
+       * tested field. */
+      bool has_offset;
+    };
+
+    /** Decodes a big-endian unsigned integer of 1 to 8 octets. */
+    static uint64_t decode_unsigned(const uint8_t* p, uint16_t length);
+
+    /** Evaluates one test on a field. */
+    static bool evaluate(const Test& t, const uint8_t* p);
+
+    std::vector<Test> tests;
+
+    /** Finds record and field boundaries. */
+    RecordWalker walker;
+
+    /** Field offsets of the current record, for templates with
+     * varlen fields. */
+    std::vector<uint16_t> field_offsets;
+
+    bool never;
+  };
+
+} // namespace libfc
+
+#endif // _libfc_FILTERPLAN_H_
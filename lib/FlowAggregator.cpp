@@ -0,0 +1,652 @@
+/* Copyright (c) 2011-2014 ETH Zürich. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ *    * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *    * Neither the names of ETH Zürich nor the names of other contributors 
+ *      may be used to endorse or promote products derived from this software 
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL ETH 
+ * ZURICH BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, 
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, 
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR 
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY 
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstring>
+#include <limits>
+
+#include "FlowAggregator.h"
+#include "IEType.h"
+
+#include "exceptions/IESpecError.h"
+
+#include "hash_util.h"
+
+/* Layout of a slot in the flow table, in 64-bit words. */
+static const size_t kSlotHash = 0;
+static const size_t kSlotFirst = 1;
+static const size_t kSlotLast = 2;
+static const size_t kSlotCount = 3;
+static const size_t kSlotKey = 4;
+
+/** Hash value of an empty slot. */
+static const uint64_t kEmpty = 0;
+
+static uint64_t double_bits(double d) {
+  uint64_t ret;
+  memcpy(&ret, &d, sizeof(ret));
+  return ret;
+}
+
+static double bits_double(uint64_t u) {
+  double ret;
+  memcpy(&ret, &u, sizeof(ret));
+  return ret;
+}
+
+static uint64_t hash_key(const uint64_t* key, size_t n) {
+  uint64_t h = libfc::hash_seed;
+  for (size_t i = 0; i < n; ++i)
+    h = libfc::hash_mix(h, key[i]);
+  /* Finish, so that the low bits, which select the slot, depend on
+   * all bits of the key. */
+  h = libfc::hash_finish(h);
+  return h == kEmpty ? 1 : h;
+}
+
+namespace libfc {
+
+  FlowAggregator::FlowAggregator(size_t initial_capacity)
+    : clock_input(-1),
+      time_bin(0),
+      active_timeout(0),
+      idle_timeout(0),
+      exporter(0),
+      frozen(false),
+      key_words(0),
+      slot_words(0),
+      capacity(16),
+      n_flows(0),
+      clock(0),
+      next_scan(0),
+      n_records(0),
+      n_emitted(0) {
+    while (capacity < initial_capacity)
+      capacity *= 2;
+  }
+
+  FlowAggregator::~FlowAggregator() {
+  }
+
+  unsigned int FlowAggregator::add_input(const InfoElement* ie, Kind kind,
+                                         size_t width) {
+    for (unsigned int i = 0; i < inputs.size(); ++i)
+      if (inputs[i].ie == ie)
+        return i;
+
+    Input in;
+    in.ie = ie;
+    in.kind = kind;
+    in.width = width;
+    in.offset = 0;
+    inputs.push_back(in);
+    return inputs.size() - 1;
+  }
+
+  void FlowAggregator::check_output(const InfoElement* ie) const {
+    for (auto k = keys.begin(); k != keys.end(); ++k)
+      if (inputs[k->input].ie == ie)
+        throw IESpecError("IE " + ie->toIESpec() + " is already a key");
+    for (auto v = values.begin(); v != values.end(); ++v)
+      if (v->ie == ie)
+        throw IESpecError("IE " + ie->toIESpec() + " is already a value");
+  }
+
+  void FlowAggregator::add_key(const InfoElement* ie,
+                               unsigned int prefix_length) {
+    assert(!frozen);
+
+    Kind kind = unsigned_kind;
+    size_t width = ie->ietype()->placedWidth();
+    unsigned int max_prefix_length = 0;
+
+    switch (ie->ietype()->number()) {
+    case IEType::kUnsigned8:
+    case IEType::kUnsigned16:
+    case IEType::kUnsigned32:
+    case IEType::kUnsigned64:
+    case IEType::kBoolean:
+    case IEType::kDateTimeSeconds:
+    case IEType::kDateTimeMilliseconds:
+    case IEType::kDateTimeMicroseconds:
+    case IEType::kDateTimeNanoseconds:
+    case IEType::kMacAddress:
+      break;
+    case IEType::kSigned8:
+    case IEType::kSigned16:
+    case IEType::kSigned32:
+    case IEType::kSigned64:
+      kind = signed_kind;
+      break;
+    case IEType::kIpv4Address:
+      max_prefix_length = 32;
+      break;
+    case IEType::kIpv6Address:
+      max_prefix_length = 128;
+      break;
+    default:
+      throw IESpecError("Can't aggregate on IE " + ie->toIESpec());
+    }
+
+    if (prefix_length > max_prefix_length)
+      throw IESpecError("Invalid prefix length "
+                        + std::to_string(prefix_length)
+                        + " for IE " + ie->toIESpec());
+    check_output(ie);
+
+    Key k;
+    k.input = add_input(ie, kind, width);
+    k.prefix_length = prefix_length;
+    k.offset = 0;
+    k.output_offset = 0;
+    keys.push_back(k);
+  }
+
+  void FlowAggregator::add_value(const InfoElement* ie, Function function) {
+    assert(!frozen);
+
+    Kind kind = unsigned_kind;
+    size_t width = ie->ietype()->placedWidth();
+    bool is_time = false;
+
+    switch (ie->ietype()->number()) {
+    case IEType::kUnsigned8:
+    case IEType::kUnsigned16:
+    case IEType::kUnsigned32:
+    case IEType::kUnsigned64:
+      break;
+    case IEType::kSigned8:
+    case IEType::kSigned16:
+    case IEType::kSigned32:
+    case IEType::kSigned64:
+      kind = signed_kind;
+      break;
+    case IEType::kFloat32:
+    case IEType::kFloat64:
+      kind = float_kind;
+      break;
+    case IEType::kDateTimeSeconds:
+    case IEType::kDateTimeMilliseconds:
+    case IEType::kDateTimeMicroseconds:
+    case IEType::kDateTimeNanoseconds:
+      is_time = true;
+      break;
+    default:
+      throw IESpecError("Can't aggregate values of IE " + ie->toIESpec());
+    }
+
+    if ((is_time && function == sum)
+        || (function == count && kind != unsigned_kind))
+      throw IESpecError("Invalid aggregation function for IE "
+                        + ie->toIESpec());
+    check_output(ie);
+
+    Value v;
+    v.ie = ie;
+    v.function = function;
+    v.input = function == count ? 0 : add_input(ie, kind, width);
+    v.kind = kind;
+    v.width = width;
+    v.output_offset = 0;
+    values.push_back(v);
+  }
+
+  void FlowAggregator::set_clock(const InfoElement* ie) {
+    assert(!frozen);
+
+    switch (ie->ietype()->number()) {
+    case IEType::kDateTimeSeconds:
+      clock_input = add_input(ie, unsigned_kind, 4);
+      break;
+    case IEType::kDateTimeMilliseconds:
+    case IEType::kDateTimeMicroseconds:
+    case IEType::kDateTimeNanoseconds:
+      clock_input = add_input(ie, unsigned_kind, 8);
+      break;
+    default:
+      throw IESpecError("Can't take time from IE " + ie->toIESpec());
+    }
+  }
+
+  void FlowAggregator::set_time_bin(uint64_t width) {
+    assert(!frozen);
+    time_bin = width;
+  }
+
+  void FlowAggregator::set_timeouts(uint64_t active, uint64_t idle) {
+    active_timeout = active;
+    idle_timeout = idle;
+    next_scan = 0;
+  }
+
+  void FlowAggregator::set_exporter(PlacementExporter* _exporter) {
+    exporter = _exporter;
+  }
+
+  const PlacementTemplate* FlowAggregator::get_input_template() {
+    freeze();
+    return &input_template;
+  }
+
+  const PlacementTemplate* FlowAggregator::get_output_template() {
+    freeze();
+    return &output_template;
+  }
+
+  void FlowAggregator::freeze() {
+    if (frozen)
+      return;
+
+    size_t n = 0;
+    for (auto in = inputs.begin(); in != inputs.end(); ++in) {
+      in->offset = n*sizeof(uint64_t);
+      n += words(in->width);
+    }
+    input_buffer.assign(n, 0);
+    uint8_t* input = reinterpret_cast<uint8_t*>(input_buffer.data());
+    for (auto in = inputs.begin(); in != inputs.end(); ++in)
+      input_template.register_placement(in->ie, input + in->offset, 0);
+
+    size_t key_octets = 0;
+    n = 0;
+    for (auto k = keys.begin(); k != keys.end(); ++k) {
+      k->offset = key_octets;
+      key_octets += inputs[k->input].width;
+      k->output_offset = n*sizeof(uint64_t);
+      n += words(inputs[k->input].width);
+    }
+    for (auto v = values.begin(); v != values.end(); ++v) {
+      v->output_offset = n*sizeof(uint64_t);
+      n += words(v->width);
+    }
+    output_buffer.assign(n, 0);
+    uint8_t* output = reinterpret_cast<uint8_t*>(output_buffer.data());
+    for (auto k = keys.begin(); k != keys.end(); ++k)
+      output_template.register_placement(inputs[k->input].ie,
+                                         output + k->output_offset, 0);
+    for (auto v = values.begin(); v != values.end(); ++v)
+      output_template.register_placement(v->ie, output + v->output_offset, 0);
+
+    key_words = words(key_octets) + (time_bin != 0 ? 1 : 0);
+    slot_words = kSlotKey + key_words + values.size();
+    key_buffer.assign(key_words, 0);
+    table.assign(capacity*slot_words, kEmpty);
+
+    frozen = true;
+  }
+
+  uint64_t FlowAggregator::read_unsigned(const Input& in) const {
+    const uint8_t* p
+      = reinterpret_cast<const uint8_t*>(input_buffer.data()) + in.offset;
+    switch (in.width) {
+    case 1: return *p;
+    case 2: return *reinterpret_cast<const uint16_t*>(p);
+    case 4: return *reinterpret_cast<const uint32_t*>(p);
+    default: return *reinterpret_cast<const uint64_t*>(p);
+    }
+  }
+
+  int64_t FlowAggregator::read_signed(const Input& in) const {
+    const uint8_t* p
+      = reinterpret_cast<const uint8_t*>(input_buffer.data()) + in.offset;
+    switch (in.width) {
+    case 1: return *reinterpret_cast<const int8_t*>(p);
+    case 2: return *reinterpret_cast<const int16_t*>(p);
+    case 4: return *reinterpret_cast<const int32_t*>(p);
+    default: return *reinterpret_cast<const int64_t*>(p);
+    }
+  }
+
+  double FlowAggregator::read_float(const Input& in) const {
+    const uint8_t* p
+      = reinterpret_cast<const uint8_t*>(input_buffer.data()) + in.offset;
+    if (in.width == 4)
+      return *reinterpret_cast<const float*>(p);
+    else
+      return *reinterpret_cast<const double*>(p);
+  }
+
+  uint64_t FlowAggregator::current_time() const {
+    if (clock_input < 0)
+      return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+
+    const Input& in = inputs[clock_input];
+    uint64_t t = read_unsigned(in);
+    switch (in.ie->ietype()->number()) {
+    case IEType::kDateTimeSeconds: return t*1000;
+    case IEType::kDateTimeMicroseconds: return t/1000;
+    case IEType::kDateTimeNanoseconds: return t/1000000;
+    default: return t;
+    }
+  }
+
+  uint64_t* FlowAggregator::find_or_insert(const uint64_t* key,
+                                           uint64_t hash) {
+    if (2*(n_flows + 1) > capacity)
+      grow();
+
+    size_t mask = capacity - 1;
+    for (size_t i = hash & mask; ; i = (i + 1) & mask) {
+      uint64_t* slot = &table[i*slot_words];
+
+      if (slot[kSlotHash] == hash
+          && memcmp(slot + kSlotKey, key, key_words*sizeof(uint64_t)) == 0)
+        return slot;
+
+      if (slot[kSlotHash] == kEmpty) {
+        slot[kSlotHash] = hash;
+        slot[kSlotFirst] = std::numeric_limits<uint64_t>::max();
+        slot[kSlotLast] = 0;
+        slot[kSlotCount] = 0;
+        memcpy(slot + kSlotKey, key, key_words*sizeof(uint64_t));
+
+        uint64_t* acc = slot + kSlotKey + key_words;
+        for (auto v = values.begin(); v != values.end(); ++v, ++acc) {
+          if (v->function == min) {
+            switch (v->kind) {
+            case unsigned_kind:
+              *acc = std::numeric_limits<uint64_t>::max();
+              break;
+            case signed_kind:
+              *acc = std::numeric_limits<int64_t>::max();
+              break;
+            case float_kind:
+              *acc = double_bits(std::numeric_limits<double>::infinity());
+              break;
+            }
+          } else if (v->function == max) {
+            switch (v->kind) {
+            case unsigned_kind:
+              *acc = 0;
+              break;
+            case signed_kind:
+              *acc = std::numeric_limits<int64_t>::min();
+              break;
+            case float_kind:
+              *acc = double_bits(-std::numeric_limits<double>::infinity());
+              break;
+            }
+          } else
+            *acc = v->kind == float_kind ? double_bits(0.0) : 0;
+        }
+
+        ++n_flows;
+        return slot;
+      }
+    }
+  }
+
+  void FlowAggregator::grow() {
+    std::vector<uint64_t> old_table(2*capacity*slot_words, kEmpty);
+    old_table.swap(table);
+    capacity *= 2;
+    reinsert(old_table);
+  }
+
+  void FlowAggregator::reinsert(const std::vector<uint64_t>& old_table) {
+    size_t mask = capacity - 1;
+    for (size_t j = 0; j < old_table.size(); j += slot_words) {
+      if (old_table[j + kSlotHash] == kEmpty)
+        continue;
+      size_t i = old_table[j + kSlotHash] & mask;
+      while (table[i*slot_words + kSlotHash] != kEmpty)
+        i = (i + 1) & mask;
+      memcpy(&table[i*slot_words], &old_table[j],
+             slot_words*sizeof(uint64_t));
+    }
+  }
+
+  void FlowAggregator::add_record() {
+    freeze();
+
+    uint64_t t = current_time();
+    if (t > clock)
+      clock = t;
+
+    uint8_t* key = reinterpret_cast<uint8_t*>(key_buffer.data());
+    memset(key, 0, key_words*sizeof(uint64_t));
+    for (auto k = keys.begin(); k != keys.end(); ++k) {
+      const Input& in = inputs[k->input];
+      uint8_t* p = key + k->offset;
+      memcpy(p, reinterpret_cast<const uint8_t*>(input_buffer.data())
+             + in.offset, in.width);
+
+      if (k->prefix_length == 0)
+        continue;
+      if (in.ie->ietype()->number() == IEType::kIpv4Address) {
+        /* Placed in host byte order. */
+        uint32_t a;
+        memcpy(&a, p, sizeof(a));
+        a &= ~static_cast<uint32_t>(0) << (32 - k->prefix_length);
+        memcpy(p, &a, sizeof(a));
+      } else {
+        /* ipv6Address, placed in network byte order. */
+        unsigned int full = k->prefix_length / 8;
+        unsigned int bits = k->prefix_length % 8;
+        if (bits != 0)
+          p[full++] &= 0xff << (8 - bits);
+        memset(p + full, 0, in.width - full);
+      }
+    }
+    if (time_bin != 0)
+      key_buffer[key_words - 1] = t - t % time_bin;
+
+    uint64_t* slot = find_or_insert(key_buffer.data(),
+                                    hash_key(key_buffer.data(), key_words));
+
+    if (t < slot[kSlotFirst])
+      slot[kSlotFirst] = t;
+    if (t > slot[kSlotLast])
+      slot[kSlotLast] = t;
+    ++slot[kSlotCount];
+
+    uint64_t* acc = slot + kSlotKey + key_words;
+    for (auto v = values.begin(); v != values.end(); ++v, ++acc) {
+      if (v->function == count)
+        continue;
+
+      const Input& in = inputs[v->input];
+      switch (v->kind) {
+      case unsigned_kind:
+        {
+          uint64_t x = read_unsigned(in);
+          if (v->function == sum)
+            *acc += x;
+          else if ((v->function == min) == (x < *acc))
+            *acc = x;
+        }
+        break;
+      case signed_kind:
+        {
+          int64_t x = read_signed(in);
+          int64_t a = static_cast<int64_t>(*acc);
+          if (v->function == sum)
+            *acc += static_cast<uint64_t>(x);
+          else if ((v->function == min) == (x < a))
+            *acc = static_cast<uint64_t>(x);
+        }
+        break;
+      case float_kind:
+        {
+          double x = read_float(in);
+          double a = bits_double(*acc);
+          if (v->function == sum)
+            *acc = double_bits(a + x);
+          else if ((v->function == min) == (x < a))
+            *acc = double_bits(x);
+        }
+        break;
+      }
+    }
+
+    ++n_records;
+
+    if (clock >= next_scan)
+      expire(clock);
+  }
+
+  bool FlowAggregator::is_expired(const uint64_t* slot, uint64_t now) const {
+    if (idle_timeout != 0 && now >= slot[kSlotLast] + idle_timeout)
+      return true;
+    if (active_timeout != 0 && now >= slot[kSlotFirst] + active_timeout)
+      return true;
+    if (time_bin != 0 && now >= slot[kSlotKey + key_words - 1] + time_bin)
+      return true;
+    return false;
+  }
+
+  void FlowAggregator::expire(uint64_t now) {
+    freeze();
+
+    uint64_t interval = std::numeric_limits<uint64_t>::max();
+    if (active_timeout != 0 && active_timeout < interval)
+      interval = active_timeout;
+    if (idle_timeout != 0 && idle_timeout < interval)
+      interval = idle_timeout;
+    if (time_bin != 0 && time_bin < interval)
+      interval = time_bin;
+
+    if (interval == std::numeric_limits<uint64_t>::max()) {
+      next_scan = interval;
+      return;
+    }
+    interval = interval >= 8 ? interval / 8 : 1;
+    next_scan = now + interval;
+    if (time_bin != 0 && now - now % time_bin + time_bin < next_scan)
+      next_scan = now - now % time_bin + time_bin;
+
+    /* Emit expired flows and move the others into a fresh table, so
+     * that no deleted slots remain in the probe sequences. */
+    bool any_expired = false;
+    for (size_t j = 0; j < table.size(); j += slot_words) {
+      if (table[j + kSlotHash] != kEmpty && is_expired(&table[j], now)) {
+        emit_slot(&table[j]);
+        table[j + kSlotHash] = kEmpty;
+        --n_flows;
+        any_expired = true;
+      }
+    }
+    if (!any_expired)
+      return;
+
+    std::vector<uint64_t> old_table(table.size(), kEmpty);
+    old_table.swap(table);
+    reinsert(old_table);
+  }
+
+  void FlowAggregator::flush() {
+    freeze();
+
+    for (size_t j = 0; j < table.size(); j += slot_words)
+      if (table[j + kSlotHash] != kEmpty)
+        emit_slot(&table[j]);
+
+    std::fill(table.begin(), table.end(), kEmpty);
+    n_flows = 0;
+  }
+
+  void FlowAggregator::emit_slot(const uint64_t* slot) {
+    uint8_t* output = reinterpret_cast<uint8_t*>(output_buffer.data());
+    const uint8_t* key = reinterpret_cast<const uint8_t*>(slot + kSlotKey);
+
+    for (auto k = keys.begin(); k != keys.end(); ++k)
+      memcpy(output + k->output_offset, key + k->offset,
+             inputs[k->input].width);
+
+    const uint64_t* acc = slot + kSlotKey + key_words;
+    for (auto v = values.begin(); v != values.end(); ++v, ++acc) {
+      uint8_t* p = output + v->output_offset;
+
+      switch (v->kind) {
+      case unsigned_kind:
+        {
+          uint64_t x = v->function == count ? slot[kSlotCount] : *acc;
+          /* Sums saturate at the largest value of the IE type. */
+          uint64_t max = v->width == 8
+            ? std::numeric_limits<uint64_t>::max()
+            : (static_cast<uint64_t>(1) << (8*v->width)) - 1;
+          if (x > max)
+            x = max;
+          switch (v->width) {
+          case 1: *p = static_cast<uint8_t>(x); break;
+          case 2: *reinterpret_cast<uint16_t*>(p) = x; break;
+          case 4: *reinterpret_cast<uint32_t*>(p) = x; break;
+          default: *reinterpret_cast<uint64_t*>(p) = x; break;
+          }
+        }
+        break;
+      case signed_kind:
+        {
+          int64_t x = static_cast<int64_t>(*acc);
+          if (v->width < 8) {
+            int64_t max = (static_cast<int64_t>(1) << (8*v->width - 1)) - 1;
+            if (x > max)
+              x = max;
+            else if (x < -max - 1)
+              x = -max - 1;
+          }
+          switch (v->width) {
+          case 1: *reinterpret_cast<int8_t*>(p) = x; break;
+          case 2: *reinterpret_cast<int16_t*>(p) = x; break;
+          case 4: *reinterpret_cast<int32_t*>(p) = x; break;
+          default: *reinterpret_cast<int64_t*>(p) = x; break;
+          }
+        }
+        break;
+      case float_kind:
+        if (v->width == 4)
+          *reinterpret_cast<float*>(p) = bits_double(*acc);
+        else
+          *reinterpret_cast<double*>(p) = bits_double(*acc);
+        break;
+      }
+    }
+
+    ++n_emitted;
+    emit(&output_template);
+  }
+
+  void FlowAggregator::emit(const PlacementTemplate* tmpl) {
+    if (exporter != 0)
+      exporter->place_values(tmpl);
+  }
+
+  size_t FlowAggregator::get_flow_count() const {
+    return n_flows;
+  }
+
+  uint64_t FlowAggregator::get_record_count() const {
+    return n_records;
+  }
+
+  uint64_t FlowAggregator::get_emitted_count() const {
+    return n_emitted;
+  }
+
+} // namespace libfc
@@ -0,0 +1,351 @@
+/* Hi Emacs, please use -*- mode: C++; -*- */
+/* Copyright (c) 2011-2014 ETH Zürich. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ *    * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *    * Neither the names of ETH Zürich nor the names of other contributors 
+ *      may be used to endorse or promote products derived from this software 
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL ETH 
+ * ZURICH BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, 
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, 
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR 
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY 
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ * @author Stephan Neuhaus <neuhaust@tik.ee.ethz.ch>
+ */
+
+#ifndef _libfc_FLOWAGGREGATOR_H_
+#  define _libfc_FLOWAGGREGATOR_H_
+
+#  include <cstdint>
+#  include <vector>
+
+#  include "InfoElement.h"
+#  include "PlacementExporter.h"
+#  include "PlacementTemplate.h"
+
+namespace libfc {
+
+  /** Aggregates records by a configurable key.
+   *
+   * An aggregator is given a list of key IEs and a list of value IEs,
+   * each with an aggregation function.  Records that agree on all key
+   * IEs (after masking address keys to a prefix, and after putting the
+   * record time into a time bin, if that is wanted) are merged into a
+   * single flow, whose values are the sum, minimum or maximum of the
+   * values of the merged records.
+   *
+   * The aggregator has an input template, on which it places the key
+   * and value IEs of incoming records.  To aggregate collected
+   * records, register this template with a collector and call
+   * add_record() from end_placement():
+   *
+   * @code
+   * class MyCollector : public PlacementCollector {
+   * public:
+   *   MyCollector(FlowAggregator& agg)
+   *     : PlacementCollector(PlacementCollector::ipfix), agg(agg) {
+   *     register_placement_template(agg.get_input_template());
+   *   }
+   *
+   *   std::shared_ptr<ErrorContext>
+   *     end_placement(const PlacementTemplate* tmpl) {
+   *     agg.add_record();
+   *     libfc_RETURN_OK();
+   *   }
+   *   ...
+   * };
+   * @endcode
+   *
+   * Flows are kept in an open-addressing hash table with linear
+   * probing.  Each slot holds the hash, timestamps, key and
+   * accumulators of a flow in one contiguous run of memory, so that
+   * a lookup usually touches a single cache line.  The table grows
+   * when it becomes half full.
+   *
+   * A flow is emitted when it has been idle for longer than the idle
+   * timeout, when it has been active for longer than the active
+   * timeout, when its time bin has ended, or when flush() is called.
+   * So that add_record() does not have to look at every flow, the
+   * table is scanned for expired flows only every eighth of the
+   * shortest timeout or time bin, so flows are emitted up to that
+   * much later than their timeouts say.
+   * Emitting a flow places its key and values on the output template
+   * and calls emit(), which by default hands the record to the
+   * exporter given with set_exporter().  Derived classes can override
+   * emit() to receive aggregated records instead.
+   *
+   * All times are in milliseconds.  Unless a clock IE is set with
+   * set_clock(), timeouts are measured against the system clock at
+   * the time add_record() is called.
+   *
+   * The key and value IEs must all be set before the first call to
+   * get_input_template() or add_record().  Flows that have not been
+   * emitted when the aggregator is destroyed are discarded; call
+   * flush() first.
+   */
+  class FlowAggregator {
+  public:
+    /** How the values of merged records are combined. */
+    enum Function {
+      /** The sum of the values. */
+      sum,
+      /** The smallest value. */
+      min,
+      /** The largest value. */
+      max,
+      /** The number of records merged into the flow; the IE is not
+       * read from the records. */
+      count,
+    };
+
+    /** Creates an aggregator.
+     *
+     * @param initial_capacity the initial number of slots in the flow
+     *   table; rounded up to a power of two
+     */
+    explicit FlowAggregator(size_t initial_capacity
+                            = default_initial_capacity);
+
+    virtual ~FlowAggregator();
+
+    /** Adds a key IE.
+     *
+     * Keys can have any fixed-length type.  For ipv4Address and
+     * ipv6Address keys, a prefix length can be given, so that, for
+     * example, flows can be aggregated per /24 source network.
+     *
+     * @param ie the information element
+     * @param prefix_length the number of leading address bits to
+     *   keep, or 0 to keep the entire key
+     *
+     * @throw IESpecError if the IE can't be used as a key, or if the
+     *   prefix length does not fit the IE type
+     */
+    void add_key(const InfoElement* ie, unsigned int prefix_length = 0);
+
+    /** Adds a value IE.
+     *
+     * Values must have an unsigned, signed, float or dateTime type.
+     * Each IE can appear at most once in the output.
+     *
+     * @param ie the information element
+     * @param function how to combine the values of merged records
+     *
+     * @throw IESpecError if the IE can't be aggregated with this
+     *   function, or if it already appears in the output
+     */
+    void add_value(const InfoElement* ie, Function function);
+
+    /** Takes the time of a record from an IE instead of from the
+     * system clock.
+     *
+     * This should be used when aggregating stored records, since
+     * timeouts and time bins then refer to the time at which flows
+     * were observed.  The clock is taken to be the largest time seen
+     * so far, so that out-of-order records do not move it backwards.
+     *
+     * @param ie an IE with a dateTime type, for example
+     *   flowEndMilliseconds
+     *
+     * @throw IESpecError if the IE doesn't have a dateTime type
+     */
+    void set_clock(const InfoElement* ie);
+
+    /** Aggregates flows into time bins of a given width.
+     *
+     * The start of the time bin of a record becomes part of its key,
+     * and a flow is emitted once the clock has passed the end of its
+     * time bin.
+     *
+     * @param width the width of a time bin, or 0 for no time bins
+     */
+    void set_time_bin(uint64_t width);
+
+    /** Sets the active and idle timeouts.
+     *
+     * @param active emit flows that have been active for this long,
+     *   or 0 for no active timeout
+     * @param idle emit flows that have seen no record for this long,
+     *   or 0 for no idle timeout
+     */
+    void set_timeouts(uint64_t active, uint64_t idle);
+
+    /** Sets the exporter to which the default emit() hands records.
+     *
+     * @param exporter the exporter, or 0 to drop records
+     */
+    void set_exporter(PlacementExporter* exporter);
+
+    /** Returns the template on which incoming records are placed.
+     *
+     * @return the input template
+     */
+    const PlacementTemplate* get_input_template();
+
+    /** Returns the template on which emitted records are placed.
+     *
+     * It contains the key IEs followed by the value IEs.
+     *
+     * @return the output template
+     */
+    const PlacementTemplate* get_output_template();
+
+    /** Merges the record currently placed on the input template into
+     * its flow, and emits flows whose timeouts have expired.
+     */
+    void add_record();
+
+    /** Emits flows whose timeouts have expired at the given time.
+     *
+     * This is useful when aggregating live input that may pause.
+     *
+     * @param now the current time
+     */
+    void expire(uint64_t now);
+
+    /** Emits all flows and empties the flow table. */
+    void flush();
+
+    /** Returns the number of flows in the flow table.
+     *
+     * @return the number of flows in the flow table
+     */
+    size_t get_flow_count() const;
+
+    /** Returns the number of records merged so far.
+     *
+     * @return the number of records merged so far
+     */
+    uint64_t get_record_count() const;
+
+    /** Returns the number of flows emitted so far.
+     *
+     * @return the number of flows emitted so far
+     */
+    uint64_t get_emitted_count() const;
+
+    static const size_t default_initial_capacity = 4096;
+
+  protected:
+    /** Called for every emitted flow.
+     *
+     * The values of the flow are placed on the output template.  The
+     * default implementation passes the record to the exporter, if
+     * there is one.
+     *
+     * @param tmpl the output template
+     */
+    virtual void emit(const PlacementTemplate* tmpl);
+
+  private:
+    /** How a placed value is read. */
+    enum Kind { unsigned_kind, signed_kind, float_kind };
+
+    /** An IE placed on the input template. */
+    struct Input {
+      const InfoElement* ie;
+      Kind kind;
+      size_t width;
+      /** Offset of the placement in input_buffer. */
+      size_t offset;
+    };
+
+    struct Key {
+      unsigned int input;
+      unsigned int prefix_length;
+      /** Offset in the key part of a slot, in octets. */
+      size_t offset;
+      /** Offset in output_buffer. */
+      size_t output_offset;
+    };
+
+    struct Value {
+      const InfoElement* ie;
+      Function function;
+      unsigned int input;
+      Kind kind;
+      size_t width;
+      /** Offset in output_buffer. */
+      size_t output_offset;
+    };
+
+    unsigned int add_input(const InfoElement* ie, Kind kind, size_t width);
+    void check_output(const InfoElement* ie) const;
+    void freeze();
+
+    uint64_t* find_or_insert(const uint64_t* key, uint64_t hash);
+    void grow();
+    void reinsert(const std::vector<uint64_t>& old_table);
+    bool is_expired(const uint64_t* slot, uint64_t now) const;
+    void emit_slot(const uint64_t* slot);
+
+    uint64_t read_unsigned(const Input& in) const;
+    int64_t read_signed(const Input& in) const;
+    double read_float(const Input& in) const;
+    uint64_t current_time() const;
+
+    std::vector<Input> inputs;
+    std::vector<Key> keys;
+    std::vector<Value> values;
+
+    int clock_input;
+    uint64_t time_bin;
+    uint64_t active_timeout;
+    uint64_t idle_timeout;
+
+    PlacementExporter* exporter;
+
+    PlacementTemplate input_template;
+    PlacementTemplate output_template;
+    std::vector<uint64_t> input_buffer;
+    std::vector<uint64_t> output_buffer;
+
+    /** Whether the layout of inputs, slots and output is fixed. */
+    bool frozen;
+
+    /** Number of 64-bit words in the key part of a slot, including
+     * the time bin. */
+    size_t key_words;
+
+    /** Number of 64-bit words in a slot. */
+    size_t slot_words;
+
+    /** The flow table, capacity*slot_words words. */
+    std::vector<uint64_t> table;
+    size_t capacity;
+    size_t n_flows;
+
+    /** The key of the current record. */
+    std::vector<uint64_t> key_buffer;
+
+    /** The largest time seen so far. */
+    uint64_t clock;
+
+    /** The next time at which the table is scanned for expired
+     * flows. */
+    uint64_t next_scan;
+
+    uint64_t n_records;
+    uint64_t n_emitted;
+  };
+
+} // namespace libfc
+
+#endif // _libfc_FLOWAGGREGATOR_H_
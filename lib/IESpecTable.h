@@ -0,0 +1,81 @@
+/* Hi Emacs, please use -*- mode: C++; -*- */
+/* Copyright (c) 2011-2014 ETH Zürich. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ *    * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *    * Neither the names of ETH Zürich nor the names of other contributors 
+ *      may be used to endorse or promote products derived from this software 
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL ETH 
+ * ZURICH BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, 
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, 
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR 
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY 
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ * @author Stephan Neuhaus <neuhaust@tik.ee.ethz.ch>
+ *
+ * Static tables of information elements.
+ *
+ * The IANA registry and the RFC 5103 reverse IEs are kept as IESpec
+ * files (lib/iana.iespec and lib/rfc5103.iespec).  At build time,
+ * cmake/GenerateIETable.cmake turns each into a constant-initialised
+ * array of StaticIESpec, so that InfoModel::defaultIPFIX() does not
+ * have to parse hundreds of IESpecs at startup.  InfoModel creates
+ * an InfoElement from a table entry only when it is first looked up.
+ */
+
+#ifndef _libfc_IESPECTABLE_H_
+#  define _libfc_IESPECTABLE_H_
+
+#  include <cstddef>
+#  include <cstdint>
+
+#  include "IEType.h"
+
+namespace libfc {
+
+  /** An information element in a static table. */
+  struct StaticIESpec {
+    /** The IE name. */
+    const char* name;
+
+    /** The private enterprise number, or 0 for IANA IEs. */
+    uint32_t pen;
+
+    /** The IE number. */
+    uint16_t number;
+
+    /** The IE type, as one of the IEType::k* constants. */
+    uint8_t type;
+
+    /** The IE length, or 0 if the spec didn't give one. */
+    uint16_t len;
+  };
+
+  /** The IANA information elements, from lib/iana.iespec. */
+  extern const StaticIESpec iana_ie_specs[];
+  extern const size_t n_iana_ie_specs;
+
+  /** The RFC 5103 reverse information elements, from
+   * lib/rfc5103.iespec. */
+  extern const StaticIESpec rfc5103_ie_specs[];
+  extern const size_t n_rfc5103_ie_specs;
+
+} // namespace libfc
+
+#endif // _libfc_IESPECTABLE_H_
@@ -38,7 +38,8 @@
 namespace libfc {
 
   IETemplate::IETemplate()
-    : minlen_(0)
+    : minlen_(0),
+      scope_count_(0)
 #if defined(_libfc_HAVE_LOG4CPLUS_)
                 , 
       logger(log4cplus::Logger::getInstance(LOG4CPLUS_TEXT("IETemplate")))
@@ -93,6 +94,15 @@ namespace libfc {
     return ies_.size();
   }
 
+  size_t IETemplate::scope_count() const {
+    return scope_count_;
+  }
+
+  void IETemplate::set_scope_count(size_t scope_count) {
+    assert(scope_count <= ies_.size());
+    scope_count_ = scope_count;
+  }
+
   void IETemplate::add_inner(const InfoElement* ie) {
     ies_.push_back(ie);
   }
@@ -117,6 +117,22 @@ namespace libfc {
      */
     void add(const InfoElement* ie);
 
+    /** Returns the number of scope fields.
+     *
+     * Only options templates have scope fields; they are the first
+     * IEs of the template.
+     *
+     * @return number of scope fields, or 0 if this is not an options
+     *   template
+     */
+    size_t scope_count() const;
+
+    /** Sets the number of scope fields.
+     *
+     * @param scope_count number of scope fields
+     */
+    void set_scope_count(size_t scope_count);
+
     /** Compares two IE templates for equality.
      *
      * Two templates are equal iff they contain the same IEs in the
@@ -153,6 +169,9 @@ namespace libfc {
     // minimum length of record represented by template
     size_t minlen_;
 
+    // number of scope fields at the start of an options template
+    size_t scope_count_;
+
 #  if defined(_libfc_HAVE_LOG4CPLUS_)
     log4cplus::Logger logger;
 #  endif /* defined(_libfc_HAVE_LOG4CPLUS_) */
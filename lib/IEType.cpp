@@ -137,4 +137,35 @@ const IEType* IEType::unknown() {
   return &iet; 
 }
 
+size_t IEType::placedWidth() const {
+  switch (number_) {
+  case kUnsigned8:
+  case kSigned8:
+  case kBoolean:
+    return 1;
+  case kUnsigned16:
+  case kSigned16:
+    return 2;
+  case kUnsigned32:
+  case kSigned32:
+  case kFloat32:
+  case kDateTimeSeconds:
+  case kIpv4Address:
+    return 4;
+  case kMacAddress:
+    return 6;
+  case kUnsigned64:
+  case kSigned64:
+  case kFloat64:
+  case kDateTimeMilliseconds:
+  case kDateTimeMicroseconds:
+  case kDateTimeNanoseconds:
+    return 8;
+  case kIpv6Address:
+    return 16;
+  default:
+    return 0;
+  }
+}
+
 }
@@ -241,6 +241,17 @@ public:
     return (len >= minlen_ && len <= maxlen_);
   }
 
+  /**
+   * Get the width of a value of this type where it is placed, i.e., in
+   * the native variable a PlacementTemplate decodes it into.  This is
+   * the width of the full-length encoding, whatever the encoding on
+   * the wire.
+   *
+   * @return the placed width in octets, or 0 for octetArray, string
+   *   and unknown types, which are placed as BasicOctetArray
+   */
+  size_t placedWidth() const;
+
 protected:
 
   /** Convenience const for setting the endian flag in IEType constructors */
@@ -101,6 +101,9 @@ namespace libfc {
                            0, &is, message, nbytes, 0);
 
       message_size = decode_uint16(cur +  2);
+#if defined(_libfc_HAVE_LATENCY_HISTOGRAMS_)
+      uint64_t message_start = TscClock::now();
+#endif /* defined(_libfc_HAVE_LATENCY_HISTOGRAMS_) */
       libfc_RETURN_CALLBACK_ERROR(
         start_message(version,
                       message_size,
@@ -155,6 +158,10 @@ namespace libfc {
        *
        * -- Stephan Neuhaus
        */
+      uint64_t n_template_sets = 0;
+      uint64_t n_options_template_sets = 0;
+      uint64_t n_data_sets = 0;
+
       while (cur + kIpfixSetHeaderLen <= message_end) {
         /* Decode set header. */
         uint16_t set_id = decode_uint16(cur + 0);
@@ -183,6 +190,7 @@ namespace libfc {
               set_id, set_length - kIpfixSetHeaderLen, cur));
           cur += set_length - kIpfixSetHeaderLen;
           libfc_RETURN_CALLBACK_ERROR(end_template_set());
+          n_template_sets++;
         } else if (set_id == kIpfixOptionTemplateSetID) {
           libfc_RETURN_CALLBACK_ERROR(
             start_options_template_set(
@@ -190,12 +198,14 @@ namespace libfc {
           cur += set_length - kIpfixSetHeaderLen;
           libfc_RETURN_CALLBACK_ERROR(
             end_options_template_set());
+          n_options_template_sets++;
         } else  if (set_id >= kMinDataSetId) {
           libfc_RETURN_CALLBACK_ERROR(
             start_data_set(
               set_id, set_length - kIpfixSetHeaderLen, cur));
           cur += set_length - kIpfixSetHeaderLen;
           libfc_RETURN_CALLBACK_ERROR(end_data_set());
+          n_data_sets++;
         } else
           libfc_RETURN_ERROR(recoverable, format_error,
                              "Set has ID " << set_id << ", which is not "
@@ -210,6 +220,19 @@ namespace libfc {
 
       libfc_RETURN_CALLBACK_ERROR(end_message());
 
+#if defined(_libfc_HAVE_LATENCY_HISTOGRAMS_)
+      if (latencies != 0)
+        latencies->message.record(TscClock::now() - message_start);
+#endif /* defined(_libfc_HAVE_LATENCY_HISTOGRAMS_) */
+
+      if (counters != 0) {
+        counters->messages.add(1);
+        counters->message_octets.add(message_size);
+        counters->template_sets.add(n_template_sets);
+        counters->options_template_sets.add(n_options_template_sets);
+        counters->data_sets.add(n_data_sets);
+      }
+
       offset += nbytes;
       is.advance_message_offset();
       memset(message, '\0', sizeof(message));
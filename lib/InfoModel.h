@@ -43,7 +43,9 @@
 #include <mutex>
 #include <stdexcept>
 #include <string>
+#include <vector>
 
+#include "IESpecTable.h"
 #include "IEType.h"
 
 // FIXME enforce thread safety on changes to the infomodel
@@ -77,6 +79,11 @@ namespace libfc {
      * Initializes this InfoModel for IPFIX. IPFIX applications not using 
      * bidirectional flows as per RFC5103 should call this method once on 
      * the default instance returned by instance() at startup.
+     *
+     * This is cheap: the IANA IEs come from a static table that is
+     * generated at build time, and an IE is only created when it is
+     * first looked up.  IEs added later with add() take effect as if
+     * all IANA IEs had been added first.
      */
     void defaultIPFIX();
 
@@ -210,14 +217,32 @@ namespace libfc {
     void registerIEType(const IEType* iet);
     void initTypes();
 
+    // Static IE tables; internal
+    void addStaticTable(const StaticIESpec* specs, size_t n_specs);
+    void buildStaticIndex() const;
+    const StaticIESpec* findStatic(uint32_t pen, uint16_t number) const;
+    const StaticIESpec* findStatic(const std::string& name) const;
+    const InfoElement* materialize(const StaticIESpec& spec) const;
+    const InfoElement* findRegistered(uint32_t pen, uint16_t number) const;
+
     // Information element registry. Keep canonical IEs by autopointer.
-    std::map<uint16_t, std::shared_ptr<InfoElement> > iana_registry_;
-    std::map<uint32_t, std::map<uint16_t,
+    // Mutable because lookups create IEs from the static tables.
+    mutable std::map<uint16_t, std::shared_ptr<InfoElement> > iana_registry_;
+    mutable std::map<uint32_t, std::map<uint16_t,
                                 std::shared_ptr<InfoElement> > >  pen_registry_;
     std::vector<std::shared_ptr<InfoElement> > rle_registry_;
     
     // Information element name lookup. 
-    std::map<std::string, std::shared_ptr<InfoElement> >  name_registry_;
+    mutable std::map<std::string, std::shared_ptr<InfoElement> >  name_registry_;
+
+    // Static IE tables, in the order in which they were added, and
+    // their entries sorted by (pen, number) and by name.  Entries are
+    // stably sorted, so that the first table wins on duplicates, as
+    // add() would have it.  The indexes are built on first use.
+    std::vector<std::pair<const StaticIESpec*, size_t> > static_tables_;
+    mutable std::vector<const StaticIESpec*> static_by_number_;
+    mutable std::vector<const StaticIESpec*> static_by_name_;
+    mutable bool static_index_valid_;
     
     // Information element type lookup.
     std::map<std::string, const IEType*> ietypes_byname_;
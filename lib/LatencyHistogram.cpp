@@ -0,0 +1,171 @@
+/* Copyright (c) 2011-2014 ETH Zürich. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ *    * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *    * Neither the names of ETH Zürich nor the names of other contributors 
+ *      may be used to endorse or promote products derived from this software 
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL ETH 
+ * ZURICH BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, 
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, 
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR 
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY 
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <chrono>
+#include <cstring>
+
+#include "LatencyHistogram.h"
+
+namespace libfc {
+
+  static double calibrate_ns_per_tick() {
+#if defined(__x86_64__) || defined(__i386__)
+    typedef std::chrono::steady_clock clock;
+
+    clock::time_point start = clock::now();
+    uint64_t start_ticks = TscClock::now();
+    clock::time_point end;
+    do {
+      end = clock::now();
+    } while (end - start < std::chrono::milliseconds(5));
+    uint64_t end_ticks = TscClock::now();
+
+    double ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      end - start).count();
+    return ns / (end_ticks - start_ticks);
+#else
+    return 1.0;
+#endif
+  }
+
+  double TscClock::ns_per_tick() {
+    static const double ns = calibrate_ns_per_tick();
+    return ns;
+  }
+
+  LatencyHistogram::LatencyHistogram() {
+    reset();
+  }
+
+  void LatencyHistogram::reset() {
+    memset(counts, 0, sizeof(counts));
+    n = 0;
+    sum = 0;
+    min_value = UINT64_MAX;
+    max_value = 0;
+  }
+
+  LatencyHistogram&
+  LatencyHistogram::operator+=(const LatencyHistogram& rhs) {
+    for (unsigned int i = 0; i < n_buckets; i++)
+      counts[i] += rhs.counts[i];
+    n += rhs.n;
+    sum += rhs.sum;
+    if (rhs.min_value < min_value)
+      min_value = rhs.min_value;
+    if (rhs.max_value > max_value)
+      max_value = rhs.max_value;
+    return *this;
+  }
+
+  uint64_t LatencyHistogram::value_at_percentile(double percentile) const {
+    if (n == 0)
+      return 0;
+
+    if (percentile < 0.0)
+      percentile = 0.0;
+    else if (percentile > 100.0)
+      percentile = 100.0;
+
+    /* The rank of the wanted value, counting from 1. */
+    uint64_t rank = static_cast<uint64_t>(percentile / 100.0 * n + 0.5);
+    if (rank == 0)
+      rank = 1;
+
+    uint64_t seen = 0;
+    for (unsigned int i = 0; i < n_buckets; i++) {
+      seen += counts[i];
+      if (seen >= rank) {
+        uint64_t high = bucket_high(i);
+        return high < max_value ? high : max_value;
+      }
+    }
+    return max_value;
+  }
+
+  uint64_t LatencyHistogram::bucket_low(unsigned int bucket) {
+    if (bucket < 64)
+      return bucket;
+    unsigned int shift = bucket/32 - 1;
+    return static_cast<uint64_t>(bucket - shift*32) << shift;
+  }
+
+  uint64_t LatencyHistogram::bucket_high(unsigned int bucket) {
+    if (bucket < 64)
+      return bucket;
+    unsigned int shift = bucket/32 - 1;
+    return bucket_low(bucket) + ((static_cast<uint64_t>(1) << shift) - 1);
+  }
+
+#if defined(_libfc_HAVE_LATENCY_HISTOGRAMS_)
+  const bool CollectorLatencies::compiled_in = true;
+#else
+  const bool CollectorLatencies::compiled_in = false;
+#endif /* defined(_libfc_HAVE_LATENCY_HISTOGRAMS_) */
+
+  CollectorLatencies&
+  CollectorLatencies::operator+=(const CollectorLatencies& rhs) {
+    message += rhs.message;
+    data_set += rhs.data_set;
+    callback += rhs.callback;
+    return *this;
+  }
+
+  void CollectorLatencies::reset() {
+    message.reset();
+    data_set.reset();
+    callback.reset();
+  }
+
+  static void write_summary(std::ostream& os, const std::string& name,
+                            const char* help, const LatencyHistogram& h) {
+    static const double quantiles[] = { 0.5, 0.9, 0.99, 0.999, 1.0 };
+    double ns_per_tick = TscClock::ns_per_tick();
+
+    os << "# HELP " << name << " " << help << "\n"
+       << "# TYPE " << name << " summary\n";
+    for (double q : quantiles)
+      os << name << "{quantile=\"" << q << "\"} "
+         << static_cast<uint64_t>(h.value_at_percentile(q * 100.0)
+                                  * ns_per_tick)
+         << "\n";
+    os << name << "_sum "
+       << static_cast<uint64_t>(h.mean() * h.count() * ns_per_tick) << "\n"
+       << name << "_count " << h.count() << "\n";
+  }
+
+  void CollectorLatencies::write_prometheus(std::ostream& os,
+                                            const std::string& prefix) const {
+    write_summary(os, prefix + "_message_latency_ns",
+                  "Time per message in nanoseconds.", message);
+    write_summary(os, prefix + "_data_set_latency_ns",
+                  "Time per data set in libfc in nanoseconds.", data_set);
+    write_summary(os, prefix + "_callback_latency_ns",
+                  "Time per record in end_placement() in nanoseconds.",
+                  callback);
+  }
+
+} // namespace libfc
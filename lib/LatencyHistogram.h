@@ -0,0 +1,199 @@
+/* Hi Emacs, please use -*- mode: C++; -*- */
+/* Copyright (c) 2011-2014 ETH Zürich. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ *    * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *    * Neither the names of ETH Zürich nor the names of other contributors 
+ *      may be used to endorse or promote products derived from this software 
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL ETH 
+ * ZURICH BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, 
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, 
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR 
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY 
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ * @author Stephan Neuhaus <neuhaust@tik.ee.ethz.ch>
+ */
+
+#ifndef _libfc_LATENCYHISTOGRAM_H_
+#  define _libfc_LATENCYHISTOGRAM_H_
+
+#  include <cstdint>
+#  include <ostream>
+#  include <string>
+
+#  if defined(__x86_64__) || defined(__i386__)
+#    include <x86intrin.h>
+#  else
+#    include <chrono>
+#  endif
+
+namespace libfc {
+
+  /** A cheap, monotonic clock for timing code sections.
+   *
+   * On x86, this reads the time stamp counter, which costs a few
+   * dozen cycles instead of the few hundred of a clock_gettime()
+   * call.  Elsewhere, it falls back to std::chrono::steady_clock.
+   * Ticks are converted to nanoseconds only on export.
+   */
+  class TscClock {
+  public:
+    /** Returns the current time in ticks. */
+    static uint64_t now() {
+#  if defined(__x86_64__) || defined(__i386__)
+      return __rdtsc();
+#  else
+      return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+#  endif
+    }
+
+    /** Returns the length of a tick in nanoseconds.
+     *
+     * The first call calibrates the clock against steady_clock,
+     * which takes a few milliseconds.
+     */
+    static double ns_per_tick();
+  };
+
+  /** A histogram of durations with bounded relative error.
+   *
+   * This uses the bucketing of HdrHistogram: values below 64 have a
+   * bucket each, and every power-of-two range above that is divided
+   * into 32 equal buckets, so that any recorded value is reported
+   * with a relative error below 1/32.  The range is all of
+   * uint64_t, in 1920 buckets.
+   *
+   * Values are in clock ticks (see TscClock).  Recording is not
+   * thread-safe; a histogram belongs to the thread that records into
+   * it.  Histograms of different threads can be added.
+   */
+  class LatencyHistogram {
+  public:
+    /** The number of buckets. */
+    static const unsigned int n_buckets = 1920;
+
+    LatencyHistogram();
+
+    /** Records one value. */
+    void record(uint64_t ticks) {
+      counts[bucket_of(ticks)]++;
+      n++;
+      sum += ticks;
+      if (ticks < min_value)
+        min_value = ticks;
+      if (ticks > max_value)
+        max_value = ticks;
+    }
+
+    /** Resets the histogram to empty. */
+    void reset();
+
+    LatencyHistogram& operator+=(const LatencyHistogram& rhs);
+
+    /** Returns the number of recorded values. */
+    uint64_t count() const { return n; }
+
+    /** Returns the smallest recorded value, or 0 if empty. */
+    uint64_t min() const { return n == 0 ? 0 : min_value; }
+
+    /** Returns the largest recorded value, or 0 if empty. */
+    uint64_t max() const { return max_value; }
+
+    /** Returns the mean of the recorded values, or 0 if empty. */
+    double mean() const {
+      return n == 0 ? 0.0 : static_cast<double>(sum) / n;
+    }
+
+    /** Returns the value below which a given percentage of the
+     * recorded values lie.
+     *
+     * The result is the upper end of the bucket that contains the
+     * percentile, clamped to max().
+     *
+     * @param percentile the percentile, from 0 to 100
+     *
+     * @return the value at this percentile, or 0 if empty
+     */
+    uint64_t value_at_percentile(double percentile) const;
+
+    /** Returns the bucket that a value falls into. */
+    static unsigned int bucket_of(uint64_t value) {
+      if (value < 64)
+        return static_cast<unsigned int>(value);
+      unsigned int shift = 63 - __builtin_clzll(value) - 5;
+      return shift*32 + static_cast<unsigned int>(value >> shift);
+    }
+
+    /** Returns the smallest value in a bucket. */
+    static uint64_t bucket_low(unsigned int bucket);
+
+    /** Returns the largest value in a bucket. */
+    static uint64_t bucket_high(unsigned int bucket);
+
+  private:
+    uint64_t counts[n_buckets];
+    uint64_t n;
+    uint64_t sum;
+    uint64_t min_value;
+    uint64_t max_value;
+  };
+
+  /** Latency histograms of a collector.
+   *
+   * The histograms are only recorded if libfc was built with
+   * LIBFC_LATENCY_HISTOGRAMS, which defines
+   * _libfc_HAVE_LATENCY_HISTOGRAMS_.  Otherwise, the timing code is
+   * compiled out and the histograms stay empty.  Only the timing code
+   * depends on the build option, not the layout of any class in the
+   * public headers, so clients need not know how libfc was built.
+   */
+  struct CollectorLatencies {
+    /** Whether latency histograms are recorded in this build. */
+    static const bool compiled_in;
+
+    CollectorLatencies& operator+=(const CollectorLatencies& rhs);
+
+    /** Resets all histograms to empty. */
+    void reset();
+
+    /** Writes the histograms as Prometheus summaries, in
+     * nanoseconds.
+     *
+     * @param os the stream to write to
+     * @param prefix the prefix of all metric names
+     */
+    void write_prometheus(std::ostream& os,
+                          const std::string& prefix = "libfc") const;
+
+    /** Time per message, from start_message() to the return of
+     * end_message(), including everything in between. */
+    LatencyHistogram message;
+
+    /** Time per data set spent in libfc, that is, the time for
+     * decoding the set minus the time spent in end_placement(). */
+    LatencyHistogram data_set;
+
+    /** Time per record spent in end_placement(). */
+    LatencyHistogram callback;
+  };
+
+} // namespace libfc
+
+#endif // _libfc_LATENCYHISTOGRAM_H_
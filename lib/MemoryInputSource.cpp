@@ -0,0 +1,103 @@
+/* Copyright (c) 2011-2014 ETH Zürich. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ *    * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *    * Neither the names of ETH Zürich nor the names of other contributors 
+ *      may be used to endorse or promote products derived from this software 
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL ETH 
+ * ZURICH BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, 
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, 
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR 
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY 
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cassert>
+#include <cstring>
+#include <sstream>
+
+#include "MemoryInputSource.h"
+
+namespace libfc {
+
+  MemoryInputSource::MemoryInputSource(const uint8_t* buf, size_t len,
+                                       std::string region_name)
+    : buf(buf),
+      len(len),
+      off(0),
+      message_offset(0),
+      current_offset(0),
+      region_name(region_name),
+      name(0) {
+  }
+
+  MemoryInputSource::~MemoryInputSource() {
+    delete[] const_cast<char*>(name);
+  }
+
+  ssize_t MemoryInputSource::read(uint8_t* result_buf, uint16_t result_len) {
+    ssize_t ret = peek(result_buf, result_len);
+
+    if (ret >= 0) {
+      off += ret;
+      current_offset += ret;
+    }
+
+    return ret;
+  }
+
+  ssize_t MemoryInputSource::peek(uint8_t* result_buf, uint16_t result_len) {
+    assert(off <= len);
+
+    /* See BufferInputSource::peek() for why this fits into 16 bits. */
+    size_t bytes_to_copy = off + result_len > len ? len - off : result_len;
+    memcpy(result_buf, buf + off, bytes_to_copy);
+
+    return static_cast<ssize_t>(bytes_to_copy);
+  }
+
+  bool MemoryInputSource::resync() {
+    // TODO
+    return true;
+  }
+
+  size_t MemoryInputSource::get_message_offset() const {
+    return message_offset;
+  }
+
+  void MemoryInputSource::advance_message_offset() {
+    message_offset += current_offset;
+    current_offset = 0;
+  }
+
+  const char* MemoryInputSource::get_name() const {
+    if (name == 0) {
+      std::ostringstream sstr;
+
+      sstr << "Memory(name=\"" << region_name << "\",length=" << len << ')';
+      std::string s = sstr.str();
+
+      name = new char[s.length() + 1];
+      std::strcpy(const_cast<char*>(name), s.c_str());
+    }
+
+    return name;
+  }
+
+  bool MemoryInputSource::can_peek() const {
+    return true;
+  }
+
+} // namespace libfc
@@ -36,7 +36,9 @@
 namespace libfc {
 
   MessageStreamParser::MessageStreamParser() 
-    : content_handler(0)
+    : content_handler(0),
+      counters(0),
+      latencies(0)
 #if defined(_libfc_HAVE_LOG4CPLUS_)
                       ,
       logger(log4cplus::Logger::getInstance(LOG4CPLUS_TEXT("logger")))
@@ -51,5 +53,13 @@ namespace libfc {
     content_handler = handler;
   }
 
+  void MessageStreamParser::set_counters(CollectorCounters* _counters) {
+    counters = _counters;
+  }
+
+  void MessageStreamParser::set_latencies(CollectorLatencies* _latencies) {
+    latencies = _latencies;
+  }
+
 
 } // namespace libfc
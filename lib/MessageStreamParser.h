@@ -40,6 +40,8 @@
 #  endif /* defined(_libfc_HAVE_LOG4CPLUS_) */
 
 #  include "ContentHandler.h"
+#  include "LatencyHistogram.h"
+#  include "CollectorStatistics.h"
 #  include "Constants.h"
 #  include "ErrorContext.h"
 #  include "InputSource.h"
@@ -77,8 +79,28 @@ namespace libfc {
      */
     void set_content_handler(ContentHandler* handler);
 
+    /** Sets the counters that this parser updates.
+     *
+     * The parser counts messages, message octets and sets once per
+     * message.  Counting is off if counters is 0, which is the
+     * default.
+     *
+     * @param counters the counters to update, or 0
+     */
+    void set_counters(CollectorCounters* counters);
+
+    /** Sets the histograms into which this parser records the time
+     * per message, or 0 for none.  Nothing is recorded unless libfc
+     * was built with latency histograms (see CollectorLatencies).
+     *
+     * @param latencies the histograms to record into, or 0
+     */
+    void set_latencies(CollectorLatencies* latencies);
+
   protected:
     ContentHandler* content_handler;
+    CollectorCounters* counters;
+    CollectorLatencies* latencies;
 
   private:
 
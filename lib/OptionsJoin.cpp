@@ -0,0 +1,282 @@
+/* Copyright (c) 2011-2014 ETH Zürich. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ *    * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *    * Neither the names of ETH Zürich nor the names of other contributors 
+ *      may be used to endorse or promote products derived from this software 
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL ETH 
+ * ZURICH BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, 
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, 
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR 
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY 
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cassert>
+#include <cstring>
+#include <limits>
+
+#include "BasicOctetArray.h"
+#include "IEType.h"
+#include "OptionsJoin.h"
+
+#include "exceptions/IESpecError.h"
+
+/** Computes (a*b + c)/d without losing the high bits of a*b + c.
+ *
+ * The 128-bit intermediate is kept in two 64-bit halves, so that this
+ * needs no compiler extension.
+ *
+ * @return false if the quotient doesn't fit in 64 bits
+ */
+static bool muldiv(uint64_t a, uint64_t b, uint64_t c, uint64_t d,
+                   uint64_t* q) {
+  uint64_t a_lo = a & 0xffffffff;
+  uint64_t a_hi = a >> 32;
+  uint64_t b_lo = b & 0xffffffff;
+  uint64_t b_hi = b >> 32;
+  uint64_t p0 = a_lo * b_lo;
+  uint64_t p1 = a_lo * b_hi;
+  uint64_t p2 = a_hi * b_lo;
+  uint64_t mid = (p0 >> 32) + (p1 & 0xffffffff) + (p2 & 0xffffffff);
+  uint64_t lo = (p0 & 0xffffffff) | (mid << 32);
+  uint64_t hi = a_hi * b_hi + (p1 >> 32) + (p2 >> 32) + (mid >> 32);
+
+  lo += c;
+  if (lo < c)
+    hi++;
+  if (hi >= d)
+    return false;
+
+  /* Long division; r < d holds throughout, but 2r may not fit. */
+  uint64_t r = hi;
+  uint64_t quotient = 0;
+  for (int i = 63; i >= 0; --i) {
+    bool carry = (r >> 63) != 0;
+    r = (r << 1) | ((lo >> i) & 1);
+    quotient <<= 1;
+    if (carry || r >= d) {
+      r -= d;
+      quotient |= 1;
+    }
+  }
+  *q = quotient;
+  return true;
+}
+
+/** Multiplies an integer counter by num/den, rounding to the nearest
+ * integer.  The product is exact, even above 2^53, and saturates
+ * instead of wrapping around.  Integral factors and products that fit
+ * in 64 bits, which is nearly all of them, take a short path. */
+template<typename T> static void scale(T* p, uint64_t num, uint64_t den) {
+  uint64_t v = *p;
+  uint64_t q;
+  if (num % den == 0) {
+    uint64_t factor = num / den;
+    q = v > UINT64_MAX / factor ? UINT64_MAX : v * factor;
+  } else if (v <= (UINT64_MAX - den/2) / num)
+    q = (v * num + den/2) / den;
+  else if (!muldiv(v, num, den/2, den, &q))
+    q = UINT64_MAX;
+  *p = q > std::numeric_limits<T>::max()
+    ? std::numeric_limits<T>::max() : static_cast<T>(q);
+}
+
+namespace libfc {
+
+  OptionsJoin::OptionsJoin()
+    : n_hits(0),
+      n_misses(0) {
+  }
+
+  unsigned int OptionsJoin::add_lookup(const OptionsTable* table,
+                                       const void* key_p,
+                                       const InfoElement* key) {
+    if (key == 0)
+      key = table->get_scope();
+
+    size_t key_width = 0;
+    if (!table->is_domain_scoped()) {
+      assert(key_p != 0);
+      switch (key->ietype()->number()) {
+      case IEType::kUnsigned8: key_width = 1; break;
+      case IEType::kUnsigned16: key_width = 2; break;
+      case IEType::kUnsigned32: key_width = 4; break;
+      case IEType::kUnsigned64: key_width = 8; break;
+      default:
+        throw IESpecError("Can't use IE " + key->toIESpec() + " as key");
+      }
+    } else
+      key_p = 0;
+
+    for (unsigned int i = 0; i < lookups.size(); ++i)
+      if (lookups[i].table == table && lookups[i].key_p == key_p)
+        return i;
+
+    Lookup l;
+    l.table = table;
+    l.key_p = key_p;
+    l.key_width = key_width;
+    l.row = -1;
+    lookups.push_back(l);
+    return lookups.size() - 1;
+  }
+
+  void OptionsJoin::add_value(const OptionsTable* table,
+                              const InfoElement* ie, void* p,
+                              const void* key_p, const InfoElement* key) {
+    int value = table->value_index(ie);
+    if (value < 0)
+      throw IESpecError("IE " + ie->toIESpec()
+                        + " is not in the options table");
+
+    Target t;
+    t.lookup = add_lookup(table, key_p, key);
+    t.value = value;
+    t.p = p;
+    targets.push_back(t);
+  }
+
+  int OptionsJoin::unsigned_value(const OptionsTable* table,
+                                  const InfoElement* ie) {
+    int value = table->value_index(ie);
+    if (value < 0)
+      throw IESpecError("IE " + ie->toIESpec()
+                        + " is not in the options table");
+    switch (ie->ietype()->number()) {
+    case IEType::kUnsigned8:
+    case IEType::kUnsigned16:
+    case IEType::kUnsigned32:
+    case IEType::kUnsigned64:
+      return value;
+    default:
+      throw IESpecError("Can't use IE " + ie->toIESpec()
+                        + " as sampling parameter");
+    }
+  }
+
+  void OptionsJoin::add_normalization(const OptionsTable* table,
+                                      const InfoElement* interval,
+                                      const InfoElement* space,
+                                      const InfoElement* counter, void* p,
+                                      const void* key_p,
+                                      const InfoElement* key) {
+    Normalization n;
+    n.interval = unsigned_value(table, interval);
+    n.space = space == 0 ? -1 : unsigned_value(table, space);
+    n.type = counter->ietype()->number();
+    switch (n.type) {
+    case IEType::kUnsigned8:
+    case IEType::kUnsigned16:
+    case IEType::kUnsigned32:
+    case IEType::kUnsigned64:
+    case IEType::kFloat32:
+    case IEType::kFloat64:
+      break;
+    default:
+      throw IESpecError("Can't normalize IE " + counter->toIESpec());
+    }
+    n.lookup = add_lookup(table, key_p, key);
+    n.p = p;
+    normalizations.push_back(n);
+  }
+
+  void OptionsJoin::apply(uint32_t domain) {
+    for (auto l = lookups.begin(); l != lookups.end(); ++l) {
+      uint64_t key = 0;
+      switch (l->key_width) {
+      case 0: break;
+      case 1: key = *static_cast<const uint8_t*>(l->key_p); break;
+      case 2: key = *static_cast<const uint16_t*>(l->key_p); break;
+      case 4: key = *static_cast<const uint32_t*>(l->key_p); break;
+      default: key = *static_cast<const uint64_t*>(l->key_p); break;
+      }
+      l->row = l->table->find(domain, key);
+      if (l->row >= 0)
+        n_hits++;
+      else
+        n_misses++;
+    }
+
+    for (auto t = targets.begin(); t != targets.end(); ++t) {
+      const Lookup& l = lookups[t->lookup];
+      if (l.row >= 0 && l.table->has_value(l.row, t->value)) {
+        l.table->copy_value(l.row, t->value, t->p);
+        continue;
+      }
+      size_t width = l.table->values[t->value].width;
+      if (width == 0) {
+        static const uint8_t empty = 0;
+        static_cast<BasicOctetArray*>(t->p)->copy_content(&empty, 0);
+      } else
+        memset(t->p, 0, width);
+    }
+
+    for (auto n = normalizations.begin(); n != normalizations.end(); ++n) {
+      const Lookup& l = lookups[n->lookup];
+      if (l.row < 0 || !l.table->has_value(l.row, n->interval))
+        continue;
+
+      uint64_t interval = l.table->read_unsigned(l.row, n->interval);
+      if (interval == 0)
+        interval = 1;
+      uint64_t num = interval;
+      uint64_t den = 1;
+      if (n->space >= 0) {
+        if (!l.table->has_value(l.row, n->space))
+          continue;
+        uint64_t space = l.table->read_unsigned(l.row, n->space);
+        num = space > UINT64_MAX - interval ? UINT64_MAX : interval + space;
+        den = interval;
+      }
+      if (num == den)
+        continue;
+      double factor = static_cast<double>(num) / den;
+
+      switch (n->type) {
+      case IEType::kUnsigned8:
+        scale(static_cast<uint8_t*>(n->p), num, den);
+        break;
+      case IEType::kUnsigned16:
+        scale(static_cast<uint16_t*>(n->p), num, den);
+        break;
+      case IEType::kUnsigned32:
+        scale(static_cast<uint32_t*>(n->p), num, den);
+        break;
+      case IEType::kUnsigned64:
+        scale(static_cast<uint64_t*>(n->p), num, den);
+        break;
+      case IEType::kFloat32:
+        *static_cast<float*>(n->p) *= factor;
+        break;
+      case IEType::kFloat64:
+        *static_cast<double*>(n->p) *= factor;
+        break;
+      default:
+        /* Can't happen, ignore silently */
+        break;
+      }
+    }
+  }
+
+  uint64_t OptionsJoin::get_hits() const {
+    return n_hits;
+  }
+
+  uint64_t OptionsJoin::get_misses() const {
+    return n_misses;
+  }
+
+} // namespace libfc
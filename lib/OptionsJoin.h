@@ -0,0 +1,202 @@
+/* Hi Emacs, please use -*- mode: C++; -*- */
+/* Copyright (c) 2011-2014 ETH Zürich. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ *    * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *    * Neither the names of ETH Zürich nor the names of other contributors 
+ *      may be used to endorse or promote products derived from this software 
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL ETH 
+ * ZURICH BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, 
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, 
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR 
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY 
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ * @author Stephan Neuhaus <neuhaust@tik.ee.ethz.ch>
+ */
+
+#ifndef _libfc_OPTIONSJOIN_H_
+#  define _libfc_OPTIONSJOIN_H_
+
+#  include <cstdint>
+#  include <vector>
+
+#  include "InfoElement.h"
+#  include "OptionsTable.h"
+
+namespace libfc {
+
+  /** Joins data records with options tables while they are decoded.
+   *
+   * A join is set on a placement template with
+   * PlacementTemplate::set_options_join().  After each data record
+   * has been placed, and before end_placement() is called, the join
+   * looks up the record's rows in its options tables and
+   *
+   *   - places options values, such as the interfaceName of the
+   *     record's ingressInterface, as if they had been in the record;
+   *     and
+   *   - scales counters, such as octetDeltaCount, by the sampling
+   *     rate, so that they estimate the unsampled traffic.
+   *
+   * The key of a lookup is read from where the data record's key IE
+   * was placed, so the key IE must also be in the placement template.
+   * For example, to name the ingress interface and normalize octet
+   * counts by the sampling interval of the observation domain:
+   *
+   * @code
+   * OptionsTable interfaces(model.lookupIE("ingressInterface"));
+   * interfaces.add_value(model.lookupIE("interfaceName"));
+   * OptionsTable sampling(model.lookupIE("observationDomainId"));
+   * sampling.add_value(model.lookupIE("samplingPacketInterval"));
+   * sampling.add_value(model.lookupIE("samplingPacketSpace"));
+   *
+   * tmpl->register_placement(model.lookupIE("ingressInterface"),
+   *                          &ingress_interface, 0);
+   * tmpl->register_placement(model.lookupIE("octetDeltaCount"),
+   *                          &octets, 0);
+   *
+   * OptionsJoin join;
+   * join.add_value(&interfaces, model.lookupIE("interfaceName"),
+   *                &interface_name, &ingress_interface);
+   * join.add_normalization(&sampling,
+   *                        model.lookupIE("samplingPacketInterval"),
+   *                        model.lookupIE("samplingPacketSpace"),
+   *                        model.lookupIE("octetDeltaCount"), &octets);
+   * tmpl->set_options_join(&join);
+   * @endcode
+   *
+   * Each distinct pair of table and key is looked up once per record.
+   * If there is no row, or the row has no value for an IE, fixed-length
+   * values are set to zero and octet arrays to empty, and counters are
+   * left alone.
+   */
+  class OptionsJoin {
+  public:
+    OptionsJoin();
+
+    /** Places an options value for every record.
+     *
+     * @param table the options table
+     * @param ie a value IE of the table
+     * @param p where to place the value; for string and octetArray
+     *   IEs, a BasicOctetArray
+     * @param key_p where the key IE of the record is placed; unused
+     *   if the table is domain-scoped
+     * @param key the key IE, or 0 for the scope IE of the table
+     *
+     * @throw IESpecError if ie is not a value of the table, or if the
+     *   key IE doesn't have an unsigned type
+     */
+    void add_value(const OptionsTable* table, const InfoElement* ie,
+                   void* p, const void* key_p = 0,
+                   const InfoElement* key = 0);
+
+    /** Scales a counter by the sampling rate for every record.
+     *
+     * With a space IE, the record was selected by systematic sampling
+     * of interval items followed by space items that were not
+     * selected, as with samplingPacketInterval and samplingPacketSpace
+     * (RFC 5476), and the counter is multiplied by (interval + space)
+     * / interval.  Without one, the interval is taken to mean that one
+     * in interval items was selected, as with the samplingInterval of
+     * NetFlow v9, and the counter is multiplied by interval.  An
+     * interval of 0 is taken to mean 1.  Integer counters are scaled
+     * exactly, rounded to the nearest integer, and saturate at the
+     * largest value of their type.
+     *
+     * @param table the options table
+     * @param interval an unsigned value IE of the table
+     * @param space an unsigned value IE of the table, or 0
+     * @param counter the counter IE; it must have an unsigned or float
+     *   type
+     * @param p where the counter is placed
+     * @param key_p where the key IE of the record is placed; unused
+     *   if the table is domain-scoped
+     * @param key the key IE, or 0 for the scope IE of the table
+     *
+     * @throw IESpecError if interval or space is not an unsigned value
+     *   of the table, or if the counter or key IE has the wrong type
+     */
+    void add_normalization(const OptionsTable* table,
+                           const InfoElement* interval,
+                           const InfoElement* space,
+                           const InfoElement* counter, void* p,
+                           const void* key_p = 0,
+                           const InfoElement* key = 0);
+
+    /** Joins the record that has just been placed.
+     *
+     * This is called by PlacementContentHandler.
+     *
+     * @param domain the observation domain of the record
+     */
+    void apply(uint32_t domain);
+
+    /** Returns the number of lookups that found a row.
+     *
+     * @return the number of lookups that found a row
+     */
+    uint64_t get_hits() const;
+
+    /** Returns the number of lookups that found no row.
+     *
+     * @return the number of lookups that found no row
+     */
+    uint64_t get_misses() const;
+
+  private:
+    struct Lookup {
+      const OptionsTable* table;
+      const void* key_p;
+      size_t key_width;
+      /** The row of the current record, or -1. */
+      int64_t row;
+    };
+
+    struct Target {
+      unsigned int lookup;
+      unsigned int value;
+      void* p;
+    };
+
+    struct Normalization {
+      unsigned int lookup;
+      unsigned int interval;
+      /** The space value, or -1 for none. */
+      int space;
+      void* p;
+      unsigned int type;
+    };
+
+    static int unsigned_value(const OptionsTable* table,
+                              const InfoElement* ie);
+    unsigned int add_lookup(const OptionsTable* table, const void* key_p,
+                            const InfoElement* key);
+
+    std::vector<Lookup> lookups;
+    std::vector<Target> targets;
+    std::vector<Normalization> normalizations;
+
+    uint64_t n_hits;
+    uint64_t n_misses;
+  };
+
+} // namespace libfc
+
+#endif // _libfc_OPTIONSJOIN_H_
@@ -0,0 +1,268 @@
+/* Copyright (c) 2011-2014 ETH Zürich. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ *    * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *    * Neither the names of ETH Zürich nor the names of other contributors 
+ *      may be used to endorse or promote products derived from this software 
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL ETH 
+ * ZURICH BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, 
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, 
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR 
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY 
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+#include "BasicOctetArray.h"
+#include "DecodePlan.h"
+#include "IEType.h"
+#include "OptionsTable.h"
+#include "PlacementTemplate.h"
+
+#include "exceptions/IESpecError.h"
+
+/** The number of observationDomainId. */
+static const uint16_t kObservationDomainId = 149;
+
+/** Reads a placed unsigned value. */
+static uint64_t read_placed_unsigned(const void* p, size_t width) {
+  switch (width) {
+  case 1: { uint8_t v; memcpy(&v, p, sizeof(v)); return v; }
+  case 2: { uint16_t v; memcpy(&v, p, sizeof(v)); return v; }
+  case 4: { uint32_t v; memcpy(&v, p, sizeof(v)); return v; }
+  default: { uint64_t v; memcpy(&v, p, sizeof(v)); return v; }
+  }
+}
+
+namespace libfc {
+
+  OptionsTable::OptionsTable(const InfoElement* scope, size_t direct_limit)
+    : scope(scope),
+      scope_width(scope->ietype()->placedWidth()),
+      domain_scoped(scope->pen() == 0
+                    && scope->number() == kObservationDomainId),
+      direct_limit(direct_limit),
+      n_octet_arrays(0),
+      row_size(0),
+      n_rows(0),
+      last_domain(0),
+      last(0) {
+    switch (scope->ietype()->number()) {
+    case IEType::kUnsigned8:
+    case IEType::kUnsigned16:
+    case IEType::kUnsigned32:
+    case IEType::kUnsigned64:
+      break;
+    default:
+      throw IESpecError("Can't use IE " + scope->toIESpec() + " as scope");
+    }
+  }
+
+  void OptionsTable::add_value(const InfoElement* ie) {
+    assert(n_rows == 0);
+
+    if (ie == scope || value_index(ie) >= 0)
+      throw IESpecError("IE " + ie->toIESpec()
+                        + " is already in the options table");
+
+    Value v;
+    v.ie = ie;
+    v.width = ie->ietype()->placedWidth();
+    v.offset = v.width == 0 ? n_octet_arrays++ : 0;
+    values.push_back(v);
+
+    /* Lay out the row again: bitmap first, then the values. */
+    row_size = (values.size() + 7) / 8;
+    for (auto i = values.begin(); i != values.end(); ++i) {
+      if (i->width != 0) {
+        i->offset = row_size;
+        row_size += i->width;
+      }
+    }
+  }
+
+  const InfoElement* OptionsTable::get_scope() const {
+    return scope;
+  }
+
+  bool OptionsTable::is_domain_scoped() const {
+    return domain_scoped;
+  }
+
+  int OptionsTable::value_index(const InfoElement* ie) const {
+    for (unsigned int i = 0; i < values.size(); ++i)
+      if (values[i].ie == ie)
+        return i;
+    return -1;
+  }
+
+  int64_t OptionsTable::find(uint32_t domain, uint64_t key) const {
+    if (last == 0 || domain != last_domain) {
+      auto d = domains.find(domain);
+      if (d == domains.end())
+        return -1;
+      last_domain = domain;
+      last = &d->second;
+    }
+
+    if (domain_scoped)
+      key = 0;
+    if (key < last->direct.size())
+      return static_cast<int64_t>(last->direct[key]) - 1;
+    if (key < direct_limit)
+      return -1;
+    auto h = last->hashed.find(key);
+    if (h == last->hashed.end())
+      return -1;
+    return h->second;
+  }
+
+  uint32_t OptionsTable::find_or_insert(uint32_t domain, uint64_t key) {
+    int64_t row = find(domain, key);
+    if (row >= 0)
+      return static_cast<uint32_t>(row);
+
+    Domain& d = domains[domain];
+    row = n_rows++;
+    fixed.resize(n_rows*row_size, 0);
+    octet_arrays.resize(n_rows*n_octet_arrays);
+
+    if (domain_scoped)
+      key = 0;
+    if (key < direct_limit) {
+      if (key >= d.direct.size()) {
+        size_t size = d.direct.empty() ? 16 : d.direct.size();
+        while (size <= key)
+          size *= 2;
+        d.direct.resize(std::min(size, direct_limit), 0);
+      }
+      d.direct[key] = row + 1;
+    } else
+      d.hashed[key] = row;
+    return static_cast<uint32_t>(row);
+  }
+
+  bool OptionsTable::has_value(uint32_t row, unsigned int value) const {
+    return (fixed[row*row_size + value/8] & (1 << (value % 8))) != 0;
+  }
+
+  void OptionsTable::copy_value(uint32_t row, unsigned int value,
+                                void* p) const {
+    const Value& v = values[value];
+    if (v.width == 0) {
+      const std::string& s = octet_arrays[row*n_octet_arrays + v.offset];
+      static_cast<BasicOctetArray*>(p)->copy_content(
+        reinterpret_cast<const uint8_t*>(s.data()), s.size());
+    } else
+      memcpy(p, &fixed[row*row_size + v.offset], v.width);
+  }
+
+  uint64_t OptionsTable::read_unsigned(uint32_t row,
+                                       unsigned int value) const {
+    const Value& v = values[value];
+    return read_placed_unsigned(&fixed[row*row_size + v.offset], v.width);
+  }
+
+  uint64_t OptionsTable::load(uint32_t domain,
+                              const IETemplate* wire_template,
+                              const uint8_t* buf, uint16_t length) {
+    size_t n_scope = wire_template->scope_count();
+    bool has_scope = false;
+    for (auto i = wire_template->begin();
+         i != wire_template->begin() + n_scope; ++i)
+      has_scope = has_scope || (*i)->matches(*scope);
+    if (!has_scope)
+      return 0;
+
+    /* Options data is rare, so we can afford to set up a placement
+     * template for every data set. */
+    PlacementTemplate placement;
+    uint64_t scope_value = 0;
+    std::vector<uint64_t> fixed_values(2*values.size());
+    std::vector<BasicOctetArray> octet_array_values(n_octet_arrays);
+    std::vector<unsigned int> present;
+
+    placement.register_placement(scope, &scope_value, 0);
+    for (unsigned int i = 0; i < values.size(); ++i) {
+      if (!wire_template->contains(values[i].ie))
+        continue;
+      void* p = values[i].width == 0
+        ? static_cast<void*>(&octet_array_values[values[i].offset])
+        : static_cast<void*>(&fixed_values[2*i]);
+      placement.register_placement(values[i].ie, p, 0);
+      present.push_back(i);
+    }
+    if (present.empty())
+      return 0;
+
+    DecodePlan plan(&placement, wire_template);
+    size_t min_length = wire_template->minlen();
+    const uint8_t* cur = buf;
+    uint64_t n = 0;
+
+    while (min_length > 0 && length >= min_length) {
+      uint16_t consumed = plan.execute(cur, length);
+      if (consumed == 0)
+        break;
+
+      uint32_t row = find_or_insert(
+        domain, read_placed_unsigned(&scope_value, scope_width));
+      for (auto i = present.begin(); i != present.end(); ++i) {
+        const Value& v = values[*i];
+        fixed[row*row_size + *i/8] |= 1 << (*i % 8);
+        if (v.width == 0) {
+          const BasicOctetArray& a = octet_array_values[v.offset];
+          octet_arrays[row*n_octet_arrays + v.offset].assign(
+            reinterpret_cast<const char*>(a.get_buf()), a.get_length());
+        } else
+          memcpy(&fixed[row*row_size + v.offset], &fixed_values[2*(*i)],
+                 v.width);
+      }
+
+      cur += consumed;
+      length -= consumed;
+      n++;
+    }
+    return n;
+  }
+
+  bool OptionsTable::lookup(uint32_t domain, uint64_t key,
+                            const InfoElement* ie, void* p) const {
+    int value = value_index(ie);
+    if (value < 0)
+      return false;
+    int64_t row = find(domain, key);
+    if (row < 0 || !has_value(row, value))
+      return false;
+    copy_value(row, value, p);
+    return true;
+  }
+
+  size_t OptionsTable::get_row_count() const {
+    return n_rows;
+  }
+
+  void OptionsTable::clear() {
+    domains.clear();
+    fixed.clear();
+    octet_arrays.clear();
+    n_rows = 0;
+    last = 0;
+  }
+
+} // namespace libfc
@@ -0,0 +1,207 @@
+/* Hi Emacs, please use -*- mode: C++; -*- */
+/* Copyright (c) 2011-2014 ETH Zürich. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ *    * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *    * Neither the names of ETH Zürich nor the names of other contributors 
+ *      may be used to endorse or promote products derived from this software 
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL ETH 
+ * ZURICH BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, 
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, 
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR 
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY 
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ * @author Stephan Neuhaus <neuhaust@tik.ee.ethz.ch>
+ */
+
+#ifndef _libfc_OPTIONSTABLE_H_
+#  define _libfc_OPTIONSTABLE_H_
+
+#  include <cstdint>
+#  include <string>
+#  include <unordered_map>
+#  include <vector>
+
+#  include "IETemplate.h"
+#  include "InfoElement.h"
+
+namespace libfc {
+
+  class OptionsJoin;
+
+  /** A table of options data, indexed by a scope field.
+   *
+   * Exporters send metadata such as interface names or sampling
+   * parameters as options records, whose scope fields say what the
+   * remaining fields describe; see RFC 7011, Section 3.4.2.2.  An
+   * options table collects the values of some IEs from options
+   * records that have a given IE, for example ingressInterface or
+   * selectorId, among their scope fields.  Rows are kept per
+   * observation domain, which is how this library tells exporters
+   * apart, and a later record for the same scope value overwrites
+   * the values it contains.
+   *
+   * If the scope IE is observationDomainId, the table has at most one
+   * row per observation domain, and joins use the observation domain
+   * of the message rather than a field of the data record.
+   *
+   * Tables are filled by registering them with a PlacementCollector
+   * (see PlacementCollector::register_options_table()), and are read
+   * while decoding data records through an OptionsJoin.  Scope values
+   * below the direct limit are looked up in an array, larger ones in a
+   * hash table, so that a lookup takes constant time either way.
+   *
+   * A table is updated and read by the thread that collects.
+   */
+  class OptionsTable {
+  public:
+    /** Creates a table.
+     *
+     * @param scope the scope IE; it must have an unsigned type
+     * @param direct_limit scope values below this are looked up in
+     *   an array, which grows up to this many entries per domain
+     *
+     * @throw IESpecError if the scope IE doesn't have an unsigned type
+     */
+    explicit OptionsTable(const InfoElement* scope,
+                          size_t direct_limit = default_direct_limit);
+
+    /** Adds an IE whose values are kept.
+     *
+     * The IE may have any type that can be placed, including string
+     * and octetArray.
+     *
+     * @param ie the information element
+     *
+     * @throw IESpecError if the IE is the scope IE or already a value
+     */
+    void add_value(const InfoElement* ie);
+
+    /** Returns the scope IE.
+     *
+     * @return the scope IE
+     */
+    const InfoElement* get_scope() const;
+
+    /** Tells whether the rows are per observation domain.
+     *
+     * @return true if the scope IE is observationDomainId
+     */
+    bool is_domain_scoped() const;
+
+    /** Loads the records of an options data set.
+     *
+     * Data sets whose template is not an options template, whose
+     * scope fields don't include the scope IE, or that have none of
+     * the value IEs, are ignored.
+     *
+     * @param domain the observation domain of the message
+     * @param wire_template the template of the data set
+     * @param buf the data records
+     * @param length the length of buf
+     *
+     * @return the number of records loaded
+     */
+    uint64_t load(uint32_t domain, const IETemplate* wire_template,
+                  const uint8_t* buf, uint16_t length);
+
+    /** Looks up a value.
+     *
+     * @param domain the observation domain
+     * @param key the scope value; ignored if is_domain_scoped()
+     * @param ie a value IE
+     * @param p where to store the value, as it would be placed; for
+     *   string and octetArray IEs, a BasicOctetArray
+     *
+     * @return true if the value was found, false otherwise
+     */
+    bool lookup(uint32_t domain, uint64_t key, const InfoElement* ie,
+                void* p) const;
+
+    /** Returns the number of rows in all domains.
+     *
+     * @return the number of rows
+     */
+    size_t get_row_count() const;
+
+    /** Removes all rows. */
+    void clear();
+
+    static const size_t default_direct_limit = 65536;
+
+  private:
+    friend class OptionsJoin;
+
+    struct Value {
+      const InfoElement* ie;
+      /** Placed width, or 0 for octet arrays. */
+      size_t width;
+      /** Offset in the fixed part of a row, or index of the octet
+       * array in a row. */
+      size_t offset;
+    };
+
+    struct Domain {
+      /** Row index plus one, or 0 for no row. */
+      std::vector<uint32_t> direct;
+      std::unordered_map<uint64_t, uint32_t> hashed;
+    };
+
+    /** Returns the index of a value IE, or -1. */
+    int value_index(const InfoElement* ie) const;
+
+    /** Returns a row, or -1 if there is none. */
+    int64_t find(uint32_t domain, uint64_t key) const;
+    uint32_t find_or_insert(uint32_t domain, uint64_t key);
+
+    /** Tells whether a row has a value. */
+    bool has_value(uint32_t row, unsigned int value) const;
+
+    /** Copies a value of a row to where it would be placed. */
+    void copy_value(uint32_t row, unsigned int value, void* p) const;
+
+    /** Reads an unsigned value of a row. */
+    uint64_t read_unsigned(uint32_t row, unsigned int value) const;
+
+    const InfoElement* scope;
+    size_t scope_width;
+    bool domain_scoped;
+    size_t direct_limit;
+
+    std::vector<Value> values;
+    size_t n_octet_arrays;
+
+    /** Octets in the fixed part of a row: a presence bitmap, followed
+     * by the fixed-width values. */
+    size_t row_size;
+
+    size_t n_rows;
+    std::vector<uint8_t> fixed;
+    std::vector<std::string> octet_arrays;
+
+    std::unordered_map<uint32_t, Domain> domains;
+
+    /** The domain looked up last, which is usually the next one. */
+    mutable uint32_t last_domain;
+    mutable const Domain* last;
+  };
+
+} // namespace libfc
+
+#endif // _libfc_OPTIONSTABLE_H_
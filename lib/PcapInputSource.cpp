@@ -0,0 +1,586 @@
+/* Copyright (c) 2011-2014 ETH Zürich. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ *    * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *    * Neither the names of ETH Zürich nor the names of other contributors 
+ *      may be used to endorse or promote products derived from this software 
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL ETH 
+ * ZURICH BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, 
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, 
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR 
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY 
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cstdint>
+#include <cstring>
+#include <sstream>
+#include <thread>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+
+#include "PcapInputSource.h"
+
+#include "exceptions/FormatError.h"
+
+/** Link types, from http://www.tcpdump.org/linktypes.html */
+static const unsigned int kLinkTypeNull = 0;
+static const unsigned int kLinkTypeEthernet = 1;
+static const unsigned int kLinkTypeRaw = 101;
+static const unsigned int kLinkTypeLoop = 108;
+static const unsigned int kLinkTypeLinuxSll = 113;
+static const unsigned int kLinkTypeIpv4 = 228;
+static const unsigned int kLinkTypeIpv6 = 229;
+static const unsigned int kLinkTypeLinuxSll2 = 276;
+
+static const uint32_t kPcapMagicMicroseconds = 0xa1b2c3d4;
+static const uint32_t kPcapMagicNanoseconds = 0xa1b23c4d;
+static const uint32_t kPcapngSectionHeader = 0x0a0d0d0a;
+static const uint32_t kPcapngByteOrderMagic = 0x1a2b3c4d;
+static const uint32_t kPcapngInterfaceDescription = 1;
+static const uint32_t kPcapngSimplePacket = 3;
+static const uint32_t kPcapngEnhancedPacket = 6;
+static const uint16_t kPcapngOptionTsresol = 9;
+
+/** Packets larger than this are taken as a sign of a corrupt file. */
+static const size_t kMaxPacketLen = 1 << 20;
+
+static const uint16_t kEtherTypeIpv4 = 0x0800;
+static const uint16_t kEtherTypeIpv6 = 0x86dd;
+static const uint16_t kEtherTypeVlan = 0x8100;
+static const uint16_t kEtherTypeQinQ = 0x88a8;
+
+static uint16_t be16(const uint8_t* p) {
+  return (p[0] << 8) | p[1];
+}
+
+static uint32_t swap32(uint32_t v) {
+  return ((v & 0xff) << 24) | ((v & 0xff00) << 8)
+    | ((v >> 8) & 0xff00) | (v >> 24);
+}
+
+/** Converts a timestamp in ticks to nanoseconds. */
+static uint64_t ticks_to_ns(uint64_t ticks, uint64_t ticks_per_second) {
+  uint64_t fraction = ticks % ticks_per_second;
+  /* Finer than nanoseconds, the fraction times 10^9 might overflow. */
+  if (ticks_per_second > UINT64_MAX / 1000000000ULL)
+    fraction /= ticks_per_second / 1000000000ULL;
+  else
+    fraction = fraction * 1000000000ULL / ticks_per_second;
+  return ticks / ticks_per_second * 1000000000ULL + fraction;
+}
+
+namespace libfc {
+
+  PcapInputSource::PcapInputSource(int fd, std::string file_name,
+                                   uint16_t port)
+    : file(fdopen(fd, "rb")),
+      file_name(file_name),
+      port(port),
+      speed(0),
+      is_pcapng(false),
+      swapped(false),
+      eof(false),
+      link_type(0),
+      ticks_per_second(1000000),
+      consumed(0),
+      source_length(0),
+      capture_time(0),
+      n_datagrams(0),
+      n_skipped(0),
+      first_capture_time(0) {
+    memset(&source, 0, sizeof(source));
+    if (file == 0)
+      throw FormatError("Can't open \"" + file_name + "\"");
+    setvbuf(file, 0, _IOFBF, 1 << 20);
+
+    bool ok = false;
+    try {
+      ok = read_header();
+    } catch (FormatError& e) {
+      fclose(file);
+      throw;
+    }
+    if (!ok) {
+      fclose(file);
+      throw FormatError("\"" + file_name + "\" is not a pcap or pcapng file");
+    }
+  }
+
+  PcapInputSource::~PcapInputSource() {
+    (void) fclose(file);
+  }
+
+  void PcapInputSource::set_speed(double _speed) {
+    speed = _speed;
+  }
+
+  const struct sockaddr* PcapInputSource::get_source() const {
+    return reinterpret_cast<const struct sockaddr*>(&source);
+  }
+
+  socklen_t PcapInputSource::get_source_length() const {
+    return source_length;
+  }
+
+  uint64_t PcapInputSource::get_capture_time() const {
+    return capture_time;
+  }
+
+  uint64_t PcapInputSource::get_datagram_count() const {
+    return n_datagrams;
+  }
+
+  uint64_t PcapInputSource::get_skipped_count() const {
+    return n_skipped;
+  }
+
+  uint16_t PcapInputSource::get16(const uint8_t* p) const {
+    uint16_t v;
+    memcpy(&v, p, sizeof(v));
+    return swapped ? static_cast<uint16_t>((v << 8) | (v >> 8)) : v;
+  }
+
+  uint32_t PcapInputSource::get32(const uint8_t* p) const {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return swapped ? swap32(v) : v;
+  }
+
+  bool PcapInputSource::read_fully(void* buf, size_t len) {
+    return fread(buf, 1, len, file) == len;
+  }
+
+  bool PcapInputSource::read_header() {
+    uint8_t magic_bytes[4];
+    if (!read_fully(magic_bytes, sizeof(magic_bytes)))
+      return false;
+
+    uint32_t magic;
+    memcpy(&magic, magic_bytes, sizeof(magic));
+
+    if (magic == kPcapngSectionHeader) {
+      /* The section header block is read like any other, which
+       * determines the byte order. */
+      is_pcapng = true;
+      uint8_t length_bytes[4];
+      if (!read_fully(length_bytes, sizeof(length_bytes)))
+        return false;
+      return read_section_header(length_bytes);
+    }
+
+    if (magic == kPcapMagicMicroseconds || magic == kPcapMagicNanoseconds)
+      swapped = false;
+    else if (swap32(magic) == kPcapMagicMicroseconds
+             || swap32(magic) == kPcapMagicNanoseconds)
+      swapped = true;
+    else
+      return false;
+
+    ticks_per_second = get32(magic_bytes) == kPcapMagicNanoseconds
+      ? 1000000000 : 1000000;
+
+    /* Version, time zone, significant figures, snap length and link
+     * type. */
+    uint8_t header[20];
+    if (!read_fully(header, sizeof(header)))
+      return false;
+    link_type = get32(header + 16) & 0xffff;
+    return true;
+  }
+
+  PcapInputSource::Packet PcapInputSource::next_packet() {
+    return is_pcapng ? next_pcapng_packet() : next_pcap_packet();
+  }
+
+  PcapInputSource::Packet PcapInputSource::next_pcap_packet() {
+    uint8_t header[16];
+    if (!read_fully(header, sizeof(header)))
+      return end_of_file;
+
+    uint32_t seconds = get32(header + 0);
+    uint32_t fraction = get32(header + 4);
+    uint32_t captured_length = get32(header + 8);
+
+    if (captured_length > kMaxPacketLen)
+      throw FormatError("Corrupt packet record in \"" + file_name + "\"");
+    packet.resize(captured_length);
+    if (!read_fully(packet.data(), captured_length))
+      return end_of_file;
+
+    capture_time = seconds*1000000000ULL
+      + ticks_to_ns(fraction, ticks_per_second);
+
+    return decode_link(link_type, packet.data(), captured_length)
+      ? udp_datagram : skipped_packet;
+  }
+
+  bool PcapInputSource::read_section_header(const uint8_t* length_bytes) {
+    /* A new section can have a different byte order. */
+    uint8_t byte_order_magic[4];
+    if (!read_fully(byte_order_magic, sizeof(byte_order_magic)))
+      return false;
+    uint32_t bom;
+    memcpy(&bom, byte_order_magic, sizeof(bom));
+    if (bom == kPcapngByteOrderMagic)
+      swapped = false;
+    else if (swap32(bom) == kPcapngByteOrderMagic)
+      swapped = true;
+    else
+      throw FormatError("Bad byte order in \"" + file_name + "\"");
+
+    uint32_t block_length = get32(length_bytes);
+    if (block_length < 12 + 16 || block_length % 4 != 0
+        || block_length > kMaxPacketLen)
+      throw FormatError("Corrupt section in \"" + file_name + "\"");
+    packet.resize(block_length - 12);
+    if (!read_fully(packet.data(), packet.size()))
+      return false;
+
+    if_link_types.clear();
+    if_ticks_per_second.clear();
+    return true;
+  }
+
+  PcapInputSource::Packet PcapInputSource::next_pcapng_packet() {
+    uint8_t header[8];
+    if (!read_fully(header, sizeof(header)))
+      return end_of_file;
+
+    uint32_t type = get32(header + 0);
+
+    if (type == kPcapngSectionHeader) {
+      if (!read_section_header(header + 4))
+        return end_of_file;
+      return no_packet;
+    }
+
+    uint32_t block_length = get32(header + 4);
+    if (block_length < 12 || block_length % 4 != 0
+        || block_length > kMaxPacketLen)
+      throw FormatError("Corrupt block in \"" + file_name + "\"");
+
+    /* The body and the trailing block length. */
+    packet.resize(block_length - 8);
+    if (!read_fully(packet.data(), packet.size()))
+      return end_of_file;
+    const uint8_t* body = packet.data();
+    size_t body_length = block_length - 12;
+
+    if (type == kPcapngInterfaceDescription) {
+      if (body_length < 8)
+        throw FormatError("Corrupt interface in \"" + file_name + "\"");
+
+      uint64_t tps = 1000000;
+      size_t off = 8;
+      while (off + 4 <= body_length) {
+        uint16_t code = get16(body + off);
+        uint16_t length = get16(body + off + 2);
+        if (code == 0 || off + 4 + length > body_length)
+          break;
+        if (code == kPcapngOptionTsresol && length >= 1) {
+          uint8_t resolution = body[off + 4];
+          uint64_t base = (resolution & 0x80) ? 2 : 10;
+          tps = 1;
+          for (unsigned int i = 0; i < (resolution & 0x7f); ++i) {
+            if (tps > UINT64_MAX / base)
+              throw FormatError("Timestamp resolution out of range in \""
+                                + file_name + "\"");
+            tps *= base;
+          }
+        }
+        off += 4 + (length + 3)/4*4;
+      }
+
+      if_link_types.push_back(get16(body));
+      if_ticks_per_second.push_back(tps);
+      return no_packet;
+    }
+
+    if (type == kPcapngEnhancedPacket) {
+      if (body_length < 20)
+        throw FormatError("Corrupt packet in \"" + file_name + "\"");
+      uint32_t interface = get32(body + 0);
+      uint64_t ticks = (static_cast<uint64_t>(get32(body + 4)) << 32)
+        | get32(body + 8);
+      uint32_t captured_length = get32(body + 12);
+      if (interface >= if_link_types.size()
+          || captured_length > body_length - 20)
+        throw FormatError("Corrupt packet in \"" + file_name + "\"");
+
+      capture_time = ticks_to_ns(ticks, if_ticks_per_second[interface]);
+      return decode_link(if_link_types[interface], body + 20,
+                         captured_length)
+        ? udp_datagram : skipped_packet;
+    }
+
+    if (type == kPcapngSimplePacket) {
+      /* Simple packets have no timestamp, so the capture time stays
+       * that of the previous packet. */
+      if (body_length < 4 || if_link_types.empty())
+        throw FormatError("Corrupt packet in \"" + file_name + "\"");
+      size_t captured_length = get32(body);
+      if (captured_length > body_length - 4)
+        captured_length = body_length - 4;
+      return decode_link(if_link_types[0], body + 4, captured_length)
+        ? udp_datagram : skipped_packet;
+    }
+
+    return no_packet;
+  }
+
+  bool PcapInputSource::decode_link(unsigned int type, const uint8_t* p,
+                                    size_t len) {
+    uint16_t ether_type;
+    size_t off;
+
+    switch (type) {
+    case kLinkTypeEthernet:
+      if (len < 14)
+        return false;
+      ether_type = be16(p + 12);
+      off = 14;
+      while (ether_type == kEtherTypeVlan || ether_type == kEtherTypeQinQ) {
+        if (len < off + 4)
+          return false;
+        ether_type = be16(p + off + 2);
+        off += 4;
+      }
+      break;
+    case kLinkTypeLinuxSll:
+      if (len < 16)
+        return false;
+      ether_type = be16(p + 14);
+      off = 16;
+      break;
+    case kLinkTypeLinuxSll2:
+      if (len < 20)
+        return false;
+      ether_type = be16(p + 0);
+      off = 20;
+      break;
+    case kLinkTypeNull:
+    case kLinkTypeLoop:
+      /* The address family is in the capturing host's byte order;
+       * the IP version tells us just as well. */
+      if (len < 4)
+        return false;
+      return decode_ip(p + 4, len - 4);
+    case kLinkTypeRaw:
+    case kLinkTypeIpv4:
+    case kLinkTypeIpv6:
+      return decode_ip(p, len);
+    default:
+      return false;
+    }
+
+    if (ether_type != kEtherTypeIpv4 && ether_type != kEtherTypeIpv6)
+      return false;
+    return decode_ip(p + off, len - off);
+  }
+
+  bool PcapInputSource::decode_ip(const uint8_t* p, size_t len) {
+    if (len < 1)
+      return false;
+
+    if (p[0] >> 4 == 4) {
+      if (len < 20)
+        return false;
+      size_t header_length = (p[0] & 0x0f)*4;
+      size_t total_length = be16(p + 2);
+      /* Link layers may pad short packets. */
+      if (header_length < 20 || total_length < header_length
+          || total_length > len)
+        return false;
+      /* Fragments are not reassembled. */
+      if ((be16(p + 6) & 0x3fff) != 0 || p[9] != IPPROTO_UDP)
+        return false;
+
+      struct sockaddr_in* sin = reinterpret_cast<struct sockaddr_in*>(&source);
+      memset(sin, 0, sizeof(*sin));
+      sin->sin_family = AF_INET;
+      memcpy(&sin->sin_addr, p + 12, 4);
+      source_length = sizeof(*sin);
+
+      return decode_udp(p + header_length, total_length - header_length);
+    } else if (p[0] >> 4 == 6) {
+      if (len < 40)
+        return false;
+      size_t total_length = 40 + be16(p + 4);
+      if (total_length > len)
+        return false;
+
+      /* Skip hop-by-hop, routing and destination options headers;
+       * fragments are not reassembled. */
+      uint8_t next_header = p[6];
+      size_t off = 40;
+      while (next_header == 0 || next_header == 43 || next_header == 60) {
+        if (total_length < off + 8)
+          return false;
+        next_header = p[off];
+        off += (p[off + 1] + 1)*8;
+      }
+      if (next_header != IPPROTO_UDP || off > total_length)
+        return false;
+
+      struct sockaddr_in6* sin6
+        = reinterpret_cast<struct sockaddr_in6*>(&source);
+      memset(sin6, 0, sizeof(*sin6));
+      sin6->sin6_family = AF_INET6;
+      memcpy(&sin6->sin6_addr, p + 8, 16);
+      source_length = sizeof(*sin6);
+
+      return decode_udp(p + off, total_length - off);
+    }
+
+    return false;
+  }
+
+  bool PcapInputSource::decode_udp(const uint8_t* p, size_t len) {
+    if (len < 8)
+      return false;
+
+    size_t udp_length = be16(p + 4);
+    if (udp_length < 8 || udp_length > len)
+      return false;
+    if (port != 0 && be16(p + 2) != port)
+      return false;
+
+    /* The port is at the same place in both address families. */
+    uint16_t source_port;
+    memcpy(&source_port, p, sizeof(source_port));
+    if (source.ss_family == AF_INET)
+      reinterpret_cast<struct sockaddr_in*>(&source)->sin_port = source_port;
+    else
+      reinterpret_cast<struct sockaddr_in6*>(&source)->sin6_port
+        = source_port;
+
+    datagram.assign(p + 8, p + udp_length);
+    consumed = 0;
+    return true;
+  }
+
+  bool PcapInputSource::fill() {
+    while (consumed >= datagram.size()) {
+      if (eof)
+        return false;
+
+      switch (next_packet()) {
+      case end_of_file:
+        eof = true;
+        datagram.clear();
+        consumed = 0;
+        return false;
+      case udp_datagram:
+        if (datagram.empty()) {
+          n_skipped++;
+          break;
+        }
+        n_datagrams++;
+        pace();
+        return true;
+      case skipped_packet:
+        n_skipped++;
+        break;
+      case no_packet:
+        break;
+      }
+    }
+    return true;
+  }
+
+  void PcapInputSource::pace() {
+    if (speed <= 0)
+      return;
+
+    if (n_datagrams == 1) {
+      first_capture_time = capture_time;
+      first_replay_time = std::chrono::steady_clock::now();
+      return;
+    }
+    if (capture_time <= first_capture_time)
+      return;
+
+    double delay = (capture_time - first_capture_time)/speed;
+    std::this_thread::sleep_until(
+      first_replay_time
+      + std::chrono::nanoseconds(static_cast<int64_t>(delay)));
+  }
+
+  ssize_t PcapInputSource::read(uint8_t* buf, uint16_t len) {
+    ssize_t ret = peek(buf, len);
+    if (ret > 0)
+      consumed += ret;
+    return ret;
+  }
+
+  ssize_t PcapInputSource::peek(uint8_t* buf, uint16_t len) {
+    if (!fill())
+      return 0;
+
+    /* A message never extends beyond its datagram. */
+    size_t n = datagram.size() - consumed;
+    if (n > len)
+      n = len;
+    memcpy(buf, datagram.data() + consumed, n);
+    return static_cast<ssize_t>(n);
+  }
+
+  bool PcapInputSource::resync() {
+    consumed = datagram.size();
+    return fill();
+  }
+
+  size_t PcapInputSource::get_message_offset() const {
+    return 0;
+  }
+
+  void PcapInputSource::advance_message_offset() {
+    /* Discard whatever follows the message in its datagram.  If the
+     * parser has only peeked into the next datagram, as the V9 parser
+     * does to find the end of a message, keep it. */
+    if (consumed > 0)
+      consumed = datagram.size();
+  }
+
+  const char* PcapInputSource::get_name() const {
+    std::ostringstream sstr;
+    char address[INET6_ADDRSTRLEN] = "";
+    uint16_t source_port = 0;
+
+    if (source.ss_family == AF_INET) {
+      const struct sockaddr_in* sin
+        = reinterpret_cast<const struct sockaddr_in*>(&source);
+      inet_ntop(AF_INET, &sin->sin_addr, address, sizeof(address));
+      source_port = ntohs(sin->sin_port);
+    } else if (source.ss_family == AF_INET6) {
+      const struct sockaddr_in6* sin6
+        = reinterpret_cast<const struct sockaddr_in6*>(&source);
+      inet_ntop(AF_INET6, &sin6->sin6_addr, address, sizeof(address));
+      source_port = ntohs(sin6->sin6_port);
+    }
+
+    sstr << "Pcap(name=\"" << file_name << "\",datagram=" << n_datagrams
+         << ",source=" << address << ',' << source_port << ')';
+    name = sstr.str();
+    return name.c_str();
+  }
+
+  bool PcapInputSource::can_peek() const {
+    return true;
+  }
+
+} // namespace libfc
@@ -0,0 +1,202 @@
+/* Hi Emacs, please use -*- mode: C++; -*- */
+/* Copyright (c) 2011-2014 ETH Zürich. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ *    * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *    * Neither the names of ETH Zürich nor the names of other contributors 
+ *      may be used to endorse or promote products derived from this software 
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL ETH 
+ * ZURICH BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, 
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, 
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR 
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY 
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ * @author Stephan Neuhaus <neuhaust@tik.ee.ethz.ch>
+ */
+
+#ifndef _libfc_PCAPINPUTSOURCE_H_
+#  define _libfc_PCAPINPUTSOURCE_H_
+
+#  include <chrono>
+#  include <cstdio>
+#  include <string>
+#  include <vector>
+
+#  include <sys/socket.h>
+
+#  include "InputSource.h"
+
+namespace libfc {
+
+  /** An input source that replays IPFIX or NetFlow v9 over UDP from
+   * a packet capture.
+   *
+   * The capture can be a pcap or a pcapng file with Ethernet (with
+   * or without VLAN tags), Linux cooked, BSD loopback or raw IP link
+   * layers.  The link, IPv4 or IPv6 and UDP headers are stripped, and
+   * the payloads of the UDP datagrams are presented one after the
+   * other, just as a UDP socket would deliver them.  Packets that are
+   * not UDP, that are IP fragments, that were truncated by the
+   * capture, or that are not addressed to the chosen port are
+   * skipped.
+   *
+   * During collection, get_source() and get_capture_time() tell
+   * where the current datagram came from and when it was captured.
+   * Note that the collectors key templates by observation domain
+   * only, so a capture from several exporters should use distinct
+   * observation domains.
+   *
+   * By default, datagrams are replayed as fast as they can be
+   * parsed; with set_speed(), they are replayed at the captured
+   * timing, or at a multiple of it.  This allows reproducible
+   * benchmarks of the datagram collection path without a network.
+   */
+  class PcapInputSource : public InputSource {
+  public:
+    /** Creates a pcap input source from a file descriptor.
+     *
+     * @param fd the file descriptor belonging to a pcap or pcapng file
+     * @param file_name the name you want this file to be known to
+     *   diagnostics
+     * @param port the UDP destination port of the datagrams to
+     *   replay, or 0 for all UDP datagrams
+     *
+     * @throw FormatError if the file is not a pcap or pcapng file
+     */
+    PcapInputSource(int fd, std::string file_name, uint16_t port = 0);
+    ~PcapInputSource();
+
+    /** Sets the replay speed.
+     *
+     * @param speed 0 to replay as fast as possible, which is the
+     *   default, 1 to replay at the captured timing, and other
+     *   positive values to replay that many times faster than
+     *   captured
+     */
+    void set_speed(double speed);
+
+    /** Returns the source address of the current datagram.
+     *
+     * @return the source address, either a sockaddr_in or a
+     *   sockaddr_in6
+     */
+    const struct sockaddr* get_source() const;
+
+    /** Returns the length of the source address of the current
+     * datagram.
+     *
+     * @return the length of the source address, in bytes
+     */
+    socklen_t get_source_length() const;
+
+    /** Returns when the current datagram was captured.
+     *
+     * @return the capture time in nanoseconds since the epoch
+     */
+    uint64_t get_capture_time() const;
+
+    /** Returns the number of datagrams replayed so far.
+     *
+     * @return the number of datagrams replayed
+     */
+    uint64_t get_datagram_count() const;
+
+    /** Returns the number of packets skipped so far.
+     *
+     * @return the number of packets skipped
+     */
+    uint64_t get_skipped_count() const;
+
+    ssize_t read(uint8_t* buf, uint16_t len);
+    ssize_t peek(uint8_t* buf, uint16_t len);
+    bool resync();
+    size_t get_message_offset() const;
+    void advance_message_offset();
+    const char* get_name() const;
+    bool can_peek() const;
+
+  private:
+    /** What next_packet() found. */
+    enum Packet {
+      end_of_file,
+      /** A pcapng block that does not contain a packet. */
+      no_packet,
+      skipped_packet,
+      udp_datagram,
+    };
+
+    bool read_fully(void* buf, size_t len);
+    bool read_header();
+    bool read_section_header(const uint8_t* length_bytes);
+    Packet next_packet();
+    Packet next_pcap_packet();
+    Packet next_pcapng_packet();
+    bool decode_link(unsigned int link_type, const uint8_t* p, size_t len);
+    bool decode_ip(const uint8_t* p, size_t len);
+    bool decode_udp(const uint8_t* p, size_t len);
+    bool fill();
+    void pace();
+
+    uint16_t get16(const uint8_t* p) const;
+    uint32_t get32(const uint8_t* p) const;
+
+    FILE* file;
+    std::string file_name;
+    uint16_t port;
+    double speed;
+
+    bool is_pcapng;
+    /** Whether the file's byte order differs from ours. */
+    bool swapped;
+    bool eof;
+
+    /** pcap: the link type and the number of timestamp units per
+     * second. */
+    unsigned int link_type;
+    uint64_t ticks_per_second;
+
+    /** pcapng: the link type and timestamp units of each interface. */
+    std::vector<unsigned int> if_link_types;
+    std::vector<uint64_t> if_ticks_per_second;
+
+    std::vector<uint8_t> packet;
+
+    /** The payload of the current datagram, and how much of it has
+     * been read. */
+    std::vector<uint8_t> datagram;
+    size_t consumed;
+
+    struct sockaddr_storage source;
+    socklen_t source_length;
+    uint64_t capture_time;
+
+    uint64_t n_datagrams;
+    uint64_t n_skipped;
+
+    /** For pacing: the capture time and the wall clock time of the
+     * first datagram. */
+    uint64_t first_capture_time;
+    std::chrono::steady_clock::time_point first_replay_time;
+
+    mutable std::string name;
+  };
+
+} // namespace libfc
+
+#endif // _libfc_PCAPINPUTSOURCE_H_
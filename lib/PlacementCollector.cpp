@@ -45,6 +45,11 @@ namespace libfc {
 
     if (ir != 0)
       ir->set_content_handler(&d);
+    set_statistics_enabled(false);
+
+    if (ir != 0)
+      ir->set_latencies(&latencies);
+    d.set_latencies(&latencies);
   }
 
   PlacementCollector::~PlacementCollector() {
@@ -55,6 +60,25 @@ namespace libfc {
     return ir->parse(is);
   }
 
+  CollectorStatistics PlacementCollector::get_statistics() const {
+    return counters.snapshot();
+  }
+
+  void PlacementCollector::set_statistics_enabled(bool enabled) {
+    CollectorCounters* c = enabled ? &counters : 0;
+    if (ir != 0)
+      ir->set_counters(c);
+    d.set_counters(c);
+  }
+
+  CollectorLatencies PlacementCollector::get_latencies() const {
+    return latencies;
+  }
+
+  void PlacementCollector::reset_latencies() {
+    latencies.reset();
+  }
+
   void PlacementCollector::register_placement_template(
       const PlacementTemplate* placement) {
     d.register_placement_template(placement, this);
@@ -74,6 +98,10 @@ namespace libfc {
     libfc_RETURN_OK();
   }
 
+  void PlacementCollector::register_options_table(OptionsTable* table) {
+    d.register_options_table(table);
+  }
+
   void PlacementCollector::give_me_unhandled_data_sets() {
     d.register_unhandled_data_set_handler(const_cast<PlacementCollector*>(this));
   }
@@ -33,6 +33,8 @@
 #ifndef _libfc_PLACEMENTCALLBACK_H_
 #  define _libfc_PLACEMENTCALLBACK_H_
 
+#  include "CollectorStatistics.h"
+#  include "LatencyHistogram.h"
 #  include "PlacementContentHandler.h"
 #  include "MessageStreamParser.h"
 #  include "PlacementTemplate.h"
@@ -65,6 +67,42 @@ namespace libfc {
      */
     std::shared_ptr<ErrorContext> collect(InputSource& is);
 
+    /** Returns a snapshot of this collector's runtime statistics.
+     *
+     * The counters are updated by the thread that calls collect(),
+     * but this function may be called from any thread at any time,
+     * for example from a metrics endpoint while collection is in
+     * progress.  To get totals over several collectors, add their
+     * snapshots.
+     *
+     * @return the current counter values
+     */
+    CollectorStatistics get_statistics() const;
+
+    /** Turns runtime statistics on or off.
+     *
+     * Statistics are off by default, so that collectors that don't
+     * report them don't pay for them.  Counters keep their values when
+     * statistics are turned off.
+     *
+     * @param enabled whether to update the counters
+     */
+    void set_statistics_enabled(bool enabled);
+
+    /** Returns a copy of this collector's latency histograms.
+     *
+     * Unlike get_statistics(), this must be called from the thread
+     * that calls collect(), for example between two calls to
+     * collect() or from a callback.  If libfc was built without
+     * LIBFC_LATENCY_HISTOGRAMS, the histograms are empty.
+     *
+     * @return the latency histograms
+     */
+    CollectorLatencies get_latencies() const;
+
+    /** Resets the latency histograms to empty. */
+    void reset_latencies();
+
     /** Signals that placement of values will now begin. 
      *
      * @param template placement template for current placements
@@ -143,9 +181,18 @@ namespace libfc {
      */
     void give_me_unhandled_data_sets();
 
+    /** Registers an options table, into which options data is
+     * loaded; see OptionsTable.
+     *
+     * @param table the options table to register
+     */
+    void register_options_table(OptionsTable* table);
+
   private:
     PlacementContentHandler d;
     MessageStreamParser* ir;
+    CollectorCounters counters;
+    CollectorLatencies latencies;
   };
 
 } // namespace libfc
@@ -24,11 +24,13 @@
  * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <algorithm>
 #include <cassert>
 #include <climits>
 #include <cstdarg>
 #include <cstdio>
 #include <iomanip>
+#include <memory>
 #include <sstream>
 
 #include <time.h>
@@ -43,11 +45,15 @@
 
 #include "decode_util.h"
 #include "pointer_checks.h"
+#include "trace_util.h"
 
 #include "BasicOctetArray.h"
 #include "DecodePlan.h"
+#include "DeduplicationPlan.h"
+#include "FilterPlan.h"
 #include "PlacementContentHandler.h"
 #include "PlacementCollector.h"
+#include "RecordWalker.h"
 
 namespace libfc {
 
@@ -65,12 +71,48 @@ namespace libfc {
         return err;                                                     \
     } while (0)
 
+/* Timing of data sets and callbacks.  Both macros expect the
+ * variables set_start and callback_ticks from
+ * CH_START_DATA_SET_LATENCY() in scope. */
+#if defined(_libfc_HAVE_LATENCY_HISTOGRAMS_)
+#  define CH_START_DATA_SET_LATENCY()                                   \
+    uint64_t set_start = TscClock::now();                               \
+    uint64_t callback_ticks = 0
+
+#  define CH_REPORT_TIMED_CALLBACK_ERROR(call)                          \
+    do {                                                                \
+      uint64_t callback_start = TscClock::now();                        \
+      std::shared_ptr<ErrorContext> err = call;                         \
+      if (latencies != 0) {                                             \
+        uint64_t callback_time = TscClock::now() - callback_start;      \
+        latencies->callback.record(callback_time);                      \
+        callback_ticks += callback_time;                                \
+      }                                                                 \
+      if (err != 0)                                                     \
+        return err;                                                     \
+    } while (0)
+
+#  define CH_RECORD_DATA_SET_LATENCY()                                  \
+    do {                                                                \
+      if (latencies != 0)                                               \
+        latencies->data_set.record(TscClock::now() - set_start          \
+                                   - callback_ticks);                   \
+    } while (0)
+#else
+#  define CH_START_DATA_SET_LATENCY()
+#  define CH_REPORT_TIMED_CALLBACK_ERROR(call) CH_REPORT_CALLBACK_ERROR(call)
+#  define CH_RECORD_DATA_SET_LATENCY()
+#endif /* defined(_libfc_HAVE_LATENCY_HISTOGRAMS_) */
+
 
   PlacementContentHandler::PlacementContentHandler()
     : info_model(InfoModel::instance()),
       unhandled_data_set_handler(0),
+      counters(0),
+      latencies(0),
       use_matched_template_cache(false),
       current_wire_template(0),
+      current_scope_field_count(0),
       parse_is_good(true)
 #ifdef _libfc_HAVE_LOG4CPLUS_
                          ,
@@ -119,7 +161,7 @@ namespace libfc {
       uint32_t sequence_number,
       uint32_t observation_domain,
       uint64_t base_time) {
-    LOG4CPLUS_TRACE(logger,
+    libfc_HOT_TRACE(logger,
                     "ENTER start_message"
                     << ", version=" << version
                     << ", length=" << length
@@ -149,14 +191,14 @@ namespace libfc {
 
     this->observation_domain = observation_domain;
 
-    LOG4CPLUS_TRACE(logger, "LEAVE start_message");
+    libfc_HOT_TRACE(logger, "LEAVE start_message");
     return std::shared_ptr<ErrorContext>(0);
   }
 
   std::shared_ptr<ErrorContext> PlacementContentHandler::end_message() {
-    LOG4CPLUS_TRACE(logger, "ENTER end_message");
+    libfc_HOT_TRACE(logger, "ENTER end_message");
     assert(current_wire_template == 0);
-    LOG4CPLUS_TRACE(logger, "LEAVE end_message");
+    libfc_HOT_TRACE(logger, "LEAVE end_message");
     return std::shared_ptr<ErrorContext>(0);
   }
 
@@ -177,7 +219,11 @@ namespace libfc {
       uint16_t field_count = decode_uint16(cur + 2);
       uint16_t scope_field_count = is_options_set ? decode_uint16(cur + 4) : 0;
       
-      CH_REPORT_CALLBACK_ERROR(start_template_record(set_id, field_count));
+      if (is_options_set)
+        CH_REPORT_CALLBACK_ERROR(start_options_template_record(
+                                   set_id, field_count, scope_field_count));
+      else
+        CH_REPORT_CALLBACK_ERROR(start_template_record(set_id, field_count));
       
       cur += header_length;
       
@@ -224,7 +270,10 @@ namespace libfc {
         assert (cur <= set_end);
       }
       
-      CH_REPORT_CALLBACK_ERROR(end_template_record());
+      if (is_options_set)
+        CH_REPORT_CALLBACK_ERROR(end_options_template_record());
+      else
+        CH_REPORT_CALLBACK_ERROR(end_template_record());
     }
     libfc_RETURN_OK();
   }
@@ -276,6 +325,9 @@ namespace libfc {
     assert(current_wire_template != 0);
 
     if (current_wire_template->size() > 0) {
+      if (counters != 0)
+        counters->get_template(observation_domain, current_template_id)
+          .template_records.add(1);
 
       const IETemplate *my_wire_template 
         = find_wire_template(current_template_id);
@@ -293,6 +345,7 @@ namespace libfc {
           = current_wire_template;
 
         matched_templates.erase(my_wire_template);
+        data_set_plans.erase(my_wire_template);
       } else if (my_wire_template == 0) {
         LOG4CPLUS_INFO(logger, "  New template for domain " 
                        << observation_domain 
@@ -334,6 +387,34 @@ namespace libfc {
     libfc_RETURN_OK();
   }
 
+  std::shared_ptr<ErrorContext>
+  PlacementContentHandler::start_options_template_record(
+      uint16_t template_id,
+      uint16_t field_count,
+      uint16_t scope_field_count) {
+    LOG4CPLUS_TRACE(logger,
+                    "ENTER start_options_template_record"
+                    << ", template_id=" << template_id
+                    << ", field_count=" << field_count
+                    << ", scope_field_count=" << scope_field_count);
+    current_scope_field_count = scope_field_count;
+    return start_template_record(template_id, field_count);
+  }
+
+  std::shared_ptr<ErrorContext>
+  PlacementContentHandler::end_options_template_record() {
+    LOG4CPLUS_TRACE(logger, "ENTER end_options_template_record");
+    assert(current_wire_template != 0);
+
+    /* A malformed header may claim more scope fields than there are
+     * fields; end_template_record() reports the mismatch. */
+    current_wire_template->set_scope_count(
+      std::min<size_t>(current_scope_field_count,
+                       current_wire_template->size()));
+    current_scope_field_count = 0;
+    return end_template_record();
+  }
+
   std::shared_ptr<ErrorContext> PlacementContentHandler::start_options_template_set(
       uint16_t set_id,
       uint16_t set_length,
@@ -454,7 +535,7 @@ namespace libfc {
   PlacementContentHandler::match_placement_template(
       uint16_t id,
       const IETemplate* wire_template) const {
-    LOG4CPLUS_TRACE(logger, "ENTER match_placement_template");
+    libfc_HOT_TRACE(logger, "ENTER match_placement_template");
 
     /* This strategy: return first match. Other strategies are also
      * possible, such as "return match with most IEs". */
@@ -473,7 +554,7 @@ namespace libfc {
           = new std::set<const InfoElement*>();
 
         unsigned int n_matches = (*i)->is_match(wire_template, unmatched);
-        LOG4CPLUS_TRACE(logger, "n_matches=" << n_matches 
+        libfc_HOT_TRACE(logger, "n_matches=" << n_matches 
                         << ",unmatched->size()=" << unmatched->size()
                         << ",wire_template->size()="
                         << wire_template->size());
@@ -512,15 +593,16 @@ namespace libfc {
       uint16_t id,
       uint16_t length,
       const uint8_t* buf) {
-    LOG4CPLUS_TRACE(logger,
+    libfc_HOT_TRACE(logger,
                     "ENTER start_data_set"
                     << ", id=" << id
                     << ", length=" << length);
+    CH_START_DATA_SET_LATENCY();
 
     // Find out who is interested in data from this data set
     const IETemplate* wire_template = find_wire_template(id);
 
-    LOG4CPLUS_TRACE(logger, "  wire_template=" << wire_template);
+    libfc_HOT_TRACE(logger, "  wire_template=" << wire_template);
 
     if (wire_template == 0) {
       if (unhandled_data_set_handler == 0) {
@@ -531,6 +613,7 @@ namespace libfc {
                          " (this warning will appear only once)");
           unmatched_template_ids.insert(make_template_key(id));
         }
+        count_missing_template(id, length);
         libfc_RETURN_OK();
       } else {
         std::shared_ptr<ErrorContext> e 
@@ -547,6 +630,7 @@ namespace libfc {
                              " (this warning will appear only once)");
               unmatched_template_ids.insert(make_template_key(id));
             }
+            count_missing_template(id, length);
             libfc_RETURN_OK();
           }
         }
@@ -555,13 +639,32 @@ namespace libfc {
 
     assert(wire_template != 0);
 
+    if (wire_template->scope_count() > 0)
+      for (auto t = options_tables.begin(); t != options_tables.end(); ++t)
+        (*t)->load(observation_domain, wire_template, buf, length);
+
+    const uint16_t min_length = wire_template_min_length(wire_template);
+    DataSetPlans& plans = get_data_set_plans(wire_template);
+
+    CollectorCounters::Template* template_counters = 0;
+    if (counters != 0) {
+      template_counters = &counters->get_template(observation_domain, id);
+      template_counters->data_sets.add(1);
+      template_counters->data_octets.add(length);
+    }
+
     const PlacementTemplate* placement_template
       = match_placement_template(id, wire_template);
 
-    LOG4CPLUS_TRACE(logger, "  placement_template=" << placement_template);
+    libfc_HOT_TRACE(logger, "  placement_template=" << placement_template);
 
     if (placement_template == 0) {
-      LOG4CPLUS_TRACE(logger, "  no one interested in this data set; skipping");
+      libfc_HOT_TRACE(logger, "  no one interested in this data set; skipping");
+      if (template_counters != 0) {
+        template_counters->unmatched_sets.add(1);
+        template_counters->unmatched_records.add(
+          plans.walker.count(buf, length));
+      }
       libfc_RETURN_OK();
     }
 
@@ -569,27 +672,103 @@ namespace libfc {
 
     const uint8_t* buf_end = buf + length;
     const uint8_t* cur = buf;
-    const uint16_t min_length = wire_template_min_length(wire_template);
     
     auto callback = callbacks.find(placement_template);
     assert(callback != callbacks.end());
 
+    const RecordFilter* filter = placement_template->get_filter();
+    RecordDeduplicator* dedup = placement_template->get_deduplicator();
+    OptionsJoin* join = placement_template->get_options_join();
+    bool has_filter = filter != 0 && !filter->empty();
+    if (has_filter || dedup != 0) {
+      /* An empty filter accepts every record, but still finds out
+       * where records end. */
+      static const RecordFilter no_filter;
+      FilterPlan& filter_plan
+        = get_filter_plan(plans, has_filter ? filter : &no_filter,
+                          wire_template);
+      if (filter_plan.rejects_all()) {
+        libfc_HOT_TRACE(logger, "  filter rejects all records; skipping");
+        if (template_counters != 0)
+          template_counters->filtered_records.add(
+            plans.walker.count(buf, length));
+        libfc_RETURN_OK();
+      }
+
+      DeduplicationPlan* dedup_plan = 0;
+      if (dedup != 0)
+        dedup_plan = &get_dedup_plan(plans, dedup, wire_template);
+
+      uint64_t n_accepted = 0;
+      uint64_t n_rejected = 0;
+      uint64_t n_duplicates = 0;
+      while (cur < buf_end && length >= min_length) {
+        uint16_t record_length;
+        bool accept = filter_plan.execute(cur, length, &record_length);
+        if (record_length == 0)
+          break;
+
+        if (!accept)
+          n_rejected++;
+        else if (dedup_plan != 0 && dedup_plan->execute(cur, record_length))
+          n_duplicates++;
+        else {
+          CH_REPORT_CALLBACK_ERROR(
+            callback->second->start_placement(placement_template));
+          uint16_t consumed = plan.execute(cur, length);
+          assert(consumed == record_length);
+          if (join != 0)
+            join->apply(observation_domain);
+          libfc_SAMPLED_TRACE(logger, trace_sampler,
+                              "  sampled record: domain=" << observation_domain
+                              << ", template=" << id
+                              << ", offset=" << (cur - buf)
+                              << ", length=" << consumed);
+          CH_REPORT_TIMED_CALLBACK_ERROR(
+            callback->second->end_placement(placement_template));
+          n_accepted++;
+        }
+        cur += record_length;
+        length -= record_length;
+      }
+      if (template_counters != 0) {
+        template_counters->records.add(n_accepted);
+        template_counters->filtered_records.add(n_rejected);
+        template_counters->duplicate_records.add(n_duplicates);
+      }
+      CH_RECORD_DATA_SET_LATENCY();
+      libfc_RETURN_OK();
+    }
+
+    uint64_t n_records = 0;
     while (cur < buf_end && length >= min_length) {
       CH_REPORT_CALLBACK_ERROR(
         callback->second->start_placement(placement_template));
       uint16_t consumed = plan.execute(cur, length);
-      CH_REPORT_CALLBACK_ERROR(
+      if (join != 0)
+        join->apply(observation_domain);
+      libfc_SAMPLED_TRACE(logger, trace_sampler,
+                          "  sampled record: domain=" << observation_domain
+                          << ", template=" << id
+                          << ", offset=" << (cur - buf)
+                          << ", length=" << consumed);
+      CH_REPORT_TIMED_CALLBACK_ERROR(
         callback->second->end_placement(placement_template));
       cur += consumed;
       length -= consumed;
+      n_records++;
     }
 
+    if (template_counters != 0)
+      template_counters->records.add(n_records);
+
+    CH_RECORD_DATA_SET_LATENCY();
     libfc_RETURN_OK();
   }
 
   std::shared_ptr<ErrorContext> PlacementContentHandler::end_data_set() {
-    LOG4CPLUS_TRACE(logger, "ENTER end_data_set");
-    LOG4CPLUS_TRACE(logger, "LEAVE end_data_set");
+    libfc_HOT_TRACE(logger, "ENTER end_data_set");
+    libfc_HOT_TRACE(logger, "LEAVE end_data_set");
     libfc_RETURN_OK();
   }
 
@@ -606,7 +785,75 @@ namespace libfc {
   {
     unhandled_data_set_handler = callback;
   }
-    
+
+  void PlacementContentHandler::register_options_table(OptionsTable* table) {
+    options_tables.push_back(table);
+  }
+
+  void PlacementContentHandler::set_counters(CollectorCounters* _counters) {
+    counters = _counters;
+  }
+
+  void PlacementContentHandler::set_latencies(
+      CollectorLatencies* _latencies) {
+    latencies = _latencies;
+  }
+
+  void PlacementContentHandler::count_missing_template(uint16_t id,
+                                                       uint16_t length) {
+    if (counters != 0) {
+      CollectorCounters::Template& t
+        = counters->get_template(observation_domain, id);
+      t.missing_template_sets.add(1);
+      t.missing_template_octets.add(length);
+    }
+  }
+
+  PlacementContentHandler::DataSetPlans::DataSetPlans(
+      const IETemplate* wire_template)
+    : walker(wire_template),
+      filter(0),
+      filter_size(0),
+      dedup(0),
+      dedup_key_count(0) {
+  }
+
+  PlacementContentHandler::DataSetPlans&
+  PlacementContentHandler::get_data_set_plans(
+      const IETemplate* wire_template) {
+    auto p = data_set_plans.find(wire_template);
+    if (p == data_set_plans.end())
+      p = data_set_plans.emplace(wire_template,
+                                 DataSetPlans(wire_template)).first;
+    return p->second;
+  }
+
+  FilterPlan& PlacementContentHandler::get_filter_plan(
+      DataSetPlans& plans,
+      const RecordFilter* filter,
+      const IETemplate* wire_template) {
+    if (!plans.filter_plan || plans.filter != filter
+        || plans.filter_size != filter->size()) {
+      plans.filter_plan.reset(new FilterPlan(filter, wire_template));
+      plans.filter = filter;
+      plans.filter_size = filter->size();
+    }
+    return *plans.filter_plan;
+  }
+
+  DeduplicationPlan& PlacementContentHandler::get_dedup_plan(
+      DataSetPlans& plans,
+      RecordDeduplicator* dedup,
+      const IETemplate* wire_template) {
+    if (!plans.dedup_plan || plans.dedup != dedup
+        || plans.dedup_key_count != dedup->get_key_count()) {
+      plans.dedup_plan.reset(new DeduplicationPlan(dedup, wire_template));
+      plans.dedup = dedup;
+      plans.dedup_key_count = dedup->get_key_count();
+    }
+    return *plans.dedup_plan;
+  }
+
   uint16_t PlacementContentHandler::wire_template_min_length(const IETemplate* t) {
     uint16_t min = 0;
 
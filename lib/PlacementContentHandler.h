@@ -35,18 +35,26 @@
 
 #  include <list>
 #  include <map>
+#  include <memory>
 #  include <vector>
 
 #  if defined(_libfc_HAVE_LOG4CPLUS_)
 #    include <log4cplus/logger.h>
 #  endif /* defined(_libfc_HAVE_LOG4CPLUS_) */
 
+#  include "CollectorStatistics.h"
 #  include "ContentHandler.h"
 #  include "InfoElement.h"
 #  include "InfoModel.h"
 #  include "InputSource.h"
+#  include "DeduplicationPlan.h"
+#  include "FilterPlan.h"
+#  include "LatencyHistogram.h"
 #  include "IETemplate.h"
+#  include "OptionsTable.h"
 #  include "PlacementTemplate.h"
+#  include "RecordWalker.h"
+#  include "trace_util.h"
 
 namespace libfc {
 
@@ -117,6 +125,36 @@ namespace libfc {
      */
     void register_unhandled_data_set_handler(PlacementCollector* callback);
 
+    /** Registers an options table.
+     *
+     * The records of every options data set are loaded into the
+     * table before the data set is decoded into placement templates,
+     * so that joins in the same message already see them.  The table
+     * is not owned by this content handler.
+     *
+     * @param table the options table
+     */
+    void register_options_table(OptionsTable* table);
+
+    /** Sets the counters that this content handler updates.
+     *
+     * Per-template counters are updated once per template record and
+     * once per data set.  Counting is off if counters is 0, which is
+     * the default.
+     *
+     * @param counters the counters to update, or 0
+     */
+    void set_counters(CollectorCounters* counters);
+
+    /** Sets the histograms into which this content handler records
+     * the time per data set and per end_placement() call, or 0 for
+     * none.  Nothing is recorded unless libfc was built with latency
+     * histograms (see CollectorLatencies).
+     *
+     * @param latencies the histograms to record into, or 0
+     */
+    void set_latencies(CollectorLatencies* latencies);
+
   private:
     /** Observation domain for this message. */
     uint32_t observation_domain;
@@ -198,6 +236,14 @@ namespace libfc {
      */
     uint16_t wire_template_min_length(const IETemplate* t);
 
+    /** Counts a data set that was dropped because its template is
+     * unknown.
+     *
+     * @param id the template ID of the data set
+     * @param length the length of the data set, without set header
+     */
+    void count_missing_template(uint16_t id, uint16_t length);
+
     std::shared_ptr<ErrorContext> process_template_set(
       uint16_t set_id, uint16_t set_length,
       const uint8_t* buf, bool is_options_set);
@@ -242,9 +288,18 @@ namespace libfc {
     /** Association between placement template and callback. */
     std::map<const PlacementTemplate*, PlacementCollector*> callbacks;
 
+    /** Options tables to load options data into. */
+    std::vector<OptionsTable*> options_tables;
+
     /** Unhandled data set handler, if any. */
     PlacementCollector* unhandled_data_set_handler;
 
+    /** Counters to update, or 0 if counting is off. */
+    CollectorCounters* counters;
+
+    /** Histograms to record into, or 0 if timing is off. */
+    CollectorLatencies* latencies;
+
     /** Says whether to use the matched template cache. 
      *
      * At the moment, this is statically set in the constructor (to
@@ -268,6 +323,71 @@ namespace libfc {
     mutable std::map<const IETemplate*, const PlacementTemplate*>
       matched_templates;
 
+    /** What start_data_set() needs for data sets of one wire template
+     * besides the DecodePlan. */
+    struct DataSetPlans {
+      explicit DataSetPlans(const IETemplate* wire_template);
+
+      /** Counts records in data sets that aren't decoded. */
+      RecordWalker walker;
+
+      /** The filter for which filter_plan was made, and its size at
+       * the time; see RecordFilter::size(). */
+      const RecordFilter* filter;
+      size_t filter_size;
+
+      /** The filter plan, or 0 if none has been needed yet. */
+      std::unique_ptr<FilterPlan> filter_plan;
+
+      /** The deduplicator for which dedup_plan was made, and its
+       * number of keys at the time. */
+      RecordDeduplicator* dedup;
+      size_t dedup_key_count;
+
+      /** The deduplication plan, or 0 if none has been needed yet. */
+      std::unique_ptr<DeduplicationPlan> dedup_plan;
+    };
+
+    /** Returns the plans for a wire template, creating them on first
+     * use.
+     *
+     * @param wire_template the wire template
+     *
+     * @return the plans
+     */
+    DataSetPlans& get_data_set_plans(const IETemplate* wire_template);
+
+    /** Returns a filter plan for a wire template, making it anew only
+     * if the filter has changed since it was last made.
+     *
+     * @param plans the wire template's plans
+     * @param filter the filter
+     * @param wire_template the wire template
+     *
+     * @return the filter plan
+     */
+    static FilterPlan& get_filter_plan(DataSetPlans& plans,
+                                       const RecordFilter* filter,
+                                       const IETemplate* wire_template);
+
+    /** Returns a deduplication plan for a wire template, making it
+     * anew only if the deduplicator's keys have changed since it was
+     * last made.
+     *
+     * @param plans the wire template's plans
+     * @param dedup the deduplicator
+     * @param wire_template the wire template
+     *
+     * @return the deduplication plan
+     */
+    static DeduplicationPlan& get_dedup_plan(DataSetPlans& plans,
+                                             RecordDeduplicator* dedup,
+                                             const IETemplate* wire_template);
+
+    /** Plans for each wire template, dropped when the wire template
+     * is redefined. */
+    std::map<const IETemplate*, DataSetPlans> data_set_plans;
+
     /** The current wire template that is being assembled. 
      *
      * This pointer is set to null after every template record.
@@ -280,6 +400,10 @@ namespace libfc {
     /** Number of fields in current wire template. */
     uint16_t current_field_count;
 
+    /** Number of scope fields in current wire template, if it is an
+     * options template. */
+    uint16_t current_scope_field_count;
+
     /** Wire template field currently being assembled.
      *
      * This number must be less than current_field_count.
@@ -306,6 +430,9 @@ namespace libfc {
 
 #  if defined(_libfc_HAVE_LOG4CPLUS_)
     log4cplus::Logger logger;
+
+    /** Picks the records to trace; see set_trace_sampling(). */
+    TraceSampler trace_sampler;
 #  endif /* defined(_libfc_HAVE_LOG4CPLUS_) */
  };
 
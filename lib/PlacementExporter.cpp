@@ -26,6 +26,7 @@
  */
 #include <algorithm>
 #include <climits>
+#include <cstdint>
 #include <ctime>
 #include <cstdarg>
 #include <sstream>
@@ -41,6 +42,7 @@
 #include "ipfix_endian.h"
 
 #include "BasicOctetArray.h"
+#include "ConcurrentPlacementExporter.h"
 #include "PlacementExporter.h"
 
 #include "exceptions/ExportError.h"
@@ -188,7 +190,7 @@ EncodePlan::EncodePlan(const libfc::PlacementTemplate* placement_template)
 #if defined(IPFIX_BIG_ENDIAN)
   Decision::decision_type_t encode_fixlen_maybe_endianness
     = Decision::encode_fixlen;
-  Decision::decision_type_t encode_double_as_float_maybe_endianness
+  Decision::decision_type_t encode_float_into_double_maybe_endianness
     = Decision::encode_double_as_float;
 #elif defined(IPFIX_LITTLE_ENDIAN)
   Decision::decision_type_t encode_fixlen_maybe_endianness
@@ -326,7 +328,7 @@ EncodePlan::EncodePlan(const libfc::PlacementTemplate* placement_template)
 
       d.unencoded_length = sizeof(uint64_t);
       d.encoded_length = size;
-      if (d.unencoded_length == sizeof(uint32_t))
+      if (d.encoded_length == sizeof(uint32_t))
         d.type = encode_float_into_double_maybe_endianness;
       else
         d.type = encode_fixlen_maybe_endianness;
@@ -604,9 +606,10 @@ uint16_t EncodePlan::execute(uint8_t* buf, uint16_t offset,
       {
         float f = *static_cast<const double*>(i->address);
         assert(sizeof(f) == sizeof(uint32_t));
+        assert(offset + sizeof(uint32_t) <= length);
         std::reverse_copy(reinterpret_cast<char*>(&f),
-                          reinterpret_cast<char*>(&f) + sizeof(uint32_t) - 1,
-                          buf);
+                          reinterpret_cast<char*>(&f) + sizeof(uint32_t),
+                          buf + offset);
         
         bytes_copied = sizeof(uint32_t);
       }
@@ -616,7 +619,8 @@ uint16_t EncodePlan::execute(uint8_t* buf, uint16_t offset,
       {
         float f = *static_cast<const double*>(i->address);
         assert(sizeof(f) == sizeof(uint32_t));
-        memcpy(buf, &f, sizeof(uint32_t));
+        assert(offset + sizeof(uint32_t) <= length);
+        memcpy(buf + offset, &f, sizeof(uint32_t));
         bytes_copied = sizeof(uint32_t);
       }
       break;
@@ -629,6 +633,249 @@ uint16_t EncodePlan::execute(uint8_t* buf, uint16_t offset,
   return ret;
 }
 
+/** Chooses reduced-length encodings for a placement template.
+ *
+ * RFC 5101, Section 6.2 allows unsigned integers to be sent with
+ * fewer octets than their type would imply, and float64 values to be
+ * sent as float32.  Exporters typically keep counters in 64-bit
+ * variables, even though most values would fit into 32 or even 16
+ * bits.  A reduced-length encoder watches the values that are placed
+ * with a placement template and maintains a variant of that template
+ * in which those fields are registered with narrower sizes.
+ *
+ * A field is widened as soon as a value does not fit any more, and
+ * it is narrowed again only if all values in a full sample window
+ * would have fit into the narrower size.  Each distinct combination
+ * of sizes is a separate PlacementTemplate and hence gets its own
+ * template ID; a combination that has been used before is reused.
+ * Templates are never withdrawn, so once max_variants combinations
+ * exist, fields are only widened and never narrowed again.  Since
+ * every field can be widened at most three times, an encoder makes
+ * at most max_variants + 3 templates per field.
+ *
+ * Only unsigned integers and float64 values are reduced.  Signed
+ * integers would need sign extension on the collecting side, which
+ * DecodePlan does not do.
+ */
+class ReducedLengthEncoder {
+public:
+  /** Creates a reduced-length encoder.
+   *
+   * @param placement_template the template whose values are to be
+   *   encoded
+   * @param sample_size the number of records after which narrower
+   *   sizes are considered
+   */
+  ReducedLengthEncoder(const libfc::PlacementTemplate* placement_template,
+                       unsigned int sample_size);
+
+  ~ReducedLengthEncoder();
+
+  /** Returns the template with which the current values should be
+   * encoded.
+   *
+   * @return a variant of the original placement template
+   */
+  const libfc::PlacementTemplate* select();
+
+private:
+  struct Field {
+    /** What kind of reduction this field admits. */
+    enum field_type_t {
+      /** Size cannot be reduced. */
+      fixed,
+
+      /** Unsigned integer; native_size is the size of the variable. */
+      unsigned_integer,
+
+      /** float64; may be sent as float32. */
+      float64,
+    } type;
+
+    const libfc::InfoElement* ie;
+    void* address;
+
+    /** Size of the variable at address. */
+    size_t native_size;
+
+    /** Largest allowed size on the wire, as registered by the user. */
+    size_t max_size;
+
+    /** Size currently used on the wire. */
+    size_t current_size;
+
+    /** Largest size needed by a value in the current sample window. */
+    size_t window_size;
+  };
+
+  /** Computes the size that the field's current value needs. */
+  static size_t needed_size(const Field& f);
+
+  /** Returns the template for the current field sizes, creating it
+   * if needed. */
+  const libfc::PlacementTemplate* make_variant();
+
+  std::vector<Field> fields;
+  unsigned int sample_size;
+  unsigned int n_sampled;
+
+  /** The number of variants after which fields are no longer
+   * narrowed. */
+  static const size_t max_variants = 16;
+
+  /** All variants created so far, indexed by field sizes. */
+  std::map<std::vector<size_t>, libfc::PlacementTemplate*> variants;
+
+  /** Variant for the current field sizes. */
+  const libfc::PlacementTemplate* current;
+};
+
+ReducedLengthEncoder::ReducedLengthEncoder(
+    const libfc::PlacementTemplate* placement_template,
+    unsigned int _sample_size)
+  : sample_size(_sample_size),
+    n_sampled(0),
+    current(0) {
+  for (auto ie = placement_template->begin();
+       ie != placement_template->end();
+       ++ie) {
+    Field f;
+    size_t size;
+
+    bool ie_present
+      = placement_template->lookup_placement(*ie, &f.address, &size);
+    assert(ie_present);
+
+    f.ie = *ie;
+    f.type = Field::fixed;
+    f.native_size = size;
+    f.max_size = size;
+
+    switch ((*ie)->ietype()->number()) {
+    case libfc::IEType::kUnsigned16:
+      f.type = Field::unsigned_integer;
+      f.native_size = sizeof(uint16_t);
+      break;
+    case libfc::IEType::kUnsigned32:
+      f.type = Field::unsigned_integer;
+      f.native_size = sizeof(uint32_t);
+      break;
+    case libfc::IEType::kUnsigned64:
+      f.type = Field::unsigned_integer;
+      f.native_size = sizeof(uint64_t);
+      break;
+    case libfc::IEType::kFloat64:
+      if (size == sizeof(double)) {
+        f.type = Field::float64;
+        f.native_size = sizeof(double);
+      }
+      break;
+    default:
+      break;
+    }
+
+    /* Start with the registered sizes; values are sampled before
+     * anything is narrowed. */
+    f.current_size = f.max_size;
+    f.window_size = 0;
+    fields.push_back(f);
+  }
+
+  current = make_variant();
+}
+
+ReducedLengthEncoder::~ReducedLengthEncoder() {
+  for (auto i = variants.begin(); i != variants.end(); ++i)
+    delete i->second;
+}
+
+size_t ReducedLengthEncoder::needed_size(const Field& f) {
+  switch (f.type) {
+  case Field::unsigned_integer:
+    {
+      uint64_t v = 0;
+      switch (f.native_size) {
+      case sizeof(uint16_t): v = *static_cast<const uint16_t*>(f.address); break;
+      case sizeof(uint32_t): v = *static_cast<const uint32_t*>(f.address); break;
+      case sizeof(uint64_t): v = *static_cast<const uint64_t*>(f.address); break;
+      }
+      if (v <= UINT8_MAX)
+        return sizeof(uint8_t);
+      else if (v <= UINT16_MAX)
+        return sizeof(uint16_t);
+      else if (v <= UINT32_MAX)
+        return sizeof(uint32_t);
+      else
+        return sizeof(uint64_t);
+    }
+
+  case Field::float64:
+    {
+      double d = *static_cast<const double*>(f.address);
+      /* NaN never compares equal, but survives the conversion. */
+      if (d != d || static_cast<double>(static_cast<float>(d)) == d)
+        return sizeof(float);
+      else
+        return sizeof(double);
+    }
+
+  case Field::fixed:
+    break;
+  }
+  return f.max_size;
+}
+
+const libfc::PlacementTemplate* ReducedLengthEncoder::select() {
+  bool changed = false;
+
+  for (auto f = fields.begin(); f != fields.end(); ++f) {
+    if (f->type == Field::fixed)
+      continue;
+
+    size_t needed = std::min(needed_size(*f), f->max_size);
+    if (needed > f->window_size)
+      f->window_size = needed;
+    if (needed > f->current_size) {
+      f->current_size = needed;
+      changed = true;
+    }
+  }
+
+  if (++n_sampled == sample_size) {
+    bool may_narrow = variants.size() < max_variants;
+    for (auto f = fields.begin(); f != fields.end(); ++f) {
+      if (may_narrow && f->type != Field::fixed
+          && f->window_size < f->current_size) {
+        f->current_size = f->window_size;
+        changed = true;
+      }
+      f->window_size = 0;
+    }
+    n_sampled = 0;
+  }
+
+  if (changed)
+    current = make_variant();
+  return current;
+}
+
+const libfc::PlacementTemplate* ReducedLengthEncoder::make_variant() {
+  std::vector<size_t> sizes;
+  for (auto f = fields.begin(); f != fields.end(); ++f)
+    sizes.push_back(f->current_size);
+
+  auto v = variants.find(sizes);
+  if (v != variants.end())
+    return v->second;
+
+  libfc::PlacementTemplate* variant = new libfc::PlacementTemplate();
+  for (auto f = fields.begin(); f != fields.end(); ++f)
+    variant->register_placement(f->ie, f->address, f->current_size);
+
+  variants[sizes] = variant;
+  return variant;
+}
+
 
 namespace libfc {
 
@@ -637,14 +884,32 @@ namespace libfc {
 
   PlacementExporter::PlacementExporter(ExportDestination& _os,
                                        uint32_t _observation_domain)
+    : PlacementExporter(_os, _observation_domain, 0) {
+  }
+
+  PlacementExporter::PlacementExporter(
+      ExportDestination& _os,
+      uint32_t _observation_domain,
+      ConcurrentPlacementExporter* _shared)
     : os(_os),
       current_template(0),
       current_template_id(255),
       sequence_number(0),
+      protocol_version(kIpfixVersion),
+      message_header_len(kIpfixMessageHeaderLen),
+      export_time(0),
+      first_export_time(0),
+      n_message_records(0),
+      template_refresh_interval(0),
+      messages_since_refresh(0),
       observation_domain(_observation_domain), 
       n_message_octets(kIpfixMessageHeaderLen),
       template_set_size(0),
-      plan(0)
+      plan(0),
+      shared(_shared),
+      reduced_length_sample_size(0),
+      last_reduced_template(0),
+      last_reduced_encoder(0)
 #if defined(_libfc_HAVE_LOG4CPLUS_)
     , logger(log4cplus::Logger::getInstance(LOG4CPLUS_TEXT("PlacementExporter")))
 #endif /* defined(_libfc_HAVE_LOG4CPLUS_) */
@@ -664,6 +929,11 @@ namespace libfc {
 
     delete plan;
 
+    for (auto i = reduced_length_encoders.begin();
+         i != reduced_length_encoders.end();
+         ++i)
+      delete i->second;
+
     for (auto i = iovecs.begin(); i != iovecs.end(); ++i)
       delete[] static_cast<uint8_t*>(i->iov_base);
   }
@@ -724,37 +994,51 @@ namespace libfc {
     ssize_t ret = 0;
 
     /* Only write something if we have anything nontrivial to write. */
-    if (n_message_octets > kIpfixMessageHeaderLen) {
+    if (n_message_octets > message_header_len) {
       /** This message header.
        *
        * This variable is dynamically allocated so as to facilitate
        * its deletion later as part of the iovecs vector. */
-      uint8_t* message_header = new uint8_t[kIpfixMessageHeaderLen];
+      uint8_t* message_header = new uint8_t[message_header_len];
       
       /** Points to the end of this message.
        *
        * Used for range checks. */
-      const uint8_t* message_end = message_header + kIpfixMessageHeaderLen;
+      const uint8_t* message_end = message_header + message_header_len;
       
       /** Moves through the message header. */
       uint8_t* p = message_header;
       
-      time_t now = time(0);
-      if (now == static_cast<time_t>(-1))
+      time_t now = export_time;
+      if (now == 0)
+        now = time(0);
+      if (now == static_cast<time_t>(-1)) {
+        delete[] message_header;
         return false;
+      }
+      if (first_export_time == 0)
+        first_export_time = static_cast<uint32_t>(now);
       
       /* Message header */
-      encode16(kIpfixVersion, &p, message_end);
-      encode16(static_cast<uint16_t>(n_message_octets), &p, message_end);
+      encode16(protocol_version, &p, message_end);
+      if (protocol_version == kV9Version) {
+        /* V9 has a record count instead of a length, and the system
+         * uptime in milliseconds before the export time.  We take
+         * the first export as the system's boot time. */
+        encode16(n_message_records, &p, message_end);
+        encode32(static_cast<uint32_t>(now - first_export_time) * 1000,
+                 &p, message_end);
+      } else
+        encode16(static_cast<uint16_t>(n_message_octets), &p, message_end);
       encode32(static_cast<uint32_t>(now), &p, message_end);
       encode32(sequence_number++, &p, message_end);
       encode32(observation_domain, &p, message_end);
       
       iovecs[message_header_index].iov_base = message_header;
-      iovecs[message_header_index].iov_len = kIpfixMessageHeaderLen;
+      iovecs[message_header_index].iov_len = message_header_len;
       
       LOG4CPLUS_TRACE(logger, "writing message with "
-                      << "version=" << kIpfixVersion
+                      << "version=" << protocol_version
                       << ", length=" << n_message_octets
                       << ", export-time=" << make_time(now)
                       << ", sequence=" << (sequence_number - 1)
@@ -771,7 +1055,8 @@ namespace libfc {
           = static_cast<uint8_t*>(iovecs[template_set_index].iov_base);
         const uint8_t* buf_end = buf + template_set_size;
 
-        encode16(2, &buf, buf_end);
+        encode16(protocol_version == kV9Version ? kV9TemplateSetID : 2,
+                 &buf, buf_end);
         encode16(template_set_size, &buf, buf_end);
 
         for (auto t = new_templates.begin(); t != new_templates.end(); ++t) {
@@ -810,14 +1095,84 @@ namespace libfc {
       iovecs[template_set_index].iov_base = 0;
       iovecs[template_set_index].iov_len = 0;
       
-      n_message_octets = kIpfixMessageHeaderLen;
+      n_message_octets = message_header_len;
+      n_message_records = 0;
+
+      /* Forget all templates every so often, so that they are sent
+       * again with their next data record. */
+      if (template_refresh_interval != 0
+          && ++messages_since_refresh >= template_refresh_interval) {
+        used_templates.clear();
+        messages_since_refresh = 0;
+      }
+
+      /* There is no open data set any more, so the next record must
+       * start a new one, even if it has the same template. */
+      current_template = 0;
     }
     return ret;
   }
 
+  void PlacementExporter::set_reduced_length_encoding(
+      unsigned int sample_size) {
+    reduced_length_sample_size = sample_size;
+  }
+
+  void PlacementExporter::set_protocol_version(uint16_t version) {
+    if (version != kIpfixVersion && version != kV9Version)
+      report_error("Can't export message version %u", version);
+    if (shared != 0 && version != kIpfixVersion)
+      report_error("Concurrent export supports IPFIX only");
+    if (sequence_number != 0 || n_message_octets != message_header_len)
+      report_error("Can't change message version after records are placed");
+
+    protocol_version = version;
+    message_header_len = version == kV9Version
+      ? kV9MessageHeaderLen : kIpfixMessageHeaderLen;
+    n_message_octets = message_header_len;
+  }
+
+  void PlacementExporter::set_export_time(uint32_t _export_time) {
+    export_time = _export_time;
+  }
+
+  void PlacementExporter::set_template_refresh(unsigned int n_messages) {
+    template_refresh_interval = n_messages;
+    messages_since_refresh = 0;
+  }
+
+  /** Checks that a template can be sent in a v9 export packet. */
+  static void check_v9_template(const PlacementTemplate* tmpl) {
+    for (auto i = tmpl->begin(); i != tmpl->end(); ++i) {
+      void* p = 0;
+      size_t size = 0;
+      tmpl->lookup_placement(*i, &p, &size);
+      if (size == kIpfixVarlen)
+        report_error("Netflow v9 can't export varlen IE %s",
+                     (*i)->toIESpec().c_str());
+      if ((*i)->pen() != 0)
+        report_error("Netflow v9 can't export enterprise-specific IE %s",
+                     (*i)->toIESpec().c_str());
+    }
+  }
+
   void PlacementExporter::place_values(const PlacementTemplate* tmpl) {
     LOG4CPLUS_TRACE(logger, "ENTER place_values");
 
+    if (reduced_length_sample_size != 0) {
+      if (tmpl != last_reduced_template) {
+        ReducedLengthEncoder*& encoder = reduced_length_encoders[tmpl];
+        if (encoder == 0)
+          encoder = new ReducedLengthEncoder(tmpl,
+                                             reduced_length_sample_size);
+        last_reduced_template = tmpl;
+        last_reduced_encoder = encoder;
+      }
+      /* From here on, the record is placed with the variant that has
+       * the right field sizes for the current values. */
+      tmpl = last_reduced_encoder->select();
+    }
+
     assert(n_message_octets <= kMaxMessageLen);
 
     /** The number of bytes added to the current message as a result
@@ -849,6 +1204,12 @@ namespace libfc {
         LOG4CPLUS_TRACE(logger, "template not known, inserting");
         unknown_template = tmpl;
 
+        if (protocol_version == kV9Version)
+          check_v9_template(tmpl);
+        if (shared == 0 && tmpl->get_template_id() == 0
+            && current_template_id == UINT16_MAX)
+          report_error("No template IDs left for another template");
+
         /* Need to create template set? */
         if (template_set_size == 0) {
           template_set_size += kIpfixSetHeaderLen;
@@ -859,10 +1220,16 @@ namespace libfc {
 
         /* Need to add a new template to the template record section */
         size_t template_bytes = 0;
-        tmpl->wire_template(++current_template_id, 0, &template_bytes);
+        if (shared != 0)
+          shared->assign_template_id(tmpl, &template_bytes);
+        else if (tmpl->get_template_id() != 0)
+          tmpl->wire_template(0, 0, &template_bytes); /* Re-sent */
+        else
+          tmpl->wire_template(++current_template_id, 0, &template_bytes);
         new_bytes += template_bytes;
         template_set_size += template_bytes;
         new_templates.insert(tmpl);
+        n_message_records++;
 
         LOG4CPLUS_TRACE(logger, "computed wire template, now "
                         << new_bytes << " new bytes");
@@ -884,8 +1251,17 @@ namespace libfc {
 
     size_t prospective_data_set_header
       = make_new_data_set ? kIpfixSetHeaderLen : 0;
+
+    /* V9 packets have no length field.  Collectors find the end of a
+     * packet by peeking at what follows its last set, so leave room
+     * for that in a maximum-sized buffer. */
+    size_t max_message_len = os.preferred_maximum_message_size();
+    if (protocol_version == kV9Version
+        && max_message_len > kMaxMessageLen - kV9SetHeaderLen)
+      max_message_len = kMaxMessageLen - kV9SetHeaderLen;
+
     if (n_message_octets + new_bytes + prospective_data_set_header
-        > os.preferred_maximum_message_size()) {
+        > max_message_len) {
       LOG4CPLUS_TRACE(logger,
                       "Flushing because n_message_octets ("
                       << n_message_octets
@@ -918,6 +1294,7 @@ namespace libfc {
 
     if (unknown_template != 0)
       used_templates.insert(unknown_template);
+    n_message_records++;
 
     iovec& l = iovecs.back();
     assert(l.iov_base != 0);
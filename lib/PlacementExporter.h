@@ -35,6 +35,7 @@
 
 #  include <cstdint>
 #  include <list>
+#  include <map>
 #  include <set>
 #  include <vector>
 
@@ -49,9 +50,12 @@
 #  include "PlacementTemplate.h"
 
 class EncodePlan;
+class ReducedLengthEncoder;
 
 namespace libfc {
 
+  class ConcurrentPlacementExporter;
+
   /** Interface for exporter with the placement interface.
    *
    * A simple example of how to use the placement interface for export
@@ -112,10 +116,91 @@ namespace libfc {
     /** Place values in a PlacementTemplate into the message. 
      *
      * @param template placement template for current placement
+     *
+     * @throw ExportError if the template is new and all template IDs
+     *   are taken
      */
     void place_values(const PlacementTemplate* tmpl);
 
+    /** Turns reduced-length encoding on or off.
+     *
+     * With reduced-length encoding, the exporter samples the values
+     * of unsigned integer and float64 fields and sends them with
+     * fewer octets whenever they fit (see RFC 5101, Section 6.2).
+     * For example, a uint64_t octet counter whose values all fit
+     * into 32 bits will be sent as a 4-octet field.  When a value no
+     * longer fits, the field is widened immediately; it is narrowed
+     * again only if all values of a full sample window fit.  Every
+     * new combination of field sizes is announced with a new
+     * template, so this mode trades a few extra template records for
+     * smaller data records.  The number of these templates is
+     * bounded: after a few combinations, fields are only widened.
+     *
+     * This only affects templates placed after the call.
+     *
+     * @param sample_size the number of records per template after
+     *   which narrower sizes are considered, or 0 to turn
+     *   reduced-length encoding off
+     */
+    void set_reduced_length_encoding(unsigned int sample_size);
+
+    /** Selects the message format.
+     *
+     * By default, the exporter writes IPFIX messages.  With version
+     * 9, it writes Netflow v9 export packets instead (see RFC 3954):
+     * a 20-octet packet header with a record count and system
+     * uptime, and template sets with set ID 0.  Netflow v9 has no
+     * varlen encoding and no enterprise-specific IEs, so placing a
+     * template containing either will throw an ExportError.
+     *
+     * This must be called before the first record is placed.
+     *
+     * @param version kIpfixVersion or kV9Version
+     *
+     * @throw ExportError if the version is not supported or records
+     *   have already been placed
+     */
+    void set_protocol_version(uint16_t version);
+
+    /** Uses a fixed export time instead of the current time.
+     *
+     * This is useful to produce byte-identical output from identical
+     * input, for example for benchmark workloads.  The time applies
+     * to all messages written after the call.
+     *
+     * @param export_time the export time in seconds since the epoch,
+     *   or 0 to use the current time again
+     */
+    void set_export_time(uint32_t export_time);
+
+    /** Re-sends templates periodically.
+     *
+     * Normally, a template is sent only once per session, before its
+     * first data record.  With template refresh, all templates are
+     * forgotten after every n messages, so that each of them is sent
+     * again in the message in which it is next used, as collectors
+     * over connectionless transports expect.
+     *
+     * @param n_messages the number of messages after which templates
+     *   are re-sent, or 0 to turn template refresh off
+     */
+    void set_template_refresh(unsigned int n_messages);
+
   private:
+    friend class ConcurrentPlacementExporter;
+
+    /** Creates an exporter that is one of several producers of a
+     * ConcurrentPlacementExporter.
+     *
+     * Template IDs are then assigned by the concurrent exporter
+     * instead of by this exporter.
+     *
+     * @param os the output stream to use
+     * @param observation_domain the observation domain; see RFC5101
+     * @param shared the concurrent exporter this exporter belongs to
+     */
+    PlacementExporter(ExportDestination& os, uint32_t observation_domain,
+                      ConcurrentPlacementExporter* shared);
 
     ExportDestination& os;
     /* The expression of cont-ness for the PlacementTemplates pointed
@@ -156,6 +241,28 @@ namespace libfc {
     /** Sequence number for messages; see RFC 5101. */
     uint32_t sequence_number;
 
+    /** Message version number, either kIpfixVersion or kV9Version. */
+    uint16_t protocol_version;
+
+    /** Size of the message header for protocol_version. */
+    size_t message_header_len;
+
+    /** Fixed export time, or 0 if the current time is used. */
+    uint32_t export_time;
+
+    /** Export time of the first message, for the v9 system uptime. */
+    uint32_t first_export_time;
+
+    /** Number of template and data records in this message.  Only
+     * needed for the v9 packet header. */
+    uint16_t n_message_records;
+
+    /** Number of messages after which templates are re-sent, or 0. */
+    unsigned int template_refresh_interval;
+
+    /** Number of messages written since templates were last sent. */
+    unsigned int messages_since_refresh;
+
     /** Observation domain for messages; see RFC 5101.
      *
      * For the moment, we support only one observation domain. This
@@ -178,6 +285,21 @@ namespace libfc {
 
     EncodePlan* plan;
 
+    /** The concurrent exporter this exporter is a producer for, or 0. */
+    ConcurrentPlacementExporter* shared;
+
+    /** Sample size for reduced-length encoding, or 0 if off. */
+    unsigned int reduced_length_sample_size;
+
+    /** Reduced-length encoders, one per placement template. */
+    std::map<const PlacementTemplate*, ReducedLengthEncoder*>
+      reduced_length_encoders;
+
+    /** Most recently used entry in reduced_length_encoders, so that
+     * runs of records with the same template avoid the map lookup. */
+    const PlacementTemplate* last_reduced_template;
+    ReducedLengthEncoder* last_reduced_encoder;
+
 #  if defined(_libfc_HAVE_LOG4CPLUS_)
     log4cplus::Logger logger;
 #  endif /* defined(_libfc_HAVE_LOG4CPLUS_) */
@@ -66,7 +66,10 @@ namespace libfc {
     : buf(0), 
       size(0),
       fixlen_data_record_size(0),
-      template_id(0)
+      template_id(0),
+      record_filter(0),
+      deduplicator(0),
+      options_join(0)
 #if defined(_libfc_HAVE_LOG4CPLUS_)
     , logger(log4cplus::Logger::getInstance(LOG4CPLUS_TEXT("PlacementTemplate")))
 #endif /* defined(_libfc_HAVE_LOG4CPLUS_) */
@@ -75,6 +78,7 @@ namespace libfc {
 
   PlacementTemplate::~PlacementTemplate() {
     delete[] buf;
+    delete record_filter;
   }
 
   bool PlacementTemplate::register_placement(const InfoElement* ie,
@@ -183,15 +187,19 @@ namespace libfc {
       /* Use IES, not PLACEMENTS for iteration, because now, sequence
        * matters. */
       for (auto i = ies.begin(); i != ies.end(); ++i) {
+        /* Use the registered size, not the IE's default size, so
+         * that reduced-length encoding shows up on the wire. */
+        size_t size_on_wire = placements.find(*i)->second->size_on_wire;
+
         LOG4CPLUS_TRACE(logger,
                         "  wire template for (" << (*i)->pen()
                         << "/" << (*i)->number()
-                        << ")[" << (*i)->len() << "]");
+                        << ")[" << size_on_wire << "]");
 
         uint32_t ie_pen = htonl((*i)->pen());
         uint16_t ie_id = htons((*i)->number()
                                | (ie_pen == 0 ? 0 : (1 << 15)));
-        uint16_t ie_len = htons((*i)->len());
+        uint16_t ie_len = htons(static_cast<uint16_t>(size_on_wire));
         assert(p + sizeof(ie_id) <= buf + size);
         memcpy(p, &ie_id, sizeof ie_id); p += sizeof ie_id;
         assert(p + sizeof(ie_len) <= buf + size);
@@ -234,6 +242,32 @@ namespace libfc {
     return template_id;
   }
 
+  RecordFilter& PlacementTemplate::filter() {
+    if (record_filter == 0)
+      record_filter = new RecordFilter();
+    return *record_filter;
+  }
+
+  const RecordFilter* PlacementTemplate::get_filter() const {
+    return record_filter;
+  }
+
+  void PlacementTemplate::set_deduplicator(RecordDeduplicator* dedup) {
+    deduplicator = dedup;
+  }
+
+  RecordDeduplicator* PlacementTemplate::get_deduplicator() const {
+    return deduplicator;
+  }
+
+  void PlacementTemplate::set_options_join(OptionsJoin* join) {
+    options_join = join;
+  }
+
+  OptionsJoin* PlacementTemplate::get_options_join() const {
+    return options_join;
+  }
+
   std::list<const InfoElement*>::const_iterator 
   PlacementTemplate::begin() const {
     return ies.begin();
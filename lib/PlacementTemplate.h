@@ -43,6 +43,9 @@
 
 #  include "InfoElement.h"
 #  include "IETemplate.h"
+#  include "OptionsJoin.h"
+#  include "RecordDeduplicator.h"
+#  include "RecordFilter.h"
 
 namespace libfc {
 
@@ -352,6 +355,57 @@ namespace libfc {
      */
     uint16_t get_template_id() const;
 
+    /** Returns this template's record filter, creating it if needed.
+     *
+     * Predicates added to the filter restrict which records are
+     * decoded into this template's placements when collecting; see
+     * RecordFilter.  Filters have no effect on export.
+     *
+     * @return this template's record filter
+     */
+    RecordFilter& filter();
+
+    /** Returns this template's record filter.
+     *
+     * @return the filter, or 0 if this template has no filter
+     */
+    const RecordFilter* get_filter() const;
+
+    /** Sets this template's record deduplicator.
+     *
+     * When collecting, records that the deduplicator finds to be
+     * duplicates are not decoded into this template's placements;
+     * see RecordDeduplicator.  The deduplicator is not owned by this
+     * template and may be shared with other templates.
+     * Deduplicators have no effect on export.
+     *
+     * @param dedup the deduplicator, or 0 for none
+     */
+    void set_deduplicator(RecordDeduplicator* dedup);
+
+    /** Returns this template's record deduplicator.
+     *
+     * @return the deduplicator, or 0 if this template has none
+     */
+    RecordDeduplicator* get_deduplicator() const;
+
+    /** Sets this template's options join.
+     *
+     * When collecting, the join places options values and normalizes
+     * counters after each record has been decoded into this
+     * template's placements; see OptionsJoin.  The join is not owned
+     * by this template.  Joins have no effect on export.
+     *
+     * @param join the join, or 0 for none
+     */
+    void set_options_join(OptionsJoin* join);
+
+    /** Returns this template's options join.
+     *
+     * @return the join, or 0 if this template has none
+     */
+    OptionsJoin* get_options_join() const;
+
     /** Returns an iterator over the InfoElements in this template.
      *
      * @return an iterator pointing to the first information element.
@@ -386,6 +440,15 @@ namespace libfc {
     /** The template ID for the wire representation of this template. */
     mutable uint16_t template_id;
 
+    /** Record filter, or 0 if there is none. */
+    RecordFilter* record_filter;
+
+    /** Record deduplicator, or 0 if there is none. */
+    RecordDeduplicator* deduplicator;
+
+    /** Options join, or 0 if there is none. */
+    OptionsJoin* options_join;
+
 #  if defined(_libfc_HAVE_LOG4CPLUS_)
     log4cplus::Logger logger;
 #  endif /* defined(_libfc_HAVE_LOG4CPLUS_) */
@@ -0,0 +1,160 @@
+/* Copyright (c) 2011-2014 ETH Zürich. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ *    * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *    * Neither the names of ETH Zürich nor the names of other contributors 
+ *      may be used to endorse or promote products derived from this software 
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL ETH 
+ * ZURICH BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, 
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, 
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR 
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY 
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <limits>
+
+#include "RecordDeduplicator.h"
+
+namespace libfc {
+
+  RecordDeduplicator::RecordDeduplicator(uint64_t window,
+                                         size_t max_records,
+                                         unsigned int n_generations)
+    : window(window),
+      n_generations(n_generations),
+      capacity(16),
+      current(0),
+      current_start(std::numeric_limits<uint64_t>::max()),
+      current_load(0) {
+    assert(n_generations >= 2);
+    assert(max_records > 0);
+
+    /* Any fingerprint stays for at least n_generations - 1 full
+     * generations, so these together must cover the window. */
+    generation_span = (window + n_generations - 2) / (n_generations - 1);
+    if (generation_span == 0)
+      generation_span = 1;
+
+    size_t per_generation
+      = (max_records + n_generations - 2) / (n_generations - 1);
+    while (capacity < 2*per_generation)
+      capacity *= 2;
+    max_load = capacity / 2;
+
+    sets.assign(n_generations*capacity, 0);
+  }
+
+  void RecordDeduplicator::add_key(const InfoElement* ie) {
+    keys.push_back(ie);
+  }
+
+  size_t RecordDeduplicator::get_key_count() const {
+    return keys.size();
+  }
+
+  bool RecordDeduplicator::check(uint64_t fingerprint) {
+    return check(fingerprint,
+                 std::chrono::duration_cast<std::chrono::milliseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+                 .count());
+  }
+
+  bool RecordDeduplicator::check(uint64_t fingerprint, uint64_t now) {
+    if (fingerprint == 0)
+      fingerprint = 1;
+
+    if (current_start == std::numeric_limits<uint64_t>::max())
+      current_start = now;
+    else if (now - current_start >= n_generations*generation_span) {
+      /* Everything is older than the window. */
+      std::fill(sets.begin(), sets.end(), 0);
+      current_start = now;
+      current_load = 0;
+    } else {
+      while (now - current_start >= generation_span)
+        rotate(current_start + generation_span);
+    }
+
+    size_t mask = capacity - 1;
+    for (unsigned int g = 0; g < n_generations; g++) {
+      const uint64_t* set = &sets[g*capacity];
+      for (size_t i = fingerprint & mask; set[i] != 0; i = (i + 1) & mask)
+        if (set[i] == fingerprint) {
+          hits.add(1);
+          return true;
+        }
+    }
+
+    uint64_t* set = &sets[current*capacity];
+    size_t i = fingerprint & mask;
+    while (set[i] != 0)
+      i = (i + 1) & mask;
+    set[i] = fingerprint;
+    misses.add(1);
+
+    if (++current_load >= max_load) {
+      overflows.add(1);
+      rotate(now);
+    }
+    return false;
+  }
+
+  void RecordDeduplicator::rotate(uint64_t now) {
+    current = (current + 1) % n_generations;
+    std::fill(sets.begin() + current*capacity,
+              sets.begin() + (current + 1)*capacity, 0);
+    current_start = now;
+    current_load = 0;
+  }
+
+  void RecordDeduplicator::clear() {
+    std::fill(sets.begin(), sets.end(), 0);
+    current_start = std::numeric_limits<uint64_t>::max();
+    current_load = 0;
+  }
+
+  uint64_t RecordDeduplicator::get_hits() const {
+    return hits.get();
+  }
+
+  uint64_t RecordDeduplicator::get_misses() const {
+    return misses.get();
+  }
+
+  uint64_t RecordDeduplicator::get_overflows() const {
+    return overflows.get();
+  }
+
+  void RecordDeduplicator::write_prometheus(std::ostream& os,
+                                            const std::string& prefix) const {
+    os << "# HELP " << prefix << "_dedup_hits_total"
+       << " Records suppressed as duplicates.\n"
+       << "# TYPE " << prefix << "_dedup_hits_total counter\n"
+       << prefix << "_dedup_hits_total " << get_hits() << "\n"
+       << "# HELP " << prefix << "_dedup_misses_total"
+       << " Records not seen before within the window.\n"
+       << "# TYPE " << prefix << "_dedup_misses_total counter\n"
+       << prefix << "_dedup_misses_total " << get_misses() << "\n"
+       << "# HELP " << prefix << "_dedup_overflows_total"
+       << " Generations rotated early because they were full.\n"
+       << "# TYPE " << prefix << "_dedup_overflows_total counter\n"
+       << prefix << "_dedup_overflows_total " << get_overflows() << "\n";
+  }
+
+} // namespace libfc
@@ -0,0 +1,204 @@
+/* Hi Emacs, please use -*- mode: C++; -*- */
+/* Copyright (c) 2011-2014 ETH Zürich. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ *    * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *    * Neither the names of ETH Zürich nor the names of other contributors 
+ *      may be used to endorse or promote products derived from this software 
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL ETH 
+ * ZURICH BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, 
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, 
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR 
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY 
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ * @author Stephan Neuhaus <neuhaust@tik.ee.ethz.ch>
+ */
+
+#ifndef _libfc_RECORDDEDUPLICATOR_H_
+#  define _libfc_RECORDDEDUPLICATOR_H_
+
+#  include <cstdint>
+#  include <ostream>
+#  include <string>
+#  include <vector>
+
+#  include "CollectorStatistics.h"
+#  include "InfoElement.h"
+
+namespace libfc {
+
+  /** Suppresses repeated records within a sliding time window.
+   *
+   * A deduplicator computes a 64-bit fingerprint from some of the
+   * IEs of each record and remembers the fingerprints it has seen.
+   * When a placement template has a deduplicator (see
+   * PlacementTemplate::set_deduplicator()), records whose
+   * fingerprint was seen within the window are neither decoded nor
+   * passed to the collector's callbacks.  This removes the copies of
+   * records that arrive from both exporters of a redundant pair, or
+   * in duplicated datagrams.
+   *
+   * The IEs to fingerprint are given with add_key(); they should
+   * identify a record, for example the 5-tuple, the flow start time
+   * and the counters.  Without keys, the fingerprint covers the
+   * entire record.  Integers are fingerprinted by value, so that the
+   * same record sent with different reduced-length encodings is still
+   * recognized; IEs that are missing from a wire template are left
+   * out.  Fingerprints are computed from the raw records, so they
+   * don't depend on the observation domain or template ID, and one
+   * deduplicator can serve several placement templates.
+   *
+   * Fingerprints are kept in a small number of generations, each an
+   * open-addressing hash set covering a fraction of the window.  When
+   * a generation has covered its time span, the oldest generation is
+   * cleared and reused.  Memory is bounded by max_records: when a
+   * generation fills up before its time is over, it is rotated early,
+   * which shortens the effective window instead of growing the sets;
+   * such rotations are counted as overflows.
+   *
+   * A deduplicator must only be used by one collector thread.  The
+   * counters may be read from any thread.
+   *
+   * @code
+   * RecordDeduplicator dedup(10000);
+   * dedup.add_key(model.lookupIE("sourceIPv4Address"));
+   * dedup.add_key(model.lookupIE("destinationIPv4Address"));
+   * dedup.add_key(model.lookupIE("flowStartMilliseconds"));
+   * dedup.add_key(model.lookupIE("octetDeltaCount"));
+   *
+   * my_flow_template->set_deduplicator(&dedup);
+   * @endcode
+   */
+  class RecordDeduplicator {
+  public:
+    /** Creates a deduplicator.
+     *
+     * @param window how long a fingerprint is remembered, in
+     *   milliseconds
+     * @param max_records the largest number of fingerprints that
+     *   must fit into one window
+     * @param n_generations the number of generations; more
+     *   generations make the window slide more smoothly, but cost a
+     *   lookup each
+     */
+    explicit RecordDeduplicator(uint64_t window,
+                                size_t max_records = default_max_records,
+                                unsigned int n_generations = 4);
+
+    /** Adds an IE to the fingerprint.
+     *
+     * @param ie the information element
+     */
+    void add_key(const InfoElement* ie);
+
+    /** Returns the number of keys.  Since keys can only be added,
+     * this also tells whether the keys have changed.
+     *
+     * @return the number of keys
+     */
+    size_t get_key_count() const;
+
+    /** Tells whether a fingerprint was seen within the window, and
+     * remembers it if it wasn't.
+     *
+     * The time is taken from a monotonic clock.
+     *
+     * @param fingerprint the fingerprint of a record
+     *
+     * @return true if the record is a duplicate
+     */
+    bool check(uint64_t fingerprint);
+
+    /** Tells whether a fingerprint was seen within the window at a
+     * given time, and remembers it if it wasn't.
+     *
+     * @param fingerprint the fingerprint of a record
+     * @param now the current time in milliseconds; must not decrease
+     *   from call to call
+     *
+     * @return true if the record is a duplicate
+     */
+    bool check(uint64_t fingerprint, uint64_t now);
+
+    /** Forgets all fingerprints.  The counters are kept. */
+    void clear();
+
+    /** Returns the number of records found to be duplicates.
+     *
+     * @return the number of duplicates
+     */
+    uint64_t get_hits() const;
+
+    /** Returns the number of records not found to be duplicates.
+     *
+     * @return the number of records let through
+     */
+    uint64_t get_misses() const;
+
+    /** Returns the number of generations that were rotated early
+     * because they were full.
+     *
+     * @return the number of early rotations
+     */
+    uint64_t get_overflows() const;
+
+    /** Writes the counters in the Prometheus text exposition format.
+     *
+     * @param os the stream to write to
+     * @param prefix the prefix of all metric names
+     */
+    void write_prometheus(std::ostream& os,
+                          const std::string& prefix = "libfc") const;
+
+    static const size_t default_max_records = 1 << 20;
+
+  private:
+    friend class DeduplicationPlan;
+
+    void rotate(uint64_t now);
+
+    std::vector<const InfoElement*> keys;
+
+    uint64_t window;
+    unsigned int n_generations;
+
+    /** The time span of one generation. */
+    uint64_t generation_span;
+
+    /** The fingerprints of all generations, capacity slots each, 0
+     * for empty slots. */
+    std::vector<uint64_t> sets;
+    size_t capacity;
+
+    /** The number of fingerprints a generation may hold. */
+    size_t max_load;
+
+    /** The current generation, its start time and its load. */
+    unsigned int current;
+    uint64_t current_start;
+    size_t current_load;
+
+    StatisticsCounter hits;
+    StatisticsCounter misses;
+    StatisticsCounter overflows;
+  };
+
+} // namespace libfc
+
+#endif // _libfc_RECORDDEDUPLICATOR_H_
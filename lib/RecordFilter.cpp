@@ -0,0 +1,140 @@
+/* Copyright (c) 2011-2014 ETH Zürich. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ *    * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *    * Neither the names of ETH Zürich nor the names of other contributors 
+ *      may be used to endorse or promote products derived from this software 
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL ETH 
+ * ZURICH BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, 
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, 
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR 
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY 
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <cassert>
+
+#include "IEType.h"
+#include "RecordFilter.h"
+
+namespace libfc {
+
+  RecordFilter::RecordFilter() {
+  }
+
+  bool RecordFilter::add_comparison(const InfoElement* ie, comparison_t op,
+                                    uint64_t value) {
+    assert(ie != 0);
+
+    Predicate p;
+    p.ie = ie;
+    p.op = op;
+    p.value = value;
+    p.prefix_length = 0;
+
+    switch (ie->ietype()->number()) {
+    case IEType::kUnsigned8:
+    case IEType::kUnsigned16:
+    case IEType::kUnsigned32:
+    case IEType::kUnsigned64:
+    case IEType::kDateTimeSeconds:
+    case IEType::kDateTimeMilliseconds:
+    case IEType::kDateTimeMicroseconds:
+    case IEType::kDateTimeNanoseconds:
+    case IEType::kIpv4Address:
+      p.type = Predicate::compare_unsigned;
+      break;
+
+    case IEType::kSigned8:
+    case IEType::kSigned16:
+    case IEType::kSigned32:
+    case IEType::kSigned64:
+      p.type = Predicate::compare_signed;
+      break;
+
+    default:
+      return false;
+    }
+
+    predicates.push_back(p);
+    return true;
+  }
+
+  bool RecordFilter::add_prefix(const InfoElement* ie, const uint8_t* prefix,
+                                unsigned int prefix_length) {
+    assert(ie != 0);
+
+    size_t address_length;
+    switch (ie->ietype()->number()) {
+    case IEType::kIpv4Address: address_length = 4; break;
+    case IEType::kIpv6Address: address_length = 16; break;
+    default: return false;
+    }
+
+    if (prefix_length > 8*address_length)
+      return false;
+
+    Predicate p;
+    p.type = Predicate::prefix;
+    p.ie = ie;
+    p.op = eq;
+    p.value = 0;
+    p.address.assign(prefix, prefix + address_length);
+    p.prefix_length = prefix_length;
+
+    predicates.push_back(p);
+    return true;
+  }
+
+  bool RecordFilter::add_set(const InfoElement* ie,
+                             const std::set<uint64_t>& values) {
+    assert(ie != 0);
+
+    switch (ie->ietype()->number()) {
+    case IEType::kUnsigned8:
+    case IEType::kUnsigned16:
+    case IEType::kUnsigned32:
+    case IEType::kUnsigned64:
+      break;
+    default:
+      return false;
+    }
+
+    Predicate p;
+    p.type = Predicate::member;
+    p.ie = ie;
+    p.op = eq;
+    p.value = 0;
+    p.prefix_length = 0;
+    p.values.assign(values.begin(), values.end());
+
+    if (values.empty() || *values.rbegin() <= UINT16_MAX) {
+      p.bitmap.resize((UINT16_MAX + 1) / 64, 0);
+      for (auto v = values.begin(); v != values.end(); ++v)
+        p.bitmap[*v / 64] |= static_cast<uint64_t>(1) << (*v % 64);
+    }
+
+    predicates.push_back(p);
+    return true;
+  }
+
+  bool RecordFilter::empty() const {
+    return predicates.empty();
+  }
+
+  size_t RecordFilter::size() const {
+    return predicates.size();
+  }
+
+} // namespace libfc
@@ -0,0 +1,175 @@
+/* Hi Emacs, please use -*- mode: C++; -*- */
+/* Copyright (c) 2011-2014 ETH Zürich. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ *    * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *    * Neither the names of ETH Zürich nor the names of other contributors 
+ *      may be used to endorse or promote products derived from this software 
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL ETH 
+ * ZURICH BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, 
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, 
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR 
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY 
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ * @author Stephan Neuhaus <neuhaust@tik.ee.ethz.ch>
+ */
+
+#ifndef _libfc_RECORDFILTER_H_
+#  define _libfc_RECORDFILTER_H_
+
+#  include <cstdint>
+#  include <set>
+#  include <vector>
+
+#  include "InfoElement.h"
+
+namespace libfc {
+
+  /** Record-level predicates for a placement template.
+   *
+   * A record filter is a conjunction of simple predicates on the
+   * information elements of a data record.  When a placement template
+   * has a filter (see PlacementTemplate::filter()), only records that
+   * satisfy all predicates are decoded and passed to the collector's
+   * callbacks.  The predicates are evaluated on the raw record bytes,
+   * so rejected records cost no more than finding out where they end.
+   *
+   * The IEs used in predicates need not be registered as placements.
+   * If a predicate uses an IE that is not in the wire template, no
+   * record of that data set can satisfy the filter.
+   *
+   * @code
+   * PlacementTemplate* t = new PlacementTemplate();
+   * // register placements
+   *
+   * std::set<uint64_t> web_ports = { 80, 443 };
+   * uint8_t net[] = { 10, 0, 0, 0 };
+   *
+   * t->filter().add_set(model.lookupIE("destinationTransportPort"),
+   *                     web_ports);
+   * t->filter().add_prefix(model.lookupIE("sourceIPv4Address"), net, 8);
+   * t->filter().add_comparison(model.lookupIE("octetDeltaCount"),
+   *                            RecordFilter::ge, 1500);
+   * @endcode
+   */
+  class RecordFilter {
+  public:
+    /** Comparison operators. */
+    enum comparison_t { eq, ne, lt, le, gt, ge };
+
+    RecordFilter();
+
+    /** Adds a comparison between an IE and a constant.
+     *
+     * The IE must be of an integral type: unsigned or signed
+     * integers, dateTimeSeconds and friends, or ipv4Address (which is
+     * compared as an unsigned integer).  Values of signed types are
+     * compared as signed numbers.
+     *
+     * @param ie the information element
+     * @param op the comparison operator
+     * @param value the constant; for signed types, this is the two's
+     *   complement representation of the constant
+     *
+     * @return true if the predicate was added, false if the IE's
+     *   type doesn't support comparisons
+     */
+    bool add_comparison(const InfoElement* ie, comparison_t op,
+                        uint64_t value);
+
+    /** Adds a prefix match on an address.
+     *
+     * @param ie an information element of type ipv4Address or
+     *   ipv6Address
+     * @param prefix the prefix, in network byte order; must have 4
+     *   octets for IPv4 and 16 octets for IPv6 addresses
+     * @param prefix_length the prefix length in bits
+     *
+     * @return true if the predicate was added, false if the IE is not
+     *   an address or prefix_length is too long
+     */
+    bool add_prefix(const InfoElement* ie, const uint8_t* prefix,
+                    unsigned int prefix_length);
+
+    /** Adds a set membership test, useful for ports and protocols.
+     *
+     * @param ie an information element of an unsigned integer type
+     * @param values the set of accepted values
+     *
+     * @return true if the predicate was added, false if the IE is not
+     *   of an unsigned integer type
+     */
+    bool add_set(const InfoElement* ie, const std::set<uint64_t>& values);
+
+    /** Tells whether this filter has any predicates.
+     *
+     * @return true if there are no predicates
+     */
+    bool empty() const;
+
+    /** Returns the number of predicates.  Since predicates can only
+     * be added, this also tells whether the filter has changed.
+     *
+     * @return the number of predicates
+     */
+    size_t size() const;
+
+  private:
+    friend class FilterPlan;
+
+    struct Predicate {
+      /** The predicate type. */
+      enum predicate_type_t {
+        /** Compare an unsigned value with a constant. */
+        compare_unsigned,
+
+        /** Compare a signed value with a constant. */
+        compare_signed,
+
+        /** Match an address prefix. */
+        prefix,
+
+        /** Test for membership in a set of values. */
+        member,
+      } type;
+
+      const InfoElement* ie;
+
+      comparison_t op;
+      uint64_t value;
+
+      /** The prefix for prefix matches, in network byte order. */
+      std::vector<uint8_t> address;
+      unsigned int prefix_length;
+
+      /** Sorted values for membership tests. */
+      std::vector<uint64_t> values;
+
+      /** For membership tests where all values fit into 16 bits, a
+       * bitmap with one bit per value, so that port and protocol
+       * sets are a single lookup. */
+      std::vector<uint64_t> bitmap;
+    };
+
+    std::vector<Predicate> predicates;
+  };
+
+} // namespace libfc
+
+#endif // _libfc_RECORDFILTER_H_
@@ -0,0 +1,239 @@
+/* Copyright (c) 2011-2014 ETH Zürich. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ *    * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *    * Neither the names of ETH Zürich nor the names of other contributors 
+ *      may be used to endorse or promote products derived from this software 
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL ETH 
+ * ZURICH BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, 
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, 
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR 
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY 
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cassert>
+#include <cstring>
+
+#include "IEType.h"
+#include "RecordSketches.h"
+
+#include "exceptions/IESpecError.h"
+
+#include "hash_util.h"
+
+namespace libfc {
+
+  KeySketch::KeySketch(const std::vector<const InfoElement*>& key,
+                       size_t key_length, size_t top_k,
+                       unsigned int precision, size_t cm_width,
+                       unsigned int cm_depth)
+    : key(key),
+      key_length(key_length),
+      count_min(cm_width, cm_depth),
+      space_saving(top_k, key_length),
+      hyperloglog(precision) {
+  }
+
+  uint64_t KeySketch::estimate(const uint8_t* _key) const {
+    return count_min.estimate(sketch_hash(_key, key_length));
+  }
+
+  std::vector<SpaceSaving::Entry> KeySketch::top(size_t n) const {
+    return space_saving.top(n);
+  }
+
+  double KeySketch::distinct() const {
+    return hyperloglog.estimate();
+  }
+
+  uint64_t KeySketch::total() const {
+    return count_min.total();
+  }
+
+  const std::vector<const InfoElement*>& KeySketch::get_key() const {
+    return key;
+  }
+
+  size_t KeySketch::get_key_length() const {
+    return key_length;
+  }
+
+  KeySketch& KeySketch::operator+=(const KeySketch& rhs) {
+    assert(key == rhs.key);
+    count_min += rhs.count_min;
+    space_saving += rhs.space_saving;
+    hyperloglog += rhs.hyperloglog;
+    return *this;
+  }
+
+  void KeySketch::reset() {
+    count_min.reset();
+    space_saving.reset();
+    hyperloglog.reset();
+  }
+
+  RecordSketches::RecordSketches()
+    : frozen(false),
+      n_records(0) {
+  }
+
+  unsigned int RecordSketches::add_input(const InfoElement* ie,
+                                         size_t width) {
+    for (unsigned int i = 0; i < inputs.size(); ++i)
+      if (inputs[i].ie == ie)
+        return i;
+
+    Input in;
+    in.ie = ie;
+    in.width = width;
+    in.offset = 0;
+    inputs.push_back(in);
+    return inputs.size() - 1;
+  }
+
+  size_t RecordSketches::add_sketch(const std::vector<const InfoElement*>& key,
+                                    const InfoElement* weight,
+                                    size_t top_k,
+                                    unsigned int precision,
+                                    size_t cm_width,
+                                    unsigned int cm_depth) {
+    assert(!frozen);
+    assert(!key.empty());
+
+    Sketch s;
+    size_t key_length = 0;
+
+    for (auto ie = key.begin(); ie != key.end(); ++ie) {
+      /* Floats are placed, but equal values may differ in their
+       * bits, so they make poor keys. */
+      unsigned int type = (*ie)->ietype()->number();
+      size_t width = (*ie)->ietype()->placedWidth();
+      if (width == 0 || type == IEType::kFloat32 || type == IEType::kFloat64)
+        throw IESpecError("Can't sketch on IE " + (*ie)->toIESpec());
+
+      s.key_inputs.push_back(add_input(*ie, width));
+      key_length += width;
+    }
+
+    s.weight_input = -1;
+    if (weight != 0) {
+      switch (weight->ietype()->number()) {
+      case IEType::kUnsigned8:
+      case IEType::kUnsigned16:
+      case IEType::kUnsigned32:
+      case IEType::kUnsigned64:
+        break;
+      default:
+        throw IESpecError("Can't use IE " + weight->toIESpec()
+                          + " as weight");
+      }
+      s.weight_input = add_input(weight, weight->ietype()->placedWidth());
+    }
+
+    sketches.push_back(s);
+    key_sketches.push_back(KeySketch(key, key_length, top_k, precision,
+                                     cm_width, cm_depth));
+    if (key_length > key_buffer.size())
+      key_buffer.resize(key_length);
+    return sketches.size() - 1;
+  }
+
+  const PlacementTemplate* RecordSketches::get_input_template() {
+    freeze();
+    return &input_template;
+  }
+
+  void RecordSketches::freeze() {
+    if (frozen)
+      return;
+
+    size_t n = 0;
+    for (auto in = inputs.begin(); in != inputs.end(); ++in) {
+      in->offset = n*sizeof(uint64_t);
+      n += words(in->width);
+    }
+    input_buffer.assign(n, 0);
+    uint8_t* input = reinterpret_cast<uint8_t*>(input_buffer.data());
+    for (auto in = inputs.begin(); in != inputs.end(); ++in)
+      input_template.register_placement(in->ie, input + in->offset, 0);
+
+    frozen = true;
+  }
+
+  uint64_t RecordSketches::read_weight(const Input& in) const {
+    const uint8_t* p
+      = reinterpret_cast<const uint8_t*>(input_buffer.data()) + in.offset;
+    switch (in.width) {
+    case 1: return *p;
+    case 2: return *reinterpret_cast<const uint16_t*>(p);
+    case 4: return *reinterpret_cast<const uint32_t*>(p);
+    default: return *reinterpret_cast<const uint64_t*>(p);
+    }
+  }
+
+  void RecordSketches::add_record() {
+    freeze();
+
+    const uint8_t* input
+      = reinterpret_cast<const uint8_t*>(input_buffer.data());
+    for (size_t i = 0; i < sketches.size(); ++i) {
+      const Sketch& s = sketches[i];
+
+      /* A key made of a single IE is hashed in place. */
+      const uint8_t* key = input + inputs[s.key_inputs[0]].offset;
+      if (s.key_inputs.size() > 1) {
+        uint8_t* p = key_buffer.data();
+        for (auto k = s.key_inputs.begin(); k != s.key_inputs.end(); ++k) {
+          memcpy(p, input + inputs[*k].offset, inputs[*k].width);
+          p += inputs[*k].width;
+        }
+        key = key_buffer.data();
+      }
+
+      uint64_t weight = 1;
+      if (s.weight_input >= 0)
+        weight = read_weight(inputs[s.weight_input]);
+      key_sketches[i].add(key, weight);
+    }
+    n_records++;
+  }
+
+  size_t RecordSketches::get_sketch_count() const {
+    return key_sketches.size();
+  }
+
+  const KeySketch& RecordSketches::get_sketch(size_t index) const {
+    assert(index < key_sketches.size());
+    return key_sketches[index];
+  }
+
+  std::vector<KeySketch> RecordSketches::snapshot() const {
+    return key_sketches;
+  }
+
+  std::vector<KeySketch> RecordSketches::rotate() {
+    std::vector<KeySketch> ret(key_sketches);
+    for (auto s = key_sketches.begin(); s != key_sketches.end(); ++s)
+      s->reset();
+    n_records = 0;
+    return ret;
+  }
+
+  uint64_t RecordSketches::get_record_count() const {
+    return n_records;
+  }
+
+} // namespace libfc
@@ -0,0 +1,288 @@
+/* Hi Emacs, please use -*- mode: C++; -*- */
+/* Copyright (c) 2011-2014 ETH Zürich. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ *    * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *    * Neither the names of ETH Zürich nor the names of other contributors 
+ *      may be used to endorse or promote products derived from this software 
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL ETH 
+ * ZURICH BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, 
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, 
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR 
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY 
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ * @author Stephan Neuhaus <neuhaust@tik.ee.ethz.ch>
+ */
+
+#ifndef _libfc_RECORDSKETCHES_H_
+#  define _libfc_RECORDSKETCHES_H_
+
+#  include <cstdint>
+#  include <vector>
+
+#  include "InfoElement.h"
+#  include "PlacementTemplate.h"
+#  include "Sketches.h"
+
+namespace libfc {
+
+  /** Sketches of the keys of a stream of records.
+   *
+   * A key is the concatenation of the placed values of one or more
+   * IEs, in the order in which they were given, for example the
+   * sourceIPv4Address as a uint32_t in host byte order.  Each key is
+   * hashed once and then added to a Count-Min sketch, a SpaceSaving
+   * summary and a HyperLogLog sketch, which together answer
+   *
+   *   - how much weight a given key had (estimate()),
+   *   - which keys had the most weight (top()), and
+   *   - how many distinct keys there were (distinct()),
+   *
+   * in memory that does not depend on the number of records or keys.
+   */
+  class KeySketch {
+  public:
+    /** Creates a sketch.
+     *
+     * @param key the IEs that make up the key
+     * @param key_length the length of a key in octets
+     * @param top_k the number of keys in the SpaceSaving summary
+     * @param precision the precision of the HyperLogLog sketch
+     * @param cm_width the width of the Count-Min sketch
+     * @param cm_depth the depth of the Count-Min sketch
+     */
+    KeySketch(const std::vector<const InfoElement*>& key,
+              size_t key_length, size_t top_k, unsigned int precision,
+              size_t cm_width, unsigned int cm_depth);
+
+    /** Adds weight to a key.
+     *
+     * @param key the key, get_key_length() octets
+     * @param weight the weight to add
+     */
+    void add(const uint8_t* key, uint64_t weight) {
+      uint64_t hash = sketch_hash(key, key_length);
+      count_min.add(hash, weight);
+      space_saving.add(key, hash, weight);
+      hyperloglog.add(hash);
+    }
+
+    /** Returns the estimated weight of a key; never too small.
+     *
+     * @param key the key, get_key_length() octets
+     *
+     * @return the estimated weight
+     */
+    uint64_t estimate(const uint8_t* key) const;
+
+    /** Returns the keys with the most weight.
+     *
+     * @param n the number of keys to return
+     *
+     * @return up to n keys in decreasing order of weight
+     */
+    std::vector<SpaceSaving::Entry> top(size_t n) const;
+
+    /** Returns the estimated number of distinct keys.
+     *
+     * @return the estimated number of distinct keys
+     */
+    double distinct() const;
+
+    /** Returns the total weight added.
+     *
+     * @return the total weight added
+     */
+    uint64_t total() const;
+
+    /** Returns the IEs that make up the key.
+     *
+     * @return the IEs that make up the key
+     */
+    const std::vector<const InfoElement*>& get_key() const;
+
+    /** Returns the length of a key in octets.
+     *
+     * @return the length of a key in octets
+     */
+    size_t get_key_length() const;
+
+    /** Merges a sketch of the same keys, for example the sketch of
+     * the previous window, or that of another collector.
+     *
+     * @param rhs a sketch with the same key and parameters
+     *
+     * @return this sketch
+     */
+    KeySketch& operator+=(const KeySketch& rhs);
+
+    void reset();
+
+  private:
+    std::vector<const InfoElement*> key;
+    size_t key_length;
+    CountMinSketch count_min;
+    SpaceSaving space_saving;
+    HyperLogLog hyperloglog;
+  };
+
+  /** Maintains sketches over chosen IEs of collected records.
+   *
+   * Each sketch is configured with add_sketch(), giving the key IEs
+   * and optionally an unsigned IE such as octetDeltaCount whose value
+   * is the weight of a record; without one, every record has weight
+   * 1.  Like FlowAggregator, this class places the IEs it needs on an
+   * input template; register that template with a collector and call
+   * add_record() from end_placement():
+   *
+   * @code
+   * class MyCollector : public PlacementCollector {
+   * public:
+   *   MyCollector(RecordSketches& sketches)
+   *     : PlacementCollector(PlacementCollector::ipfix),
+   *       sketches(sketches) {
+   *     register_placement_template(sketches.get_input_template());
+   *   }
+   *
+   *   std::shared_ptr<ErrorContext>
+   *     end_placement(const PlacementTemplate* tmpl) {
+   *     sketches.add_record();
+   *     libfc_RETURN_OK();
+   *   }
+   *   ...
+   * };
+   * @endcode
+   *
+   * Since a placement template only matches data records that contain
+   * all of its IEs, all sketches of one instance see the same
+   * records.  Sketches over IEs that don't occur together, such as
+   * IPv4 and IPv6 addresses, need separate instances.
+   *
+   * For per-window statistics, call rotate() at the end of every
+   * window; it returns the sketches of the ending window and starts
+   * empty ones.  Sketches of consecutive windows, or of several
+   * collectors, can be merged with KeySketch::operator+=.
+   *
+   * The sketches must all be added before the first call to
+   * get_input_template() or add_record().
+   */
+  class RecordSketches {
+  public:
+    RecordSketches();
+
+    /** Adds a sketch.
+     *
+     * @param key the IEs that make up the key; they must have
+     *   fixed-length types
+     * @param weight an unsigned IE whose value is the weight of a
+     *   record, or 0 to count records
+     * @param top_k the number of keys in the top-k summary
+     * @param precision the precision of the distinct count; its
+     *   relative error is about 1.04/sqrt(2^precision)
+     * @param cm_width the width of the Count-Min sketch
+     * @param cm_depth the depth of the Count-Min sketch
+     *
+     * @return the index of the new sketch
+     *
+     * @throw IESpecError if an IE can't be used as key or weight
+     */
+    size_t add_sketch(const std::vector<const InfoElement*>& key,
+                      const InfoElement* weight = 0,
+                      size_t top_k = 64,
+                      unsigned int precision = 12,
+                      size_t cm_width = 4096,
+                      unsigned int cm_depth = 4);
+
+    /** Returns the template on which incoming records are placed.
+     *
+     * @return the input template
+     */
+    const PlacementTemplate* get_input_template();
+
+    /** Adds the record currently placed on the input template to all
+     * sketches. */
+    void add_record();
+
+    /** Returns the number of sketches.
+     *
+     * @return the number of sketches
+     */
+    size_t get_sketch_count() const;
+
+    /** Returns a sketch.
+     *
+     * @param index the index of the sketch, as returned by
+     *   add_sketch()
+     *
+     * @return the sketch
+     */
+    const KeySketch& get_sketch(size_t index) const;
+
+    /** Returns copies of all sketches.
+     *
+     * @return the sketches, in the order in which they were added
+     */
+    std::vector<KeySketch> snapshot() const;
+
+    /** Returns copies of all sketches and resets them.
+     *
+     * @return the sketches, in the order in which they were added
+     */
+    std::vector<KeySketch> rotate();
+
+    /** Returns the number of records added since the last rotate().
+     *
+     * @return the number of records
+     */
+    uint64_t get_record_count() const;
+
+  private:
+    /** An IE placed on the input template. */
+    struct Input {
+      const InfoElement* ie;
+      size_t width;
+      /** Offset of the placement in input_buffer. */
+      size_t offset;
+    };
+
+    struct Sketch {
+      std::vector<unsigned int> key_inputs;
+      /** The weight input, or -1 for none. */
+      int weight_input;
+    };
+
+    unsigned int add_input(const InfoElement* ie, size_t width);
+    void freeze();
+    uint64_t read_weight(const Input& in) const;
+
+    std::vector<Input> inputs;
+    std::vector<Sketch> sketches;
+    std::vector<KeySketch> key_sketches;
+
+    PlacementTemplate input_template;
+    std::vector<uint64_t> input_buffer;
+    bool frozen;
+
+    std::vector<uint8_t> key_buffer;
+    uint64_t n_records;
+  };
+
+} // namespace libfc
+
+#endif // _libfc_RECORDSKETCHES_H_
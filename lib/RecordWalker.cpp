@@ -0,0 +1,121 @@
+/* Copyright (c) 2011-2014 ETH Zürich. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ *    * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *    * Neither the names of ETH Zürich nor the names of other contributors 
+ *      may be used to endorse or promote products derived from this software 
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL ETH 
+ * ZURICH BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, 
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, 
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR 
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY 
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "Constants.h"
+#include "RecordWalker.h"
+
+#include "decode_util.h"
+
+namespace libfc {
+
+  RecordWalker::RecordWalker()
+    : min_length(0),
+      varlen(false) {
+  }
+
+  RecordWalker::RecordWalker(const IETemplate* wire_template)
+    : min_length(0),
+      varlen(false) {
+    for (auto ie = wire_template->begin(); ie != wire_template->end(); ++ie)
+      add_field((*ie)->len());
+  }
+
+  void RecordWalker::add_field(uint16_t length) {
+    field_lengths.push_back(length);
+    if (length == kIpfixVarlen) {
+      varlen = true;
+      min_length += 1;
+    } else
+      min_length += length;
+  }
+
+  size_t RecordWalker::get_field_count() const {
+    return field_lengths.size();
+  }
+
+  bool RecordWalker::has_varlen() const {
+    return varlen;
+  }
+
+  size_t RecordWalker::get_min_length() const {
+    return min_length;
+  }
+
+  size_t RecordWalker::walk(const uint8_t* buf, size_t length,
+                            uint16_t* field_offsets,
+                            uint16_t* field_sizes) const {
+    if (!varlen && field_offsets == 0 && field_sizes == 0)
+      return min_length <= length ? min_length : 0;
+
+    const uint8_t* cur = buf;
+    const uint8_t* buf_end = buf + length;
+
+    for (unsigned int i = 0; i < field_lengths.size(); i++) {
+      size_t l = field_lengths[i];
+
+      if (l == kIpfixVarlen) {
+        if (cur >= buf_end)
+          return 0;
+        l = *cur++;
+        if (l == UINT8_MAX) {
+          if (buf_end - cur < static_cast<ptrdiff_t>(sizeof(uint16_t)))
+            return 0;
+          l = decode_uint16(cur);
+          cur += sizeof(uint16_t);
+        }
+      }
+
+      if (static_cast<size_t>(buf_end - cur) < l)
+        return 0;
+      if (field_offsets != 0)
+        field_offsets[i] = static_cast<uint16_t>(cur - buf);
+      if (field_sizes != 0)
+        field_sizes[i] = static_cast<uint16_t>(l);
+      cur += l;
+    }
+
+    return cur - buf;
+  }
+
+  uint64_t RecordWalker::count(const uint8_t* buf, size_t length) const {
+    if (min_length == 0)
+      return 0;
+    if (!varlen)
+      return length / min_length;
+
+    uint64_t n = 0;
+    size_t offset = 0;
+    while (length - offset >= min_length) {
+      size_t record_length = walk(buf + offset, length - offset);
+      if (record_length == 0)
+        break;
+      offset += record_length;
+      n++;
+    }
+    return n;
+  }
+
+} // namespace libfc
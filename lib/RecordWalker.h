@@ -0,0 +1,129 @@
+/* Hi Emacs, please use -*- mode: C++; -*- */
+/* Copyright (c) 2011-2014 ETH Zürich. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ *    * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *    * Neither the names of ETH Zürich nor the names of other contributors 
+ *      may be used to endorse or promote products derived from this software 
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL ETH 
+ * ZURICH BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, 
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, 
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR 
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY 
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ * @author Stephan Neuhaus <neuhaust@tik.ee.ethz.ch>
+ */
+
+#ifndef _libfc_RECORDWALKER_H_
+#  define _libfc_RECORDWALKER_H_
+
+#  include <cstddef>
+#  include <cstdint>
+#  include <vector>
+
+#  include "IETemplate.h"
+
+namespace libfc {
+
+  /** Finds the boundaries of data records without decoding them.
+   *
+   * A record walker knows the wire lengths of the fields of one
+   * template.  With them, it finds where a record ends and, if asked,
+   * where each of its fields starts, reading the length prefixes of
+   * variable-length fields as described in RFC 7011, Section 7.  This
+   * is what everything needs that looks at records but doesn't place
+   * them: counting the records in a data set, skipping records, or
+   * testing fields in place.
+   */
+  class RecordWalker {
+  public:
+    /** Creates a walker for a template without fields. */
+    RecordWalker();
+
+    /** Creates a walker for a wire template.
+     *
+     * @param wire_template the wire template
+     */
+    explicit RecordWalker(const IETemplate* wire_template);
+
+    /** Appends a field.
+     *
+     * @param length the field's wire length, or kIpfixVarlen
+     */
+    void add_field(uint16_t length);
+
+    /** Returns the number of fields.
+     *
+     * @return the number of fields
+     */
+    size_t get_field_count() const;
+
+    /** Tells whether any field has variable length.
+     *
+     * @return true if there is a variable-length field
+     */
+    bool has_varlen() const;
+
+    /** Returns the length of the shortest possible record, counting
+     * one octet for each variable-length field.  Anything shorter at
+     * the end of a data set is padding.
+     *
+     * @return the minimum record length
+     */
+    size_t get_min_length() const;
+
+    /** Finds the end of a record.
+     *
+     * @param buf the start of the record
+     * @param length the number of octets from buf to the end of the
+     *   data set
+     * @param field_offsets if not 0, receives the offset of each
+     *   field's value (after any length prefix) from buf
+     * @param field_sizes if not 0, receives the length of each
+     *   field's value
+     *
+     * @return the length of the record, or 0 if the record extends
+     *   beyond the data set
+     */
+    size_t walk(const uint8_t* buf, size_t length,
+                uint16_t* field_offsets = 0,
+                uint16_t* field_sizes = 0) const;
+
+    /** Counts the complete records in a data set.
+     *
+     * Counting stops at padding, and at a record that extends beyond
+     * the data set.
+     *
+     * @param buf the data set contents, without set header
+     * @param length the length of buf
+     *
+     * @return the number of complete records in buf
+     */
+    uint64_t count(const uint8_t* buf, size_t length) const;
+
+  private:
+    /** Wire lengths of all fields, kIpfixVarlen for varlen fields. */
+    std::vector<uint16_t> field_lengths;
+    size_t min_length;
+    bool varlen;
+  };
+
+} // namespace libfc
+
+#endif // _libfc_RECORDWALKER_H_
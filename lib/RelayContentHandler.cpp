@@ -0,0 +1,443 @@
+/* Copyright (c) 2011-2014 ETH Zürich. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ *    * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *    * Neither the names of ETH Zürich nor the names of other contributors 
+ *      may be used to endorse or promote products derived from this software 
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL ETH 
+ * ZURICH BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, 
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, 
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR 
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY 
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <sstream>
+
+#if defined(_libfc_HAVE_LOG4CPLUS_)
+#  include <log4cplus/loggingmacros.h>
+#else
+#  define LOG4CPLUS_TRACE(logger, expr)
+#endif /* defined(_libfc_HAVE_LOG4CPLUS_) */
+
+#include "RelayContentHandler.h"
+
+#include "decode_util.h"
+
+namespace libfc {
+
+  static void encode16(uint16_t val, uint8_t* buf) {
+    buf[0] = (val >> 8) & 0xff;
+    buf[1] = (val >> 0) & 0xff;
+  }
+
+  static void encode32(uint32_t val, uint8_t* buf) {
+    buf[0] = (val >> 24) & 0xff;
+    buf[1] = (val >> 16) & 0xff;
+    buf[2] = (val >>  8) & 0xff;
+    buf[3] = (val >>  0) & 0xff;
+  }
+
+  RelayContentHandler::OutputDomain::OutputDomain()
+    : sequence_number(0) {
+  }
+
+  RelayContentHandler::RelayContentHandler()
+    : input_domain(0),
+      output_domain_id(0),
+      output_domain(0),
+      export_time(0),
+      message_records(0),
+      message_length(0),
+      max_message_length(kMaxMessageLen),
+      headers_used(0),
+      scratch_used(0),
+      dropped_data_sets(0)
+#if defined(_libfc_HAVE_LOG4CPLUS_)
+    , logger(log4cplus::Logger::getInstance(LOG4CPLUS_TEXT("RelayContentHandler")))
+#endif /* defined(_libfc_HAVE_LOG4CPLUS_) */
+  {
+  }
+
+  RelayContentHandler::~RelayContentHandler() {
+  }
+
+  void RelayContentHandler::add_destination(ExportDestination& destination) {
+    destinations.push_back(&destination);
+    if (destination.preferred_maximum_message_size() < max_message_length)
+      max_message_length = destination.preferred_maximum_message_size();
+  }
+
+  void RelayContentHandler::map_observation_domain(uint32_t from,
+                                                   uint32_t to) {
+    domain_map[from] = to;
+  }
+
+  uint64_t RelayContentHandler::get_dropped_data_sets() const {
+    return dropped_data_sets;
+  }
+
+  uint32_t
+  RelayContentHandler::get_sequence_number(uint32_t observation_domain) const {
+    auto d = output_domains.find(observation_domain);
+    return d == output_domains.end() ? 0 : d->second.sequence_number;
+  }
+
+  uint64_t RelayContentHandler::make_template_key(uint16_t tid) const {
+    return (static_cast<uint64_t>(input_domain) << 16) + tid;
+  }
+
+  std::shared_ptr<ErrorContext> RelayContentHandler::start_session() {
+    LOG4CPLUS_TRACE(logger, "ENTER start_session");
+
+    /* Templates belong to a session, but the output stream goes on,
+     * so keep the sequence numbers. */
+    templates.clear();
+    for (auto d = output_domains.begin(); d != output_domains.end(); ++d)
+      d->second.owners.clear();
+    libfc_RETURN_OK();
+  }
+
+  std::shared_ptr<ErrorContext> RelayContentHandler::end_session() {
+    LOG4CPLUS_TRACE(logger, "ENTER end_session");
+    libfc_RETURN_OK();
+  }
+
+  std::shared_ptr<ErrorContext>
+  RelayContentHandler::start_message(uint16_t version,
+                                     uint16_t length,
+                                     uint32_t _export_time,
+                                     uint32_t sequence_number,
+                                     uint32_t observation_domain,
+                                     uint64_t base_time) {
+    LOG4CPLUS_TRACE(logger, "ENTER start_message");
+
+    if (version != kIpfixVersion)
+      libfc_RETURN_ERROR(recoverable, message_version_number,
+                         "Can only relay IPFIX messages, got version "
+                         << version, 0, 0, 0, 0, 0);
+
+    input_domain = observation_domain;
+    auto m = domain_map.find(observation_domain);
+    output_domain_id
+      = m == domain_map.end() ? observation_domain : m->second;
+    output_domain = &output_domains[output_domain_id];
+    export_time = _export_time;
+
+    scratch_used = 0;
+    start_output_message();
+
+    libfc_RETURN_OK();
+  }
+
+  std::shared_ptr<ErrorContext> RelayContentHandler::end_message() {
+    LOG4CPLUS_TRACE(logger, "ENTER end_message");
+
+    /* Don't send messages whose sets have all been dropped. */
+    if (message_length == kIpfixMessageHeaderLen)
+      libfc_RETURN_OK();
+
+    return send_message();
+  }
+
+  void RelayContentHandler::start_output_message() {
+    message_records = 0;
+
+    iovecs.clear();
+    headers_used = 0;
+
+    ::iovec header;
+    header.iov_base = header_alloc(kIpfixMessageHeaderLen);
+    header.iov_len = kIpfixMessageHeaderLen;
+    iovecs.push_back(header);
+    message_length = kIpfixMessageHeaderLen;
+  }
+
+  std::shared_ptr<ErrorContext> RelayContentHandler::send_message() {
+    assert(message_length <= max_message_length);
+
+    uint8_t* header = static_cast<uint8_t*>(iovecs[0].iov_base);
+    encode16(kIpfixVersion, header + 0);
+    encode16(static_cast<uint16_t>(message_length), header + 2);
+    encode32(export_time, header + 4);
+    encode32(output_domain->sequence_number, header + 8);
+    encode32(output_domain_id, header + 12);
+
+    output_domain->sequence_number += message_records;
+
+    for (auto d = destinations.begin(); d != destinations.end(); ++d) {
+      errno = 0;
+      if ((*d)->writev(iovecs) < 0)
+        libfc_RETURN_ERROR(fatal, system_error,
+                           "Can't write relayed message of "
+                           << message_length << " bytes",
+                           errno, 0, 0, 0, 0);
+    }
+
+    start_output_message();
+    libfc_RETURN_OK();
+  }
+
+  uint8_t* RelayContentHandler::scratch_alloc(size_t size) {
+    assert(scratch_used + size <= sizeof(scratch));
+    uint8_t* ret = scratch + scratch_used;
+    scratch_used += size;
+    return ret;
+  }
+
+  uint8_t* RelayContentHandler::header_alloc(size_t size) {
+    assert(headers_used + size <= sizeof(headers));
+    uint8_t* ret = headers + headers_used;
+    headers_used += size;
+    return ret;
+  }
+
+  void RelayContentHandler::append_set(uint16_t set_id,
+                                       const uint8_t* body,
+                                       uint16_t length) {
+    uint8_t* set_header = header_alloc(kIpfixSetHeaderLen);
+    encode16(set_id, set_header + 0);
+    encode16(length + kIpfixSetHeaderLen, set_header + 2);
+
+    ::iovec v;
+    v.iov_base = set_header;
+    v.iov_len = kIpfixSetHeaderLen;
+    iovecs.push_back(v);
+
+    /* The set contents stay where they are; writev() doesn't modify
+     * them. */
+    v.iov_base = const_cast<uint8_t*>(body);
+    v.iov_len = length;
+    iovecs.push_back(v);
+
+    message_length += kIpfixSetHeaderLen + length;
+  }
+
+  std::shared_ptr<ErrorContext>
+  RelayContentHandler::append_records(uint16_t set_id,
+                                      const uint8_t* body,
+                                      const std::vector<size_t>& record_ends,
+                                      bool is_data_set) {
+    size_t first = 0;
+    size_t start = 0;
+
+    while (first < record_ends.size()) {
+      /* Take as many records as fit into the outgoing message. */
+      size_t end = first;
+      if (message_length + kIpfixSetHeaderLen < max_message_length) {
+        size_t room = max_message_length - message_length
+          - kIpfixSetHeaderLen;
+        while (end < record_ends.size() && record_ends[end] - start <= room)
+          end++;
+      }
+
+      if (end == first) {
+        if (message_length == kIpfixMessageHeaderLen)
+          libfc_RETURN_ERROR(fatal, long_set,
+                             "Record of " << record_ends[first] - start
+                             << " octets in set " << set_id
+                             << " doesn't fit into a message of "
+                             << max_message_length << " octets",
+                             0, 0, 0, 0, 0);
+
+        std::shared_ptr<ErrorContext> e = send_message();
+        if (e != 0)
+          return e;
+        continue;
+      }
+
+      append_set(set_id, body + start,
+                 static_cast<uint16_t>(record_ends[end - 1] - start));
+      if (is_data_set)
+        message_records += end - first;
+
+      start = record_ends[end - 1];
+      first = end;
+    }
+
+    libfc_RETURN_OK();
+  }
+
+  uint16_t RelayContentHandler::assign_output_id(uint16_t input_id) {
+    if (output_domain->owners.find(input_id) == output_domain->owners.end())
+      return input_id;
+
+    for (uint32_t id = kMinDataSetId; id <= UINT16_MAX; id++)
+      if (output_domain->owners.find(id) == output_domain->owners.end())
+        return static_cast<uint16_t>(id);
+
+    return 0;
+  }
+
+  std::shared_ptr<ErrorContext>
+  RelayContentHandler::process_template_set(uint16_t set_id,
+                                            uint16_t set_length,
+                                            const uint8_t* buf,
+                                            bool is_options_set) {
+    const uint8_t* cur = buf;
+    const uint8_t* set_end = buf + set_length;
+    const uint16_t header_length
+      = is_options_set ? kOptionsTemplateHeaderLen : kTemplateHeaderLen;
+
+    /* Template records are copied one by one, so that records we
+     * can't forward can be left out. */
+    uint8_t* out = scratch_alloc(set_length);
+    uint8_t* w = out;
+    std::vector<size_t> record_ends;
+
+    while (cur + header_length <= set_end) {
+      const uint8_t* record = cur;
+      uint16_t tid = decode_uint16(cur + 0);
+      uint16_t field_count = decode_uint16(cur + 2);
+      uint64_t key = make_template_key(tid);
+      cur += header_length;
+
+      if (field_count == 0) {
+        /* Template withdrawal.  Only forward withdrawals for
+         * templates we know, since the ID might belong to another
+         * input domain otherwise. */
+        auto t = templates.find(key);
+        if (t != templates.end()) {
+          memcpy(w, record, header_length);
+          encode16(t->second.output_id, w);
+          w += header_length;
+          record_ends.push_back(w - out);
+
+          output_domain->owners.erase(t->second.output_id);
+          templates.erase(t);
+        }
+        continue;
+      }
+
+      TemplateInfo info;
+
+      for (uint16_t field = 0; field < field_count; field++) {
+        if (cur + kFieldSpecifierLen > set_end)
+          libfc_RETURN_ERROR(recoverable, long_fieldspec,
+                             "Template " << tid << " field " << field
+                             << " extends past end of set",
+                             0, 0, 0, 0, 0);
+
+        uint16_t ie_id = decode_uint16(cur + 0);
+        uint16_t ie_length = decode_uint16(cur + 2);
+        cur += kFieldSpecifierLen;
+
+        if ((ie_id & kEnterpriseBit) != 0) {
+          if (cur + kEnterpriseLen > set_end)
+            libfc_RETURN_ERROR(recoverable, long_fieldspec,
+                               "Template " << tid << " field " << field
+                               << " enterprise number extends past end "
+                               "of set", 0, 0, 0, 0, 0);
+          cur += kEnterpriseLen;
+        }
+
+        info.walker.add_field(ie_length);
+      }
+
+      auto t = templates.find(key);
+      if (t != templates.end())
+        info.output_id = t->second.output_id;
+      else {
+        info.output_id = assign_output_id(tid);
+        if (info.output_id == 0)
+          libfc_RETURN_ERROR(recoverable, inconsistent_state,
+                             "No free template ID in output domain "
+                             << output_domain_id, 0, 0, 0, 0, 0);
+      }
+
+      LOG4CPLUS_TRACE(logger, "template " << input_domain << "/" << tid
+                      << " -> " << output_domain_id << "/"
+                      << info.output_id);
+
+      output_domain->owners[info.output_id] = key;
+      templates[key] = info;
+
+      memcpy(w, record, cur - record);
+      encode16(info.output_id, w);
+      w += cur - record;
+      record_ends.push_back(w - out);
+    }
+
+    if (w == out)
+      libfc_RETURN_OK();
+
+    if (message_length + kIpfixSetHeaderLen + (w - out) > max_message_length)
+      return append_records(set_id, out, record_ends, false);
+
+    append_set(set_id, out, static_cast<uint16_t>(w - out));
+    libfc_RETURN_OK();
+  }
+
+  std::shared_ptr<ErrorContext>
+  RelayContentHandler::start_template_set(uint16_t set_id,
+                                          uint16_t set_length,
+                                          const uint8_t* buf) {
+    return process_template_set(set_id, set_length, buf, false);
+  }
+
+  std::shared_ptr<ErrorContext> RelayContentHandler::end_template_set() {
+    libfc_RETURN_OK();
+  }
+
+  std::shared_ptr<ErrorContext>
+  RelayContentHandler::start_options_template_set(uint16_t set_id,
+                                                  uint16_t set_length,
+                                                  const uint8_t* buf) {
+    return process_template_set(set_id, set_length, buf, true);
+  }
+
+  std::shared_ptr<ErrorContext>
+  RelayContentHandler::end_options_template_set() {
+    libfc_RETURN_OK();
+  }
+
+  std::shared_ptr<ErrorContext>
+  RelayContentHandler::start_data_set(uint16_t id,
+                                      uint16_t length,
+                                      const uint8_t* buf) {
+    LOG4CPLUS_TRACE(logger, "ENTER start_data_set, id=" << id);
+
+    auto t = templates.find(make_template_key(id));
+    if (t == templates.end()) {
+      dropped_data_sets++;
+      libfc_RETURN_OK();
+    }
+
+    const RecordWalker& walker = t->second.walker;
+
+    if (message_length + kIpfixSetHeaderLen + length > max_message_length) {
+      /* Split the set at record boundaries; padding is left out. */
+      std::vector<size_t> record_ends;
+      size_t offset = 0;
+      while (size_t n = walker.walk(buf + offset, length - offset)) {
+        offset += n;
+        record_ends.push_back(offset);
+      }
+      return append_records(t->second.output_id, buf, record_ends, true);
+    }
+
+    message_records += walker.count(buf, length);
+    append_set(t->second.output_id, buf, length);
+
+    libfc_RETURN_OK();
+  }
+
+  std::shared_ptr<ErrorContext> RelayContentHandler::end_data_set() {
+    libfc_RETURN_OK();
+  }
+
+} // namespace libfc
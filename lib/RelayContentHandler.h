@@ -0,0 +1,286 @@
+/* Hi Emacs, please use -*- mode: C++; -*- */
+/* Copyright (c) 2011-2014 ETH Zürich. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ *    * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *    * Neither the names of ETH Zürich nor the names of other contributors 
+ *      may be used to endorse or promote products derived from this software 
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL ETH 
+ * ZURICH BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, 
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, 
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR 
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY 
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ * @author Stephan Neuhaus <neuhaust@tik.ee.ethz.ch>
+ */
+
+#ifndef _libfc_RELAYCONTENTHANDLER_H_
+#  define _libfc_RELAYCONTENTHANDLER_H_
+
+#  include <list>
+#  include <map>
+#  include <vector>
+
+#  include <sys/uio.h>
+
+#  if defined(_libfc_HAVE_LOG4CPLUS_)
+#    include <log4cplus/logger.h>
+#  endif /* defined(_libfc_HAVE_LOG4CPLUS_) */
+
+#  include "Constants.h"
+#  include "ContentHandler.h"
+#  include "ExportDestination.h"
+#  include "RecordWalker.h"
+
+namespace libfc {
+
+  /** Forwards IPFIX messages to export destinations without decoding
+   * data records.
+   *
+   * This content handler is used with an IPFIXMessageStreamParser.
+   * Instead of decoding data records into placements and encoding
+   * them again, it copies data sets byte for byte into an outgoing
+   * message, which is then written to every registered
+   * ExportDestination.  The only things that are rewritten are:
+   *
+   *   - the message header: the observation domain can be mapped to
+   *     another one with map_observation_domain(), and the sequence
+   *     number is recomputed for the outgoing stream;
+   *   - template IDs, but only where needed: if several input
+   *     observation domains are mapped to the same output domain and
+   *     their template IDs collide, later templates get fresh IDs,
+   *     and the set IDs of their data sets are rewritten to match.
+   *
+   * Template and options template sets are forwarded with the
+   * remapped IDs.  Data sets for which no template has been seen are
+   * dropped, since they could not be decoded downstream anyway.
+   *
+   * Sequence numbers follow RFC 5101: the sequence number of an
+   * outgoing message is the number of data records sent in its
+   * observation domain before it.  Records are counted using the
+   * field lengths from the template, which does not need any decoding
+   * for templates without variable-length fields.
+   *
+   * Messages are written with scatter-gather I/O: data set contents
+   * are not copied but referenced in the parser's message buffer.
+   *
+   * An outgoing message is never longer than the smallest
+   * preferred_maximum_message_size() of the destinations.  Where an
+   * incoming message doesn't fit, it is sent as several messages, and
+   * a set that doesn't fit is split at record boundaries.
+   */
+  class RelayContentHandler : public ContentHandler {
+  public:
+    RelayContentHandler();
+    virtual ~RelayContentHandler();
+
+    /** Adds a destination to which messages are forwarded.
+     *
+     * @param destination the destination; must outlive this handler
+     *   and keep its preferred maximum message size
+     */
+    void add_destination(ExportDestination& destination);
+
+    /** Maps an input observation domain to an output domain.
+     *
+     * Domains that are not mapped are forwarded unchanged.
+     *
+     * @param from the observation domain in the input
+     * @param to the observation domain in the output
+     */
+    void map_observation_domain(uint32_t from, uint32_t to);
+
+    /** Returns the number of data sets dropped for lack of a template.
+     *
+     * @return the number of dropped data sets
+     */
+    uint64_t get_dropped_data_sets() const;
+
+    /** Returns the number of data records sent so far in an output
+     * observation domain, which is also the sequence number of the
+     * next message in that domain.
+     *
+     * @param observation_domain the output observation domain
+     *
+     * @return the number of data records sent in that domain
+     */
+    uint32_t get_sequence_number(uint32_t observation_domain) const;
+
+    /* From ContentHandler */
+    std::shared_ptr<ErrorContext> start_session();
+    std::shared_ptr<ErrorContext> end_session();
+
+    std::shared_ptr<ErrorContext> start_message(uint16_t version,
+                       uint16_t length,
+                       uint32_t export_time,
+                       uint32_t sequence_number,
+                       uint32_t observation_domain,
+                       uint64_t base_time);
+    std::shared_ptr<ErrorContext> end_message();
+    std::shared_ptr<ErrorContext> start_template_set(uint16_t set_id,
+                            uint16_t set_length,
+                            const uint8_t* buf);
+    std::shared_ptr<ErrorContext> end_template_set();
+    std::shared_ptr<ErrorContext> start_options_template_set(uint16_t set_id,
+                                   uint16_t set_length,
+                                   const uint8_t* buf);
+    std::shared_ptr<ErrorContext> end_options_template_set();
+    std::shared_ptr<ErrorContext> start_data_set(uint16_t id,
+                                                 uint16_t length,
+                                                 const uint8_t* buf);
+    std::shared_ptr<ErrorContext> end_data_set();
+
+  private:
+    /** What we need to know about an input template. */
+    struct TemplateInfo {
+      /** Template ID in the output domain. */
+      uint16_t output_id;
+
+      /** Counts the records in data sets for this template. */
+      RecordWalker walker;
+    };
+
+    /** State for one observation domain in the output. */
+    struct OutputDomain {
+      OutputDomain();
+
+      /** Number of data records sent so far (RFC 5101 sequence number). */
+      uint32_t sequence_number;
+
+      /** Which input template (see make_template_key()) owns which
+       * output template ID. */
+      std::map<uint16_t, uint64_t> owners;
+    };
+
+    std::shared_ptr<ErrorContext> process_template_set(
+      uint16_t set_id,
+      uint16_t set_length,
+      const uint8_t* buf,
+      bool is_options_set);
+
+    /** Finds an output template ID for an input template.
+     *
+     * Keeps the input ID if it is free in the output domain.
+     *
+     * @return the output ID, or 0 if all IDs are in use
+     */
+    uint16_t assign_output_id(uint16_t input_id);
+
+    /** Reserves space in the scratch buffer. */
+    uint8_t* scratch_alloc(size_t size);
+
+    /** Reserves space for headers of the outgoing message. */
+    uint8_t* header_alloc(size_t size);
+
+    /** Starts a new outgoing message. */
+    void start_output_message();
+
+    /** Writes the outgoing message to all destinations and starts a
+     * new one. */
+    std::shared_ptr<ErrorContext> send_message();
+
+    /** Appends a set to the outgoing message.
+     *
+     * @param set_id the (possibly rewritten) set ID
+     * @param body the set's contents, without set header
+     * @param length the length of body
+     */
+    void append_set(uint16_t set_id, const uint8_t* body, uint16_t length);
+
+    /** Appends a set that doesn't fit into the outgoing message.
+     *
+     * As many records as fit go into the outgoing message, which is
+     * then sent, and so on until all records are in a message.
+     *
+     * @param set_id the (possibly rewritten) set ID
+     * @param body the set's contents, without set header
+     * @param record_ends the offset from body of the end of each
+     *   record
+     * @param is_data_set whether the records are data records, which
+     *   count towards the sequence number
+     *
+     * @return an error if a record doesn't fit into any message
+     */
+    std::shared_ptr<ErrorContext>
+    append_records(uint16_t set_id, const uint8_t* body,
+                   const std::vector<size_t>& record_ends,
+                   bool is_data_set);
+
+    uint64_t make_template_key(uint16_t tid) const;
+
+    std::list<ExportDestination*> destinations;
+    std::map<uint32_t, uint32_t> domain_map;
+
+    /** Input templates, keyed by make_template_key(). */
+    std::map<uint64_t, TemplateInfo> templates;
+
+    /** Output domains. */
+    std::map<uint32_t, OutputDomain> output_domains;
+
+    /** Input observation domain of the current message. */
+    uint32_t input_domain;
+
+    /** Output observation domain of the current message. */
+    uint32_t output_domain_id;
+
+    /** Output state for the current message. */
+    OutputDomain* output_domain;
+
+    /** Export time of the current message. */
+    uint32_t export_time;
+
+    /** Number of data records in the current message. */
+    uint32_t message_records;
+
+    /** Length of the outgoing message so far. */
+    size_t message_length;
+
+    /** The largest message that all destinations take. */
+    size_t max_message_length;
+
+    /** The outgoing message.  The first iovec is the message header;
+     * then come set headers and set contents. */
+    std::vector< ::iovec> iovecs;
+
+    /** Storage for the message header and set headers of the outgoing
+     * message.  They are part of the message, so kMaxMessageLen
+     * octets are enough. */
+    uint8_t headers[kMaxMessageLen];
+
+    /** Used octets in headers. */
+    size_t headers_used;
+
+    /** Storage for the rewritten template sets of the incoming
+     * message.  They are never longer than the sets they replace, so
+     * kMaxMessageLen octets are enough. */
+    uint8_t scratch[kMaxMessageLen];
+
+    /** Used octets in scratch. */
+    size_t scratch_used;
+
+    uint64_t dropped_data_sets;
+
+#  if defined(_libfc_HAVE_LOG4CPLUS_)
+    log4cplus::Logger logger;
+#  endif /* defined(_libfc_HAVE_LOG4CPLUS_) */
+  };
+
+} // namespace libfc
+
+#endif // _libfc_RELAYCONTENTHANDLER_H_
@@ -0,0 +1,112 @@
+/* Hi Emacs, please use -*- mode: C++; -*- */
+/* Copyright (c) 2011-2014 ETH Zürich. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ *    * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *    * Neither the names of ETH Zürich nor the names of other contributors 
+ *      may be used to endorse or promote products derived from this software 
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL ETH 
+ * ZURICH BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, 
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, 
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR 
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY 
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ * @author Stephan Neuhaus <neuhaust@tik.ee.ethz.ch>
+ *
+ * The layout of the shared-memory ring written by ShmRingPublisher
+ * and read by ShmRingReader.
+ *
+ * The shared memory object starts with a ShmRingHeader, followed by
+ * field_count ShmRingField descriptors, the slots and the arena, at
+ * the offsets given in the header.  A slot is a 64-bit sequence
+ * number followed by a record of record_size octets.  Every field of
+ * a record starts at an 8-octet boundary; a fixed-length value is
+ * stored as placed (for example, an ipv4Address is a uint32_t in
+ * host byte order), whereas a variable-length value is stored in the
+ * arena and the record holds a ShmRingVarlen referring to it.
+ *
+ * Record n goes into slot n mod slot_count.  While the publisher
+ * writes it, the sequence number of that slot is 2n + 1; afterwards,
+ * it is 2n + 2, and the header's head is n + 1.  A reader copies a
+ * record and checks that the sequence number is still 2n + 2;
+ * otherwise, the publisher has lapped it.  Positions in the arena
+ * grow monotonically and are taken modulo arena_size; a value never
+ * wraps around the end of the arena.  Before the publisher writes
+ * octets up to position p, it sets arena_reserved to p, so a value at
+ * position q is intact as long as arena_reserved <= q + arena_size.
+ */
+
+#ifndef _libfc_SHMRING_H_
+#  define _libfc_SHMRING_H_
+
+#  include <atomic>
+#  include <cstdint>
+
+namespace libfc {
+
+  /** "LFCR", the magic number of a libfc ring. */
+  const uint32_t kShmRingMagic = 0x4c464352;
+  const uint32_t kShmRingVersion = 1;
+
+  struct ShmRingHeader {
+    /** kShmRingMagic; written last, once the ring is initialised. */
+    std::atomic<uint32_t> magic;
+    uint32_t version;
+    uint32_t field_count;
+    uint32_t record_size;
+    uint64_t slot_count;
+    uint64_t slot_size;
+    uint64_t arena_size;
+    uint64_t fields_offset;
+    uint64_t slots_offset;
+    uint64_t arena_offset;
+    uint64_t total_size;
+
+    /** The number of records published. */
+    std::atomic<uint64_t> head;
+
+    /** The arena position up to which octets may have been written. */
+    std::atomic<uint64_t> arena_reserved;
+
+    /** Non-zero once the publisher has gone away. */
+    std::atomic<uint32_t> closed;
+  };
+
+  struct ShmRingField {
+    uint32_t enterprise;
+    uint16_t number;
+    /** The IEType number of the IE. */
+    uint8_t ietype;
+    /** Non-zero if values are stored in the arena. */
+    uint8_t varlen;
+    /** The offset of the value in a record. */
+    uint32_t offset;
+    /** The size of a fixed-length value in octets. */
+    uint32_t width;
+  };
+
+  struct ShmRingVarlen {
+    uint64_t position;
+    uint32_t length;
+    uint32_t reserved;
+  };
+
+} // namespace libfc
+
+#endif // _libfc_SHMRING_H_
@@ -0,0 +1,221 @@
+/* Copyright (c) 2011-2014 ETH Zürich. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ *    * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *    * Neither the names of ETH Zürich nor the names of other contributors 
+ *      may be used to endorse or promote products derived from this software 
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL ETH 
+ * ZURICH BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, 
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, 
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR 
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY 
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <new>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "Constants.h"
+#include "ShmRingPublisher.h"
+
+#include "exceptions/ExportError.h"
+#include "exceptions/IESpecError.h"
+
+static size_t round_up(size_t n, size_t alignment) {
+  return (n + alignment - 1) / alignment * alignment;
+}
+
+static size_t next_power_of_two(size_t n) {
+  size_t p = 1;
+  while (p < n)
+    p <<= 1;
+  return p;
+}
+
+namespace libfc {
+
+  ShmRingPublisher::ShmRingPublisher(const std::string& name,
+                                     const std::vector<const InfoElement*>& ies,
+                                     size_t slot_count,
+                                     size_t arena_size)
+    : name(name),
+      base(0),
+      size(0),
+      header(0),
+      slots(0),
+      arena(0),
+      head(0),
+      arena_position(0) {
+    assert(!ies.empty());
+
+    std::vector<ShmRingField> fields(ies.size());
+    size_t record_size = 0;
+    size_t n_varlen = 0;
+
+    for (unsigned int i = 0; i < ies.size(); ++i) {
+      ShmRingField& f = fields[i];
+      unsigned int type = ies[i]->ietype()->number();
+
+      f.enterprise = ies[i]->pen();
+      f.number = ies[i]->number();
+      f.ietype = type;
+      f.varlen = 0;
+      f.offset = record_size;
+      f.width = ies[i]->ietype()->placedWidth();
+      if (f.width == 0) {
+        if (type != IEType::kOctetArray && type != IEType::kString)
+          throw IESpecError("Can't publish IE " + ies[i]->toIESpec());
+        f.varlen = 1;
+        f.width = sizeof(ShmRingVarlen);
+        n_varlen++;
+      }
+      record_size += round_up(f.width, sizeof(uint64_t));
+    }
+
+    slot_count = next_power_of_two(slot_count < 2 ? 2 : slot_count);
+    if (n_varlen == 0)
+      arena_size = 0;
+    else
+      arena_size = next_power_of_two(arena_size < 2*kMaxMessageLen
+                                     ? 2*kMaxMessageLen : arena_size);
+    slot_mask = slot_count - 1;
+    arena_mask = arena_size == 0 ? 0 : arena_size - 1;
+
+    size_t slot_size = sizeof(uint64_t) + record_size;
+    size_t fields_offset = round_up(sizeof(ShmRingHeader), 64);
+    size_t slots_offset
+      = round_up(fields_offset + fields.size()*sizeof(ShmRingField), 64);
+    size_t arena_offset = round_up(slots_offset + slot_count*slot_size, 64);
+    size = arena_offset + arena_size;
+
+    int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+    if (fd < 0 && errno == EEXIST)
+      throw ExportError("Shared memory \"" + name + "\" already exists");
+    else if (fd < 0)
+      throw ExportError("Can't create shared memory \"" + name + "\": "
+                        + strerror(errno));
+    if (ftruncate(fd, size) < 0) {
+      int saved_errno = errno;
+      (void) close(fd);
+      (void) shm_unlink(name.c_str());
+      throw ExportError("Can't size shared memory \"" + name + "\": "
+                        + strerror(saved_errno));
+    }
+    void* p = mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    int saved_errno = errno;
+    (void) close(fd);
+    if (p == MAP_FAILED) {
+      (void) shm_unlink(name.c_str());
+      throw ExportError("Can't map shared memory \"" + name + "\": "
+                        + strerror(saved_errno));
+    }
+
+    base = static_cast<uint8_t*>(p);
+    header = new (base) ShmRingHeader;
+    header->version = kShmRingVersion;
+    header->field_count = fields.size();
+    header->record_size = record_size;
+    header->slot_count = slot_count;
+    header->slot_size = slot_size;
+    header->arena_size = arena_size;
+    header->fields_offset = fields_offset;
+    header->slots_offset = slots_offset;
+    header->arena_offset = arena_offset;
+    header->total_size = size;
+    header->head.store(0, std::memory_order_relaxed);
+    header->arena_reserved.store(0, std::memory_order_relaxed);
+    header->closed.store(0, std::memory_order_relaxed);
+    memcpy(base + fields_offset, fields.data(),
+           fields.size()*sizeof(ShmRingField));
+    slots = base + slots_offset;
+    arena = base + arena_offset;
+    header->magic.store(kShmRingMagic, std::memory_order_release);
+
+    /* Sized once, since the input template points into both. */
+    record.assign(record_size/sizeof(uint64_t), 0);
+    varlens.resize(n_varlen);
+
+    uint8_t* r = reinterpret_cast<uint8_t*>(record.data());
+    size_t j = 0;
+    for (unsigned int i = 0; i < ies.size(); ++i)
+      if (fields[i].varlen) {
+        varlens[j].offset = fields[i].offset;
+        input_template.register_placement(ies[i], &varlens[j].value, 0);
+        j++;
+      } else
+        input_template.register_placement(ies[i], r + fields[i].offset, 0);
+  }
+
+  bool ShmRingPublisher::remove(const std::string& name) {
+    return shm_unlink(name.c_str()) == 0;
+  }
+
+  ShmRingPublisher::~ShmRingPublisher() {
+    header->closed.store(1, std::memory_order_release);
+    (void) munmap(base, size);
+    (void) shm_unlink(name.c_str());
+  }
+
+  const PlacementTemplate* ShmRingPublisher::get_input_template() const {
+    return &input_template;
+  }
+
+  void ShmRingPublisher::add_record() {
+    uint8_t* slot = slots + (head & slot_mask)*header->slot_size;
+    std::atomic<uint64_t>* sequence
+      = reinterpret_cast<std::atomic<uint64_t>*>(slot);
+    uint8_t* r = slot + sizeof(uint64_t);
+
+    sequence->store(2*head + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    memcpy(r, record.data(), record.size()*sizeof(uint64_t));
+
+    for (auto v = varlens.begin(); v != varlens.end(); ++v) {
+      ShmRingVarlen ref;
+      ref.length = v->value.get_length();
+      ref.reserved = 0;
+
+      /* Values don't wrap around the end of the arena. */
+      uint64_t offset = arena_position & arena_mask;
+      if (offset + ref.length > arena_mask + 1)
+        arena_position += arena_mask + 1 - offset;
+      ref.position = arena_position;
+      arena_position += ref.length;
+
+      header->arena_reserved.store(arena_position, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_release);
+      if (ref.length > 0)
+        memcpy(arena + (ref.position & arena_mask), v->value.get_buf(),
+               ref.length);
+      memcpy(r + v->offset, &ref, sizeof(ref));
+    }
+
+    sequence->store(2*head + 2, std::memory_order_release);
+    head++;
+    header->head.store(head, std::memory_order_release);
+  }
+
+  uint64_t ShmRingPublisher::get_record_count() const {
+    return head;
+  }
+
+} // namespace libfc
@@ -0,0 +1,174 @@
+/* Hi Emacs, please use -*- mode: C++; -*- */
+/* Copyright (c) 2011-2014 ETH Zürich. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ *    * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *    * Neither the names of ETH Zürich nor the names of other contributors 
+ *      may be used to endorse or promote products derived from this software 
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL ETH 
+ * ZURICH BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, 
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, 
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR 
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY 
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ * @author Stephan Neuhaus <neuhaust@tik.ee.ethz.ch>
+ */
+
+#ifndef _libfc_SHMRINGPUBLISHER_H_
+#  define _libfc_SHMRINGPUBLISHER_H_
+
+#  include <cstdint>
+#  include <string>
+#  include <vector>
+
+#  include "BasicOctetArray.h"
+#  include "InfoElement.h"
+#  include "PlacementTemplate.h"
+#  include "ShmRing.h"
+
+namespace libfc {
+
+  /** Publishes decoded records to other processes through a ring in
+   * POSIX shared memory.
+   *
+   * Several consumers on the same host can then share one collector
+   * instead of each decoding the same IPFIX stream; they read the
+   * ring with ShmRingReader.  The ring has a single producer and any
+   * number of consumers, and is lock-free: the publisher never waits
+   * for consumers, and a consumer that falls behind by more than the
+   * ring's capacity loses records instead of holding up the others.
+   *
+   * The publisher is given the IEs that make up a record.  Like
+   * FlowAggregator, it places them on an input template; register
+   * that template with a collector and call add_record() from
+   * end_placement():
+   *
+   * @code
+   * class MyCollector : public PlacementCollector {
+   * public:
+   *   MyCollector(ShmRingPublisher& publisher)
+   *     : PlacementCollector(PlacementCollector::ipfix),
+   *       publisher(publisher) {
+   *     register_placement_template(publisher.get_input_template());
+   *   }
+   *
+   *   std::shared_ptr<ErrorContext>
+   *     end_placement(const PlacementTemplate* tmpl) {
+   *     publisher.add_record();
+   *     libfc_RETURN_OK();
+   *   }
+   *   ...
+   * };
+   * @endcode
+   *
+   * Fixed-length values are copied into the ring as placed; string
+   * and octetArray values go into a separate circular arena.  See
+   * ShmRing.h for the layout.
+   *
+   * The shared memory object is created by the constructor, which
+   * fails if an object of the same name exists, so that a second
+   * publisher can't take over a ring that is in use.  A ring left
+   * behind by a publisher that died can be removed with remove().
+   * The destructor removes the ring.  Readers that still have it
+   * open can read the remaining records and then see that the ring
+   * is closed.
+   */
+  class ShmRingPublisher {
+  public:
+    /** Creates a publisher and its ring.
+     *
+     * @param name the name of the shared memory object, which must
+     *   start with a slash, as in "/libfc-flows"
+     * @param ies the IEs that make up a record
+     * @param slot_count the number of records in the ring; rounded up
+     *   to a power of two
+     * @param arena_size the size of the arena for variable-length
+     *   values in octets; rounded up to a power of two, and to at
+     *   least twice the maximum message length
+     *
+     * @throw ExportError if a shared memory object of that name exists
+     *   or the ring can't be created
+     * @throw IESpecError if an IE can't be published
+     */
+    ShmRingPublisher(const std::string& name,
+                     const std::vector<const InfoElement*>& ies,
+                     size_t slot_count = default_slot_count,
+                     size_t arena_size = default_arena_size);
+
+    /** Removes a ring, such as one left behind by a publisher that
+     * died.  Readers that have the ring open keep it until they close
+     * it, but will see no new records.
+     *
+     * @param name the name of the shared memory object
+     *
+     * @return true if the ring was removed, false if there was none
+     */
+    static bool remove(const std::string& name);
+
+    /** Closes the ring and removes its name. */
+    ~ShmRingPublisher();
+
+    /** Returns the template on which incoming records are placed.
+     *
+     * @return the input template
+     */
+    const PlacementTemplate* get_input_template() const;
+
+    /** Publishes the record currently placed on the input template. */
+    void add_record();
+
+    /** Returns the number of records published so far.
+     *
+     * @return the number of records published
+     */
+    uint64_t get_record_count() const;
+
+    static const size_t default_slot_count = 65536;
+    static const size_t default_arena_size = 16 << 20;
+
+  private:
+    struct Varlen {
+      /** The offset of the ShmRingVarlen in a record. */
+      size_t offset;
+      BasicOctetArray value;
+    };
+
+    std::string name;
+    uint8_t* base;
+    size_t size;
+    ShmRingHeader* header;
+    uint8_t* slots;
+    uint8_t* arena;
+    uint64_t slot_mask;
+    uint64_t arena_mask;
+
+    PlacementTemplate input_template;
+
+    /** The record as placed, with room for the ShmRingVarlen
+     * references. */
+    std::vector<uint64_t> record;
+    std::vector<Varlen> varlens;
+
+    uint64_t head;
+    uint64_t arena_position;
+  };
+
+} // namespace libfc
+
+#endif // _libfc_SHMRINGPUBLISHER_H_
@@ -0,0 +1,215 @@
+/* Copyright (c) 2011-2014 ETH Zürich. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ *    * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *    * Neither the names of ETH Zürich nor the names of other contributors 
+ *      may be used to endorse or promote products derived from this software 
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL ETH 
+ * ZURICH BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, 
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, 
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR 
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY 
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "ShmRingReader.h"
+
+#include "exceptions/FormatError.h"
+
+namespace libfc {
+
+  ShmRingReader::ShmRingReader(const std::string& name)
+    : name(name),
+      base(0),
+      size(0),
+      header(0),
+      fields(0),
+      slots(0),
+      arena(0),
+      slot_mask(0),
+      arena_size(0),
+      next(0),
+      lost(0) {
+    int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0)
+      throw FormatError("Can't open shared memory \"" + name + "\": "
+                        + strerror(errno));
+
+    struct stat st;
+    if (fstat(fd, &st) < 0
+        || static_cast<size_t>(st.st_size) < sizeof(ShmRingHeader)) {
+      (void) close(fd);
+      throw FormatError("Shared memory \"" + name + "\" is not a ring");
+    }
+    size = st.st_size;
+
+    void* p = mmap(0, size, PROT_READ, MAP_SHARED, fd, 0);
+    int saved_errno = errno;
+    (void) close(fd);
+    if (p == MAP_FAILED)
+      throw FormatError("Can't map shared memory \"" + name + "\": "
+                        + strerror(saved_errno));
+    base = static_cast<const uint8_t*>(p);
+    header = reinterpret_cast<const ShmRingHeader*>(base);
+
+    if (header->magic.load(std::memory_order_acquire) != kShmRingMagic
+        || header->version != kShmRingVersion
+        || header->total_size > size) {
+      (void) munmap(const_cast<uint8_t*>(base), size);
+      throw FormatError("Shared memory \"" + name
+                        + "\" is not a ring, or not a ring of this version");
+    }
+
+    fields = reinterpret_cast<const ShmRingField*>(
+      base + header->fields_offset);
+    slots = base + header->slots_offset;
+    arena = base + header->arena_offset;
+    slot_mask = header->slot_count - 1;
+    arena_size = header->arena_size;
+
+    for (size_t i = 0; i < header->field_count; ++i)
+      if (fields[i].varlen)
+        varlen_fields.push_back(i);
+    record.assign(header->record_size/sizeof(uint64_t), 0);
+    varlen_values.resize(header->field_count);
+
+    next = header->head.load(std::memory_order_acquire);
+  }
+
+  ShmRingReader::~ShmRingReader() {
+    (void) munmap(const_cast<uint8_t*>(base), size);
+  }
+
+  void ShmRingReader::skip(uint64_t head) {
+    uint64_t half = (slot_mask + 1)/2;
+    uint64_t to = head > half ? head - half : 0;
+    if (to <= next)
+      to = next + 1;
+    lost += to - next;
+    next = to;
+  }
+
+  ShmRingReader::Status ShmRingReader::read() {
+    for (;;) {
+      /* The publisher sets closed after its last head, so loading
+       * closed first means that head is final if closed is set. */
+      bool is_closed = header->closed.load(std::memory_order_acquire) != 0;
+      uint64_t head = header->head.load(std::memory_order_acquire);
+      if (next >= head)
+        return is_closed ? closed : empty;
+      if (head - next > slot_mask + 1) {
+        skip(head);
+        continue;
+      }
+
+      const uint8_t* slot = slots + (next & slot_mask)*header->slot_size;
+      const std::atomic<uint64_t>* sequence
+        = reinterpret_cast<const std::atomic<uint64_t>*>(slot);
+      const uint8_t* r = slot + sizeof(uint64_t);
+
+      uint64_t expected = 2*next + 2;
+      if (sequence->load(std::memory_order_acquire) != expected) {
+        skip(head);
+        continue;
+      }
+
+      memcpy(record.data(), r, header->record_size);
+
+      /* The oldest arena position that this record refers to. */
+      uint64_t oldest = UINT64_MAX;
+      bool torn = false;
+      for (auto i = varlen_fields.begin(); i != varlen_fields.end(); ++i) {
+        ShmRingVarlen ref;
+        memcpy(&ref, reinterpret_cast<const uint8_t*>(record.data())
+                     + fields[*i].offset, sizeof(ref));
+        uint64_t offset = ref.position & (arena_size - 1);
+        if (offset + ref.length > arena_size) {
+          torn = true;
+          break;
+        }
+        varlen_values[*i].assign(arena + offset, arena + offset + ref.length);
+        if (ref.position < oldest)
+          oldest = ref.position;
+      }
+
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (torn || sequence->load(std::memory_order_relaxed) != expected) {
+        skip(head);
+        continue;
+      }
+      if (oldest != UINT64_MAX
+          && header->arena_reserved.load(std::memory_order_relaxed)
+             > oldest + arena_size) {
+        /* The slot is intact, but its values were overwritten. */
+        lost++;
+        next++;
+        continue;
+      }
+
+      next++;
+      return ok;
+    }
+  }
+
+  size_t ShmRingReader::get_field_count() const {
+    return header->field_count;
+  }
+
+  const ShmRingField& ShmRingReader::get_field(size_t field) const {
+    assert(field < header->field_count);
+    return fields[field];
+  }
+
+  int ShmRingReader::find_field(const InfoElement* ie) const {
+    for (size_t i = 0; i < header->field_count; ++i)
+      if (fields[i].enterprise == ie->pen()
+          && fields[i].number == ie->number())
+        return static_cast<int>(i);
+    return -1;
+  }
+
+  const void* ShmRingReader::get_value(size_t field) const {
+    assert(field < header->field_count);
+    if (fields[field].varlen)
+      return varlen_values[field].data();
+    return reinterpret_cast<const uint8_t*>(record.data())
+      + fields[field].offset;
+  }
+
+  size_t ShmRingReader::get_length(size_t field) const {
+    assert(field < header->field_count);
+    if (fields[field].varlen)
+      return varlen_values[field].size();
+    return fields[field].width;
+  }
+
+  uint64_t ShmRingReader::get_sequence() const {
+    return next - 1;
+  }
+
+  uint64_t ShmRingReader::get_lost_count() const {
+    return lost;
+  }
+
+} // namespace libfc
@@ -0,0 +1,185 @@
+/* Hi Emacs, please use -*- mode: C++; -*- */
+/* Copyright (c) 2011-2014 ETH Zürich. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ *    * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *    * Neither the names of ETH Zürich nor the names of other contributors 
+ *      may be used to endorse or promote products derived from this software 
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL ETH 
+ * ZURICH BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, 
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, 
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR 
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY 
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ * @author Stephan Neuhaus <neuhaust@tik.ee.ethz.ch>
+ */
+
+#ifndef _libfc_SHMRINGREADER_H_
+#  define _libfc_SHMRINGREADER_H_
+
+#  include <cstdint>
+#  include <string>
+#  include <vector>
+
+#  include "InfoElement.h"
+#  include "ShmRing.h"
+
+namespace libfc {
+
+  /** Reads records from a ring published by ShmRingPublisher.
+   *
+   * A reader starts with the first record published after it has
+   * opened the ring, and reads records one at a time with read():
+   *
+   * @code
+   * ShmRingReader reader("/libfc-flows");
+   * int octets = reader.find_field(model.lookupIE("octetDeltaCount"));
+   *
+   * for (;;) {
+   *   ShmRingReader::Status s = reader.read();
+   *   if (s == ShmRingReader::closed)
+   *     break;
+   *   else if (s == ShmRingReader::empty)
+   *     usleep(1000);
+   *   else
+   *     total += *static_cast<const uint64_t*>(reader.get_value(octets));
+   * }
+   * @endcode
+   *
+   * Reading never blocks or disturbs the publisher or other readers.
+   * A reader that has fallen so far behind that the publisher has
+   * overwritten records it hasn't read yet skips ahead to the middle
+   * of the ring; get_lost_count() tells how many records were lost.
+   */
+  class ShmRingReader {
+  public:
+    /** The result of read(). */
+    enum Status {
+      /** A record has been read. */
+      ok,
+      /** No new record has been published yet. */
+      empty,
+      /** All records have been read, and the publisher has gone
+       * away. */
+      closed,
+    };
+
+    /** Opens a ring.
+     *
+     * @param name the name with which the ring was published
+     *
+     * @throw FormatError if there is no such ring, or if it isn't a
+     *   ring that this reader understands
+     */
+    explicit ShmRingReader(const std::string& name);
+    ~ShmRingReader();
+
+    /** Reads the next record.
+     *
+     * If this returns ok, the record's values are available through
+     * get_value() and get_length() until the next call.
+     *
+     * @return whether a record was read
+     */
+    Status read();
+
+    /** Returns the number of fields in a record.
+     *
+     * @return the number of fields
+     */
+    size_t get_field_count() const;
+
+    /** Returns the description of a field.
+     *
+     * @param field the index of the field
+     *
+     * @return the description of the field
+     */
+    const ShmRingField& get_field(size_t field) const;
+
+    /** Looks up the field that holds an IE.
+     *
+     * @param ie the IE
+     *
+     * @return the index of the field, or -1 if the ring doesn't have
+     *   that IE
+     */
+    int find_field(const InfoElement* ie) const;
+
+    /** Returns a value of the record last read.
+     *
+     * Fixed-length values are as placed by a PlacementTemplate; for
+     * example, an ipv4Address is a uint32_t in host byte order.
+     * Values are suitably aligned for their type.
+     *
+     * @param field the index of the field
+     *
+     * @return the value
+     */
+    const void* get_value(size_t field) const;
+
+    /** Returns the length of a value of the record last read.
+     *
+     * @param field the index of the field
+     *
+     * @return the length of the value in octets
+     */
+    size_t get_length(size_t field) const;
+
+    /** Returns the sequence number of the record last read, which
+     * counts the records published, starting at zero.
+     *
+     * @return the sequence number of the record last read
+     */
+    uint64_t get_sequence() const;
+
+    /** Returns the number of records that were overwritten before
+     * this reader could read them.
+     *
+     * @return the number of records lost
+     */
+    uint64_t get_lost_count() const;
+
+  private:
+    void skip(uint64_t head);
+
+    std::string name;
+    const uint8_t* base;
+    size_t size;
+    const ShmRingHeader* header;
+    const ShmRingField* fields;
+    const uint8_t* slots;
+    const uint8_t* arena;
+    uint64_t slot_mask;
+    uint64_t arena_size;
+
+    /** Indices of the fields with values in the arena. */
+    std::vector<size_t> varlen_fields;
+
+    /** The record last read, and its variable-length values. */
+    std::vector<uint64_t> record;
+    std::vector<std::vector<uint8_t> > varlen_values;
+
+    uint64_t next;
+    uint64_t lost;
+  };
+
+} // namespace libfc
+
+#endif // _libfc_SHMRINGREADER_H_
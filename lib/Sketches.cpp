@@ -0,0 +1,366 @@
+/* Copyright (c) 2011-2014 ETH Zürich. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ *    * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *    * Neither the names of ETH Zürich nor the names of other contributors 
+ *      may be used to endorse or promote products derived from this software 
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL ETH 
+ * ZURICH BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, 
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, 
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR 
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY 
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <map>
+#include <string>
+
+#include "Sketches.h"
+
+#include "hash_util.h"
+
+namespace libfc {
+
+  uint64_t sketch_hash(const uint8_t* key, size_t length) {
+    return hash_finish(hash_octets(hash_seed ^ length, key, length));
+  }
+
+  CountMinSketch::CountMinSketch(size_t width, unsigned int depth)
+    : width(1),
+      depth(depth),
+      total_weight(0) {
+    assert(depth > 0);
+    while (this->width < width)
+      this->width *= 2;
+    assert(this->width <= UINT32_MAX);
+    counters.assign(this->width*depth, 0);
+  }
+
+  /* The rows use the hashes h1 + i*h2, made from the two halves of
+   * the key hash (Kirsch and Mitzenmacher). */
+  void CountMinSketch::add(uint64_t hash, uint64_t weight) {
+    uint32_t h1 = static_cast<uint32_t>(hash);
+    uint32_t h2 = static_cast<uint32_t>(hash >> 32) | 1;
+    size_t mask = width - 1;
+
+    for (unsigned int i = 0; i < depth; i++)
+      counters[i*width + ((h1 + i*h2) & mask)] += weight;
+    total_weight += weight;
+  }
+
+  uint64_t CountMinSketch::estimate(uint64_t hash) const {
+    uint32_t h1 = static_cast<uint32_t>(hash);
+    uint32_t h2 = static_cast<uint32_t>(hash >> 32) | 1;
+    size_t mask = width - 1;
+
+    uint64_t ret = UINT64_MAX;
+    for (unsigned int i = 0; i < depth; i++)
+      ret = std::min(ret, counters[i*width + ((h1 + i*h2) & mask)]);
+    return ret;
+  }
+
+  uint64_t CountMinSketch::total() const {
+    return total_weight;
+  }
+
+  CountMinSketch& CountMinSketch::operator+=(const CountMinSketch& rhs) {
+    assert(width == rhs.width && depth == rhs.depth);
+    for (size_t i = 0; i < counters.size(); i++)
+      counters[i] += rhs.counters[i];
+    total_weight += rhs.total_weight;
+    return *this;
+  }
+
+  void CountMinSketch::reset() {
+    std::fill(counters.begin(), counters.end(), 0);
+    total_weight = 0;
+  }
+
+  HyperLogLog::HyperLogLog(unsigned int precision)
+    : precision(precision),
+      registers(static_cast<size_t>(1) << precision, 0) {
+    assert(4 <= precision && precision <= 18);
+  }
+
+  double HyperLogLog::estimate() const {
+    double m = registers.size();
+    double alpha = m == 16 ? 0.673 : m == 32 ? 0.697 : m == 64 ? 0.709
+      : 0.7213/(1.0 + 1.079/m);
+
+    double sum = 0.0;
+    unsigned int zeros = 0;
+    for (auto r = registers.begin(); r != registers.end(); ++r) {
+      sum += std::ldexp(1.0, -*r);
+      if (*r == 0)
+        zeros++;
+    }
+
+    double e = alpha*m*m/sum;
+    if (e <= 2.5*m && zeros > 0)
+      e = m*std::log(m/zeros);
+    return e;
+  }
+
+  HyperLogLog& HyperLogLog::operator+=(const HyperLogLog& rhs) {
+    assert(precision == rhs.precision);
+    for (size_t i = 0; i < registers.size(); i++)
+      registers[i] = std::max(registers[i], rhs.registers[i]);
+    return *this;
+  }
+
+  void HyperLogLog::reset() {
+    std::fill(registers.begin(), registers.end(), 0);
+  }
+
+  SpaceSaving::SpaceSaving(size_t k, size_t key_length)
+    : k(k),
+      key_length(key_length),
+      n_entries(0),
+      keys(k*key_length),
+      hashes(k),
+      counts(k),
+      errors(k),
+      heap(k),
+      heap_pos(k) {
+    assert(0 < k && k < UINT32_MAX);
+
+    size_t index_size = 16;
+    while (index_size < 2*k)
+      index_size *= 2;
+    index.assign(index_size, 0);
+    index_mask = index_size - 1;
+  }
+
+  size_t SpaceSaving::find(const uint8_t* key, uint64_t hash) const {
+    for (size_t pos = hash & index_mask; index[pos] != 0;
+         pos = (pos + 1) & index_mask) {
+      uint32_t e = index[pos] - 1;
+      if (hashes[e] == hash
+          && memcmp(&keys[e*key_length], key, key_length) == 0)
+        return pos;
+    }
+    return index.size();
+  }
+
+  void SpaceSaving::index_insert(uint32_t e) {
+    size_t pos = hashes[e] & index_mask;
+    while (index[pos] != 0)
+      pos = (pos + 1) & index_mask;
+    index[pos] = e + 1;
+  }
+
+  void SpaceSaving::index_remove(size_t pos) {
+    /* Backward-shift deletion, so that probe sequences stay
+     * unbroken without tombstones. */
+    size_t hole = pos;
+    for (size_t j = (hole + 1) & index_mask; index[j] != 0;
+         j = (j + 1) & index_mask) {
+      size_t home = hashes[index[j] - 1] & index_mask;
+      if (((j - home) & index_mask) >= ((j - hole) & index_mask)) {
+        index[hole] = index[j];
+        hole = j;
+      }
+    }
+    index[hole] = 0;
+  }
+
+  void SpaceSaving::swap_heap(size_t a, size_t b) {
+    std::swap(heap[a], heap[b]);
+    heap_pos[heap[a]] = a;
+    heap_pos[heap[b]] = b;
+  }
+
+  void SpaceSaving::sift_up(size_t pos) {
+    while (pos > 0) {
+      size_t parent = (pos - 1)/2;
+      if (counts[heap[parent]] <= counts[heap[pos]])
+        break;
+      swap_heap(pos, parent);
+      pos = parent;
+    }
+  }
+
+  void SpaceSaving::sift_down(size_t pos) {
+    for (;;) {
+      size_t smallest = pos;
+      size_t left = 2*pos + 1;
+      size_t right = left + 1;
+      if (left < n_entries && counts[heap[left]] < counts[heap[smallest]])
+        smallest = left;
+      if (right < n_entries && counts[heap[right]] < counts[heap[smallest]])
+        smallest = right;
+      if (smallest == pos)
+        break;
+      swap_heap(pos, smallest);
+      pos = smallest;
+    }
+  }
+
+  void SpaceSaving::add(const uint8_t* key, uint64_t hash, uint64_t weight) {
+    size_t pos = find(key, hash);
+    if (pos != index.size()) {
+      uint32_t e = index[pos] - 1;
+      counts[e] += weight;
+      sift_down(heap_pos[e]);
+      return;
+    }
+
+    uint32_t e;
+    uint64_t base = 0;
+    if (n_entries < k) {
+      e = n_entries++;
+      heap[e] = e;
+      heap_pos[e] = e;
+    } else {
+      /* Replace the key with the smallest count. */
+      e = heap[0];
+      base = counts[e];
+      pos = find(&keys[e*key_length], hashes[e]);
+      assert(pos != index.size());
+      index_remove(pos);
+    }
+
+    memcpy(&keys[e*key_length], key, key_length);
+    hashes[e] = hash;
+    counts[e] = base + weight;
+    errors[e] = base;
+    index_insert(e);
+
+    if (base == 0)
+      sift_up(heap_pos[e]);
+    sift_down(heap_pos[e]);
+  }
+
+  std::vector<SpaceSaving::Entry> SpaceSaving::top(size_t n) const {
+    std::vector<uint32_t> order(n_entries);
+    for (uint32_t e = 0; e < n_entries; e++)
+      order[e] = e;
+    n = std::min(n, static_cast<size_t>(n_entries));
+    std::partial_sort(order.begin(), order.begin() + n, order.end(),
+                      [this](uint32_t a, uint32_t b) {
+                        return counts[a] > counts[b];
+                      });
+
+    std::vector<Entry> ret(n);
+    for (size_t i = 0; i < n; i++) {
+      uint32_t e = order[i];
+      ret[i].key.assign(keys.begin() + e*key_length,
+                        keys.begin() + (e + 1)*key_length);
+      ret[i].count = counts[e];
+      ret[i].error = errors[e];
+    }
+    return ret;
+  }
+
+  size_t SpaceSaving::size() const {
+    return n_entries;
+  }
+
+  uint64_t SpaceSaving::min_count() const {
+    return n_entries == k ? counts[heap[0]] : 0;
+  }
+
+  SpaceSaving& SpaceSaving::operator+=(const SpaceSaving& rhs) {
+    assert(key_length == rhs.key_length);
+
+    struct Merged {
+      uint64_t hash;
+      uint64_t count;
+      uint64_t error;
+      bool in_lhs;
+      bool in_rhs;
+    };
+    std::map<std::string, Merged> merged;
+
+    uint64_t lhs_min = min_count();
+    uint64_t rhs_min = rhs.min_count();
+
+    for (size_t e = 0; e < n_entries; e++) {
+      Merged& m = merged[std::string(
+        reinterpret_cast<const char*>(&keys[e*key_length]), key_length)];
+      m.hash = hashes[e];
+      m.count = counts[e];
+      m.error = errors[e];
+      m.in_lhs = true;
+      m.in_rhs = false;
+    }
+    for (size_t e = 0; e < rhs.n_entries; e++) {
+      std::string key(reinterpret_cast<const char*>(&rhs.keys[e*key_length]),
+                      key_length);
+      auto i = merged.find(key);
+      if (i == merged.end()) {
+        Merged& m = merged[key];
+        m.hash = rhs.hashes[e];
+        m.count = rhs.counts[e];
+        m.error = rhs.errors[e];
+        m.in_lhs = false;
+        m.in_rhs = true;
+      } else {
+        i->second.count += rhs.counts[e];
+        i->second.error += rhs.errors[e];
+        i->second.in_rhs = true;
+      }
+    }
+
+    std::vector<std::pair<uint64_t, const std::pair<const std::string,
+                                                    Merged>*> > order;
+    for (auto i = merged.begin(); i != merged.end(); ++i) {
+      Merged& m = i->second;
+      if (!m.in_lhs) {
+        m.count += lhs_min;
+        m.error += lhs_min;
+      }
+      if (!m.in_rhs) {
+        m.count += rhs_min;
+        m.error += rhs_min;
+      }
+      order.push_back(std::make_pair(m.count, &*i));
+    }
+    size_t n = std::min(k, order.size());
+    std::partial_sort(order.begin(), order.begin() + n, order.end(),
+                      [](const std::pair<uint64_t, const std::pair<
+                           const std::string, Merged>*>& a,
+                         const std::pair<uint64_t, const std::pair<
+                           const std::string, Merged>*>& b) {
+                        return a.first > b.first;
+                      });
+
+    reset();
+    for (size_t i = 0; i < n; i++) {
+      const std::string& key = order[i].second->first;
+      const Merged& m = order[i].second->second;
+      uint32_t e = n_entries++;
+      memcpy(&keys[e*key_length], key.data(), key_length);
+      hashes[e] = m.hash;
+      counts[e] = m.count;
+      errors[e] = m.error;
+      heap[e] = e;
+      heap_pos[e] = e;
+      index_insert(e);
+      sift_up(e);
+    }
+    return *this;
+  }
+
+  void SpaceSaving::reset() {
+    n_entries = 0;
+    std::fill(index.begin(), index.end(), 0);
+  }
+
+} // namespace libfc
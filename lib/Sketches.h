@@ -0,0 +1,237 @@
+/* Hi Emacs, please use -*- mode: C++; -*- */
+/* Copyright (c) 2011-2014 ETH Zürich. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ *    * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *    * Neither the names of ETH Zürich nor the names of other contributors 
+ *      may be used to endorse or promote products derived from this software 
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL ETH 
+ * ZURICH BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, 
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, 
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR 
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY 
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ * @author Stephan Neuhaus <neuhaust@tik.ee.ethz.ch>
+ */
+
+#ifndef _libfc_SKETCHES_H_
+#  define _libfc_SKETCHES_H_
+
+#  include <cstdint>
+#  include <vector>
+
+namespace libfc {
+
+  /** Hashes a key of arbitrary length to 64 bits.
+   *
+   * The sketches below take hashes rather than keys, so that a key
+   * that is fed to several sketches is hashed only once.
+   *
+   * @param key the key
+   * @param length the length of the key in octets
+   *
+   * @return the hash of the key
+   */
+  uint64_t sketch_hash(const uint8_t* key, size_t length);
+
+  /** A Count-Min sketch of the frequencies of keys.
+   *
+   * The sketch has depth rows of width counters.  Adding a key adds
+   * to one counter per row; the estimate for a key is the smallest of
+   * its counters.  Estimates are never too small, and with
+   * probability 1 - 2^-depth too large by at most
+   * e/width times the total weight.
+   */
+  class CountMinSketch {
+  public:
+    /** Creates a sketch.
+     *
+     * @param width the number of counters per row; rounded up to a
+     *   power of two
+     * @param depth the number of rows
+     */
+    explicit CountMinSketch(size_t width = 4096, unsigned int depth = 4);
+
+    /** Adds weight to a key.
+     *
+     * @param hash the hash of the key
+     * @param weight the weight to add
+     */
+    void add(uint64_t hash, uint64_t weight = 1);
+
+    /** Returns the estimated weight of a key.
+     *
+     * @param hash the hash of the key
+     *
+     * @return the estimated weight
+     */
+    uint64_t estimate(uint64_t hash) const;
+
+    /** Returns the total weight added. */
+    uint64_t total() const;
+
+    /** Adds the counts of another sketch with the same width and
+     * depth. */
+    CountMinSketch& operator+=(const CountMinSketch& rhs);
+
+    void reset();
+
+  private:
+    size_t width;
+    unsigned int depth;
+    uint64_t total_weight;
+    std::vector<uint64_t> counters;
+  };
+
+  /** A HyperLogLog sketch of the number of distinct keys.
+   *
+   * With precision p, the sketch has 2^p one-octet registers, and
+   * the relative standard error of the estimate is about
+   * 1.04/sqrt(2^p), i.e., 1.6% for the default p = 12, in 4 KiB.
+   * Small cardinalities are estimated by linear counting.
+   */
+  class HyperLogLog {
+  public:
+    /** Creates a sketch.
+     *
+     * @param precision the number of index bits, between 4 and 18
+     */
+    explicit HyperLogLog(unsigned int precision = 12);
+
+    /** Adds a key.
+     *
+     * @param hash the hash of the key
+     */
+    void add(uint64_t hash) {
+      uint64_t index = hash >> (64 - precision);
+      /* The rank is the position of the first one bit in the
+       * remaining bits; the or-ed in bit bounds it. */
+      uint64_t rest = (hash << precision) | (1ULL << (precision - 1));
+      uint8_t rank = static_cast<uint8_t>(__builtin_clzll(rest) + 1);
+      if (rank > registers[index])
+        registers[index] = rank;
+    }
+
+    /** Returns the estimated number of distinct keys. */
+    double estimate() const;
+
+    /** Merges another sketch with the same precision, so that this
+     * sketch estimates the number of keys added to either. */
+    HyperLogLog& operator+=(const HyperLogLog& rhs);
+
+    void reset();
+
+  private:
+    unsigned int precision;
+    std::vector<uint8_t> registers;
+  };
+
+  /** The k most frequent keys, found with the SpaceSaving algorithm.
+   *
+   * The summary keeps k keys with counts.  A new key that is not
+   * among them replaces the key with the smallest count c, and
+   * starts with count c plus its weight; c is remembered as the
+   * error of the new count.  Every key whose weight is more than
+   * 1/k of the total is in the summary, and its count exceeds its
+   * true weight by at most the error.
+   *
+   * Keys are found through an open-addressing hash index, and the
+   * smallest count through a binary heap, so that an update costs
+   * O(log k) in the worst case and O(1) for most keys that are
+   * already in the summary.
+   */
+  class SpaceSaving {
+  public:
+    /** A key with its count. */
+    struct Entry {
+      std::vector<uint8_t> key;
+      uint64_t count;
+      /** The count may exceed the true weight by up to this much. */
+      uint64_t error;
+    };
+
+    /** Creates a summary.
+     *
+     * @param k the number of keys to keep
+     * @param key_length the length of every key in octets
+     */
+    SpaceSaving(size_t k, size_t key_length);
+
+    /** Adds weight to a key.
+     *
+     * @param key the key, key_length octets
+     * @param hash the hash of the key
+     * @param weight the weight to add
+     */
+    void add(const uint8_t* key, uint64_t hash, uint64_t weight = 1);
+
+    /** Returns the keys with the largest counts.
+     *
+     * @param n the number of keys to return, at most k
+     *
+     * @return the keys in decreasing order of count
+     */
+    std::vector<Entry> top(size_t n) const;
+
+    /** Returns the number of keys in the summary. */
+    size_t size() const;
+
+    /** Merges another summary with the same key length.
+     *
+     * Counts of keys in both summaries are added.  A key in only one
+     * summary is given the smallest count of the other, if the other
+     * is full, as count and error.  The k largest counts are kept.
+     */
+    SpaceSaving& operator+=(const SpaceSaving& rhs);
+
+    void reset();
+
+  private:
+    size_t find(const uint8_t* key, uint64_t hash) const;
+    void index_insert(uint32_t entry);
+    void index_remove(size_t pos);
+    void sift_up(size_t pos);
+    void sift_down(size_t pos);
+    void swap_heap(size_t a, size_t b);
+
+    /** The smallest count, if the summary is full, 0 otherwise. */
+    uint64_t min_count() const;
+
+    size_t k;
+    size_t key_length;
+    size_t n_entries;
+
+    std::vector<uint8_t> keys;
+    std::vector<uint64_t> hashes;
+    std::vector<uint64_t> counts;
+    std::vector<uint64_t> errors;
+
+    /** Entries ordered as a min-heap by count, and the position of
+     * each entry in the heap. */
+    std::vector<uint32_t> heap;
+    std::vector<uint32_t> heap_pos;
+
+    /** Entry plus one for each slot, or 0 for empty slots. */
+    std::vector<uint32_t> index;
+    size_t index_mask;
+  };
+
+} // namespace libfc
+
+#endif // _libfc_SKETCHES_H_
@@ -39,6 +39,7 @@
 #endif /* defined(_libfc_HAVE_LOG4CPLUS_) */
 
 #include "decode_util.h"
+#include "trace_util.h"
 
 namespace libfc {
 
@@ -185,6 +186,10 @@ namespace libfc {
         libfc_RETURN_ERROR(fatal, system_error, "read error", errno,
                            &is, message, 0, 0);
 
+#if defined(_libfc_HAVE_LATENCY_HISTOGRAMS_)
+      uint64_t message_start = TscClock::now();
+#endif /* defined(_libfc_HAVE_LATENCY_HISTOGRAMS_) */
+
       /* Basetime computation as per email from Brian:
        *
        * (2) The header in general is different, crucially containing
@@ -222,6 +227,10 @@ namespace libfc {
        * read the corresponding comment in IPFIXMessageStreamParser.cpp.
        */
       set_no = 1;
+      uint64_t n_template_sets = 0;
+      uint64_t n_options_template_sets = 0;
+      uint64_t n_data_sets = 0;
+
       while (cur + kV9SetHeaderLen <= message_end) {
         /* Decode set header. */
         uint16_t set_id = decode_uint16(cur + 0);
@@ -244,6 +253,7 @@ namespace libfc {
               set_id, set_length - kV9SetHeaderLen, cur));
           cur += set_length - kV9SetHeaderLen;
           libfc_RETURN_CALLBACK_ERROR(end_template_set());
+          n_template_sets++;
         } else if (set_id == kV9OptionTemplateSetID) {
           libfc_RETURN_CALLBACK_ERROR(
             start_options_template_set(
@@ -251,12 +261,14 @@ namespace libfc {
           cur += set_length - kV9SetHeaderLen;
           libfc_RETURN_CALLBACK_ERROR(
             end_options_template_set());
+          n_options_template_sets++;
         } else if (set_id >= kV9MinDataSetId) {
           libfc_RETURN_CALLBACK_ERROR(
             start_data_set(
               set_id, set_length - kV9SetHeaderLen, cur));
           cur += set_length - kV9SetHeaderLen;
           libfc_RETURN_CALLBACK_ERROR(end_data_set());
+          n_data_sets++;
         } else
           libfc_RETURN_ERROR(recoverable, format_error,
                              "Set has ID " << set_id << ", which is not "
@@ -269,10 +281,23 @@ namespace libfc {
         set_no++;
       }
 
-      LOG4CPLUS_TRACE(logger, "Got " << (set_no - 1) << " sets");
+      libfc_HOT_TRACE(logger, "Got " << (set_no - 1) << " sets");
 
       libfc_RETURN_CALLBACK_ERROR(end_message());
 
+#if defined(_libfc_HAVE_LATENCY_HISTOGRAMS_)
+      if (latencies != 0)
+        latencies->message.record(TscClock::now() - message_start);
+#endif /* defined(_libfc_HAVE_LATENCY_HISTOGRAMS_) */
+
+      if (counters != 0) {
+        counters->messages.add(1);
+        counters->message_octets.add(message_size);
+        counters->template_sets.add(n_template_sets);
+        counters->options_template_sets.add(n_options_template_sets);
+        counters->data_sets.add(n_data_sets);
+      }
+
       offset += nbytes;
       is.advance_message_offset();
       memset(message, '\0', sizeof(message));
@@ -0,0 +1,186 @@
+/* Copyright (c) 2011-2014 ETH Zürich. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ *    * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *    * Neither the names of ETH Zürich nor the names of other contributors 
+ *      may be used to endorse or promote products derived from this software 
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL ETH 
+ * ZURICH BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, 
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, 
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR 
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY 
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+
+#if defined(_libfc_HAVE_LOG4CPLUS_)
+#  include <log4cplus/loggingmacros.h>
+#else
+#  define LOG4CPLUS_TRACE(logger, expr)
+#endif /* defined(_libfc_HAVE_LOG4CPLUS_) */
+
+#include "Constants.h"
+#include "WandioExportDestination.h"
+
+#include "exceptions/ExportError.h"
+
+namespace libfc {
+
+  /** Maximum number of blocks waiting for the compressor. */
+  static const size_t max_pending_blocks = 2;
+
+  WandioExportDestination::WandioExportDestination(
+      const std::string& _file_name,
+      int compression_type,
+      int compression_level,
+      size_t _block_size)
+    : iow(0),
+      file_name(_file_name),
+      block_size(_block_size),
+      compressing(false),
+      shutting_down(false),
+      write_failed(false)
+#if defined(_libfc_HAVE_LOG4CPLUS_)
+    , logger(log4cplus::Logger::getInstance(LOG4CPLUS_TEXT("WandioExportDestination")))
+#endif /* defined(_libfc_HAVE_LOG4CPLUS_) */
+  {
+    if (block_size == 0)
+      block_size = default_block_size;
+
+    iow = wandio_wcreate(file_name.c_str(), compression_type,
+                         compression_level, O_CREAT);
+    if (iow == 0)
+      throw ExportError("Can't create \"" + file_name + "\"");
+
+    /* A message is never split across blocks, so a block may exceed
+     * block_size by up to one maximum-size message. */
+    current_block.reserve(block_size + kMaxMessageLen);
+
+    compressor = std::thread(&WandioExportDestination::compress_blocks,
+                             this);
+  }
+
+  WandioExportDestination::~WandioExportDestination() {
+    flush();
+
+    {
+      std::unique_lock<std::mutex> guard(queue_lock);
+      shutting_down = true;
+    }
+    block_queued.notify_one();
+    compressor.join();
+
+    wandio_wdestroy(iow);
+  }
+
+  ssize_t WandioExportDestination::writev(const std::vector< ::iovec>& iovecs) {
+    LOG4CPLUS_TRACE(logger, "ENTER WandioExportDestination::writev");
+    LOG4CPLUS_TRACE(logger, "writing " << iovecs.size() << " iovecs");
+
+    ssize_t total = 0;
+    for (auto i = iovecs.begin(); i != iovecs.end(); ++i) {
+      const uint8_t* base = static_cast<const uint8_t*>(i->iov_base);
+      current_block.insert(current_block.end(), base, base + i->iov_len);
+      total += i->iov_len;
+    }
+    LOG4CPLUS_TRACE(logger, "total=" << total);
+
+    std::unique_lock<std::mutex> guard(queue_lock);
+    if (current_block.size() >= block_size)
+      hand_off(guard);
+
+    if (write_failed) {
+      errno = EIO;
+      return -1;
+    }
+    return total;
+  }
+
+  int WandioExportDestination::flush() {
+    LOG4CPLUS_TRACE(logger, "ENTER WandioExportDestination::flush");
+
+    std::unique_lock<std::mutex> guard(queue_lock);
+    if (!current_block.empty())
+      hand_off(guard);
+
+    while (compressing || !pending_blocks.empty())
+      block_written.wait(guard);
+
+    return write_failed ? -1 : 0;
+  }
+
+  bool WandioExportDestination::is_connectionless() const {
+    return false;
+  }
+
+  size_t WandioExportDestination::preferred_maximum_message_size() const {
+    return kMaxMessageLen;
+  }
+
+  void WandioExportDestination::hand_off(std::unique_lock<std::mutex>& guard) {
+    LOG4CPLUS_TRACE(logger, "handing off block of "
+                    << current_block.size() << " octets");
+
+    while (pending_blocks.size() >= max_pending_blocks)
+      block_written.wait(guard);
+
+    pending_blocks.push_back(std::vector<uint8_t>());
+    pending_blocks.back().swap(current_block);
+
+    if (!free_blocks.empty()) {
+      current_block.swap(free_blocks.back());
+      free_blocks.pop_back();
+    } else
+      current_block.reserve(block_size + kMaxMessageLen);
+
+    block_queued.notify_one();
+  }
+
+  void WandioExportDestination::compress_blocks() {
+    std::unique_lock<std::mutex> guard(queue_lock);
+
+    while (true) {
+      while (pending_blocks.empty() && !shutting_down)
+        block_queued.wait(guard);
+      if (pending_blocks.empty())
+        break;
+
+      std::vector<uint8_t> block;
+      block.swap(pending_blocks.front());
+      pending_blocks.pop_front();
+      compressing = true;
+
+      /* Compress without holding the lock, so that the exporter can
+       * go on filling the next block. */
+      guard.unlock();
+      int64_t n = wandio_wwrite(iow, block.data(), block.size());
+      guard.lock();
+
+      if (n != static_cast<int64_t>(block.size()))
+        write_failed = true;
+
+      block.clear();
+      if (free_blocks.size() < max_pending_blocks)
+        free_blocks.push_back(std::move(block));
+
+      compressing = false;
+      block_written.notify_all();
+    }
+  }
+
+} // namespace libfc
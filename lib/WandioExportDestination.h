@@ -0,0 +1,163 @@
+/* Hi Emacs, please use -*- mode: C++; -*- */
+/* Copyright (c) 2011-2014 ETH Zürich. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ *    * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *    * Neither the names of ETH Zürich nor the names of other contributors 
+ *      may be used to endorse or promote products derived from this software 
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL ETH 
+ * ZURICH BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, 
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, 
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR 
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY 
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ * @author Stephan Neuhaus <neuhaust@tik.ee.ethz.ch>
+ */
+
+#ifndef _libfc_WANDIOEXPORTDESTINATION_H_
+#  define _libfc_WANDIOEXPORTDESTINATION_H_
+
+#  include <condition_variable>
+#  include <deque>
+#  include <mutex>
+#  include <string>
+#  include <thread>
+
+extern "C" {
+#  include <wandio.h>
+}
+
+#  if defined(_libfc_HAVE_LOG4CPLUS_)
+#    include <log4cplus/logger.h>
+#  endif /* defined(_libfc_HAVE_LOG4CPLUS_) */
+
+#  include "ExportDestination.h"
+
+namespace libfc {
+
+  /** Compressed IPFIX file outputs.
+   *
+   * This export destination writes through libwandio's writer, so
+   * that the output can be read back with a WandioInputSource
+   * without a separate decompression pass.  The compression method
+   * is one of wandio's WANDIO_COMPRESS_* constants; zstd and lz4 are
+   * available as WANDIO_COMPRESS_ZSTD and WANDIO_COMPRESS_LZ4 if the
+   * installed wandio was built with them.
+   *
+   * Messages handed to writev() are gathered into blocks of
+   * (roughly) block_size octets.  Full blocks are compressed and
+   * written by a helper thread, so that the exporter does not have
+   * to wait for the compressor.  At most two blocks are queued for
+   * the helper thread at any one time; if the compressor falls
+   * behind, writev() will block until a block has been written.
+   *
+   * Since the compressor runs asynchronously, write errors are
+   * reported by the writev() or flush() call that follows the
+   * failed write.
+   */
+  class WandioExportDestination : public ExportDestination {
+  public:
+    /** Default size of a block handed to the compressor. */
+    static const size_t default_block_size = 1 << 20;
+
+    /** Creates a compressed file export destination.
+     *
+     * @param file_name the name of the file to create
+     * @param compression_type one of wandio's WANDIO_COMPRESS_*
+     *   constants
+     * @param compression_level the compression level, from 0 (no
+     *   compression) to 9 (best compression)
+     * @param block_size the number of octets to gather before
+     *   handing a block to the compressor
+     *
+     * @throw ExportError if the file could not be created
+     */
+    WandioExportDestination(const std::string& file_name,
+                            int compression_type = WANDIO_COMPRESS_ZLIB,
+                            int compression_level = 6,
+                            size_t block_size = default_block_size);
+
+    /** Destroys this export destination.
+     *
+     * Writes all outstanding blocks, stops the helper thread and
+     * closes the file.
+     */
+    ~WandioExportDestination();
+
+    ssize_t writev(const std::vector< ::iovec>& iovecs);
+
+    /** Flushes the stream.
+     *
+     * Hands the current block to the compressor and waits until all
+     * blocks have been written.
+     *
+     * @return 0 on success and -1 on error
+     */
+    int flush();
+
+    bool is_connectionless() const;
+    size_t preferred_maximum_message_size() const;
+
+  private:
+    /** Main loop of the helper thread. */
+    void compress_blocks();
+
+    /** Queues the current block for the helper thread and replaces
+     * it with an empty one.
+     *
+     * @param guard the lock on queue_lock, which must be held
+     */
+    void hand_off(std::unique_lock<std::mutex>& guard);
+
+    iow_t* iow;
+    std::string file_name;
+    size_t block_size;
+
+    /** Block currently being filled by writev(). Only ever touched
+     * by the exporting thread. */
+    std::vector<uint8_t> current_block;
+
+    /** Blocks waiting for the helper thread. */
+    std::deque<std::vector<uint8_t> > pending_blocks;
+
+    /** Written blocks, kept so that their memory can be reused. */
+    std::vector<std::vector<uint8_t> > free_blocks;
+
+    /** True while the helper thread is writing a block. */
+    bool compressing;
+
+    /** True when the helper thread should exit. */
+    bool shutting_down;
+
+    /** True if a block could not be written. */
+    bool write_failed;
+
+    std::mutex queue_lock;
+    std::condition_variable block_queued;
+    std::condition_variable block_written;
+    std::thread compressor;
+
+#  if defined(_libfc_HAVE_LOG4CPLUS_)
+    log4cplus::Logger logger;
+#  endif /* defined(_libfc_HAVE_LOG4CPLUS_) */
+  };
+
+} // namespace libfc
+
+#endif // _libfc_WANDIOEXPORTDESTINATION_H_
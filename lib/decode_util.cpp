@@ -46,7 +46,7 @@ namespace libfc {
 
   void report_error(const std::string message, ...) {
     static const size_t buf_size = 10240;
-    static char buf[buf_size];
+    char buf[buf_size];
     va_list args;
   
     va_start(args, message);
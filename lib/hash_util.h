@@ -0,0 +1,109 @@
+/* Hi Emacs, please use -*- mode: C++; -*- */
+/* Copyright (c) 2011-2014 ETH Zürich. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ *    * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *    * Neither the names of ETH Zürich nor the names of other contributors 
+ *      may be used to endorse or promote products derived from this software 
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL ETH 
+ * ZURICH BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, 
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, 
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR 
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY 
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ * @author Stephan Neuhaus <neuhaust@tik.ee.ethz.ch>
+ */
+
+#ifndef _libfc_HASH_UTIL_H_
+#  define _libfc_HASH_UTIL_H_
+
+#  include <cstddef>
+#  include <cstdint>
+#  include <cstring>
+
+namespace libfc {
+
+  /** Initial value for hash_mix(). */
+  static const uint64_t hash_seed = 0x9e3779b97f4a7c15ULL;
+
+  /** Returns the number of 64-bit words needed to hold some octets.
+   *
+   * @param octets the number of octets
+   *
+   * @return the number of words
+   */
+  inline size_t words(size_t octets) {
+    return (octets + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+  }
+
+  /** Mixes a 64-bit value into a hash.
+   *
+   * These functions are inline since they are called per record by
+   * the aggregation, deduplication and sketch code.
+   *
+   * @param h the hash so far
+   * @param v the value
+   *
+   * @return the new hash
+   */
+  inline uint64_t hash_mix(uint64_t h, uint64_t v) {
+    h ^= v;
+    h *= 0xff51afd7ed558ccdULL;
+    return h ^ (h >> 32);
+  }
+
+  /** Mixes octets into a hash, one 64-bit word at a time, with the
+   * last word padded with zeroes.  The octets need not be aligned.
+   *
+   * @param h the hash so far
+   * @param p the octets
+   * @param n the number of octets
+   *
+   * @return the new hash
+   */
+  inline uint64_t hash_octets(uint64_t h, const uint8_t* p, size_t n) {
+    for (; n >= sizeof(uint64_t); n -= sizeof(uint64_t), p += sizeof(uint64_t)) {
+      uint64_t v;
+      memcpy(&v, p, sizeof(v));
+      h = hash_mix(h, v);
+    }
+    if (n > 0) {
+      uint64_t v = 0;
+      memcpy(&v, p, n);
+      h = hash_mix(h, v);
+    }
+    return h;
+  }
+
+  /** Finishes a hash with the finalizer from MurmurHash3, so that
+   * every bit of the result depends on every bit of the input.
+   *
+   * @param h the hash so far
+   *
+   * @return the finished hash
+   */
+  inline uint64_t hash_finish(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    return h ^ (h >> 33);
+  }
+
+} // namespace libfc
+
+#endif /* _libfc_HASH_UTIL_H_ */
@@ -24,19 +24,27 @@
  * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
  * DAMAGE.
  */
+#include <deque>
 #include <set>
 
+#include <cassert>
+#include <cerrno>
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
 #include <iostream>
 #include <fstream>
 
+#include <sys/mman.h>
+#include <sys/stat.h>
+
 #include "libfc.h"
 
 #include "InfoModel.h"
 #include "PlacementTemplate.h"
 #include "PlacementCollector.h"
 #include "FileInputSource.h"
+#include "MemoryInputSource.h"
 #include "WandioInputSource.h"
 #include "exceptions/FormatError.h"
 #include "exceptions/IESpecError.h"
@@ -55,15 +63,82 @@ using namespace libfc;
 
 static bool infomodel_initialized = false;
 
-struct libfc_template_t {
-    PlacementTemplate tmpl;
-    int (*callback) (const libfc_template_t* t, void *vp);
-    void *vparg;
+/** A C template is a placement template with callbacks.
+ *
+ * Deriving from PlacementTemplate lets end_placement() get from the
+ * placement template to the C template with a static_cast. */
+struct libfc_template_t : public PlacementTemplate {
+  libfc_template_t()
+    : callback(0), vparg(0),
+      batch_callback(0), batch_vparg(0), capacity(0), n_records(0) {
+  }
+
+  /** A column registered with libfc_register_column(). */
+  struct Column {
+    /** The user's column array. */
+    uint8_t* base;
+
+    /** Size of a placed value in octets. */
+    size_t width;
+
+    /** Where the template places the value of the current record. */
+    uint8_t value[16];
+  };
+
+  /** Appends the current record to the columns.
+   *
+   * @return false if the batch callback asked to abort collection
+   */
+  bool append() {
+    size_t row = n_records;
+    for (auto c = columns.begin(); c != columns.end(); ++c) {
+      uint8_t* dst = c->base + row*c->width;
+      switch (c->width) {
+      case 1: *dst = c->value[0]; break;
+      case 2: memcpy(dst, c->value, 2); break;
+      case 4: memcpy(dst, c->value, 4); break;
+      case 8: memcpy(dst, c->value, 8); break;
+      default: memcpy(dst, c->value, c->width); break;
+      }
+    }
+    if (++n_records == capacity)
+      return flush();
+    return true;
+  }
+
+  /** Hands a partial or full batch to the batch callback.
+   *
+   * @return false if the batch callback asked to abort collection
+   */
+  bool flush() {
+    size_t n = n_records;
+    n_records = 0;
+    if (n == 0 || batch_callback == 0)
+      return true;
+    return batch_callback(this, n, batch_vparg) > 0;
+  }
+
+  int (*callback) (const libfc_template_t* t, void *vp);
+  void *vparg;
+
+  int (*batch_callback) (const libfc_template_t* t, size_t n, void *vp);
+  void *batch_vparg;
+
+  /** Number of records per batch, or 0 if there is no batch
+   * callback. */
+  size_t capacity;
+
+  /** Number of records in the current batch. */
+  size_t n_records;
+
+  /** The columns; a deque, because the placement template holds
+   * pointers into its elements. */
+  std::deque<Column> columns;
 };
 
 class CBinding : public PlacementCollector {
 private:
-  std::set<PlacementTemplate*> templates;
+  std::set<libfc_template_t*> templates;
 #  ifdef _libfc_HAVE_LOG4CPLUS_
   log4cplus::Logger logger;
 #  endif /* _libfc_HAVE_LOG4CPLUS_ */
@@ -86,8 +161,25 @@ public:
   }
 
   void add_template(libfc_template_t* t) {
-    templates.insert(&(t->tmpl));
-    register_placement_template(&(t->tmpl));
+    templates.insert(t);
+    register_placement_template(t);
+  }
+
+  /** Ends a collection, handing partial batches to their callbacks.
+   *
+   * @param ok whether the collection was successful; if not, partial
+   *   batches are discarded instead
+   *
+   * @return false if the collection was not successful, or if a
+   *   batch callback asked to abort
+   */
+  bool finish(bool ok) {
+    for (auto i = templates.begin(); i != templates.end(); ++i)
+      if (ok)
+        ok = (*i)->flush();
+      else
+        (*i)->n_records = 0;
+    return ok;
   }
 
   std::shared_ptr<ErrorContext>
@@ -97,26 +189,20 @@ public:
 
   std::shared_ptr<ErrorContext>
       end_placement(const PlacementTemplate* t) {
+    /* All templates registered with this collector are C templates,
+     * which we own and may change. */
+    libfc_template_t* this_template
+      = static_cast<libfc_template_t*>(const_cast<PlacementTemplate*>(t));
 
-    /* INSANE HACK which probably works -- get template from object.
-     *
-     * NOTE: This code only compiles when compiled with
-     * -Wno-invalid-offsetof.  The reason is that 1998 ISO C++
-     * forbids offsetof() for use with non-POD (plain-old-data)
-     * types.  But a libfc_template_t is a non-POD only because the
-     * PlacementTemplate inside it has a constructor and a few virtual
-     * member functions. I'm fairly confident that this code is OK,
-     * even though it may not be portable or strictly conforming to a
-     * standard.  --neuhaust */
-    const libfc_template_t* this_template =
-      reinterpret_cast<const libfc_template_t*>(
-        reinterpret_cast<const unsigned char*>(t)
-        - offsetof(struct libfc_template_t, tmpl));
-
-    if (this_template != 0)
-      if (this_template->callback(this_template, this_template->vparg) <= 0) {
-        libfc_RETURN_ERROR(fatal, aborted_by_user, "C callback abort", 0, 0, 0, 0, 0);
-      }
+    if (this_template->capacity > 0 && !this_template->append()) {
+      libfc_RETURN_ERROR(fatal, aborted_by_user, "C batch callback abort",
+                         0, 0, 0, 0, 0);
+    }
+    if (this_template->callback != 0
+        && this_template->callback(this_template,
+                                   this_template->vparg) <= 0) {
+      libfc_RETURN_ERROR(fatal, aborted_by_user, "C callback abort", 0, 0, 0, 0, 0);
+    }
     libfc_RETURN_OK();
   }
     
@@ -135,6 +221,27 @@ struct libfc_template_group_t {
   CBinding* binding;
 };
 
+/** Collects from an input source and finishes partial batches.
+ *
+ * @return non-zero on success and 0 on error
+ */
+static int collect(InputSource& is, struct libfc_template_group_t* s) {
+  int ret = 1;
+
+  try {
+    if (s->binding->collect(is) != 0)
+      ret = 0;
+  } catch (FormatError e) {
+    std::cerr << "Format error: " << e.what() << std::endl;
+    ret = 0;
+  }
+
+  if (!s->binding->finish(ret != 0))
+    ret = 0;
+
+  return ret;
+}
+
 extern struct libfc_template_group_t* libfc_template_group_new(int version) {
   PlacementCollector::Protocol protocol;
     
@@ -165,18 +272,18 @@ extern struct libfc_template_t* libfc_template_new(
   infomodel_initialized = true;
 
   struct libfc_template_t* ret = new libfc_template_t;
-  ret->callback = 0;
   s->binding->add_template(ret);
   return ret;
 }
 
 extern void libfc_template_group_delete(struct libfc_template_group_t* s) {
   delete s->binding;
+  delete s;
 }
 
 extern int libfc_register_placement(struct libfc_template_t* t,
                                     const char* ie_name, void* p, size_t size) {
-  return t->tmpl.register_placement(
+  return t->register_placement(
            InfoModel::instance().lookupIE(ie_name), p, size);
 }
 
@@ -188,32 +295,86 @@ extern void libfc_register_callback(struct libfc_template_t* t,
   t->vparg = vparg;
 }
 
-extern int libfc_collect_from_file(int fd, const char* name,
-                                   struct libfc_template_group_t* t) {
-  int ret = 1;
+extern int libfc_register_column(struct libfc_template_t* t,
+                                 const char* ie_name, void* column,
+                                 size_t size) {
+  const InfoElement* ie = InfoModel::instance().lookupIE(ie_name);
+  if (ie == 0)
+    return 0;
 
-  FileInputSource is(fd, name);
-  try {
-    t->binding->collect(is);
-  } catch (FormatError e) {
-    std::cerr << "Format error: " << e.what() << std::endl;
-    ret = 0;
+  size_t width = ie->ietype()->placedWidth();
+  if (width == 0)
+    return 0;
+
+  t->columns.push_back(libfc_template_t::Column());
+  libfc_template_t::Column& c = t->columns.back();
+  c.base = static_cast<uint8_t*>(column);
+  c.width = width;
+  if (!t->register_placement(ie, c.value, size)) {
+    t->columns.pop_back();
+    return 0;
   }
+  return 1;
+}
 
-  return ret;
+extern void libfc_register_batch_callback(
+    struct libfc_template_t* t, size_t capacity,
+    int (*c) (const struct libfc_template_t*, size_t, void *),
+    void *vparg) {
+  assert(capacity > 0);
+  t->batch_callback = c;
+  t->batch_vparg = vparg;
+  t->capacity = capacity;
+  t->n_records = 0;
 }
 
-extern int libfc_collect_from_wandio(io_t *wio, const char *name, struct libfc_template_group_t* t) {
-  int ret = 1;
+extern int libfc_collect_from_file(int fd, const char* name,
+                                   struct libfc_template_group_t* t) {
+  FileInputSource is(fd, name);
+  return collect(is, t);
+}
 
+extern int libfc_collect_from_wandio(io_t *wio, const char *name, struct libfc_template_group_t* t) {
   WandioInputSource is(wio, name);
-  try {
-    t->binding->collect(is);
-  } catch (FormatError e) {
-    std::cerr << "Format error: " << e.what() << std::endl;
-    ret = 0;
+  return collect(is, t);
+}
+
+extern int libfc_collect_from_buffer(const void* buf, size_t len,
+                                     const char* name,
+                                     struct libfc_template_group_t* s) {
+  MemoryInputSource is(static_cast<const uint8_t*>(buf), len, name);
+  return collect(is, s);
+}
+
+extern int libfc_collect_from_mmap(int fd, const char* name,
+                                   struct libfc_template_group_t* s) {
+  struct stat st;
+  if (fstat(fd, &st) < 0) {
+    std::cerr << "Can't stat " << name << ": " << strerror(errno)
+              << std::endl;
+    return 0;
+  }
+  if (!S_ISREG(st.st_mode)) {
+    std::cerr << "Can't map " << name << ": not a regular file"
+              << std::endl;
+    return 0;
   }
 
+  size_t len = static_cast<size_t>(st.st_size);
+  if (len == 0)
+    return 1;
+
+  void* p = mmap(0, len, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (p == MAP_FAILED) {
+    std::cerr << "Can't map " << name << ": " << strerror(errno)
+              << std::endl;
+    return 0;
+  }
+  (void) posix_madvise(p, len, POSIX_MADV_SEQUENTIAL);
+
+  int ret = libfc_collect_from_buffer(p, len, name, s);
+
+  (void) munmap(p, len);
   return ret;
 }
 
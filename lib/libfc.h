@@ -254,6 +254,71 @@ extern void libfc_register_callback(struct libfc_template_t* t,
                                     int (*c) (const struct libfc_template_t*,
                                                void *),
                                     void *vparg);
+
+  /** Registers a column array for an information element.
+   *
+   * Instead of a single memory location that is overwritten with
+   * every record, a column receives one value per record: the value
+   * from the i-th record of a batch is stored at
+   * <code>column + i*w</code>, where w is the native size of the
+   * information element's type:
+   *
+   *  - 1 for unsigned8, signed8 and boolean;
+   *  - 2 for unsigned16 and signed16;
+   *  - 4 for unsigned32, signed32, float32, ipv4Address (in host
+   *    byte order) and dateTimeSeconds;
+   *  - 8 for unsigned64, signed64, float64 and dateTimeMilliseconds,
+   *    dateTimeMicroseconds and dateTimeNanoseconds;
+   *  - 6 for macAddress and 16 for ipv6Address.
+   *
+   * Variable-length information elements (string and octetArray)
+   * can't be collected into columns.  The column must have room for
+   * as many values as the capacity given to
+   * libfc_register_batch_callback().
+   *
+   * @param t the template in which to register the column
+   * @param ie_name name of the information element
+   * @param column the column array
+   * @param size the size of the information element on the wire, or
+   *   0 for the default size
+   *
+   * @return non-zero if the operation was successful, 0 if the
+   *   information element is unknown, has variable length, or if the
+   *   given size is not appropriate for it.
+   */
+  extern int libfc_register_column(struct libfc_template_t* t,
+                                   const char* ie_name, void* column,
+                                   size_t size);
+
+  /** Registers a callback for when a batch of records is complete.
+   *
+   * Records that match the template are stored in the columns that
+   * were registered with libfc_register_column().  When capacity
+   * records have been stored, the callback is called with the number
+   * of records in the columns, after which the columns are reused
+   * from the beginning.  At the end of a collection, the callback is
+   * called once more for a partial batch, if there is one.  Calling
+   * a C function once per batch instead of once per record is much
+   * cheaper when records are small and plentiful.
+   *
+   * A template can have a batch callback and a per-record callback
+   * (registered with libfc_register_callback()) at the same time; the
+   * per-record callback is then called after the record has been
+   * stored in the columns.
+   *
+   * @param t the template
+   * @param capacity the number of records that fit into each column;
+   *   must be positive
+   * @param c the callback to call.  It must return a positive value
+   *   to continue collection, and zero or a negative value to abort
+   *   it.
+   * @param vparg an optional argument to pass to the callback
+   */
+  extern void libfc_register_batch_callback(
+    struct libfc_template_t* t, size_t capacity,
+    int (*c) (const struct libfc_template_t*, size_t, void *),
+    void *vparg);
+
   /** Collect IPFIX data from a file.
    *
    * @param fd a valid file descriptor, such as you'd get back from a
@@ -278,6 +343,43 @@ extern int libfc_collect_from_file(int fd, const char* name,
 extern int libfc_collect_from_wandio(io_t *wio, const char *name,
                                      struct libfc_template_group_t* s);
 
+  /** Collect IPFIX data from memory.
+   *
+   * The memory is not copied up front; as with any other input,
+   * the parser copies each message into its own buffer.
+   *
+   * @param buf memory containing one or more complete messages
+   * @param len the length of the memory in bytes
+   * @param name the name by which you want to have this memory known
+   *     to diagnostics
+   * @param s template set containing the templates of interest
+   *
+   * @return non-zero on success and 0 on error
+   */
+extern int libfc_collect_from_buffer(const void* buf, size_t len,
+                                     const char* name,
+                                     struct libfc_template_group_t* s);
+
+  /** Collect IPFIX data from a file by mapping it into memory.
+   *
+   * This is like libfc_collect_from_file(), but maps the file with
+   * mmap(2), which saves a read(2) call for every message.  The
+   * parser still copies each message out of the mapping.  The file
+   * must be a regular file.
+   * Unlike libfc_collect_from_file(), this function does not close
+   * the file descriptor.
+   *
+   * @param fd a valid file descriptor, such as you'd get back from a
+   *     successful call to open(2)
+   * @param name the name by which you want to have this file known to
+   *     diagnostics
+   * @param s template set containing the templates of interest
+   *
+   * @return non-zero on success and 0 on error
+   */
+extern int libfc_collect_from_mmap(int fd, const char* name,
+                                   struct libfc_template_group_t* s);
+
 
   /** Add IESpecs from a file to the information model
    *
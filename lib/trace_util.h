@@ -0,0 +1,113 @@
+/* Hi Emacs, please use -*- mode: C++; -*- */
+/* Copyright (c) 2011-2014 ETH Zürich. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ *    * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *    * Neither the names of ETH Zürich nor the names of other contributors 
+ *      may be used to endorse or promote products derived from this software 
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL ETH 
+ * ZURICH BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, 
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, 
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR 
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY 
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ * @author Stephan Neuhaus <neuhaust@tik.ee.ethz.ch>
+ *
+ * Trace logging on the decode hot path.
+ *
+ * Statements that are executed once per message, data set, record
+ * or field use libfc_HOT_TRACE instead of LOG4CPLUS_TRACE.  Unless
+ * libfc is built with LIBFC_HOT_PATH_TRACE, which defines
+ * _libfc_HAVE_HOT_PATH_TRACE_, these statements compile to nothing,
+ * so that a build with log4cplus keeps its warnings and info
+ * messages without paying for a logger level check per field.
+ *
+ * For trace-level diagnostics in such a build, use sampled tracing:
+ * after set_trace_sampling(N), one record in N is traced through
+ * libfc_SAMPLED_TRACE.
+ */
+
+#ifndef _libfc_TRACE_UTIL_H_
+#  define _libfc_TRACE_UTIL_H_
+
+#  include <atomic>
+
+#  if defined(_libfc_HAVE_LOG4CPLUS_)
+#    include <log4cplus/logger.h>
+#    include <log4cplus/loggingmacros.h>
+#  endif /* defined(_libfc_HAVE_LOG4CPLUS_) */
+
+#  if defined(_libfc_HAVE_LOG4CPLUS_) && defined(_libfc_HAVE_HOT_PATH_TRACE_)
+#    define libfc_HOT_TRACE(logger, expr) LOG4CPLUS_TRACE(logger, expr)
+#  else
+#    define libfc_HOT_TRACE(logger, expr)
+#  endif
+
+#  if defined(_libfc_HAVE_LOG4CPLUS_)
+#    define libfc_SAMPLED_TRACE(logger, sampler, expr) \
+  do {                                                 \
+    if ((sampler).sample())                            \
+      LOG4CPLUS_TRACE(logger, expr);                   \
+  } while (0)
+#  else
+#    define libfc_SAMPLED_TRACE(logger, sampler, expr)
+#  endif /* defined(_libfc_HAVE_LOG4CPLUS_) */
+
+namespace libfc {
+
+  /** Sets how often sampled tracing fires.
+   *
+   * @param n trace one record in n, or none if n is 0 (the default)
+   */
+  extern void set_trace_sampling(unsigned int n);
+
+  /** Returns the current trace sampling interval.
+   *
+   * @return the interval set by set_trace_sampling()
+   */
+  extern unsigned int get_trace_sampling();
+
+  /** Decides which events to trace when sampling.
+   *
+   * Each object that traces has its own sampler, so that sampling
+   * costs a decrement and a branch per event and does not touch
+   * shared state except once per sample.
+   */
+  class TraceSampler {
+  public:
+    TraceSampler() : countdown(0) {
+    }
+
+    /** Returns true for one call in get_trace_sampling() calls. */
+    bool sample() {
+      if (countdown > 1) {
+        countdown--;
+        return false;
+      }
+      countdown = get_trace_sampling();
+      return countdown != 0;
+    }
+
+  private:
+    unsigned int countdown;
+  };
+
+} // namespace libfc
+
+#endif // _libfc_TRACE_UTIL_H_
@@ -0,0 +1,132 @@
+/* Copyright (c) 2011-2014 ETH Zürich. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ *    * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *    * Neither the name of ETH Zürich, nor the names of its contributors 
+ *      may be used to endorse or promote products derived from this software 
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL ETH 
+ * ZURICH BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, 
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, 
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR 
+ * PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER 
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR 
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF 
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE
+ */
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/test_tools.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include "ArrowCollector.h"
+#include "BasicOctetArray.h"
+#include "FileExportDestination.h"
+#include "FileInputSource.h"
+#include "InfoModel.h"
+#include "TestRoundTrip.h"
+
+using namespace libfc;
+
+BOOST_AUTO_TEST_SUITE(Arrow)
+
+BOOST_AUTO_TEST_CASE(ArrowOutput) {
+  const char* ipfix_filename = "arrow-output.ipfix";
+  const char* arrow_filename = "arrow-output.arrow";
+  const unsigned int n_records = 250;
+
+  InfoModel& model = InfoModel::instance();
+  const InfoElement* odc = model.lookupIE("octetDeltaCount");
+  const InfoElement* ol = model.lookupIE("observationLabel");
+  BOOST_REQUIRE(odc != 0);
+  BOOST_REQUIRE(ol != 0);
+
+  export_file(ipfix_filename, 1, [&](PlacementExporter& e) {
+    uint64_t octet_delta_count;
+    BasicOctetArray observation_label;
+
+    PlacementTemplate out_template;
+    out_template.register_placement(odc, &octet_delta_count, 0);
+    out_template.register_placement(ol, &observation_label, 0);
+
+    for (unsigned int i = 0; i < n_records; i++) {
+      std::string label = "label-" + std::to_string(i);
+      octet_delta_count = i;
+      observation_label.copy_content(
+        reinterpret_cast<const uint8_t*>(label.data()), label.size());
+      e.place_values(&out_template);
+    }
+
+    e.flush();
+  });
+
+  int in_fd = open(ipfix_filename, O_RDONLY);
+  BOOST_REQUIRE(in_fd >= 0);
+  int out_fd = open(arrow_filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  BOOST_REQUIRE(out_fd >= 0);
+  {
+    std::vector<const InfoElement*> columns;
+    columns.push_back(odc);
+    columns.push_back(ol);
+
+    FileExportDestination d(out_fd);
+    ArrowCollector ac(PlacementCollector::ipfix, d, columns, 100);
+    FileInputSource is(in_fd, ipfix_filename);
+
+    std::shared_ptr<ErrorContext> err = ac.collect(is);
+    BOOST_CHECK(err == 0);
+    BOOST_CHECK(ac.finish());
+    BOOST_CHECK_EQUAL(ac.get_row_count(), n_records);
+  }
+  BOOST_REQUIRE(close(out_fd) == 0);
+
+  std::ifstream arrow_file(arrow_filename, std::ios::binary);
+  std::vector<uint8_t> contents((std::istreambuf_iterator<char>(arrow_file)),
+                                std::istreambuf_iterator<char>());
+  BOOST_REQUIRE(contents.size() > 8 + 8 + 10);
+
+  /* Leading magic, padded to 8 octets, and trailing magic. */
+  const uint8_t magic[8] = { 'A', 'R', 'R', 'O', 'W', '1', 0, 0 };
+  BOOST_CHECK(std::equal(magic, magic + 8, contents.begin()));
+  BOOST_CHECK(std::equal(magic, magic + 6, contents.end() - 6));
+
+  /* The footer is preceded by the end-of-stream marker. */
+  size_t footer_length = contents[contents.size() - 10]
+    | (contents[contents.size() - 9] << 8)
+    | (contents[contents.size() - 8] << 16)
+    | (contents[contents.size() - 7] << 24);
+  BOOST_REQUIRE(footer_length + 8 + 8 + 10 < contents.size());
+  size_t eos = contents.size() - 10 - footer_length - 8;
+  const uint8_t eos_marker[8] = { 0xff, 0xff, 0xff, 0xff, 0, 0, 0, 0 };
+  BOOST_CHECK(std::equal(eos_marker, eos_marker + 8, contents.begin() + eos));
+
+  /* Strings of the last batch are stored back to back. */
+  std::string last_labels = "label-248label-249";
+  BOOST_CHECK(std::search(contents.begin(), contents.end(),
+                          last_labels.begin(), last_labels.end())
+              != contents.end());
+
+  BOOST_CHECK_EQUAL(unlink(ipfix_filename), 0);
+  BOOST_CHECK_EQUAL(unlink(arrow_filename), 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
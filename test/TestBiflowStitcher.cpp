@@ -0,0 +1,195 @@
+/* Copyright (c) 2011-2014 ETH Zürich. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ *    * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *    * Neither the name of ETH Zürich, nor the names of its contributors 
+ *      may be used to endorse or promote products derived from this software 
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL ETH 
+ * ZURICH BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, 
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, 
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR 
+ * PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER 
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR 
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF 
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE
+ */
+
+#include <vector>
+
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/test_tools.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include "BiflowStitcher.h"
+#include "InfoModel.h"
+
+#include "exceptions/IESpecError.h"
+
+using namespace libfc;
+
+BOOST_AUTO_TEST_SUITE(Biflows)
+
+class TestStitcher : public BiflowStitcher {
+public:
+  struct Biflow {
+    uint32_t sip;
+    uint32_t dip;
+    uint16_t sp;
+    uint16_t dp;
+    uint64_t start;
+    uint64_t end;
+    uint64_t octets;
+    uint64_t reverse_octets;
+  };
+
+  TestStitcher(size_t max_pending, bool default_window = false)
+    : BiflowStitcher(max_pending) {
+    InfoModel& model = InfoModel::instance();
+    odc = model.lookupIE("octetDeltaCount");
+    rodc = model.lookupIE(29305, odc->number(), odc->len());
+    add_value(odc);
+    if (!default_window)
+      set_window(100);
+  }
+
+  template<typename T> T get(const char* name) {
+    return get<T>(InfoModel::instance().lookupIE(name));
+  }
+
+  template<typename T> T get(const InfoElement* ie) {
+    void* p;
+    BOOST_REQUIRE(get_output_template(false)->lookup_placement(ie, &p, 0));
+    return *static_cast<T*>(p);
+  }
+
+  template<typename T> void set(const char* name, T value) {
+    const InfoElement* ie = InfoModel::instance().lookupIE(name);
+    void* p;
+    BOOST_REQUIRE(get_input_template(false)->lookup_placement(ie, &p, 0));
+    *static_cast<T*>(p) = value;
+  }
+
+  void add(uint32_t sip, uint16_t sp, uint32_t dip, uint16_t dp,
+           uint64_t start, uint64_t octets) {
+    set<uint32_t>("sourceIPv4Address", sip);
+    set<uint32_t>("destinationIPv4Address", dip);
+    set<uint16_t>("sourceTransportPort", sp);
+    set<uint16_t>("destinationTransportPort", dp);
+    set<uint8_t>("protocolIdentifier", 6);
+    set<uint64_t>("flowStartMilliseconds", start);
+    set<uint64_t>("flowEndMilliseconds", start + 10);
+    set<uint64_t>("octetDeltaCount", octets);
+    add_record(get_input_template(false));
+  }
+
+  std::vector<Biflow> biflows;
+  const InfoElement* odc;
+  const InfoElement* rodc;
+
+protected:
+  void emit(const PlacementTemplate* tmpl) {
+    BOOST_CHECK(tmpl == get_output_template(false));
+    Biflow b;
+    b.sip = get<uint32_t>("sourceIPv4Address");
+    b.dip = get<uint32_t>("destinationIPv4Address");
+    b.sp = get<uint16_t>("sourceTransportPort");
+    b.dp = get<uint16_t>("destinationTransportPort");
+    b.start = get<uint64_t>("flowStartMilliseconds");
+    b.end = get<uint64_t>("flowEndMilliseconds");
+    b.octets = get<uint64_t>("octetDeltaCount");
+    b.reverse_octets = get<uint64_t>(rodc);
+    biflows.push_back(b);
+  }
+};
+
+BOOST_AUTO_TEST_CASE(BiflowStitching) {
+  const uint32_t a = 0x0a000001;
+  const uint32_t b = 0x0a000002;
+  const uint32_t c = 0x0a000003;
+
+  TestStitcher s(1000);
+  BOOST_REQUIRE(s.rodc != 0);
+
+  /* A request and its response. */
+  s.add(a, 40000, b, 80, 1000, 100);
+  BOOST_CHECK_EQUAL(s.get_pending_count(), 1U);
+  s.add(b, 80, a, 40000, 1005, 5000);
+  BOOST_CHECK_EQUAL(s.get_pending_count(), 0U);
+  BOOST_REQUIRE_EQUAL(s.biflows.size(), 1U);
+  BOOST_CHECK_EQUAL(s.biflows[0].sip, a);
+  BOOST_CHECK_EQUAL(s.biflows[0].dip, b);
+  BOOST_CHECK_EQUAL(s.biflows[0].sp, 40000);
+  BOOST_CHECK_EQUAL(s.biflows[0].dp, 80);
+  BOOST_CHECK_EQUAL(s.biflows[0].start, 1000U);
+  BOOST_CHECK_EQUAL(s.biflows[0].end, 1015U);
+  BOOST_CHECK_EQUAL(s.biflows[0].octets, 100U);
+  BOOST_CHECK_EQUAL(s.biflows[0].reverse_octets, 5000U);
+
+  /* The response is exported first; the initiator still comes out
+   * as the forward direction. */
+  s.add(b, 80, c, 50000, 1020, 700);
+  s.add(c, 50000, b, 80, 1010, 70);
+  BOOST_REQUIRE_EQUAL(s.biflows.size(), 2U);
+  BOOST_CHECK_EQUAL(s.biflows[1].sip, c);
+  BOOST_CHECK_EQUAL(s.biflows[1].start, 1010U);
+  BOOST_CHECK_EQUAL(s.biflows[1].octets, 70U);
+  BOOST_CHECK_EQUAL(s.biflows[1].reverse_octets, 700U);
+
+  /* A uniflow without response is emitted alone once the window has
+   * passed. */
+  s.add(a, 40001, c, 53, 1100, 60);
+  s.add(a, 40002, c, 53, 1150, 60);
+  BOOST_CHECK_EQUAL(s.biflows.size(), 2U);
+  s.add(a, 40003, c, 53, 1215, 60);
+  BOOST_REQUIRE_EQUAL(s.biflows.size(), 3U);
+  BOOST_CHECK_EQUAL(s.biflows[2].sp, 40001);
+  BOOST_CHECK_EQUAL(s.biflows[2].reverse_octets, 0U);
+  BOOST_CHECK_EQUAL(s.get_pending_count(), 2U);
+
+  s.flush();
+  BOOST_CHECK_EQUAL(s.biflows.size(), 5U);
+  BOOST_CHECK_EQUAL(s.get_pending_count(), 0U);
+  BOOST_CHECK_EQUAL(s.get_uniflow_count(), 7U);
+  BOOST_CHECK_EQUAL(s.get_biflow_count(), 2U);
+  BOOST_CHECK_EQUAL(s.get_unmatched_count(), 3U);
+  BOOST_CHECK_EQUAL(s.get_evicted_count(), 0U);
+
+  /* Memory is bounded by evicting the oldest pending uniflows. */
+  TestStitcher small(4);
+  for (uint16_t port = 1; port <= 10; port++)
+    small.add(a, port, b, 80, 1000, 1);
+  BOOST_CHECK_EQUAL(small.get_pending_count(), 4U);
+  BOOST_CHECK_EQUAL(small.get_evicted_count(), 6U);
+  BOOST_REQUIRE_EQUAL(small.biflows.size(), 6U);
+  BOOST_CHECK_EQUAL(small.biflows[0].sp, 1);
+
+  /* The reverse direction of a pending uniflow is still joined. */
+  small.add(b, 80, a, 9, 1001, 2);
+  BOOST_CHECK_EQUAL(small.get_biflow_count(), 1U);
+  BOOST_CHECK_EQUAL(small.biflows.back().sp, 9);
+  BOOST_CHECK_EQUAL(small.biflows.back().reverse_octets, 2U);
+
+  /* The default window joins directions exported 20 s apart. */
+  TestStitcher slow(16, true);
+  slow.add(a, 40000, b, 80, 1000, 100);
+  slow.add(b, 80, a, 40000, 21000, 5000);
+  BOOST_CHECK_EQUAL(slow.get_biflow_count(), 1U);
+  BOOST_CHECK_EQUAL(slow.get_pending_count(), 0U);
+
+  BOOST_CHECK_THROW(BiflowStitcher().add_value(
+                      InfoModel::instance().lookupIE("interfaceName")),
+                    IESpecError);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
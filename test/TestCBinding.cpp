@@ -0,0 +1,138 @@
+/* Copyright (c) 2011-2014 ETH Zürich. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ *    * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *    * Neither the name of ETH Zürich, nor the names of its contributors 
+ *      may be used to endorse or promote products derived from this software 
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL ETH 
+ * ZURICH BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, 
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, 
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR 
+ * PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER 
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR 
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF 
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE
+ */
+
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/test_tools.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include "InfoModel.h"
+#include "TestRoundTrip.h"
+#include "libfc.h"
+
+using namespace libfc;
+
+BOOST_AUTO_TEST_SUITE(CBinding)
+
+/** Receives batches from the C binding. */
+struct CBatches {
+  uint64_t octets[64];
+  uint16_t ports[64];
+  std::vector<uint64_t> all_octets;
+  std::vector<uint16_t> all_ports;
+  std::vector<size_t> sizes;
+  size_t abort_after;
+};
+
+static int c_batch_callback(const struct libfc_template_t* t, size_t n,
+                            void* vp) {
+  CBatches* b = static_cast<CBatches*>(vp);
+  b->sizes.push_back(n);
+  b->all_octets.insert(b->all_octets.end(), b->octets, b->octets + n);
+  b->all_ports.insert(b->all_ports.end(), b->ports, b->ports + n);
+  return b->sizes.size() == b->abort_after ? 0 : 1;
+}
+
+BOOST_AUTO_TEST_CASE(CBindingBatches) {
+  const char* filename = "cbinding-batches.ipfix";
+  const unsigned int n_records = 1000;
+
+  const InfoElement* odc = InfoModel::instance().lookupIE("octetDeltaCount");
+  const InfoElement* sp
+    = InfoModel::instance().lookupIE("sourceTransportPort");
+  BOOST_REQUIRE(odc != 0);
+  BOOST_REQUIRE(sp != 0);
+
+  export_file(filename, 1, [&](PlacementExporter& e) {
+    uint64_t octet_delta_count;
+    uint16_t source_transport_port;
+
+    PlacementTemplate t;
+    t.register_placement(odc, &octet_delta_count, 0);
+    t.register_placement(sp, &source_transport_port, 0);
+
+    for (unsigned int i = 0; i < n_records; i++) {
+      octet_delta_count = 1000000ULL * i;
+      source_transport_port = i;
+      e.place_values(&t);
+    }
+
+    e.flush();
+  });
+
+  struct libfc_template_group_t* s = libfc_template_group_new(10);
+  BOOST_REQUIRE(s != 0);
+  struct libfc_template_t* t = libfc_template_new(s);
+
+  CBatches b;
+  b.abort_after = 0;
+  char name[32];
+  BOOST_CHECK(libfc_register_column(t, "octetDeltaCount", b.octets, 0));
+  BOOST_CHECK(libfc_register_column(t, "sourceTransportPort", b.ports, 0));
+  BOOST_CHECK(!libfc_register_column(t, "interfaceName", name, 0));
+  BOOST_CHECK(!libfc_register_column(t, "noSuchElement", name, 0));
+  libfc_register_batch_callback(t, 64, c_batch_callback, &b);
+
+  int fd = open(filename, O_RDONLY);
+  BOOST_REQUIRE(fd >= 0);
+  BOOST_CHECK(libfc_collect_from_mmap(fd, filename, s));
+
+  BOOST_REQUIRE_EQUAL(b.all_octets.size(), n_records);
+  BOOST_REQUIRE_EQUAL(b.sizes.size(), (n_records + 63)/64);
+  for (unsigned int i = 0; i + 1 < b.sizes.size(); i++)
+    BOOST_CHECK_EQUAL(b.sizes[i], 64U);
+  BOOST_CHECK_EQUAL(b.sizes.back(), n_records % 64);
+  for (unsigned int i = 0; i < n_records; i++) {
+    BOOST_CHECK_EQUAL(b.all_octets[i], 1000000ULL * i);
+    BOOST_CHECK_EQUAL(b.all_ports[i], i);
+  }
+
+  /* Collecting from memory; abort after the second batch. */
+  off_t size = lseek(fd, 0, SEEK_END);
+  BOOST_REQUIRE(size > 0);
+  std::vector<uint8_t> buf(size);
+  BOOST_REQUIRE_EQUAL(pread(fd, buf.data(), buf.size(), 0), size);
+  BOOST_REQUIRE(close(fd) == 0);
+  BOOST_CHECK_EQUAL(unlink(filename), 0);
+
+  b.all_octets.clear();
+  b.all_ports.clear();
+  b.sizes.clear();
+  b.abort_after = 2;
+  BOOST_CHECK(!libfc_collect_from_buffer(buf.data(), buf.size(), "buf", s));
+  BOOST_CHECK_EQUAL(b.sizes.size(), 2U);
+  BOOST_CHECK_EQUAL(b.all_octets.size(), 128U);
+  BOOST_CHECK_EQUAL(b.all_ports[127], 127U);
+
+  libfc_template_group_delete(s);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,173 @@
+/* Copyright (c) 2011-2014 ETH Zürich. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ *    * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *    * Neither the name of ETH Zürich, nor the names of its contributors 
+ *      may be used to endorse or promote products derived from this software 
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL ETH 
+ * ZURICH BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, 
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, 
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR 
+ * PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER 
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR 
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF 
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE
+ */
+
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/test_tools.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include "BasicOctetArray.h"
+#include "BufferInputSource.h"
+#include "CollectorStatistics.h"
+#include "InfoModel.h"
+#include "TestRoundTrip.h"
+
+using namespace libfc;
+
+BOOST_AUTO_TEST_SUITE(Statistics)
+
+BOOST_AUTO_TEST_CASE(RuntimeStatistics) {
+  const char* filename = "collector-statistics.ipfix";
+  const unsigned int n_matched = 3000;
+  const unsigned int n_unmatched = 500;
+  const uint32_t domain = 3;
+
+  const InfoElement* odc = InfoModel::instance().lookupIE("octetDeltaCount");
+  const InfoElement* sp
+    = InfoModel::instance().lookupIE("sourceTransportPort");
+  const InfoElement* ifn = InfoModel::instance().lookupIE("interfaceName");
+  BOOST_REQUIRE(odc != 0);
+  BOOST_REQUIRE(sp != 0);
+  BOOST_REQUIRE(ifn != 0);
+
+  uint16_t matched_id;
+  uint16_t unmatched_id;
+
+  off_t file_size = export_file(filename, domain, [&](PlacementExporter& e) {
+    uint64_t octet_delta_count;
+    uint16_t source_transport_port;
+    BasicOctetArray interface_name;
+
+    PlacementTemplate matched_template;
+    matched_template.register_placement(odc, &octet_delta_count, 0);
+    matched_template.register_placement(sp, &source_transport_port, 0);
+
+    PlacementTemplate unmatched_template;
+    unmatched_template.register_placement(ifn, &interface_name, 0);
+
+    for (unsigned int i = 0; i < n_matched + n_unmatched; i++) {
+      if (i % 7 == 0 && i / 7 < n_unmatched) {
+        std::string name = "eth" + std::to_string(i);
+        interface_name.copy_content(
+          reinterpret_cast<const uint8_t*>(name.data()), name.size());
+        e.place_values(&unmatched_template);
+      } else {
+        octet_delta_count = i;
+        source_transport_port = i % 65536;
+        e.place_values(&matched_template);
+      }
+    }
+    e.flush();
+
+    matched_id = matched_template.get_template_id();
+    unmatched_id = unmatched_template.get_template_id();
+  });
+
+  uint64_t octet_delta_count;
+  uint16_t source_transport_port;
+
+  RoundTripCollector cb;
+  cb.set_statistics_enabled(true);
+  PlacementTemplate* in_template = cb.add_template();
+  in_template->register_placement(odc, &octet_delta_count, 0);
+  in_template->register_placement(sp, &source_transport_port, 0);
+  cb.collect_file(filename);
+
+  std::ifstream ipfix_file(filename, std::ios::binary);
+  std::vector<uint8_t> contents((std::istreambuf_iterator<char>(ipfix_file)),
+                                std::istreambuf_iterator<char>());
+  (void) unlink(filename);
+
+  BOOST_CHECK_EQUAL(cb.n_records, n_matched);
+
+  CollectorStatistics stats = cb.get_statistics();
+  BOOST_CHECK(stats.messages > 0);
+  BOOST_CHECK_EQUAL(stats.message_octets, static_cast<uint64_t>(file_size));
+  BOOST_CHECK(stats.template_sets > 0);
+  BOOST_CHECK_EQUAL(stats.options_template_sets, 0U);
+  BOOST_CHECK_EQUAL(stats.templates.size(), 2U);
+
+  const TemplateStatistics& matched
+    = stats.templates[std::make_pair(domain, matched_id)];
+  BOOST_CHECK_EQUAL(matched.records, n_matched);
+  BOOST_CHECK_EQUAL(matched.filtered_records, 0U);
+  BOOST_CHECK_EQUAL(matched.unmatched_sets, 0U);
+  BOOST_CHECK(matched.template_records > 0);
+
+  const TemplateStatistics& unmatched
+    = stats.templates[std::make_pair(domain, unmatched_id)];
+  BOOST_CHECK_EQUAL(unmatched.records, 0U);
+  BOOST_CHECK_EQUAL(unmatched.unmatched_records, n_unmatched);
+  BOOST_CHECK_EQUAL(unmatched.unmatched_sets, unmatched.data_sets);
+
+  TemplateStatistics total = stats.total();
+  BOOST_CHECK_EQUAL(total.data_sets, stats.data_sets);
+  BOOST_CHECK_EQUAL(total.missing_template_sets, 0U);
+
+  /* Adding up snapshots sums every counter. */
+  CollectorStatistics twice = stats;
+  twice += stats;
+  BOOST_CHECK_EQUAL(twice.messages, 2 * stats.messages);
+  BOOST_CHECK_EQUAL(twice.total().records, 2ULL * n_matched);
+
+  std::ostringstream prometheus;
+  stats.write_prometheus(prometheus, "fc");
+  std::ostringstream expected;
+  expected << "fc_records_total{domain=\"" << domain << "\",template=\""
+           << matched_id << "\"} " << n_matched << "\n";
+  BOOST_CHECK(prometheus.str().find(expected.str()) != std::string::npos);
+  BOOST_CHECK(prometheus.str().find("# TYPE fc_messages_total counter\n")
+              != std::string::npos);
+
+  /* Turning statistics off leaves the counters alone. */
+  cb.set_statistics_enabled(false);
+  {
+    BufferInputSource is(contents.data(), contents.size());
+    cb.collect_checked(is);
+  }
+  BOOST_CHECK_EQUAL(cb.n_records, 2 * n_matched);
+  BOOST_CHECK_EQUAL(cb.get_statistics().messages, stats.messages);
+
+  /* Statistics are off unless asked for. */
+  RoundTripCollector quiet;
+  quiet.add_template(in_template);
+  {
+    BufferInputSource is(contents.data(), contents.size());
+    quiet.collect_checked(is);
+  }
+  BOOST_CHECK_EQUAL(quiet.n_records, n_matched);
+  BOOST_CHECK_EQUAL(quiet.get_statistics().messages, 0U);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
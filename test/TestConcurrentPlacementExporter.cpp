@@ -0,0 +1,111 @@
+/* Copyright (c) 2011-2014 ETH Zürich. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ *    * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *    * Neither the name of ETH Zürich, nor the names of its contributors 
+ *      may be used to endorse or promote products derived from this software 
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL ETH 
+ * ZURICH BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, 
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, 
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR 
+ * PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER 
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR 
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF 
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE
+ */
+
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/test_tools.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include "ConcurrentPlacementExporter.h"
+#include "FileExportDestination.h"
+#include "InfoModel.h"
+#include "TestRoundTrip.h"
+
+using namespace libfc;
+
+BOOST_AUTO_TEST_SUITE(ConcurrentExport)
+
+BOOST_AUTO_TEST_CASE(ConcurrentRoundTrip) {
+  const char* filename = "concurrent-round-trip.ipfix";
+  const unsigned int n_threads = 4;
+  const unsigned int n_records = 20000;
+
+  const InfoElement* sipv4a
+    = InfoModel::instance().lookupIE("sourceIPv4Address");
+  const InfoElement* ov = InfoModel::instance().lookupIE("observationValue");
+  BOOST_REQUIRE(sipv4a != 0);
+  BOOST_REQUIRE(ov != 0);
+
+  int fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  BOOST_REQUIRE(fd >= 0);
+  {
+    FileExportDestination d(fd);
+    ConcurrentPlacementExporter e(d, 1);
+
+    std::vector<std::thread> threads;
+    for (unsigned int t = 0; t < n_threads; t++) {
+      threads.push_back(std::thread([&e, sipv4a, ov, t, n_records]() {
+        uint32_t source_ipv4_address = t;
+        uint64_t observation_value;
+
+        PlacementTemplate out_template;
+        out_template.register_placement(sipv4a, &source_ipv4_address, 0);
+        out_template.register_placement(ov, &observation_value, 0);
+
+        PlacementExporter& my_exporter = e.make_producer();
+        for (unsigned int i = 0; i < n_records; i++) {
+          observation_value = i;
+          my_exporter.place_values(&out_template);
+        }
+        my_exporter.flush();
+      }));
+    }
+    for (auto i = threads.begin(); i != threads.end(); ++i)
+      i->join();
+  }
+  (void) close(fd);
+
+  /* Records from each thread must arrive complete and in order. */
+  uint32_t source_ipv4_address;
+  uint64_t observation_value;
+  std::vector<uint64_t> next_value(n_threads, 0);
+  unsigned int n_mismatches = 0;
+
+  RoundTripCollector cb;
+  PlacementTemplate* in_template = cb.add_template();
+  in_template->register_placement(sipv4a, &source_ipv4_address, 0);
+  in_template->register_placement(ov, &observation_value, 0);
+  cb.on_record = [&](const PlacementTemplate*) {
+    if (source_ipv4_address >= next_value.size()
+        || observation_value != next_value[source_ipv4_address]++)
+      n_mismatches++;
+  };
+
+  cb.collect_file(filename);
+  (void) unlink(filename);
+
+  BOOST_CHECK_EQUAL(n_mismatches, 0U);
+  for (unsigned int t = 0; t < n_threads; t++)
+    BOOST_CHECK_EQUAL(next_value[t], n_records);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,203 @@
+/* Copyright (c) 2011-2014 ETH Zürich. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ *    * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *    * Neither the name of ETH Zürich, nor the names of its contributors 
+ *      may be used to endorse or promote products derived from this software 
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL ETH 
+ * ZURICH BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, 
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, 
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR 
+ * PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER 
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR 
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF 
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE
+ */
+
+#include <map>
+#include <utility>
+
+#include <unistd.h>
+
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/test_tools.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include "FlowAggregator.h"
+#include "InfoModel.h"
+#include "TestRoundTrip.h"
+
+#include "exceptions/IESpecError.h"
+
+using namespace libfc;
+
+BOOST_AUTO_TEST_SUITE(FlowAggregation)
+
+class TestAggregator : public FlowAggregator {
+public:
+  struct Flow {
+    uint64_t octets;
+    uint64_t start;
+    uint64_t end;
+    uint64_t n_records;
+  };
+
+  TestAggregator() : n_emitted_flows(0) {
+    InfoModel& model = InfoModel::instance();
+    sip = model.lookupIE("sourceIPv4Address");
+    proto = model.lookupIE("protocolIdentifier");
+    odc = model.lookupIE("octetDeltaCount");
+    start = model.lookupIE("flowStartMilliseconds");
+    end = model.lookupIE("flowEndMilliseconds");
+    dfc = model.lookupIE("deltaFlowCount");
+
+    add_key(sip, 24);
+    add_key(proto);
+    add_value(odc, sum);
+    add_value(start, min);
+    add_value(end, max);
+    add_value(dfc, count);
+    set_clock(end);
+  }
+
+  /** Returns the output placement of an IE. */
+  template<typename T> T get(const InfoElement* ie) {
+    void* p;
+    BOOST_REQUIRE(get_output_template()->lookup_placement(ie, &p, 0));
+    return *static_cast<T*>(p);
+  }
+
+  /** Sets the input placement of an IE. */
+  template<typename T> void set(const InfoElement* ie, T value) {
+    void* p;
+    BOOST_REQUIRE(get_input_template()->lookup_placement(ie, &p, 0));
+    *static_cast<T*>(p) = value;
+  }
+
+  std::map<std::pair<uint32_t, uint8_t>, Flow> flows;
+  unsigned int n_emitted_flows;
+
+  const InfoElement* sip;
+  const InfoElement* proto;
+  const InfoElement* odc;
+  const InfoElement* start;
+  const InfoElement* end;
+  const InfoElement* dfc;
+
+protected:
+  void emit(const PlacementTemplate* tmpl) {
+    BOOST_CHECK(tmpl == get_output_template());
+    Flow& f = flows[std::make_pair(get<uint32_t>(sip), get<uint8_t>(proto))];
+    f.octets = get<uint64_t>(odc);
+    f.start = get<uint64_t>(start);
+    f.end = get<uint64_t>(end);
+    f.n_records = get<uint64_t>(dfc);
+    ++n_emitted_flows;
+  }
+};
+
+BOOST_AUTO_TEST_CASE(Aggregation) {
+  const char* filename = "aggregation.ipfix";
+  const unsigned int n_records = 1000;
+  const uint64_t t0 = 1400000000000ULL;
+
+  TestAggregator agg;
+
+  export_file(filename, 1, [&](PlacementExporter& e) {
+    uint32_t sip;
+    uint8_t proto;
+    uint64_t octets;
+    uint64_t start;
+    uint64_t end;
+
+    PlacementTemplate out_template;
+    out_template.register_placement(agg.sip, &sip, 0);
+    out_template.register_placement(agg.proto, &proto, 0);
+    out_template.register_placement(agg.odc, &octets, 0);
+    out_template.register_placement(agg.start, &start, 0);
+    out_template.register_placement(agg.end, &end, 0);
+
+    /* Four /24 networks, with TCP in the odd ones and UDP in the
+     * even ones. */
+    for (unsigned int i = 0; i < n_records; i++) {
+      sip = 0x0a000000 | ((i % 4) << 8) | (i % 256);
+      proto = i % 2 == 0 ? 17 : 6;
+      octets = i;
+      start = t0 + i;
+      end = start + 10;
+      e.place_values(&out_template);
+    }
+
+    e.flush();
+  });
+
+  {
+    RoundTripCollector cb;
+    cb.add_template(agg.get_input_template());
+    cb.on_record = [&](const PlacementTemplate*) { agg.add_record(); };
+    cb.collect_file(filename);
+  }
+  BOOST_CHECK_EQUAL(unlink(filename), 0);
+
+  BOOST_CHECK_EQUAL(agg.get_record_count(), n_records);
+  BOOST_CHECK_EQUAL(agg.get_flow_count(), 4U);
+  BOOST_CHECK_EQUAL(agg.n_emitted_flows, 0U);
+
+  agg.flush();
+  BOOST_CHECK_EQUAL(agg.get_flow_count(), 0U);
+  BOOST_CHECK_EQUAL(agg.get_emitted_count(), 4U);
+  BOOST_REQUIRE_EQUAL(agg.flows.size(), 4U);
+
+  for (unsigned int r = 0; r < 4; r++) {
+    TestAggregator::Flow& f
+      = agg.flows[std::make_pair(0x0a000000 | (r << 8), r % 2 == 0 ? 17 : 6)];
+    BOOST_CHECK_EQUAL(f.n_records, n_records/4);
+    BOOST_CHECK_EQUAL(f.octets, 250*r + 4*(249*250/2));
+    BOOST_CHECK_EQUAL(f.start, t0 + r);
+    BOOST_CHECK_EQUAL(f.end, t0 + 996 + r + 10);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(AggregationTimeouts) {
+  const uint64_t t0 = 1400000000000ULL;
+
+  TestAggregator agg;
+  agg.set_timeouts(0, 100);
+  agg.set<uint32_t>(agg.sip, 0x0a000001);
+  agg.set<uint64_t>(agg.odc, 1);
+
+  /* One TCP flow at t0, and a UDP flow that lasts. */
+  for (uint64_t t = 0; t <= 300; t += 10) {
+    agg.set<uint8_t>(agg.proto, t == 0 ? 6 : 17);
+    agg.set<uint64_t>(agg.start, t0 + t);
+    agg.set<uint64_t>(agg.end, t0 + t);
+    agg.add_record();
+  }
+
+  BOOST_CHECK_EQUAL(agg.n_emitted_flows, 1U);
+  BOOST_CHECK_EQUAL(agg.get_flow_count(), 1U);
+  BOOST_CHECK_EQUAL(agg.flows[std::make_pair(0x0a000000, 6)].n_records, 1U);
+
+  agg.expire(t0 + 1000);
+  BOOST_CHECK_EQUAL(agg.n_emitted_flows, 2U);
+  BOOST_CHECK_EQUAL(agg.get_flow_count(), 0U);
+  BOOST_CHECK_EQUAL(agg.flows[std::make_pair(0x0a000000, 17)].n_records, 30U);
+  BOOST_CHECK_EQUAL(agg.flows[std::make_pair(0x0a000000, 17)].octets, 30U);
+
+  BOOST_CHECK_THROW(FlowAggregator().add_key(agg.odc, 8), IESpecError);
+  BOOST_CHECK_THROW(FlowAggregator().add_value(agg.start, FlowAggregator::sum),
+                    IESpecError);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
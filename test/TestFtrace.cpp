@@ -0,0 +1,291 @@
+/* Copyright (c) 2011-2014 ETH Zürich. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ *    * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *    * Neither the name of ETH Zürich, nor the names of its contributors 
+ *      may be used to endorse or promote products derived from this software 
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL ETH 
+ * ZURICH BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, 
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, 
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR 
+ * PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER 
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR 
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF 
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE
+ */
+
+#include <cstring>
+#include <vector>
+
+#include <unistd.h>
+
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/test_tools.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include "InfoModel.h"
+#include "TestRoundTrip.h"
+#include "ftrace/libftrace.h"
+
+using namespace libfc;
+
+BOOST_AUTO_TEST_SUITE(Ftrace)
+
+static const unsigned int n_flows = 1000;
+
+/* Every fourth flow is IPv6, the others are IPv4. */
+static bool is_v6(unsigned int i) {
+  return i % 4 == 3;
+}
+
+/* PlacementExporter converts the byte order of IPv6 addresses, but
+ * the collector copies them as they are (see DecodePlan), so make
+ * addresses that read the same both ways. */
+static void make_v6_address(unsigned int i, uint8_t base, uint8_t* addr) {
+  memset(addr, 0, 16);
+  addr[0] = addr[15] = base;
+  addr[1] = addr[14] = (i >> 8) & 0xff;
+  addr[2] = addr[13] = i & 0xff;
+}
+
+/* Writes n_flows uniflows, with values that depend on the index. */
+static void write_flows(const char* filename) {
+  InfoModel& model = InfoModel::instance();
+  const char* common[] = {
+    "flowStartMilliseconds", "flowEndMilliseconds", "packetDeltaCount",
+    "octetDeltaCount", "sourceTransportPort", "destinationTransportPort",
+    "protocolIdentifier"
+  };
+
+  export_file(filename, 1, [&](PlacementExporter& e) {
+    uint64_t start, end, packets, octets;
+    uint16_t sport, dport;
+    uint8_t proto;
+    uint32_t sip4, dip4;
+    uint8_t sip6[16], dip6[16];
+    void* common_values[] = {
+      &start, &end, &packets, &octets, &sport, &dport, &proto
+    };
+
+    PlacementTemplate v4;
+    PlacementTemplate v6;
+    for (unsigned int f = 0; f < sizeof(common)/sizeof(common[0]); f++) {
+      const InfoElement* ie = model.lookupIE(common[f]);
+      BOOST_REQUIRE(ie != 0);
+      v4.register_placement(ie, common_values[f], 0);
+      v6.register_placement(ie, common_values[f], 0);
+    }
+    v4.register_placement(model.lookupIE("sourceIPv4Address"), &sip4, 0);
+    v4.register_placement(model.lookupIE("destinationIPv4Address"),
+                          &dip4, 0);
+    v6.register_placement(model.lookupIE("sourceIPv6Address"), sip6, 0);
+    v6.register_placement(model.lookupIE("destinationIPv6Address"),
+                          dip6, 0);
+
+    for (unsigned int i = 0; i < n_flows; i++) {
+      start = 1400000000000ULL + i;
+      end = start + i % 100;
+      packets = i + 1;
+      octets = 100 * packets;
+      sport = 1024 + i;
+      dport = 80;
+      proto = i % 2 == 0 ? 6 : 17;
+      if (is_v6(i)) {
+        make_v6_address(i, 0x20, sip6);
+        make_v6_address(i, 0x30, dip6);
+        e.place_values(&v6);
+      } else {
+        sip4 = 0x0a000000 + i;
+        dip4 = 0x0b000000 + i;
+        e.place_values(&v4);
+      }
+    }
+
+    e.flush();
+  });
+}
+
+/* Counts the fields of uniflow i that don't have their values. */
+static unsigned int check_flow(unsigned int i, const libftrace_uniflow_t& uf) {
+  unsigned int n_mismatches = 0;
+  uint8_t addr[16];
+
+  n_mismatches += uf.time_start != 1400000000000ULL + i;
+  n_mismatches += uf.time_end != uf.time_start + i % 100;
+  n_mismatches += uf.packets != i + 1;
+  n_mismatches += uf.octets != 100 * (i + 1);
+  n_mismatches += uf.port_src != 1024 + i;
+  n_mismatches += uf.port_dst != 80;
+  n_mismatches += uf.ip_proto != (i % 2 == 0 ? 6 : 17);
+  if (is_v6(i)) {
+    n_mismatches += uf.ip_ver != 6;
+    make_v6_address(i, 0x20, addr);
+    n_mismatches += memcmp(uf.ip.v6.src, addr, 16) != 0;
+    make_v6_address(i, 0x30, addr);
+    n_mismatches += memcmp(uf.ip.v6.dst, addr, 16) != 0;
+  } else {
+    n_mismatches += uf.ip_ver != 4;
+    n_mismatches += uf.ip.v4.src != 0x0a000000 + i;
+    n_mismatches += uf.ip.v4.dst != 0x0b000000 + i;
+  }
+  return n_mismatches;
+}
+
+BOOST_AUTO_TEST_CASE(SingleUniflows) {
+  const char* filename = "ftrace-single.ipfix";
+  write_flows(filename);
+
+  libftrace_t* ft = ftrace_create(filename, 10, 0);
+  BOOST_REQUIRE(ft != 0);
+  libftrace_uniflow_t* uf = ftrace_start_uniflow(ft);
+  BOOST_REQUIRE(uf != 0);
+
+  unsigned int n_read = 0;
+  unsigned int n_mismatches = 0;
+  int rv;
+  while ((rv = ftrace_next_uniflow(uf)) == 1)
+    n_mismatches += check_flow(n_read++, *uf);
+
+  BOOST_CHECK_EQUAL(rv, 0);
+  BOOST_CHECK_EQUAL(n_read, n_flows);
+  BOOST_CHECK_EQUAL(n_mismatches, 0U);
+
+  /* The end of the stream stays the end. */
+  BOOST_CHECK_EQUAL(ftrace_next_uniflow(uf), 0);
+
+  ftrace_destroy_uniflow(uf);
+  ftrace_destroy(ft);
+  BOOST_CHECK_EQUAL(unlink(filename), 0);
+}
+
+BOOST_AUTO_TEST_CASE(UniflowBatches) {
+  const char* filename = "ftrace-batches.ipfix";
+  const int batch = 64;
+  write_flows(filename);
+
+  libftrace_t* ft = ftrace_create(filename, 10, 0);
+  BOOST_REQUIRE(ft != 0);
+  libftrace_uniflow_t* uf = ftrace_start_uniflow(ft);
+  BOOST_REQUIRE(uf != 0);
+
+  std::vector<libftrace_uniflow_t> flows(batch);
+  std::vector<int> sizes;
+  unsigned int n_read = 0;
+  unsigned int n_mismatches = 0;
+  int rv;
+  while ((rv = ftrace_next_uniflows(ft, flows.data(), batch)) > 0) {
+    sizes.push_back(rv);
+    for (int i = 0; i < rv; i++)
+      n_mismatches += check_flow(n_read++, flows[i]);
+  }
+
+  BOOST_CHECK_EQUAL(rv, 0);
+  BOOST_CHECK_EQUAL(n_read, n_flows);
+  BOOST_CHECK_EQUAL(n_mismatches, 0U);
+
+  /* Full batches, then a partial one at the end of the stream. */
+  BOOST_REQUIRE_EQUAL(sizes.size(), (n_flows + batch - 1)/batch);
+  for (unsigned int i = 0; i + 1 < sizes.size(); i++)
+    BOOST_CHECK_EQUAL(sizes[i], batch);
+  BOOST_CHECK_EQUAL(sizes.back(), static_cast<int>(n_flows % batch));
+  BOOST_CHECK_EQUAL(ftrace_next_uniflows(ft, flows.data(), batch), 0);
+
+  ftrace_destroy_uniflow(uf);
+  ftrace_destroy(ft);
+  BOOST_CHECK_EQUAL(unlink(filename), 0);
+}
+
+BOOST_AUTO_TEST_CASE(UniflowColumns) {
+  const char* filename = "ftrace-columns.ipfix";
+  const int batch = 300;
+  write_flows(filename);
+
+  libftrace_t* ft = ftrace_create(filename, 10, 0);
+  BOOST_REQUIRE(ft != 0);
+  libftrace_uniflow_t* uf = ftrace_start_uniflow(ft);
+  BOOST_REQUIRE(uf != 0);
+
+  std::vector<uint64_t> time_start(batch);
+  std::vector<uint64_t> time_end(batch);
+  std::vector<uint64_t> packets(batch);
+  std::vector<uint64_t> octets(batch);
+  std::vector<uint32_t> src_v4(batch);
+  std::vector<uint32_t> dst_v4(batch);
+  std::vector<uint8_t> src_v6(16 * batch);
+  std::vector<uint8_t> dst_v6(16 * batch);
+  std::vector<uint16_t> port_src(batch);
+  std::vector<uint8_t> ip_ver(batch);
+  std::vector<uint8_t> ip_proto(batch);
+
+  /* Columns left NULL are not filled in. */
+  libftrace_uniflow_columns_t cols;
+  memset(&cols, 0, sizeof(cols));
+  cols.time_start = time_start.data();
+  cols.time_end = time_end.data();
+  cols.packets = packets.data();
+  cols.octets = octets.data();
+  cols.src_v4 = src_v4.data();
+  cols.dst_v4 = dst_v4.data();
+  cols.src_v6 = reinterpret_cast<uint8_t (*)[16]>(src_v6.data());
+  cols.dst_v6 = reinterpret_cast<uint8_t (*)[16]>(dst_v6.data());
+  cols.port_src = port_src.data();
+  cols.ip_ver = ip_ver.data();
+  cols.ip_proto = ip_proto.data();
+
+  std::vector<int> sizes;
+  unsigned int n_read = 0;
+  unsigned int n_mismatches = 0;
+  int rv;
+  while ((rv = ftrace_next_uniflow_columns(ft, &cols, batch)) > 0) {
+    sizes.push_back(rv);
+    for (int i = 0; i < rv; i++) {
+      /* Gather the row, so that check_flow() can check it. */
+      libftrace_uniflow_t row;
+      memset(&row, 0, sizeof(row));
+      row.time_start = time_start[i];
+      row.time_end = time_end[i];
+      row.packets = packets[i];
+      row.octets = octets[i];
+      row.port_src = port_src[i];
+      row.port_dst = 80;
+      row.ip_ver = ip_ver[i];
+      row.ip_proto = ip_proto[i];
+      if (row.ip_ver == 6) {
+        memcpy(row.ip.v6.src, cols.src_v6[i], 16);
+        memcpy(row.ip.v6.dst, cols.dst_v6[i], 16);
+      } else {
+        row.ip.v4.src = src_v4[i];
+        row.ip.v4.dst = dst_v4[i];
+      }
+      n_mismatches += check_flow(n_read++, row);
+    }
+  }
+
+  BOOST_CHECK_EQUAL(rv, 0);
+  BOOST_CHECK_EQUAL(n_read, n_flows);
+  BOOST_CHECK_EQUAL(n_mismatches, 0U);
+
+  BOOST_REQUIRE_EQUAL(sizes.size(), 4U);
+  BOOST_CHECK_EQUAL(sizes[0], batch);
+  BOOST_CHECK_EQUAL(sizes[1], batch);
+  BOOST_CHECK_EQUAL(sizes[2], batch);
+  BOOST_CHECK_EQUAL(sizes[3], 100);
+  BOOST_CHECK_EQUAL(ftrace_next_uniflow_columns(ft, &cols, batch), 0);
+
+  ftrace_destroy_uniflow(uf);
+  ftrace_destroy(ft);
+  BOOST_CHECK_EQUAL(unlink(filename), 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -85,4 +85,4 @@ GlobalFixture::GlobalFixture() {
 GlobalFixture::~GlobalFixture() {
 }
 
-BOOST_GLOBAL_FIXTURE(GlobalFixture)
+BOOST_GLOBAL_FIXTURE(GlobalFixture);
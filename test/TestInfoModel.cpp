@@ -28,6 +28,7 @@
 #include <boost/test/test_tools.hpp>
 #include <boost/test/unit_test.hpp>
 
+#include "IESpecTable.h"
 #include "InfoElement.h"
 #include "InfoModel.h"
 
@@ -63,4 +64,32 @@ BOOST_AUTO_TEST_CASE(InfoElement01) {
   BOOST_CHECK_EQUAL(e->toIESpec(), "octetDeltaCount(1)<unsigned64>[8]");
 }
 
+BOOST_AUTO_TEST_CASE(StaticTable) {
+  libfc::InfoModel& m = libfc::InfoModel::instance();
+
+  m.defaultIPFIX();
+
+  /* Every IE in the static table is found by number and by name,
+   * and both lookups give the same canonical IE. */
+  for (size_t i = 0; i < libfc::n_iana_ie_specs; i++) {
+    const libfc::StaticIESpec& spec = libfc::iana_ie_specs[i];
+    const libfc::InfoElement* by_number
+      = m.lookupIE(spec.pen, spec.number, spec.len);
+    BOOST_REQUIRE(by_number != 0);
+    BOOST_CHECK_EQUAL(by_number->name(), spec.name);
+    BOOST_CHECK_EQUAL(by_number->ietype()->number(), spec.type);
+    BOOST_CHECK_EQUAL(m.lookupIE(spec.name), by_number);
+  }
+
+  /* IEs added at runtime don't replace IEs from the table, but can
+   * be looked up. */
+  m.add("octetDeltaCount(1)<unsigned32>[4]");
+  BOOST_CHECK_EQUAL(m.lookupIE("octetDeltaCount")->toIESpec(),
+                    "octetDeltaCount(1)<unsigned64>[8]");
+  m.add("staticTableTestIE(35566/1)<unsigned32>[4]");
+  const libfc::InfoElement* e = m.lookupIE("staticTableTestIE");
+  BOOST_REQUIRE(e != 0);
+  BOOST_CHECK_EQUAL(e, m.lookupIE(35566, 1, 4));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,155 @@
+/* Copyright (c) 2011-2014 ETH Zürich. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ *    * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *    * Neither the name of ETH Zürich, nor the names of its contributors 
+ *      may be used to endorse or promote products derived from this software 
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL ETH 
+ * ZURICH BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, 
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, 
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR 
+ * PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER 
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR 
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF 
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE
+ */
+
+#include <sstream>
+#include <vector>
+
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/test_tools.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include "BufferInputSource.h"
+#include "Constants.h"
+#include "ExportDestination.h"
+#include "InfoModel.h"
+#include "LatencyHistogram.h"
+#include "PlacementExporter.h"
+#include "TestRoundTrip.h"
+
+using namespace libfc;
+
+BOOST_AUTO_TEST_SUITE(Latency)
+
+BOOST_AUTO_TEST_CASE(LatencyHistograms) {
+  LatencyHistogram h;
+  BOOST_CHECK_EQUAL(h.count(), 0U);
+  BOOST_CHECK_EQUAL(h.value_at_percentile(50.0), 0U);
+
+  /* Every bucket boundary is consistent with bucket_of(). */
+  for (unsigned int b = 0; b < LatencyHistogram::n_buckets; b++) {
+    BOOST_CHECK_EQUAL(LatencyHistogram::bucket_of(
+                        LatencyHistogram::bucket_low(b)), b);
+    BOOST_CHECK_EQUAL(LatencyHistogram::bucket_of(
+                        LatencyHistogram::bucket_high(b)), b);
+  }
+  BOOST_CHECK_EQUAL(LatencyHistogram::bucket_of(UINT64_MAX),
+                    LatencyHistogram::n_buckets - 1);
+
+  for (uint64_t v = 1; v <= 10000; v++)
+    h.record(v);
+  BOOST_CHECK_EQUAL(h.count(), 10000U);
+  BOOST_CHECK_EQUAL(h.min(), 1U);
+  BOOST_CHECK_EQUAL(h.max(), 10000U);
+  BOOST_CHECK_CLOSE(h.mean(), 5000.5, 0.001);
+
+  /* Percentiles are exact to within the bucket width of 1/32. */
+  BOOST_CHECK_CLOSE(static_cast<double>(h.value_at_percentile(50.0)),
+                    5000.0, 100.0 / 32);
+  BOOST_CHECK_CLOSE(static_cast<double>(h.value_at_percentile(99.0)),
+                    9900.0, 100.0 / 32);
+  BOOST_CHECK_EQUAL(h.value_at_percentile(100.0), 10000U);
+
+  LatencyHistogram tail;
+  tail.record(1000000);
+  h += tail;
+  BOOST_CHECK_EQUAL(h.count(), 10001U);
+  BOOST_CHECK_EQUAL(h.max(), 1000000U);
+  BOOST_CHECK_EQUAL(h.value_at_percentile(100.0), 1000000U);
+
+  h.reset();
+  BOOST_CHECK_EQUAL(h.count(), 0U);
+  BOOST_CHECK_EQUAL(h.max(), 0U);
+
+  /* Collecting fills the histograms only if they're compiled in. */
+  const InfoElement* odc = InfoModel::instance().lookupIE("octetDeltaCount");
+  BOOST_REQUIRE(odc != 0);
+
+  std::vector<uint8_t> messages;
+  {
+    class BufferExportDestination : public ExportDestination {
+    public:
+      BufferExportDestination(std::vector<uint8_t>& buf) : buf(buf) {
+      }
+
+      ssize_t writev(const std::vector< ::iovec>& iovecs) {
+        ssize_t n = 0;
+        for (auto i = iovecs.begin(); i != iovecs.end(); ++i) {
+          const uint8_t* base = static_cast<const uint8_t*>(i->iov_base);
+          buf.insert(buf.end(), base, base + i->iov_len);
+          n += i->iov_len;
+        }
+        return n;
+      }
+
+      int flush() { return 0; }
+      bool is_connectionless() const { return false; }
+      size_t preferred_maximum_message_size() const { return kMaxMessageLen; }
+
+    private:
+      std::vector<uint8_t>& buf;
+    };
+
+    uint64_t octet_delta_count;
+    PlacementTemplate out_template;
+    out_template.register_placement(odc, &octet_delta_count, 0);
+
+    BufferExportDestination d(messages);
+    PlacementExporter e(d, 1);
+    for (unsigned int i = 0; i < 1000; i++) {
+      octet_delta_count = i;
+      e.place_values(&out_template);
+    }
+  }
+
+  uint64_t octet_delta_count;
+  RoundTripCollector cb;
+  cb.set_statistics_enabled(true);
+  cb.add_template()->register_placement(odc, &octet_delta_count, 0);
+  BufferInputSource is(messages.data(), messages.size());
+  cb.collect_checked(is);
+
+  CollectorLatencies latencies = cb.get_latencies();
+  if (CollectorLatencies::compiled_in) {
+    BOOST_CHECK_EQUAL(latencies.callback.count(), 1000U);
+    BOOST_CHECK(latencies.data_set.count() > 0);
+    BOOST_CHECK_EQUAL(latencies.message.count(),
+                      cb.get_statistics().messages);
+
+    std::ostringstream prometheus;
+    latencies.write_prometheus(prometheus);
+    BOOST_CHECK(prometheus.str().find("libfc_callback_latency_ns_count 1000\n")
+                != std::string::npos);
+
+    cb.reset_latencies();
+    BOOST_CHECK_EQUAL(cb.get_latencies().callback.count(), 0U);
+  } else {
+    BOOST_CHECK_EQUAL(latencies.message.count(), 0U);
+    BOOST_CHECK_EQUAL(latencies.callback.count(), 0U);
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,248 @@
+/* Copyright (c) 2011-2014 ETH Zürich. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ *    * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *    * Neither the name of ETH Zürich, nor the names of its contributors 
+ *      may be used to endorse or promote products derived from this software 
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL ETH 
+ * ZURICH BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, 
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, 
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR 
+ * PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER 
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR 
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF 
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE
+ */
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/test_tools.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include "BasicOctetArray.h"
+#include "BufferInputSource.h"
+#include "InfoModel.h"
+#include "OptionsJoin.h"
+#include "OptionsTable.h"
+#include "PlacementCollector.h"
+
+#include "exceptions/IESpecError.h"
+
+using namespace libfc;
+
+BOOST_AUTO_TEST_SUITE(Options)
+
+class EnrichingCollector : public PlacementCollector {
+public:
+  struct Flow {
+    uint32_t ingress_interface;
+    std::string interface_name;
+    uint64_t octets;
+    uint64_t packets;
+  };
+
+  EnrichingCollector()
+    : PlacementCollector(PlacementCollector::ipfix) {
+    InfoModel& model = InfoModel::instance();
+    const InfoElement* ingress = model.lookupIE("ingressInterface");
+    const InfoElement* name = model.lookupIE("interfaceName");
+    const InfoElement* interval = model.lookupIE("samplingPacketInterval");
+    const InfoElement* space = model.lookupIE("samplingPacketSpace");
+    const InfoElement* odc = model.lookupIE("octetDeltaCount");
+    const InfoElement* pdc = model.lookupIE("packetDeltaCount");
+
+    /* Interface 1 is looked up directly, interface 2 is hashed. */
+    interfaces.reset(new OptionsTable(ingress, 2));
+    interfaces->add_value(name);
+    sampling.reset(new OptionsTable(model.lookupIE("observationDomainId")));
+    sampling->add_value(interval);
+    sampling->add_value(space);
+    register_options_table(interfaces.get());
+    register_options_table(sampling.get());
+
+    tmpl.register_placement(ingress, &flow.ingress_interface, 0);
+    tmpl.register_placement(odc, &flow.octets, 0);
+    tmpl.register_placement(pdc, &flow.packets, 0);
+    join.add_value(interfaces.get(), name, &interface_name,
+                   &flow.ingress_interface);
+    join.add_normalization(sampling.get(), interval, space, odc,
+                           &flow.octets);
+    join.add_normalization(sampling.get(), interval, space, pdc,
+                           &flow.packets);
+    tmpl.set_options_join(&join);
+    register_placement_template(&tmpl);
+  }
+
+  std::shared_ptr<ErrorContext>
+      start_placement(const PlacementTemplate* t) {
+    libfc_RETURN_OK();
+  }
+
+  std::shared_ptr<ErrorContext>
+      end_placement(const PlacementTemplate* t) {
+    flow.interface_name = interface_name.to_string();
+    flows.push_back(flow);
+    libfc_RETURN_OK();
+  }
+
+  std::unique_ptr<OptionsTable> interfaces;
+  std::unique_ptr<OptionsTable> sampling;
+  OptionsJoin join;
+  std::vector<Flow> flows;
+
+private:
+  PlacementTemplate tmpl;
+  Flow flow;
+  BasicOctetArray interface_name;
+};
+
+BOOST_AUTO_TEST_CASE(OptionsEnrichment) {
+  std::vector<uint8_t> msg;
+  auto put16 = [&msg](uint16_t v) {
+    msg.push_back(v >> 8);
+    msg.push_back(v & 0xff);
+  };
+  auto put32 = [&](uint32_t v) { put16(v >> 16); put16(v & 0xffff); };
+  auto put64 = [&](uint64_t v) { put32(v >> 32); put32(v & 0xffffffff); };
+  size_t set_start = 0;
+  auto start_set = [&](uint16_t id) {
+    set_start = msg.size();
+    put16(id);
+    put16(0);
+  };
+  auto end_set = [&]() {
+    msg[set_start + 2] = (msg.size() - set_start) >> 8;
+    msg[set_start + 3] = (msg.size() - set_start) & 0xff;
+  };
+
+  put16(10); put16(0); put32(1400000000); put32(0); put32(42);
+
+  /* Interface names, scoped by ingressInterface. */
+  start_set(3);
+  put16(256); put16(2); put16(1);
+  put16(10); put16(4);
+  put16(82); put16(0xffff);
+  /* Sampling, scoped by observationDomainId: 1 in 100 packets. */
+  put16(257); put16(3); put16(1);
+  put16(149); put16(4);
+  put16(305); put16(4);
+  put16(306); put16(4);
+  end_set();
+
+  start_set(2);
+  put16(258); put16(3);
+  put16(10); put16(4);
+  put16(1); put16(8);
+  put16(2); put16(4);
+  end_set();
+
+  start_set(256);
+  put32(1); msg.push_back(4); msg.insert(msg.end(), { 'e', 't', 'h', '0' });
+  put32(2); msg.push_back(4); msg.insert(msg.end(), { 'e', 't', 'h', '1' });
+  end_set();
+
+  start_set(257);
+  put32(42); put32(1); put32(99);
+  end_set();
+
+  start_set(258);
+  put32(1); put64(1000); put32(10);
+  put32(7); put64(500); put32(5);
+  put32(2); put64(300); put32(3);
+  /* Scaled exactly above 2^53, and saturated on overflow. */
+  put32(1); put64((1ULL << 53) + 1); put32(1);
+  put32(1); put64(1ULL << 60); put32(1);
+  end_set();
+
+  msg[2] = msg.size() >> 8;
+  msg[3] = msg.size() & 0xff;
+
+  /* Domain 43 samples 3 in 4 packets, so counters are scaled by a
+   * factor that isn't an integer, also where the product needs more
+   * than 64 bits. */
+  size_t msg_start = msg.size();
+  put16(10); put16(0); put32(1400000000); put32(1); put32(43);
+
+  start_set(3);
+  put16(257); put16(3); put16(1);
+  put16(149); put16(4);
+  put16(305); put16(4);
+  put16(306); put16(4);
+  end_set();
+
+  start_set(2);
+  put16(258); put16(3);
+  put16(10); put16(4);
+  put16(1); put16(8);
+  put16(2); put16(4);
+  end_set();
+
+  start_set(257);
+  put32(43); put32(3); put32(1);
+  end_set();
+
+  start_set(258);
+  put32(1); put64(1001); put32(3);
+  put32(1); put64(1ULL << 62); put32(1);
+  end_set();
+
+  msg[msg_start + 2] = (msg.size() - msg_start) >> 8;
+  msg[msg_start + 3] = (msg.size() - msg_start) & 0xff;
+
+  EnrichingCollector cb;
+  BufferInputSource is(msg.data(), msg.size());
+  BOOST_CHECK(cb.collect(is) == 0);
+
+  BOOST_CHECK_EQUAL(cb.interfaces->get_row_count(), 2U);
+  BOOST_CHECK_EQUAL(cb.sampling->get_row_count(), 2U);
+
+  BOOST_REQUIRE_EQUAL(cb.flows.size(), 7U);
+  BOOST_CHECK_EQUAL(cb.flows[0].ingress_interface, 1U);
+  BOOST_CHECK_EQUAL(cb.flows[0].interface_name, "eth0");
+  BOOST_CHECK_EQUAL(cb.flows[0].octets, 100000U);
+  BOOST_CHECK_EQUAL(cb.flows[0].packets, 1000U);
+  /* No options data for interface 7. */
+  BOOST_CHECK_EQUAL(cb.flows[1].interface_name, "");
+  BOOST_CHECK_EQUAL(cb.flows[1].octets, 50000U);
+  BOOST_CHECK_EQUAL(cb.flows[2].interface_name, "eth1");
+  BOOST_CHECK_EQUAL(cb.flows[3].octets, ((1ULL << 53) + 1)*100);
+  BOOST_CHECK_EQUAL(cb.flows[4].octets, UINT64_MAX);
+  /* 1001*4/3 = 1334.67 and 3*4/3 = 4. */
+  BOOST_CHECK_EQUAL(cb.flows[5].octets, 1335U);
+  BOOST_CHECK_EQUAL(cb.flows[5].packets, 4U);
+  /* 2^64/3 = 6148914691236517205.33 and 4/3 = 1.33. */
+  BOOST_CHECK_EQUAL(cb.flows[6].octets, 6148914691236517205ULL);
+  BOOST_CHECK_EQUAL(cb.flows[6].packets, 1U);
+  /* Domain 43 has no interface names. */
+  BOOST_CHECK_EQUAL(cb.flows[6].interface_name, "");
+  BOOST_CHECK_EQUAL(cb.join.get_hits(), 11U);
+  BOOST_CHECK_EQUAL(cb.join.get_misses(), 3U);
+
+  InfoModel& model = InfoModel::instance();
+  const InfoElement* name = model.lookupIE("interfaceName");
+  BasicOctetArray value;
+  BOOST_CHECK(cb.interfaces->lookup(42, 2, name, &value));
+  BOOST_CHECK_EQUAL(value.to_string(), "eth1");
+  /* Rows are per observation domain. */
+  BOOST_CHECK(!cb.interfaces->lookup(43, 2, name, &value));
+
+  BOOST_CHECK_THROW(OptionsTable table(name), IESpecError);
+  BOOST_CHECK_THROW(cb.join.add_value(cb.sampling.get(), name, &value),
+                    IESpecError);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,248 @@
+/* Copyright (c) 2011-2014 ETH Zürich. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ *    * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *    * Neither the name of ETH Zürich, nor the names of its contributors 
+ *      may be used to endorse or promote products derived from this software 
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL ETH 
+ * ZURICH BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, 
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, 
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR 
+ * PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER 
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR 
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF 
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE
+ */
+
+#include <chrono>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <unistd.h>
+
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/test_tools.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include "Constants.h"
+#include "InfoModel.h"
+#include "PcapInputSource.h"
+#include "TestRoundTrip.h"
+
+#include "exceptions/FormatError.h"
+
+using namespace libfc;
+
+BOOST_AUTO_TEST_SUITE(Pcap)
+
+BOOST_AUTO_TEST_CASE(PcapReplay) {
+  const InfoElement* odc = InfoModel::instance().lookupIE("octetDeltaCount");
+  BOOST_REQUIRE(odc != 0);
+
+  /* Five IPFIX messages of 100 records each. */
+  std::vector<std::vector<uint8_t> > messages;
+  {
+    const char* filename = "pcap-messages.ipfix";
+    export_file(filename, 1, [&](PlacementExporter& e) {
+      uint64_t octet_delta_count;
+      PlacementTemplate t;
+      t.register_placement(odc, &octet_delta_count, 0);
+      for (unsigned int i = 0; i < 500; i++) {
+        octet_delta_count = i;
+        e.place_values(&t);
+        if (i % 100 == 99)
+          e.flush();
+      }
+    });
+
+    std::ifstream f(filename, std::ios::binary);
+    std::vector<uint8_t> all((std::istreambuf_iterator<char>(f)),
+                             std::istreambuf_iterator<char>());
+    for (size_t off = 0; off + 16 <= all.size(); ) {
+      size_t length = (all[off + 2] << 8) | all[off + 3];
+      BOOST_REQUIRE(length >= 16 && off + length <= all.size());
+      messages.push_back(std::vector<uint8_t>(all.begin() + off,
+                                              all.begin() + off + length));
+      off += length;
+    }
+  }
+  BOOST_REQUIRE_EQUAL(messages.size(), 5U);
+
+  auto put16 = [](std::vector<uint8_t>& v, uint16_t x) {
+    v.push_back(x >> 8);
+    v.push_back(x & 0xff);
+  };
+  auto put32le = [](std::vector<uint8_t>& v, uint32_t x) {
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(&x);
+    v.insert(v.end(), p, p + 4);
+  };
+  auto udp = [&](uint16_t dport, const std::vector<uint8_t>& payload) {
+    std::vector<uint8_t> v;
+    put16(v, 50000); put16(v, dport); put16(v, 8 + payload.size()); put16(v, 0);
+    v.insert(v.end(), payload.begin(), payload.end());
+    return v;
+  };
+  auto ipv4 = [&](uint8_t protocol, const std::vector<uint8_t>& payload) {
+    std::vector<uint8_t> v = { 0x45, 0 };
+    put16(v, 20 + payload.size());
+    v.insert(v.end(), { 0, 0, 0x40, 0, 64, protocol, 0, 0,
+                        192, 0, 2, 1, 192, 0, 2, 2 });
+    v.insert(v.end(), payload.begin(), payload.end());
+    return v;
+  };
+
+  /* A pcap file with VLAN-tagged Ethernet frames, including a TCP
+   * segment and a datagram to another port, 10 ms apart. */
+  std::vector<uint8_t> pcap;
+  put32le(pcap, 0xa1b2c3d4);
+  put32le(pcap, 0x00040002);
+  put32le(pcap, 0); put32le(pcap, 0); put32le(pcap, 65535); put32le(pcap, 1);
+  unsigned int n_packets = 0;
+  auto ethernet = [&](const std::vector<uint8_t>& ip) {
+    std::vector<uint8_t> frame(12, 0x02);
+    put16(frame, 0x8100); put16(frame, 42); put16(frame, 0x0800);
+    frame.insert(frame.end(), ip.begin(), ip.end());
+    put32le(pcap, 1400000000); put32le(pcap, 10000*n_packets++);
+    put32le(pcap, frame.size()); put32le(pcap, frame.size());
+    pcap.insert(pcap.end(), frame.begin(), frame.end());
+  };
+  ethernet(ipv4(17, udp(4739, messages[0])));
+  ethernet(ipv4(6, std::vector<uint8_t>(20, 0)));
+  ethernet(ipv4(17, udp(53, std::vector<uint8_t>(12, 0))));
+  ethernet(ipv4(17, udp(4739, messages[1])));
+  ethernet(ipv4(17, udp(4739, messages[2])));
+
+  /* Collects octetDeltaCount and adds it up. */
+  struct CountingCollector : public RoundTripCollector {
+    CountingCollector(const InfoElement* odc) : sum(0) {
+      add_template()->register_placement(odc, &octet_delta_count, 0);
+      on_record = [this](const PlacementTemplate*) {
+        sum += octet_delta_count;
+      };
+    }
+
+    uint64_t sum;
+    uint64_t octet_delta_count;
+  };
+
+  const char* pcap_filename = "replay.pcap";
+  {
+    std::ofstream f(pcap_filename, std::ios::binary);
+    f.write(reinterpret_cast<const char*>(pcap.data()), pcap.size());
+  }
+
+  {
+    PcapInputSource is(open(pcap_filename, O_RDONLY), pcap_filename, 4739);
+    is.set_speed(1.0);
+    CountingCollector c(odc);
+    auto start = std::chrono::steady_clock::now();
+    c.collect_checked(is);
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    BOOST_CHECK_EQUAL(c.n_records, 300U);
+    BOOST_CHECK_EQUAL(c.sum, 299U*300/2);
+    BOOST_CHECK_EQUAL(is.get_datagram_count(), 3U);
+    BOOST_CHECK_EQUAL(is.get_skipped_count(), 2U);
+    BOOST_CHECK(elapsed >= std::chrono::milliseconds(30));
+    BOOST_CHECK_EQUAL(is.get_capture_time(),
+                      1400000000ULL*1000000000 + 40000000);
+
+    BOOST_REQUIRE_EQUAL(is.get_source_length(), sizeof(sockaddr_in));
+    const sockaddr_in* sin
+      = reinterpret_cast<const sockaddr_in*>(is.get_source());
+    BOOST_CHECK_EQUAL(sin->sin_family, AF_INET);
+    BOOST_CHECK_EQUAL(ntohl(sin->sin_addr.s_addr), 0xc0000201U);
+    BOOST_CHECK_EQUAL(ntohs(sin->sin_port), 50000U);
+  }
+
+  /* A pcapng file with raw IPv6 packets and nanosecond timestamps. */
+  std::vector<uint8_t> pcapng;
+  put32le(pcapng, 0x0a0d0d0a); put32le(pcapng, 28);
+  put32le(pcapng, 0x1a2b3c4d); put32le(pcapng, 1);
+  put32le(pcapng, 0xffffffff); put32le(pcapng, 0xffffffff);
+  put32le(pcapng, 28);
+  put32le(pcapng, 1); put32le(pcapng, 32);
+  put32le(pcapng, 101); put32le(pcapng, 65535);
+  put32le(pcapng, 0x00010009); put32le(pcapng, 9); put32le(pcapng, 0);
+  put32le(pcapng, 32);
+  for (unsigned int i = 0; i < messages.size(); i++) {
+    std::vector<uint8_t> payload = udp(4739, messages[i]);
+    std::vector<uint8_t> ip = { 0x60, 0, 0, 0 };
+    put16(ip, payload.size());
+    ip.push_back(17);
+    ip.push_back(64);
+    for (unsigned int j = 0; j < 32; j++)
+      ip.push_back(j < 15 || (j >= 16 && j < 31) ? 0 : 1 + j/16);
+    ip.insert(ip.end(), payload.begin(), payload.end());
+    size_t padded = (ip.size() + 3)/4*4;
+    uint64_t ns = 1400000000ULL*1000000000 + i;
+    put32le(pcapng, 6); put32le(pcapng, 32 + padded);
+    put32le(pcapng, 0); put32le(pcapng, ns >> 32); put32le(pcapng, ns);
+    put32le(pcapng, ip.size()); put32le(pcapng, ip.size());
+    pcapng.insert(pcapng.end(), ip.begin(), ip.end());
+    pcapng.resize(pcapng.size() + padded - ip.size(), 0);
+    put32le(pcapng, 32 + padded);
+  }
+
+  const char* pcapng_filename = "replay.pcapng";
+  {
+    std::ofstream f(pcapng_filename, std::ios::binary);
+    f.write(reinterpret_cast<const char*>(pcapng.data()), pcapng.size());
+  }
+
+  {
+    PcapInputSource is(open(pcapng_filename, O_RDONLY), pcapng_filename);
+    CountingCollector c(odc);
+    c.collect_checked(is);
+    BOOST_CHECK_EQUAL(c.n_records, 500U);
+    BOOST_CHECK_EQUAL(c.sum, 499U*500/2);
+    BOOST_CHECK_EQUAL(is.get_datagram_count(), 5U);
+    BOOST_CHECK_EQUAL(is.get_capture_time(),
+                      1400000000ULL*1000000000 + 4);
+    BOOST_REQUIRE_EQUAL(is.get_source_length(), sizeof(sockaddr_in6));
+    const sockaddr_in6* sin6
+      = reinterpret_cast<const sockaddr_in6*>(is.get_source());
+    BOOST_CHECK_EQUAL(sin6->sin6_family, AF_INET6);
+    BOOST_CHECK_EQUAL(sin6->sin6_addr.s6_addr[15], 1);
+    BOOST_CHECK(std::string(is.get_name()).find("source=::1,50000")
+                != std::string::npos);
+  }
+
+  /* Timestamp resolutions of 10^20 and 2^64 ticks per second don't
+   * fit into 64 bits. */
+  for (uint8_t resolution : { 20, 0x80 | 64 }) {
+    pcapng[48] = resolution;
+    {
+      std::ofstream f(pcapng_filename, std::ios::binary);
+      f.write(reinterpret_cast<const char*>(pcapng.data()), pcapng.size());
+    }
+    uint8_t buf[kMaxMessageLen];
+    PcapInputSource is(open(pcapng_filename, O_RDONLY), pcapng_filename);
+    BOOST_CHECK_THROW(is.read(buf, sizeof(buf)), FormatError);
+  }
+
+  BOOST_CHECK_THROW(PcapInputSource is(open("pcap-messages.ipfix", O_RDONLY),
+                                       "pcap-messages.ipfix"),
+                    FormatError);
+
+  BOOST_CHECK_EQUAL(unlink("pcap-messages.ipfix"), 0);
+  BOOST_CHECK_EQUAL(unlink(pcap_filename), 0);
+  BOOST_CHECK_EQUAL(unlink(pcapng_filename), 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
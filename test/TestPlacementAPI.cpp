@@ -25,7 +25,11 @@
  * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE
  */
 
+#include <memory>
+#include <vector>
+
 #include <fcntl.h>
+#include <unistd.h>
 
 #define BOOST_TEST_DYN_LINK
 #include <boost/test/test_tools.hpp>
@@ -38,13 +42,18 @@
 #  define LOG4CPLUS_DEBUG(logger, expr)
 #endif /* defined(_libfc_HAVE_LOG4CPLUS_) */
 
+#include "BasicOctetArray.h"
 #include "BufferInputSource.h"
 #include "PlacementContentHandler.h"
 #include "FileInputSource.h"
 #include "IPFIXMessageStreamParser.h"
 #include "InfoModel.h"
 #include "PlacementCollector.h"
+#include "PlacementExporter.h"
+#include "TestRoundTrip.h"
+#include "WandioInputSource.h"
 
+#include "exceptions/ExportError.h"
 #include "exceptions/FormatError.h"
 
 using namespace libfc;
@@ -121,4 +130,254 @@ BOOST_AUTO_TEST_CASE(FileDataSet) {
   }
 }
 
+BOOST_AUTO_TEST_CASE(ReducedLengthRoundTrip) {
+  const char* filename = "reduced-length-round-trip.ipfix";
+  const unsigned int n_records = 5000;
+
+  const InfoElement* odc = InfoModel::instance().lookupIE("octetDeltaCount");
+  const InfoElement* bsan
+    = InfoModel::instance().lookupIE("bgpSourceAsNumber");
+  const InfoElement* sp
+    = InfoModel::instance().lookupIE("samplingProbability");
+  BOOST_REQUIRE(odc != 0);
+  BOOST_REQUIRE(bsan != 0);
+  BOOST_REQUIRE(sp != 0);
+
+  /* Small values first, then a stretch of values that need the full
+   * width, then small values again, so that the encoder has to widen
+   * and narrow. */
+  struct Values {
+    static uint64_t octets(unsigned int i) {
+      return i >= 2000 && i < 2500 ? (1ULL << 40) + i : i % 1000;
+    }
+    static double probability(unsigned int i) {
+      return i % 2 == 0 ? 0.5 : 0.25;
+    }
+  };
+
+  off_t sizes[2];
+  for (unsigned int reduced = 0; reduced < 2; reduced++) {
+    sizes[reduced] = export_file(filename, 1, [&](PlacementExporter& e) {
+      uint64_t octet_delta_count;
+      uint32_t bgp_source_as_number;
+      double sampling_probability;
+
+      PlacementTemplate out_template;
+      out_template.register_placement(odc, &octet_delta_count, 0);
+      out_template.register_placement(bsan, &bgp_source_as_number, 0);
+      out_template.register_placement(sp, &sampling_probability, 0);
+
+      if (reduced)
+        e.set_reduced_length_encoding(100);
+
+      for (unsigned int i = 0; i < n_records; i++) {
+        octet_delta_count = Values::octets(i);
+        bgp_source_as_number = 64512 + i % 100;
+        sampling_probability = Values::probability(i);
+        e.place_values(&out_template);
+      }
+
+      e.flush();
+    });
+  }
+
+  /* 8+4+8 octets per record become at most 2+2+4 for most records. */
+  BOOST_CHECK_LT(sizes[1], sizes[0] / 2);
+
+  uint64_t octet_delta_count;
+  uint32_t bgp_source_as_number;
+  double sampling_probability;
+  unsigned int n_mismatches = 0;
+
+  RoundTripCollector cb;
+  PlacementTemplate* in_template = cb.add_template();
+  in_template->register_placement(odc, &octet_delta_count, 0);
+  in_template->register_placement(bsan, &bgp_source_as_number, 0);
+  in_template->register_placement(sp, &sampling_probability, 0);
+  cb.on_record = [&](const PlacementTemplate*) {
+    if (octet_delta_count != Values::octets(cb.n_records)
+        || bgp_source_as_number != 64512 + cb.n_records % 100
+        || sampling_probability != Values::probability(cb.n_records))
+      n_mismatches++;
+  };
+
+  cb.collect_file(filename);
+  (void) unlink(filename);
+
+  BOOST_CHECK_EQUAL(cb.n_records, n_records);
+  BOOST_CHECK_EQUAL(n_mismatches, 0U);
+}
+
+BOOST_AUTO_TEST_CASE(ReducedLengthVariants) {
+  const char* filename = "reduced-length-variants.ipfix";
+  const unsigned int n_fields = 3;
+  const unsigned int n_records = 640;
+
+  InfoModel& model = InfoModel::instance();
+  const InfoElement* ies[n_fields] = {
+    model.lookupIE("octetDeltaCount"),
+    model.lookupIE("packetDeltaCount"),
+    model.lookupIE("octetTotalCount"),
+  };
+
+  /* Field j needs 1, 2, 4 and 8 octets in turn, changing every 4^j
+   * records, so that all 64 combinations of sizes come up again and
+   * again.  With a sample window of one record, each of them would
+   * be a template of its own if fields were narrowed forever. */
+  struct Values {
+    static uint64_t value(unsigned int i, unsigned int j) {
+      static const uint64_t v[] = {
+        0x12, 0x1234, 0x12345678, 0x123456789aULL
+      };
+      return v[(i >> (2*j)) % 4];
+    }
+  };
+
+  export_file(filename, 1, [&](PlacementExporter& e) {
+    uint64_t values[n_fields];
+    PlacementTemplate out_template;
+    for (unsigned int j = 0; j < n_fields; j++)
+      out_template.register_placement(ies[j], &values[j], 0);
+
+    e.set_reduced_length_encoding(1);
+    for (unsigned int i = 0; i < n_records; i++) {
+      for (unsigned int j = 0; j < n_fields; j++)
+        values[j] = Values::value(i, j);
+      e.place_values(&out_template);
+    }
+
+    e.flush();
+  });
+
+  uint64_t values[n_fields];
+  unsigned int n_mismatches = 0;
+
+  RoundTripCollector cb;
+  cb.set_statistics_enabled(true);
+  PlacementTemplate* in_template = cb.add_template();
+  for (unsigned int j = 0; j < n_fields; j++)
+    in_template->register_placement(ies[j], &values[j], 0);
+  cb.on_record = [&](const PlacementTemplate*) {
+    for (unsigned int j = 0; j < n_fields; j++)
+      if (values[j] != Values::value(cb.n_records, j))
+        n_mismatches++;
+  };
+
+  cb.collect_file(filename);
+  (void) unlink(filename);
+
+  BOOST_CHECK_EQUAL(cb.n_records, n_records);
+  BOOST_CHECK_EQUAL(n_mismatches, 0U);
+  /* 16 variants, and then at most three widenings per field. */
+  BOOST_CHECK_LE(cb.get_statistics().templates.size(), 16U + 3*n_fields);
+}
+
+BOOST_AUTO_TEST_CASE(TemplateIdExhaustion) {
+  const char* filename = "template-id-exhaustion.ipfix";
+  const InfoElement* odc = InfoModel::instance().lookupIE("octetDeltaCount");
+  BOOST_REQUIRE(odc != 0);
+
+  uint64_t octet_delta_count = 1;
+  std::vector<std::unique_ptr<PlacementTemplate> > templates;
+
+  export_file(filename, 1, [&](PlacementExporter& e) {
+    /* Template IDs 256 to 65535 are free for the taking. */
+    for (unsigned int id = 256; id <= UINT16_MAX; id++) {
+      templates.emplace_back(new PlacementTemplate());
+      templates.back()->register_placement(odc, &octet_delta_count, 0);
+      e.place_values(templates.back().get());
+    }
+    BOOST_CHECK_EQUAL(templates.back()->get_template_id(), UINT16_MAX);
+
+    PlacementTemplate one_too_many;
+    one_too_many.register_placement(odc, &octet_delta_count, 0);
+    BOOST_CHECK_THROW(e.place_values(&one_too_many), ExportError);
+
+    /* Templates that have an ID can still be used. */
+    e.place_values(templates.front().get());
+    e.flush();
+  });
+  (void) unlink(filename);
+}
+
+BOOST_AUTO_TEST_CASE(V9RoundTrip) {
+  const char* filename = "v9-round-trip.nf";
+  const unsigned int n_records = 20000;
+  const uint32_t export_time = 1400000000;
+
+  const InfoElement* odc = InfoModel::instance().lookupIE("octetDeltaCount");
+  const InfoElement* sp
+    = InfoModel::instance().lookupIE("sourceTransportPort");
+  const InfoElement* ifn = InfoModel::instance().lookupIE("interfaceName");
+  BOOST_REQUIRE(odc != 0);
+  BOOST_REQUIRE(sp != 0);
+  BOOST_REQUIRE(ifn != 0);
+
+  export_file(filename, 7, [&](PlacementExporter& e) {
+    uint64_t octet_delta_count;
+    uint16_t source_transport_port;
+    BasicOctetArray interface_name;
+
+    PlacementTemplate out_template;
+    out_template.register_placement(odc, &octet_delta_count, 0);
+    out_template.register_placement(sp, &source_transport_port, 0);
+
+    PlacementTemplate varlen_template;
+    varlen_template.register_placement(ifn, &interface_name, 0);
+
+    e.set_protocol_version(kV9Version);
+    e.set_export_time(export_time);
+    e.set_template_refresh(2);
+
+    BOOST_CHECK_THROW(e.place_values(&varlen_template), ExportError);
+
+    for (unsigned int i = 0; i < n_records; i++) {
+      octet_delta_count = i * 1000ULL;
+      source_transport_port = i % 65536;
+      e.place_values(&out_template);
+    }
+
+    BOOST_CHECK_THROW(e.set_protocol_version(kIpfixVersion), ExportError);
+
+    e.flush();
+  });
+
+  /* The first packet has the fixed export time, a record count that
+   * includes the template, and the template set ID of v9. */
+  int fd = open(filename, O_RDONLY);
+  BOOST_REQUIRE(fd >= 0);
+  uint8_t header[kV9MessageHeaderLen + kV9SetHeaderLen];
+  BOOST_REQUIRE_EQUAL(read(fd, header, sizeof(header)),
+                      static_cast<ssize_t>(sizeof(header)));
+  BOOST_CHECK_EQUAL((header[0] << 8) | header[1], 9);
+  BOOST_CHECK_EQUAL((header[8] << 24) | (header[9] << 16)
+                    | (header[10] << 8) | header[11], export_time);
+  BOOST_CHECK_EQUAL((header[20] << 8) | header[21], kV9TemplateSetID);
+  (void) close(fd);
+
+  uint64_t octet_delta_count;
+  uint16_t source_transport_port;
+  unsigned int n_mismatches = 0;
+
+  RoundTripCollector cb(PlacementCollector::netflowv9);
+  PlacementTemplate* in_template = cb.add_template();
+  in_template->register_placement(odc, &octet_delta_count, 0);
+  in_template->register_placement(sp, &source_transport_port, 0);
+  cb.on_record = [&](const PlacementTemplate*) {
+    if (octet_delta_count != cb.n_records * 1000ULL
+        || source_transport_port != cb.n_records % 65536)
+      n_mismatches++;
+  };
+
+  /* V9 needs an input source that can peek. */
+  {
+    WandioInputSource is(filename);
+    cb.collect_checked(is);
+  }
+  (void) unlink(filename);
+
+  BOOST_CHECK_EQUAL(cb.n_records, n_records);
+  BOOST_CHECK_EQUAL(n_mismatches, 0U);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,150 @@
+/* Copyright (c) 2011-2014 ETH Zürich. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ *    * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *    * Neither the name of ETH Zürich, nor the names of its contributors 
+ *      may be used to endorse or promote products derived from this software 
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL ETH 
+ * ZURICH BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, 
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, 
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR 
+ * PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER 
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR 
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF 
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE
+ */
+
+#include <sstream>
+#include <string>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/test_tools.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include "BasicOctetArray.h"
+#include "FileExportDestination.h"
+#include "InfoModel.h"
+#include "PlacementExporter.h"
+#include "RecordDeduplicator.h"
+#include "TestRoundTrip.h"
+
+using namespace libfc;
+
+BOOST_AUTO_TEST_SUITE(Duplicates)
+
+BOOST_AUTO_TEST_CASE(Deduplication) {
+  const char* filename = "deduplication.ipfix";
+  const unsigned int n_records = 1000;
+
+  const InfoElement* odc = InfoModel::instance().lookupIE("octetDeltaCount");
+  const InfoElement* sp
+    = InfoModel::instance().lookupIE("sourceTransportPort");
+  const InfoElement* ifn = InfoModel::instance().lookupIE("interfaceName");
+  const InfoElement* prob
+    = InfoModel::instance().lookupIE("samplingProbability");
+  BOOST_REQUIRE(odc != 0);
+  BOOST_REQUIRE(sp != 0);
+  BOOST_REQUIRE(ifn != 0);
+  BOOST_REQUIRE(prob != 0);
+
+  /* Two exporters of a redundant pair send the same records, one of
+   * them with reduced-length encoding and different ports.  Reduced
+   * length sends samplingProbability as float32. */
+  int fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  BOOST_REQUIRE(fd >= 0);
+  for (uint32_t domain = 1; domain <= 2; domain++) {
+    uint64_t octet_delta_count;
+    uint16_t source_transport_port;
+    BasicOctetArray interface_name;
+    double sampling_probability;
+
+    PlacementTemplate out_template;
+    out_template.register_placement(odc, &octet_delta_count, 0);
+    out_template.register_placement(sp, &source_transport_port, 0);
+    out_template.register_placement(ifn, &interface_name, 0);
+    out_template.register_placement(prob, &sampling_probability, 0);
+
+    FileExportDestination d(fd);
+    PlacementExporter e(d, domain);
+    if (domain == 2)
+      e.set_reduced_length_encoding(16);
+
+    for (unsigned int i = 0; i < n_records; i++) {
+      std::string name = "eth" + std::to_string(i % 4);
+      interface_name.copy_content(
+        reinterpret_cast<const uint8_t*>(name.data()), name.size());
+      octet_delta_count = i;
+      source_transport_port = domain;
+      sampling_probability = 1.0/(1 << (i % 8));
+      e.place_values(&out_template);
+    }
+    e.flush();
+  }
+  BOOST_REQUIRE(close(fd) == 0);
+
+  RecordDeduplicator dedup(60000, 4096);
+  dedup.add_key(odc);
+  dedup.add_key(ifn);
+  dedup.add_key(prob);
+
+  uint64_t octet_delta_count;
+  uint16_t source_transport_port;
+  BasicOctetArray interface_name;
+  double sampling_probability;
+
+  RoundTripCollector cb;
+  cb.set_statistics_enabled(true);
+  PlacementTemplate* in_template = cb.add_template();
+  in_template->register_placement(odc, &octet_delta_count, 0);
+  in_template->register_placement(sp, &source_transport_port, 0);
+  in_template->register_placement(ifn, &interface_name, 0);
+  in_template->register_placement(prob, &sampling_probability, 0);
+  in_template->set_deduplicator(&dedup);
+  cb.on_record = [&](const PlacementTemplate*) {
+    BOOST_CHECK_EQUAL(source_transport_port, 1);
+  };
+
+  cb.collect_file(filename);
+  (void) unlink(filename);
+
+  BOOST_CHECK_EQUAL(cb.n_records, n_records);
+  BOOST_CHECK_EQUAL(dedup.get_hits(), n_records);
+  BOOST_CHECK_EQUAL(dedup.get_misses(), n_records);
+  BOOST_CHECK_EQUAL(dedup.get_overflows(), 0U);
+
+  TemplateStatistics total = cb.get_statistics().total();
+  BOOST_CHECK_EQUAL(total.records, n_records);
+  BOOST_CHECK_EQUAL(total.duplicate_records, n_records);
+
+  std::ostringstream metrics;
+  dedup.write_prometheus(metrics);
+  BOOST_CHECK(metrics.str().find("libfc_dedup_hits_total 1000\n")
+              != std::string::npos);
+
+  /* Fingerprints are forgotten after the window, and a full
+   * generation is rotated early. */
+  RecordDeduplicator window(300, 64);
+  BOOST_CHECK(!window.check(42, 1000));
+  BOOST_CHECK(window.check(42, 1200));
+  BOOST_CHECK(window.check(42, 1299));
+  BOOST_CHECK(!window.check(42, 1500));
+  for (uint64_t fp = 1; fp <= 200; fp++)
+    window.check(1000 + fp, 1500);
+  BOOST_CHECK(window.get_overflows() > 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
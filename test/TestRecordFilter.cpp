@@ -0,0 +1,140 @@
+/* Copyright (c) 2011-2014 ETH Zürich. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ *    * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *    * Neither the name of ETH Zürich, nor the names of its contributors 
+ *      may be used to endorse or promote products derived from this software 
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL ETH 
+ * ZURICH BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, 
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, 
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR 
+ * PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER 
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR 
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF 
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE
+ */
+
+#include <set>
+#include <string>
+
+#include <unistd.h>
+
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/test_tools.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include "BasicOctetArray.h"
+#include "InfoModel.h"
+#include "RecordFilter.h"
+#include "TestRoundTrip.h"
+
+using namespace libfc;
+
+BOOST_AUTO_TEST_SUITE(Filtering)
+
+BOOST_AUTO_TEST_CASE(FilteredRoundTrip) {
+  const char* filename = "filtered-round-trip.ipfix";
+  const unsigned int n_records = 10000;
+
+  InfoModel& model = InfoModel::instance();
+  const InfoElement* sipv4a = model.lookupIE("sourceIPv4Address");
+  const InfoElement* dtp = model.lookupIE("destinationTransportPort");
+  const InfoElement* odc = model.lookupIE("octetDeltaCount");
+  const InfoElement* ol = model.lookupIE("observationLabel");
+  BOOST_REQUIRE(sipv4a != 0);
+  BOOST_REQUIRE(dtp != 0);
+  BOOST_REQUIRE(odc != 0);
+  BOOST_REQUIRE(ol != 0);
+
+  struct Values {
+    static uint32_t address(unsigned int i) {
+      return i % 3 == 0 ? 0xc0a80000 + i : 0x0a000000 + i;
+    }
+    static uint16_t port(unsigned int i) {
+      return i % 7 == 0 ? 443 : (i % 5 == 0 ? 80 : 1024 + i % 1000);
+    }
+    static uint64_t octets(unsigned int i) {
+      return i % 200;
+    }
+    static bool accepted(unsigned int i) {
+      return (address(i) >> 24) == 10
+        && (port(i) == 80 || port(i) == 443)
+        && octets(i) >= 100;
+    }
+  };
+
+  export_file(filename, 1, [&](PlacementExporter& e) {
+    uint32_t source_ipv4_address;
+    uint16_t destination_transport_port;
+    uint64_t octet_delta_count;
+    BasicOctetArray observation_label;
+
+    /* The varlen field in the middle means that the filter has to
+     * walk records to find the fields after it. */
+    PlacementTemplate out_template;
+    out_template.register_placement(sipv4a, &source_ipv4_address, 0);
+    out_template.register_placement(ol, &observation_label, 0);
+    out_template.register_placement(dtp, &destination_transport_port, 0);
+    out_template.register_placement(odc, &octet_delta_count, 0);
+
+    for (unsigned int i = 0; i < n_records; i++) {
+      std::string label(i % 20, 'x');
+      source_ipv4_address = Values::address(i);
+      observation_label.copy_content(
+        reinterpret_cast<const uint8_t*>(label.data()), label.size());
+      destination_transport_port = Values::port(i);
+      octet_delta_count = Values::octets(i);
+      e.place_values(&out_template);
+    }
+
+    e.flush();
+  });
+
+  uint64_t octet_delta_count;
+  unsigned int n_wrong = 0;
+
+  RoundTripCollector cb;
+  PlacementTemplate* in_template = cb.add_template();
+  in_template->register_placement(odc, &octet_delta_count, 0);
+
+  static const uint8_t net10[] = { 10, 0, 0, 0 };
+  std::set<uint64_t> web_ports;
+  web_ports.insert(80);
+  web_ports.insert(443);
+
+  /* Filter on two IEs that are not placed. */
+  BOOST_CHECK(in_template->filter().add_prefix(sipv4a, net10, 8));
+  BOOST_CHECK(in_template->filter().add_set(dtp, web_ports));
+  BOOST_CHECK(in_template->filter().add_comparison(
+                odc, RecordFilter::ge, 100));
+
+  cb.on_record = [&](const PlacementTemplate*) {
+    if (octet_delta_count < 100)
+      n_wrong++;
+  };
+
+  cb.collect_file(filename);
+  (void) unlink(filename);
+
+  unsigned int n_expected = 0;
+  for (unsigned int i = 0; i < n_records; i++)
+    if (Values::accepted(i))
+      n_expected++;
+
+  BOOST_CHECK(n_expected > 0);
+  BOOST_CHECK_EQUAL(cb.n_records, n_expected);
+  BOOST_CHECK_EQUAL(n_wrong, 0U);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,130 @@
+/* Copyright (c) 2011-2014 ETH Zürich. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ *    * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *    * Neither the name of ETH Zürich, nor the names of its contributors 
+ *      may be used to endorse or promote products derived from this software 
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL ETH 
+ * ZURICH BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, 
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, 
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR 
+ * PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER 
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR 
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF 
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE
+ */
+
+#include <cstring>
+#include <set>
+#include <vector>
+
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/test_tools.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include "InfoModel.h"
+#include "RecordSketches.h"
+
+#include "exceptions/IESpecError.h"
+
+using namespace libfc;
+
+BOOST_AUTO_TEST_SUITE(Sketching)
+
+BOOST_AUTO_TEST_CASE(Sketches) {
+  InfoModel& model = InfoModel::instance();
+  const InfoElement* sip = model.lookupIE("sourceIPv4Address");
+  const InfoElement* dp = model.lookupIE("destinationTransportPort");
+  const InfoElement* odc = model.lookupIE("octetDeltaCount");
+
+  RecordSketches sketches;
+  size_t by_source = sketches.add_sketch({ sip }, odc, 16);
+  size_t by_port = sketches.add_sketch({ sip, dp });
+  BOOST_CHECK_THROW(sketches.add_sketch({ model.lookupIE("interfaceName") }),
+                    IESpecError);
+
+  const PlacementTemplate* tmpl = sketches.get_input_template();
+  void* p_sip;
+  void* p_dp;
+  void* p_odc;
+  BOOST_REQUIRE(tmpl->lookup_placement(sip, &p_sip, 0));
+  BOOST_REQUIRE(tmpl->lookup_placement(dp, &p_dp, 0));
+  BOOST_REQUIRE(tmpl->lookup_placement(odc, &p_odc, 0));
+
+  /* 10000 sources with one small record each, and three heavy
+   * hitters. */
+  const uint32_t heavy[] = { 0xc0a80001, 0xc0a80002, 0xc0a80003 };
+  for (unsigned int i = 0; i < 10000; i++) {
+    *static_cast<uint32_t*>(p_sip) = 0x0a000000 + i;
+    *static_cast<uint16_t*>(p_dp) = 80;
+    *static_cast<uint64_t*>(p_odc) = 100;
+    sketches.add_record();
+    if (i % 10 == 0) {
+      *static_cast<uint32_t*>(p_sip) = heavy[i % 3];
+      *static_cast<uint16_t*>(p_dp) = 443;
+      *static_cast<uint64_t*>(p_odc) = 10000;
+      sketches.add_record();
+    }
+  }
+  BOOST_CHECK_EQUAL(sketches.get_record_count(), 11000U);
+
+  const KeySketch& sources = sketches.get_sketch(by_source);
+  BOOST_CHECK_EQUAL(sources.total(), 10000U*100 + 1000U*10000);
+  BOOST_CHECK_CLOSE(sources.distinct(), 10003.0, 5.0);
+
+  std::vector<SpaceSaving::Entry> top = sources.top(3);
+  BOOST_REQUIRE_EQUAL(top.size(), 3U);
+  std::set<uint32_t> top_sources;
+  for (auto e = top.begin(); e != top.end(); ++e) {
+    uint32_t a;
+    BOOST_REQUIRE_EQUAL(e->key.size(), sizeof(a));
+    memcpy(&a, e->key.data(), sizeof(a));
+    top_sources.insert(a);
+    BOOST_CHECK(e->count >= 333U*10000);
+    BOOST_CHECK(e->count - e->error <= 334U*10000);
+  }
+  BOOST_CHECK(top_sources == std::set<uint32_t>(heavy, heavy + 3));
+
+  uint32_t key = heavy[0];
+  uint64_t estimate = sources.estimate(reinterpret_cast<uint8_t*>(&key));
+  BOOST_CHECK(estimate >= 334U*10000);
+  BOOST_CHECK(estimate <= 334U*10000 + sources.total()/100);
+
+  const KeySketch& ports = sketches.get_sketch(by_port);
+  BOOST_CHECK_EQUAL(ports.get_key_length(), 6U);
+  BOOST_CHECK_EQUAL(ports.total(), 11000U);
+  BOOST_CHECK_EQUAL(ports.top(1).at(0).count, 334U);
+
+  /* Rotating hands out the window and starts afresh; merging the
+   * window back in gives the union. */
+  std::vector<KeySketch> window = sketches.rotate();
+  BOOST_CHECK_EQUAL(sketches.get_record_count(), 0U);
+  BOOST_CHECK_EQUAL(sketches.get_sketch(by_source).total(), 0U);
+  BOOST_CHECK_EQUAL(sketches.get_sketch(by_source).top(1).size(), 0U);
+
+  for (unsigned int i = 0; i < 5000; i++) {
+    *static_cast<uint32_t*>(p_sip) = 0x0b000000 + i;
+    *static_cast<uint64_t*>(p_odc) = 1;
+    sketches.add_record();
+  }
+  window[by_source] += sketches.snapshot()[by_source];
+  BOOST_CHECK_CLOSE(window[by_source].distinct(), 15003.0, 5.0);
+  BOOST_CHECK_EQUAL(window[by_source].total(),
+                    10000U*100 + 1000U*10000 + 5000);
+  BOOST_CHECK_EQUAL(window[by_source].top(1).at(0).key.size(), 4U);
+  memcpy(&key, window[by_source].top(1).at(0).key.data(), sizeof(key));
+  BOOST_CHECK(key == heavy[0]);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,105 @@
+/* Copyright (c) 2011-2014 ETH Zürich. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ *    * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *    * Neither the name of ETH Zürich, nor the names of its contributors 
+ *      may be used to endorse or promote products derived from this software 
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL ETH 
+ * ZURICH BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, 
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, 
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR 
+ * PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER 
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR 
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF 
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE
+ */
+
+#include <cstdint>
+#include <vector>
+
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/test_tools.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include "Constants.h"
+#include "RecordWalker.h"
+
+using namespace libfc;
+
+BOOST_AUTO_TEST_SUITE(RecordWalking)
+
+BOOST_AUTO_TEST_CASE(FixedLength) {
+  RecordWalker w;
+  w.add_field(4);
+  w.add_field(2);
+  BOOST_CHECK(!w.has_varlen());
+  BOOST_CHECK_EQUAL(w.get_min_length(), 6U);
+
+  uint8_t buf[15] = { 0 };
+  BOOST_CHECK_EQUAL(w.count(buf, sizeof(buf)), 2U);
+  BOOST_CHECK_EQUAL(w.walk(buf, sizeof(buf)), 6U);
+  BOOST_CHECK_EQUAL(w.walk(buf, 5), 0U);
+
+  uint16_t offsets[2];
+  uint16_t sizes[2];
+  BOOST_CHECK_EQUAL(w.walk(buf, sizeof(buf), offsets, sizes), 6U);
+  BOOST_CHECK_EQUAL(offsets[1], 4U);
+  BOOST_CHECK_EQUAL(sizes[1], 2U);
+
+  BOOST_CHECK_EQUAL(RecordWalker().count(buf, sizeof(buf)), 0U);
+}
+
+BOOST_AUTO_TEST_CASE(VariableLength) {
+  RecordWalker w;
+  w.add_field(2);
+  w.add_field(kIpfixVarlen);
+  w.add_field(1);
+  BOOST_CHECK(w.has_varlen());
+  BOOST_CHECK_EQUAL(w.get_min_length(), 4U);
+
+  std::vector<uint8_t> set;
+  /* A short varlen field. */
+  set.insert(set.end(), { 0, 1, 3, 'a', 'b', 'c', 9 });
+  /* A long one, with a three-octet length prefix. */
+  set.insert(set.end(), { 0, 2, 255, 1, 0 });
+  set.insert(set.end(), 256, 'x');
+  set.push_back(9);
+  /* An empty one. */
+  set.insert(set.end(), { 0, 3, 0, 9 });
+  /* Padding. */
+  set.insert(set.end(), { 0, 0, 0 });
+
+  BOOST_CHECK_EQUAL(w.count(set.data(), set.size()), 3U);
+
+  uint16_t offsets[3];
+  uint16_t sizes[3];
+  BOOST_CHECK_EQUAL(w.walk(set.data(), set.size(), offsets, sizes), 7U);
+  BOOST_CHECK_EQUAL(offsets[1], 3U);
+  BOOST_CHECK_EQUAL(sizes[1], 3U);
+  BOOST_CHECK_EQUAL(offsets[2], 6U);
+
+  const uint8_t* second = set.data() + 7;
+  BOOST_CHECK_EQUAL(w.walk(second, set.size() - 7, offsets, sizes),
+                    2U + 3 + 256 + 1);
+  BOOST_CHECK_EQUAL(offsets[1], 5U);
+  BOOST_CHECK_EQUAL(sizes[1], 256U);
+
+  /* Records cut off in the length prefix or in the value. */
+  BOOST_CHECK_EQUAL(w.walk(second, 2), 0U);
+  BOOST_CHECK_EQUAL(w.walk(second, 4), 0U);
+  BOOST_CHECK_EQUAL(w.walk(second, 100), 0U);
+  BOOST_CHECK_EQUAL(w.count(set.data(), 7 + 100), 1U);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,270 @@
+/* Copyright (c) 2011-2014 ETH Zürich. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ *    * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *    * Neither the name of ETH Zürich, nor the names of its contributors 
+ *      may be used to endorse or promote products derived from this software 
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL ETH 
+ * ZURICH BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, 
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, 
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR 
+ * PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER 
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR 
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF 
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE
+ */
+
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/test_tools.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include "BasicOctetArray.h"
+#include "FileExportDestination.h"
+#include "FileInputSource.h"
+#include "IPFIXMessageStreamParser.h"
+#include "InfoModel.h"
+#include "PlacementExporter.h"
+#include "RelayContentHandler.h"
+#include "TestRoundTrip.h"
+
+using namespace libfc;
+
+BOOST_AUTO_TEST_SUITE(Relay)
+
+static const unsigned int n_rounds = 20;
+static const unsigned int n_records = 500;
+
+/* A file that takes only short messages, and remembers the longest
+ * message written to it. */
+class ShortMessageDestination : public FileExportDestination {
+public:
+  ShortMessageDestination(int fd, size_t max_message_size)
+    : FileExportDestination(fd), max_message_size(max_message_size),
+      n_messages(0), longest_message(0) {
+  }
+
+  ssize_t writev(const std::vector< ::iovec>& iovecs) {
+    size_t length = 0;
+    for (auto i = iovecs.begin(); i != iovecs.end(); ++i)
+      length += i->iov_len;
+    n_messages++;
+    if (length > longest_message)
+      longest_message = length;
+    return FileExportDestination::writev(iovecs);
+  }
+
+  size_t preferred_maximum_message_size() const {
+    return max_message_size;
+  }
+
+  size_t max_message_size;
+  unsigned int n_messages;
+  size_t longest_message;
+};
+
+/* Two exporters in different observation domains both use template
+ * ID 256 and write interleaved messages into one file. */
+static void write_input(const char* filename) {
+  const InfoElement* sipv4a
+    = InfoModel::instance().lookupIE("sourceIPv4Address");
+  const InfoElement* ov = InfoModel::instance().lookupIE("observationValue");
+  const InfoElement* ol = InfoModel::instance().lookupIE("observationLabel");
+  BOOST_REQUIRE(sipv4a != 0);
+  BOOST_REQUIRE(ov != 0);
+  BOOST_REQUIRE(ol != 0);
+
+  int fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  BOOST_REQUIRE(fd >= 0);
+  {
+    uint32_t source_ipv4_address;
+    uint64_t observation_value;
+    BasicOctetArray observation_label;
+
+    PlacementTemplate a_template;
+    a_template.register_placement(sipv4a, &source_ipv4_address, 0);
+    a_template.register_placement(ov, &observation_value, 0);
+
+    PlacementTemplate b_template;
+    b_template.register_placement(ov, &observation_value, 0);
+    b_template.register_placement(ol, &observation_label, 0);
+
+    FileExportDestination d(fd);
+    PlacementExporter a(d, 1);
+    PlacementExporter b(d, 2);
+
+    for (unsigned int r = 0; r < n_rounds; r++) {
+      for (unsigned int i = 0; i < n_records; i++) {
+        source_ipv4_address = 0x0a000000 + i;
+        observation_value = r * n_records + i;
+        a.place_values(&a_template);
+      }
+      a.flush();
+
+      for (unsigned int i = 0; i < n_records; i++) {
+        std::string label(i % 300, 'x');
+        observation_value = r * n_records + i;
+        observation_label.copy_content(
+          reinterpret_cast<const uint8_t*>(label.data()), label.size());
+        b.place_values(&b_template);
+      }
+      b.flush();
+    }
+  }
+  (void) close(fd);
+}
+
+/* Relays the input file into the destination, merging both domains
+ * into one, which forces the relay to remap one of the template
+ * IDs. */
+static std::shared_ptr<ErrorContext>
+relay_file(const char* filename, RelayContentHandler& relay,
+           ExportDestination& d) {
+  int in_fd = open(filename, O_RDONLY);
+  BOOST_REQUIRE(in_fd >= 0);
+
+  FileInputSource is(in_fd, filename);
+  IPFIXMessageStreamParser ir;
+
+  relay.add_destination(d);
+  relay.map_observation_domain(2, 1);
+  ir.set_content_handler(&relay);
+
+  return ir.parse(is);
+}
+
+/* Checks that the relayed file has all records of both exporters. */
+static void check_output(const char* filename) {
+  const InfoElement* sipv4a
+    = InfoModel::instance().lookupIE("sourceIPv4Address");
+  const InfoElement* ov = InfoModel::instance().lookupIE("observationValue");
+  const InfoElement* ol = InfoModel::instance().lookupIE("observationLabel");
+
+  uint32_t source_ipv4_address;
+  uint64_t observation_value;
+  BasicOctetArray observation_label;
+  unsigned int a_records = 0;
+  unsigned int b_records = 0;
+  unsigned int n_mismatches = 0;
+
+  RoundTripCollector cb;
+  PlacementTemplate* a_template = cb.add_template();
+  a_template->register_placement(sipv4a, &source_ipv4_address, 0);
+  a_template->register_placement(ov, &observation_value, 0);
+  PlacementTemplate* b_template = cb.add_template();
+  b_template->register_placement(ov, &observation_value, 0);
+  b_template->register_placement(ol, &observation_label, 0);
+  cb.on_record = [&](const PlacementTemplate* tmpl) {
+    if (tmpl == a_template) {
+      if (observation_value != a_records
+          || source_ipv4_address != 0x0a000000 + a_records % n_records)
+        n_mismatches++;
+      a_records++;
+    } else {
+      if (observation_value != b_records
+          || observation_label.get_length() != b_records % n_records % 300)
+        n_mismatches++;
+      b_records++;
+    }
+  };
+
+  cb.collect_file(filename);
+
+  BOOST_CHECK_EQUAL(a_records, n_rounds * n_records);
+  BOOST_CHECK_EQUAL(b_records, n_rounds * n_records);
+  BOOST_CHECK_EQUAL(n_mismatches, 0U);
+}
+
+BOOST_AUTO_TEST_CASE(MergeDomains) {
+  const char* in_filename = "relay-in.ipfix";
+  const char* out_filename = "relay-out.ipfix";
+
+  write_input(in_filename);
+
+  int out_fd = open(out_filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  BOOST_REQUIRE(out_fd >= 0);
+  {
+    FileExportDestination d(out_fd);
+    RelayContentHandler relay;
+
+    std::shared_ptr<ErrorContext> err = relay_file(in_filename, relay, d);
+    BOOST_CHECK(err == 0);
+    BOOST_CHECK_EQUAL(relay.get_dropped_data_sets(), 0U);
+    BOOST_CHECK_EQUAL(relay.get_sequence_number(1),
+                      2 * n_rounds * n_records);
+  }
+  (void) close(out_fd);
+
+  check_output(out_filename);
+  (void) unlink(in_filename);
+  (void) unlink(out_filename);
+}
+
+/* A destination that takes only short messages gets the input split
+ * at record boundaries. */
+BOOST_AUTO_TEST_CASE(SplitMessages) {
+  const char* in_filename = "relay-split-in.ipfix";
+  const char* out_filename = "relay-split-out.ipfix";
+
+  write_input(in_filename);
+
+  int out_fd = open(out_filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  BOOST_REQUIRE(out_fd >= 0);
+  {
+    ShortMessageDestination d(out_fd, 1400);
+    RelayContentHandler relay;
+
+    std::shared_ptr<ErrorContext> err = relay_file(in_filename, relay, d);
+    BOOST_CHECK(err == 0);
+    BOOST_CHECK_EQUAL(relay.get_dropped_data_sets(), 0U);
+    BOOST_CHECK_EQUAL(relay.get_sequence_number(1),
+                      2 * n_rounds * n_records);
+    BOOST_CHECK(d.longest_message <= 1400);
+    BOOST_CHECK(d.n_messages > 4 * n_rounds);
+  }
+  (void) close(out_fd);
+
+  check_output(out_filename);
+  (void) unlink(in_filename);
+  (void) unlink(out_filename);
+}
+
+/* A record that fits into no message is an error, not dropped. */
+BOOST_AUTO_TEST_CASE(RecordTooLong) {
+  const char* in_filename = "relay-long-in.ipfix";
+  const char* out_filename = "relay-long-out.ipfix";
+
+  write_input(in_filename);
+
+  int out_fd = open(out_filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  BOOST_REQUIRE(out_fd >= 0);
+  {
+    ShortMessageDestination d(out_fd, 200);
+    RelayContentHandler relay;
+
+    std::shared_ptr<ErrorContext> err = relay_file(in_filename, relay, d);
+    BOOST_REQUIRE(err != 0);
+    BOOST_CHECK_EQUAL(err->get_error(), Error::long_set);
+    BOOST_CHECK(d.longest_message <= 200);
+  }
+  (void) close(out_fd);
+
+  (void) unlink(in_filename);
+  (void) unlink(out_filename);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
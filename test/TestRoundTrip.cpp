@@ -0,0 +1,101 @@
+/* Copyright (c) 2011-2014 ETH Zürich. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ *    * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *    * Neither the name of ETH Zürich, nor the names of its contributors 
+ *      may be used to endorse or promote products derived from this software 
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL ETH 
+ * ZURICH BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, 
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, 
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR 
+ * PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER 
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR 
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF 
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE
+ */
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/test_tools.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include "FileExportDestination.h"
+#include "FileInputSource.h"
+#include "TestRoundTrip.h"
+
+#include "exceptions/FormatError.h"
+
+using namespace libfc;
+
+RoundTripCollector::RoundTripCollector(Protocol protocol)
+  : PlacementCollector(protocol), n_records(0) {
+}
+
+PlacementTemplate* RoundTripCollector::add_template() {
+  templates.push_back(std::unique_ptr<PlacementTemplate>(
+                        new PlacementTemplate()));
+  register_placement_template(templates.back().get());
+  return templates.back().get();
+}
+
+void RoundTripCollector::add_template(const PlacementTemplate* tmpl) {
+  register_placement_template(tmpl);
+}
+
+void RoundTripCollector::collect_checked(InputSource& is) {
+  try {
+    BOOST_CHECK(collect(is) == 0);
+  } catch (FormatError& e) {
+    BOOST_FAIL("Format error: " << e.what());
+  }
+}
+
+void RoundTripCollector::collect_file(const char* filename) {
+  int fd = open(filename, O_RDONLY);
+  BOOST_REQUIRE(fd >= 0);
+  {
+    FileInputSource is(fd, filename);
+    collect_checked(is);
+  }
+  (void) close(fd);
+}
+
+std::shared_ptr<ErrorContext>
+RoundTripCollector::start_placement(const PlacementTemplate* tmpl) {
+  libfc_RETURN_OK();
+}
+
+std::shared_ptr<ErrorContext>
+RoundTripCollector::end_placement(const PlacementTemplate* tmpl) {
+  if (on_record)
+    on_record(tmpl);
+  n_records++;
+  libfc_RETURN_OK();
+}
+
+off_t export_file(const char* filename, uint32_t domain,
+                  const std::function<void(PlacementExporter&)>& produce) {
+  int fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  BOOST_REQUIRE(fd >= 0);
+  {
+    FileExportDestination d(fd);
+    PlacementExporter e(d, domain);
+    produce(e);
+  }
+  off_t size = lseek(fd, 0, SEEK_END);
+  BOOST_REQUIRE(close(fd) == 0);
+  return size;
+}
@@ -0,0 +1,126 @@
+/* Copyright (c) 2011-2014 ETH Zürich. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ *    * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *    * Neither the name of ETH Zürich, nor the names of its contributors 
+ *      may be used to endorse or promote products derived from this software 
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL ETH 
+ * ZURICH BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, 
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, 
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR 
+ * PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER 
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR 
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF 
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE
+ */
+
+/**
+ * @file
+ * @author Stephan Neuhaus <neuhaust@tik.ee.ethz.ch>
+ *
+ * @section DESCRIPTION
+ *
+ * Helpers for tests that export records and collect them again.
+ */
+
+#ifndef _libfc_TESTROUNDTRIP_H_
+#  define _libfc_TESTROUNDTRIP_H_
+
+#  include <functional>
+#  include <memory>
+#  include <vector>
+
+#  include <sys/types.h>
+
+#  include "InputSource.h"
+#  include "PlacementCollector.h"
+#  include "PlacementExporter.h"
+#  include "PlacementTemplate.h"
+
+/** A collector that calls back the test for every record.
+ *
+ * The test registers placements on the templates made by
+ * add_template(), pointing into its own variables, and checks them in
+ * on_record.  For example:
+ *
+ * @code
+ * uint64_t octets;
+ * RoundTripCollector cb;
+ * cb.add_template()->register_placement(odc, &octets, 0);
+ * cb.on_record = [&](const PlacementTemplate*) {
+ *   BOOST_CHECK(octets < 100);
+ * };
+ * cb.collect_file(filename);
+ * BOOST_CHECK_EQUAL(cb.n_records, n_records);
+ * @endcode
+ */
+class RoundTripCollector : public libfc::PlacementCollector {
+public:
+  explicit RoundTripCollector(Protocol protocol = ipfix);
+
+  /** Makes an empty placement template and registers it.
+   *
+   * @return the template, owned by the collector
+   */
+  libfc::PlacementTemplate* add_template();
+
+  /** Registers a placement template owned by someone else.
+   *
+   * @param tmpl the template
+   */
+  void add_template(const libfc::PlacementTemplate* tmpl);
+
+  /** Collects from an input source, failing the test on any error.
+   *
+   * @param is the input source
+   */
+  void collect_checked(libfc::InputSource& is);
+
+  /** Collects from a file, failing the test on any error.
+   *
+   * @param filename the name of the file
+   */
+  void collect_file(const char* filename);
+
+  std::shared_ptr<libfc::ErrorContext>
+      start_placement(const libfc::PlacementTemplate* tmpl);
+
+  std::shared_ptr<libfc::ErrorContext>
+      end_placement(const libfc::PlacementTemplate* tmpl);
+
+  /** Called with the template of each record, if set.  While it
+   * runs, n_records is the index of the record. */
+  std::function<void(const libfc::PlacementTemplate*)> on_record;
+
+  /** The number of records collected so far. */
+  unsigned int n_records;
+
+private:
+  std::vector<std::unique_ptr<libfc::PlacementTemplate> > templates;
+};
+
+/** Exports records into a file, failing the test if it can't.
+ *
+ * @param filename the name of the file, which is truncated
+ * @param domain the observation domain
+ * @param produce places the records and flushes the exporter while
+ *   its templates are still alive
+ *
+ * @return the size of the file
+ */
+off_t export_file(const char* filename, uint32_t domain,
+                  const std::function<void(libfc::PlacementExporter&)>&
+                    produce);
+
+#endif // _libfc_TESTROUNDTRIP_H_
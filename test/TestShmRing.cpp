@@ -0,0 +1,148 @@
+/* Copyright (c) 2011-2014 ETH Zürich. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ *    * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *    * Neither the name of ETH Zürich, nor the names of its contributors 
+ *      may be used to endorse or promote products derived from this software 
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL ETH 
+ * ZURICH BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, 
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, 
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR 
+ * PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER 
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR 
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF 
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE
+ */
+
+#include <string>
+#include <thread>
+
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/test_tools.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include "BasicOctetArray.h"
+#include "InfoModel.h"
+#include "ShmRingPublisher.h"
+#include "ShmRingReader.h"
+
+#include "exceptions/ExportError.h"
+#include "exceptions/FormatError.h"
+
+using namespace libfc;
+
+BOOST_AUTO_TEST_SUITE(ShmRing)
+
+BOOST_AUTO_TEST_CASE(SharedMemoryRing) {
+  InfoModel& model = InfoModel::instance();
+  const InfoElement* sip = model.lookupIE("sourceIPv4Address");
+  const InfoElement* odc = model.lookupIE("octetDeltaCount");
+  const InfoElement* ifn = model.lookupIE("interfaceName");
+  const char* name = "/libfc-test-ring";
+
+  /* Left over from a test run that crashed, maybe. */
+  (void) ShmRingPublisher::remove(name);
+
+  BOOST_CHECK_THROW(ShmRingReader reader(name), FormatError);
+
+  ShmRingPublisher publisher(name, { sip, odc, ifn }, 64);
+  BOOST_CHECK_THROW(ShmRingPublisher(name, { sip, odc }), ExportError);
+  const PlacementTemplate* tmpl = publisher.get_input_template();
+  void* p_sip;
+  void* p_odc;
+  void* p_ifn;
+  BOOST_REQUIRE(tmpl->lookup_placement(sip, &p_sip, 0));
+  BOOST_REQUIRE(tmpl->lookup_placement(odc, &p_odc, 0));
+  BOOST_REQUIRE(tmpl->lookup_placement(ifn, &p_ifn, 0));
+
+  auto place = [&](uint32_t i) {
+    std::string s = "eth" + std::to_string(i);
+    *static_cast<uint32_t*>(p_sip) = i;
+    *static_cast<uint64_t*>(p_odc) = 3ULL*i;
+    static_cast<BasicOctetArray*>(p_ifn)->copy_content(
+      reinterpret_cast<const uint8_t*>(s.data()), s.size());
+    publisher.add_record();
+  };
+
+  ShmRingReader reader(name);
+  BOOST_REQUIRE_EQUAL(reader.get_field_count(), 3U);
+  int f_sip = reader.find_field(sip);
+  int f_odc = reader.find_field(odc);
+  int f_ifn = reader.find_field(ifn);
+  BOOST_REQUIRE(f_sip >= 0 && f_odc >= 0 && f_ifn >= 0);
+  BOOST_CHECK_EQUAL(reader.find_field(model.lookupIE("packetDeltaCount")), -1);
+  BOOST_CHECK(reader.read() == ShmRingReader::empty);
+
+  auto check = [&]() {
+    uint32_t i = *static_cast<const uint32_t*>(reader.get_value(f_sip));
+    std::string s(static_cast<const char*>(reader.get_value(f_ifn)),
+                  reader.get_length(f_ifn));
+    return *static_cast<const uint64_t*>(reader.get_value(f_odc)) == 3ULL*i
+      && s == "eth" + std::to_string(i);
+  };
+
+  for (uint32_t i = 0; i < 10; i++)
+    place(i);
+  for (uint32_t i = 0; i < 10; i++) {
+    BOOST_REQUIRE(reader.read() == ShmRingReader::ok);
+    BOOST_CHECK_EQUAL(reader.get_sequence(), i);
+    BOOST_CHECK(check());
+  }
+  BOOST_CHECK(reader.read() == ShmRingReader::empty);
+
+  /* Lapped by the publisher. */
+  for (uint32_t i = 10; i < 300; i++)
+    place(i);
+  uint64_t n_read = 0;
+  while (reader.read() == ShmRingReader::ok) {
+    BOOST_CHECK(check());
+    n_read++;
+  }
+  BOOST_CHECK(reader.get_lost_count() > 0);
+  BOOST_CHECK_EQUAL(n_read + reader.get_lost_count(), 290U);
+  BOOST_CHECK_EQUAL(reader.get_sequence(), 299U);
+
+  /* A concurrent reader sees consistent records. */
+  ShmRingReader concurrent(name);
+  bool consistent = true;
+  uint64_t n_concurrent = 0;
+  std::thread consumer([&]() {
+    for (;;) {
+      ShmRingReader::Status s = concurrent.read();
+      if (s == ShmRingReader::closed || n_concurrent
+          + concurrent.get_lost_count() == 100000)
+        break;
+      if (s == ShmRingReader::ok) {
+        uint32_t i
+          = *static_cast<const uint32_t*>(concurrent.get_value(f_sip));
+        std::string str(
+          static_cast<const char*>(concurrent.get_value(f_ifn)),
+          concurrent.get_length(f_ifn));
+        if (*static_cast<const uint64_t*>(concurrent.get_value(f_odc))
+            != 3ULL*i || str != "eth" + std::to_string(i)
+            || i != concurrent.get_sequence())
+          consistent = false;
+        n_concurrent++;
+      }
+    }
+  });
+  for (uint32_t i = 300; i < 100300; i++)
+    place(i);
+  consumer.join();
+  BOOST_CHECK(consistent);
+  BOOST_CHECK_EQUAL(n_concurrent + concurrent.get_lost_count(), 100000U);
+  BOOST_CHECK_EQUAL(publisher.get_record_count(), 100300U);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
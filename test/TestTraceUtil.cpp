@@ -0,0 +1,63 @@
+/* Copyright (c) 2011-2014 ETH Zürich. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ *    * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *    * Neither the name of ETH Zürich, nor the names of its contributors 
+ *      may be used to endorse or promote products derived from this software 
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL ETH 
+ * ZURICH BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, 
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, 
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR 
+ * PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER 
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR 
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF 
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE
+ */
+
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/test_tools.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include "trace_util.h"
+
+using namespace libfc;
+
+BOOST_AUTO_TEST_SUITE(Tracing)
+
+BOOST_AUTO_TEST_CASE(TraceSampling) {
+  BOOST_CHECK_EQUAL(get_trace_sampling(), 0U);
+
+  TraceSampler sampler;
+  unsigned int n_sampled = 0;
+  for (unsigned int i = 0; i < 1000; i++)
+    n_sampled += sampler.sample();
+  BOOST_CHECK_EQUAL(n_sampled, 0U);
+
+  set_trace_sampling(100);
+  n_sampled = 0;
+  for (unsigned int i = 0; i < 1000; i++)
+    n_sampled += sampler.sample();
+  BOOST_CHECK_EQUAL(n_sampled, 10U);
+
+  set_trace_sampling(1);
+  n_sampled = 0;
+  for (unsigned int i = 0; i < 1000; i++)
+    n_sampled += sampler.sample();
+  BOOST_CHECK_EQUAL(n_sampled, 1000U);
+
+  set_trace_sampling(0);
+  BOOST_CHECK(!sampler.sample());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
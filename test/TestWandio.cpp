@@ -0,0 +1,98 @@
+/* Copyright (c) 2011-2014 ETH Zürich. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ *    * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *    * Neither the name of ETH Zürich, nor the names of its contributors 
+ *      may be used to endorse or promote products derived from this software 
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL ETH 
+ * ZURICH BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, 
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, 
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR 
+ * PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER 
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR 
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF 
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE
+ */
+
+#include <unistd.h>
+
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/test_tools.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include "InfoModel.h"
+#include "PlacementExporter.h"
+#include "TestRoundTrip.h"
+#include "WandioExportDestination.h"
+#include "WandioInputSource.h"
+
+using namespace libfc;
+
+BOOST_AUTO_TEST_SUITE(Compression)
+
+BOOST_AUTO_TEST_CASE(CompressedRoundTrip) {
+  const char* filename = "compressed-round-trip.ipfix.gz";
+  const unsigned int n_records = 100000;
+
+  const InfoElement* sipv4a
+    = InfoModel::instance().lookupIE("sourceIPv4Address");
+  const InfoElement* ov = InfoModel::instance().lookupIE("observationValue");
+  BOOST_REQUIRE(sipv4a != 0);
+  BOOST_REQUIRE(ov != 0);
+
+  {
+    uint32_t source_ipv4_address;
+    uint64_t observation_value;
+
+    PlacementTemplate out_template;
+    out_template.register_placement(sipv4a, &source_ipv4_address, 0);
+    out_template.register_placement(ov, &observation_value, 0);
+
+    /* Small blocks, so that the compressor thread sees many of them. */
+    WandioExportDestination d(filename, WANDIO_COMPRESS_ZLIB, 1, 4096);
+    PlacementExporter e(d, 1);
+
+    for (unsigned int i = 0; i < n_records; i++) {
+      source_ipv4_address = 0x0a000000 + i;
+      observation_value = i;
+      e.place_values(&out_template);
+    }
+    BOOST_CHECK(e.flush());
+  }
+
+  uint32_t source_ipv4_address;
+  uint64_t observation_value;
+  unsigned int n_mismatches = 0;
+
+  RoundTripCollector cb;
+  PlacementTemplate* in_template = cb.add_template();
+  in_template->register_placement(sipv4a, &source_ipv4_address, 0);
+  in_template->register_placement(ov, &observation_value, 0);
+  cb.on_record = [&](const PlacementTemplate*) {
+    if (observation_value != cb.n_records
+        || source_ipv4_address != 0x0a000000 + cb.n_records)
+      n_mismatches++;
+  };
+
+  {
+    WandioInputSource is(filename);
+    cb.collect_checked(is);
+  }
+  (void) unlink(filename);
+
+  BOOST_CHECK_EQUAL(cb.n_records, n_records);
+  BOOST_CHECK_EQUAL(n_mismatches, 0U);
+}
+
+BOOST_AUTO_TEST_SUITE_END()